@@ -334,8 +334,41 @@ namespace GBVFS
 
 		VFS_Directory root;
 
-		void forLoadersAtDirectory(const char* p, std::function<bool(Loader*, const PathView&, bool readOnly)>);
+		//! A virtual path resolved to the loader that has it
+		struct ResolvedPath
+		{
+			//! Index of the loader, -1 if the path doesn't exist
+			int loader = -1;
+			Path loaderPath;
+			FileEntry entry;
+		};
+
+		//Parsed paths by the string given by the user
+		std::unordered_map<std::string, Path> internedPaths;
+
+		//Caches by canonical path, for read only mount points only
+		std::unordered_map<std::string, ResolvedPath> resolvedPaths;
+		std::unordered_map<std::string, std::map<std::string, FileEntry>> directoryListings;
+
+		//Result for the paths that aren't cached
+		ResolvedPath uncachedPath;
+
+		const Path& internPath(const char* p);
+		const ResolvedPath& resolve(const Path& p);
+		void forLoadersAtDirectory(const Path& p, std::function<bool(int loader, const Path& loaderPath, bool readOnly)>);
 	public:
+
+        //! Hit and miss counts of the caches, see getCacheStatistics
+        struct CacheStatistics
+        {
+            unsigned long pathHits = 0;
+            unsigned long pathMisses = 0;
+            unsigned long listingHits = 0;
+            unsigned long listingMisses = 0;
+        };
+
+        //! Maximum amount of parsed paths kept, the table is cleared when full
+        static const size_t InternedPathLimit = 8192;
         
         //! Flags for mount()
         enum
@@ -445,6 +478,24 @@ namespace GBVFS
         
         //! Gets a human readable description of mount() return code
         const char* getMountReturnCodeInformation(int i);
+
+        /*! \brief Get the hit and miss counts of the caches
+         * 
+         * The loader resolved for a path, and the contents of directories,
+         * are cached for the read only mount points, which only change
+         * when something is mounted. The writable mount points are always
+         * queried from the loaders.
+         */
+        const CacheStatistics& getCacheStatistics() const
+        {
+            return statistics;
+        }
+
+        //! Clear the caches, needed if the read only files are changed outside the VFS
+        void clearCache();
+
+    private:
+        CacheStatistics statistics;
 	};
 
 
@@ -514,18 +565,36 @@ namespace GBVFS
             {
                 //restrict access
                 target->isReadOnly = false;
+                clearCache();
                 return WARNING_LOADER_CONFLICTING_READ_ACCESS;
             }
         }
         else
             target->isReadOnly = readOnly;
 		target->loadersActive.push_back({loader, loadp});
+		clearCache();
 		return 0;
 	}
 
-	void VFS::forLoadersAtDirectory(const char* path, std::function<bool(Loader*, const PathView&, bool)> cb)
+	void VFS::clearCache()
+	{
+		resolvedPaths.clear();
+		directoryListings.clear();
+	}
+
+	const Path& VFS::internPath(const char* p)
+	{
+		auto it = internedPaths.find(p);
+		if (it != internedPaths.end())
+			return it->second;
+
+		if (internedPaths.size() >= InternedPathLimit)
+			internedPaths.clear();
+		return internedPaths.emplace(p, Path(p)).first->second;
+	}
+
+	void VFS::forLoadersAtDirectory(const Path& loadp, std::function<bool(int, const Path&, bool)> cb)
 	{
-		Path loadp(path);
 		VFS_Directory* target = &root;
 		size_t offset = 0;
 		for (; offset < loadp.components.size(); ++offset)
@@ -557,87 +626,116 @@ namespace GBVFS
 			Path pathp;
 			pathp.fromCStr(p.c_str(), true);
 
-			if (cb(loaders[it->first].get(), PathView(pathp), readOnly))
+			if (cb(it->first, pathp, readOnly))
 			{
 				break;
 			}
 		}
 	}
 
-	FileEntry VFS::getFileEntry(const char* path)
+	const VFS::ResolvedPath& VFS::resolve(const Path& p)
 	{
-		FileEntry f;
-		forLoadersAtDirectory(path, [&](Loader* l, const PathView& pv, bool readOnly)
+		auto it = resolvedPaths.find(p.fullPath);
+		if (it != resolvedPaths.end())
+		{
+			statistics.pathHits++;
+			return it->second;
+		}
+		statistics.pathMisses++;
+
+		ResolvedPath r;
+		bool cacheable = true;
+		forLoadersAtDirectory(p, [&](int loader, const Path& lp, bool readOnly)
 		{
-			f = l->getFileEntry(pv);
+			cacheable = readOnly;
+			FileEntry f = loaders[loader]->getFileEntry(PathView(lp));
 			if (f.exists)
 			{
+				r.loader = loader;
+				r.loaderPath = lp;
+				r.entry = f;
 				return true;
 			}
 			return false;
 		});
-		return f;
+
+		if (!cacheable)
+		{
+			uncachedPath = std::move(r);
+			return uncachedPath;
+		}
+		return resolvedPaths.emplace(p.fullPath, std::move(r)).first->second;
+	}
+
+	FileEntry VFS::getFileEntry(const char* path)
+	{
+		return resolve(internPath(path)).entry;
 	}
 	
 	std::unique_ptr<File> VFS::openFile(const char* path)
 	{
-		std::unique_ptr<File> f;
-		forLoadersAtDirectory(path, [&](Loader* l, const PathView& pv, bool)
-		{
-			f = l->openFile(pv);
-			if (f != nullptr)
-			{
-				return true;
-			}
-			return false;
-		});
-		return f;
+		const ResolvedPath& r = resolve(internPath(path));
+		if (r.loader < 0)
+			return nullptr;
+		return loaders[r.loader]->openFile(PathView(r.loaderPath));
 	}
 	
 	
 	std::unique_ptr<FileWriter> VFS::openFileWrite(const char* path)
 	{
+		const Path& p = internPath(path);
 		std::unique_ptr<FileWriter> f;
-		forLoadersAtDirectory(path, [&](Loader* l, const PathView& pv, bool readOnly)
+		forLoadersAtDirectory(p, [&](int loader, const Path& lp, bool readOnly)
 		{
             if (readOnly)
                 return false;
                 
-			f = l->openFileWrite(pv);
+			f = loaders[loader]->openFileWrite(PathView(lp));
 			if (f != nullptr)
 			{
 				return true;
 			}
 			return false;
 		});
+
+		//The file and its directory may have just been created
+		if (f)
+		{
+			resolvedPaths.erase(p.fullPath);
+			if (p.componentOffsets.size() > 1)
+				directoryListings.erase(p.fullPath.substr(0, p.componentOffsets.back() - 1));
+			else
+				directoryListings.erase("");
+		}
 		return f;
 	}
 
 	std::string VFS::getRealPath(const char* path)
 	{
-		std::string ret = path;
-		forLoadersAtDirectory(path, [&](Loader* l, const PathView& pv, bool)
-		{
-			auto f = l->getFileEntry(pv);
-			if (f.exists)
-			{
-				ret = pv.getCString();
-				return true;
-			}
-			return false;
-		});
-		return ret;
+		const ResolvedPath& r = resolve(internPath(path));
+		if (r.loader < 0)
+			return path;
+		return r.loaderPath.fullPath;
 	}
 
 	std::map<std::string, FileEntry> VFS::getDirectory(const char* path)
 	{
-		std::map<std::string, FileEntry> map;
+		const Path& p = internPath(path);
+		auto it = directoryListings.find(p.fullPath);
+		if (it != directoryListings.end())
+		{
+			statistics.listingHits++;
+			return it->second;
+		}
+		statistics.listingMisses++;
 
+		std::map<std::string, FileEntry> map;
+		bool cacheable = true;
 
-		forLoadersAtDirectory(path, [&](Loader* l, const PathView& pv, bool)
+		forLoadersAtDirectory(p, [&](int loader, const Path& lp, bool readOnly)
 		{
-			
-			l->iterateEntries(pv, [&](const char* fn, const FileEntry& entry)
+			cacheable = readOnly;
+			loaders[loader]->iterateEntries(PathView(lp), [&](const char* fn, const FileEntry& entry)
 				{
 					std::string str = std::string(fn);
 					if (map.find(str) == map.end())
@@ -645,6 +743,9 @@ namespace GBVFS
 				});
 			return false;
 		});
+
+		if (cacheable)
+			directoryListings[p.fullPath] = map;
 		return map;
 	}
 	
@@ -1,8 +1,22 @@
 #pragma once
 #include <string>
+#include <memory>
 
 namespace GBVFS
 {
+    //! Read only view of the whole contents of a file, see File::map
+    struct FileSpan
+    {
+        //! The contents, nullptr if the file can't be mapped
+        const char* data = nullptr;
+
+        //! Size of the contents in bytes
+        size_t size = 0;
+
+        //! Keeps the contents valid, shared by the spans of the same mapping
+        std::shared_ptr<const void> owner;
+    };
+
     //! File read access handle
 	class File
 	{
@@ -29,6 +43,18 @@ namespace GBVFS
         //! Close the file 
 		virtual void close() = 0;
 
+        /*! \brief Map the whole contents of the file to memory
+         * 
+         * Returns a span with no data if the file can't be mapped, in
+         * which case the contents must be read instead. The span stays
+         * valid as long as a copy of it exists, even after the file is
+         * closed.
+         */
+        virtual FileSpan map()
+        {
+            return FileSpan();
+        }
+
         //! Utility for reading a single line
         std::string readLine()
         {
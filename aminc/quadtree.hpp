@@ -90,6 +90,25 @@ public:
     unsigned int getInQuadrants(Vector a, Vector b);
 };
 
+//! Shape of a quadtree, see QuadTreeHolder::getStatistics
+struct QuadTreeStatistics
+{
+    //! Total amount of nodes, including the roots
+    unsigned int nodes = 0;
+
+    //! Amount of leaf nodes
+    unsigned int leaves = 0;
+
+    //! Deepest subdivision level found
+    unsigned int maxDepth = 0;
+
+    //! Sum of the leaf bucket sizes. An entity in multiple leaves is counted multiple times
+    unsigned int entries = 0;
+
+    //! Largest leaf bucket
+    unsigned int maxBucket = 0;
+};
+
 /*! The main quadtree organizer
  * 
  * 
@@ -128,6 +147,9 @@ public:
     //! Gets all entities within defined AABB
     void areaFind(Vector tl, Vector br, std::function<void(QuadTreeEntity<E, Vector>*)>);
 
+    //! Walks the whole tree and gathers its shape statistics
+    QuadTreeStatistics getStatistics() const;
+
     /*! \brief Initializes the quadtree collision world
 
     	The arguments define the size of the collision world.
@@ -485,6 +507,32 @@ void QuadTreeHolder<E, Vector>::areaFind(Vector tl, Vector br, std::function<voi
 
 }
 
+template <typename E, typename Vector>
+QuadTreeStatistics QuadTreeHolder<E, Vector>::getStatistics() const
+{
+    QuadTreeStatistics stats;
+    std::vector<const QuadTreeNode<E, Vector>*> stack(trees.begin(), trees.end());
+    while (!stack.empty())
+    {
+        const QuadTreeNode<E, Vector>* qn = stack.back();
+        stack.pop_back();
+
+        stats.nodes++;
+        stats.maxDepth = std::max(stats.maxDepth, qn->level);
+        if (qn->isLeaf)
+        {
+            unsigned int size = qn->contents.size();
+            stats.leaves++;
+            stats.entries += size;
+            stats.maxBucket = std::max(stats.maxBucket, size);
+            continue;
+        }
+        for (const QuadTreeNode<E, Vector>* c : qn->children)
+            stack.push_back(c);
+    }
+    return stats;
+}
+
 template <typename E, typename Vector>
 void QuadTreeHolder<E, Vector>::insert(QuadTreeEntity<E, Vector>* t)
 {
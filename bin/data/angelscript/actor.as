@@ -14,6 +14,11 @@ class EventPhysicsStep
     double dt;
 }
 
+//Sent after the collision detection of the last substep of each physics step
+class EventPhysicsStepEnd
+{
+}
+
 class EventGraphicsStep
 {
     double dt;
@@ -26,6 +31,11 @@ class EventCollideActor
     Vector2 fix;
 }
 
+class EventCollideActorEnd
+{
+    PhysicsActor@ other;
+}
+
 class EventCollideStatic
 {
     Vector2 normal;
@@ -99,6 +109,21 @@ class PhysicsActor
 
     }
 
+    //Called once when a contact with another actor begins,
+    //if CollisionContactEvents is set
+    void onCollisionBegin(PhysicsActor@ other, const Collision::ActorCollisionInfo& aci)
+    {
+        collide(other, aci);
+    }
+
+    //Called once when the contact with another actor ends
+    void onCollisionEnd(PhysicsActor@ other)
+    {
+        EventCollideActorEnd eae;
+        @eae.other = other;
+        ESM::QueueLocalEvent(entity, eae);
+    }
+
     //Called when our actor collides upon
     //the static geometry of the almighty Map
     void collideStatic(const Collision::MapCollisionInfo& mci)
@@ -141,7 +166,16 @@ enum CollisionFlags
         
         Useful when the object "teleports" from a place to another.
     */
-    CollisionStepTeleport = 32
+    CollisionStepTeleport = 32,
+
+    /*
+        Track the contacts with other actors between frames. Instead of
+        calling collide on every collision, onCollisionBegin is called
+        when a contact begins and onCollisionEnd when it ends.
+        The GameVar Collision.StayInterval can be used to additionally
+        call collide every N frames while the contact persists.
+    */
+    CollisionContactEvents = 64
 }
 
 enum CollisionType
@@ -10,6 +10,7 @@ class SpriteComponent
     Entity@ entity;
     
     Sprite sprite;
+    bool placed = false;
     
     [ComponentRef]
     PhysicsActor@ body;
@@ -20,10 +21,15 @@ class SpriteComponent
         sprite.register();
     }
     
+    //The sprite is drawn interpolated between the physics steps
     [EventHandler]
-    void updateGraphics(const EventGraphicsStep &in e)
+    void updatePosition(const EventPhysicsStepEnd &in e)
     {
-        sprite.setPosition(body.position);
+        if (placed)
+            sprite.stepPosition(body.position);
+        else
+            sprite.setPosition(body.position);
+        placed = true;
     }
     
     [DeinitHandler]
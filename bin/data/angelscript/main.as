@@ -270,18 +270,33 @@ bool MainLoop()
         
         ESM::SendEvents();
 
+        //The physics runs in fixed steps, which may be zero or several
+        //per frame. The drawables are stepped after the last substep of
+        //each full step, as they are interpolated over full steps
+        uint physicsSteps = GetPhysicsSteps();
+        uint physicsSubsteps = GetPhysicsSubsteps();
+        for (uint i = 0; i < physicsSteps; i++)
         {
-            EventPhysicsStep eps;
-            eps.dt = dt;
-            ESM::QueueGlobalEvent(eps);
-            ESM::SendEvents();
-        }
+            {
+                EventPhysicsStep eps;
+                eps.dt = GetPhysicsDeltaTime();
+                ESM::QueueGlobalEvent(eps);
+                ESM::SendEvents();
+            }
 
-        ESM::UpdateEntityLists();
-        
-        Collision::RunDetection();
+            ESM::UpdateEntityLists();
+            
+            Collision::RunDetection();
 
-        ESM::SendEvents();
+            ESM::SendEvents();
+
+            if ((i + 1) % physicsSubsteps == 0)
+            {
+                EventPhysicsStepEnd epse;
+                ESM::QueueGlobalEvent(epse);
+                ESM::SendEvents();
+            }
+        }
 
 
         {
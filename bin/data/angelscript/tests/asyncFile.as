@@ -0,0 +1,33 @@
+namespace AsyncFileTests
+{
+
+//Refer to the simple.toml at assets folder
+[Test]
+void TestReadAsync()
+{
+    Files::AsyncFile@ f = Files::ReadAsync("assets/simple.toml");
+    Assert(f !is null);
+    Assert(f.getFilename() == "assets/simple.toml");
+
+    f.wait();
+    Assert(f.isReady());
+    Assert(!f.isFailed());
+    Assert(f.getSize() > 0);
+
+    string data = f.getData();
+    Assert(data.length() == f.getSize());
+    Assert(data.findFirst("success!!1") >= 0);
+}
+
+[Test]
+void TestReadAsyncMissing()
+{
+    Files::AsyncFile@ f = Files::ReadAsync("assets/no_such_file.toml");
+    f.wait();
+    Assert(f.isReady());
+    Assert(f.isFailed());
+    Assert(f.getSize() == 0);
+    Assert(f.getData() == "");
+}
+
+}
@@ -0,0 +1,210 @@
+namespace TileCollision
+{
+
+/*
+    Testcases for the line casts against the tiles of a layer
+*/
+
+[Test]
+void TestMapLines()
+{
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(16, 16);
+    layer.fill(Vector2i(8, 0), Vector2i(9, 16), 1);
+
+    Vector2 tileSize(16, 16);
+    Vector2[] starts = {Vector2(8, 8), Vector2(200, 40), Vector2(8, 8), Vector2(20, 20)};
+    Vector2[] ends = {Vector2(200, 40), Vector2(8, 8), Vector2(100, 8), Vector2(20, 300)};
+
+    bool[] hits;
+    Vector2[] points;
+    Vector2[] normals;
+    Assert(Collision::MapLines(starts, ends, layer, tileSize, hits, points, normals) == 2);
+    Assert(hits.length() == 4);
+
+    //Hits the left and the right side of the wall
+    Assert(hits[0] && EqualsDelta(points[0].x, 128, 0.001));
+    Assert(normals[0] == Vector2(-1, 0));
+    Assert(hits[1] && EqualsDelta(points[1].x, 144, 0.001));
+    Assert(normals[1] == Vector2(1, 0));
+
+    //Ends before the wall, and leaves the layer
+    Assert(!hits[2] && points[2] == Vector2(100, 8));
+    Assert(!hits[3]);
+
+    //The same results one line at a time
+    for (uint i = 0; i < starts.length(); i++)
+    {
+        Vector2 pos, norm;
+        Assert(Collision::MapLine(starts[i], ends[i], layer, tileSize, pos, norm) == hits[i]);
+        if (hits[i])
+            Assert(pos == points[i] && norm == normals[i]);
+    }
+}
+
+}
+
+namespace ActorCollision
+{
+
+/*
+    Testcases for the collisions between the actors
+*/
+
+[Component]
+class ContactCounter
+{
+    Entity@ entity;
+    int begins = 0;
+    int ends = 0;
+
+    [EventHandler]
+    void begin(const EventCollideActor &in e)
+    {
+        begins++;
+    }
+
+    [EventHandler]
+    void end(const EventCollideActorEnd &in e)
+    {
+        ends++;
+    }
+}
+
+EntityMold@ EM_Actor = {
+    ComponentInfo<PhysicsActor>().getId()
+};
+
+EntityMold@ EM_CountedActor = {
+    ComponentInfo<PhysicsActor>().getId(),
+    ComponentInfo<ContactCounter>().getId()
+};
+
+void clear()
+{
+    ESM::UpdateEntityLists();
+    ESM::KillAllEntities();
+    ESM::UpdateEntityLists();
+    ESM::SendEvents();
+    Collision::RemoveAll();
+}
+
+PhysicsActor@ makeActor(EntityMold@ mold, Vector2 position, Vector2 size, uint flags, uint type, uint with)
+{
+    Entity@ e = ESM::ConstructEntity(mold);
+    PhysicsActor@ pa;
+    e.getComponent(@pa);
+    pa.position = position;
+    pa.size = size;
+    pa.collisionFlags = flags;
+    pa.collisionType = type;
+    pa.collisionWith = with;
+    return pa;
+}
+
+[Test]
+void TestCorner()
+{
+    clear();
+    Collision::SetWorldSize(Vector2(512, 512));
+
+    //A wall and a floor meeting at (100, 100)
+    makeActor(EM_Actor, Vector2(108, 100), Vector2(16, 200), CollisionStatic, CollisionStar, 0);
+    makeActor(EM_Actor, Vector2(58, 108), Vector2(116, 16), CollisionStatic, CollisionStar, 0);
+    PhysicsActor@ actor = makeActor(EM_Actor, Vector2(80, 80), Vector2(16, 16), 0, CollisionPlayer, CollisionStar);
+    ESM::UpdateEntityLists();
+    Collision::RunDetection();
+    Assert(actor.position == Vector2(80, 80));
+
+    //Pushed diagonally into the corner, the fix of the first wall is
+    //swept against the second one
+    actor.position = Vector2(110, 110);
+    Collision::RunDetection();
+    Assert(EqualsDelta(actor.position.x, 92, 0.001));
+    Assert(EqualsDelta(actor.position.y, 92, 0.001));
+
+    clear();
+}
+
+uint boxCallbackHits = 0;
+
+void countBoxCallback(ref @actor)
+{
+    boxCallbackHits++;
+}
+
+[Test]
+void TestUnfilteredQueries()
+{
+    clear();
+    Collision::SetWorldSize(Vector2(512, 512));
+
+    //The default collision type of an actor is 0
+    makeActor(EM_Actor, Vector2(50, 50), Vector2(8, 8), CollisionStatic, 0, 0);
+    makeActor(EM_Actor, Vector2(70, 50), Vector2(8, 8), CollisionStatic, CollisionStar, 0);
+    ESM::UpdateEntityLists();
+    Collision::RunDetection();
+
+    //The array queries find the same actors as the callback one
+    boxCallbackHits = 0;
+    Collision::Query(Vector2(60, 50), Vector2(64, 64), @countBoxCallback);
+    Assert(boxCallbackHits == 2);
+
+    ref[] found;
+    Assert(Collision::QueryBox(Vector2(60, 50), Vector2(64, 64), found) == 2);
+    Assert(found.length() == 2);
+    Assert(Collision::QueryCircle(Vector2(60, 50), 30, found) == 2);
+    Assert(Collision::QueryLine(Vector2(0, 50), Vector2(200, 50), found) == 2);
+
+    //A filter still leaves the type 0 actor out
+    Assert(Collision::QueryBox(Vector2(60, 50), Vector2(64, 64), found, CollisionStar) == 1);
+
+    clear();
+}
+
+[Test]
+void TestContactsAcrossSleep()
+{
+    clear();
+    Collision::SetWorldSize(Vector2(512, 512));
+    GameVar@ sleepFrames = GameVar::GetVar("Collision.SleepFrames");
+    int oldSleepFrames = sleepFrames.getInteger();
+    sleepFrames.set(2);
+
+    //A ghost resting inside a static area
+    makeActor(EM_Actor, Vector2(100, 100), Vector2(64, 64), CollisionStatic, CollisionStar, 0);
+    PhysicsActor@ actor = makeActor(EM_CountedActor, Vector2(100, 100), Vector2(16, 16), CollisionGhost | CollisionContactEvents, CollisionPlayer, CollisionStar);
+    ContactCounter@ counter;
+    actor.entity.getComponent(@counter);
+    ESM::UpdateEntityLists();
+
+    Collision::RunDetection();
+    ESM::SendEvents();
+    Assert(counter.begins == 1);
+
+    //Both fall asleep, and the contact lasts
+    for (int i = 0; i < 5; i++)
+    {
+        Collision::RunDetection();
+        ESM::SendEvents();
+    }
+    Assert(Collision::GetStatistics().sleepingActors == 2);
+    Assert(counter.begins == 1);
+    Assert(counter.ends == 0);
+
+    //Moved away, the contact ends once
+    actor.position = Vector2(300, 300);
+    Collision::RunDetection();
+    ESM::SendEvents();
+    Assert(counter.ends == 1);
+
+    Collision::RunDetection();
+    ESM::SendEvents();
+    Assert(counter.begins == 1);
+    Assert(counter.ends == 1);
+
+    sleepFrames.set(oldSleepFrames);
+    clear();
+}
+
+}
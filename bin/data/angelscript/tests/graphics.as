@@ -15,4 +15,99 @@ void TestCamera()
     Assert(EqualsDelta(camPos.y, newPos.y, 0.0001));
 }
 
+[Test]
+void TestMapLayerPartialUpdate()
+{
+    Map::Tileset@ tileset = Map::Tileset();
+    tileset.addDef(Hash("_clear"));
+
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(64, 64);
+    layer.setTileset(tileset);
+
+    DrawableMapLayer@ drawable = DrawableMapLayer();
+    drawable.generate(layer, Vector2(16, 16), 0.5);
+    Assert(drawable.updateTiles() == 0);
+
+    //A single tile
+    layer.set(Vector2i(3, 4), 1);
+    Assert(drawable.updateTiles() == 1);
+    Assert(drawable.getUploadedSpans() == 1);
+    Assert(drawable.updateTiles() == 0);
+
+    //Full rows are uploaded as one span
+    layer.fill(Vector2i(0, 10), Vector2i(64, 12), 1);
+    Assert(drawable.updateTiles() == 128);
+    Assert(drawable.getUploadedSpans() == 1);
+
+    //Narrow areas row by row
+    layer.fill(Vector2i(10, 20), Vector2i(14, 30), 1);
+    Assert(drawable.updateTiles() == 40);
+    Assert(drawable.getUploadedSpans() == 10);
+
+    float[] verts;
+    Assert(drawable.getTileVertices(Vector2i(12, 25), verts));
+    Assert(verts.length() == 20);
+    Assert(EqualsDelta(verts[2], 0.5, 0.0001));
+    Assert(!drawable.getTileVertices(Vector2i(64, 0), verts));
+
+    //Resizing rebuilds everything
+    layer.resize(32, 32);
+    Assert(drawable.updateTiles() == 32 * 32);
+}
+
+[Test]
+void TestSpriteBatch()
+{
+    SpriteBatch@ batch = SpriteBatch();
+
+    Sprite@ arrow = Sprite();
+    arrow.setTexture(Hash("arrow"));
+
+    //Sprites with the same texture are drawn together
+    for (int i = 0; i < 10; i++)
+        batch.add(arrow);
+    Assert(batch.getPendingInstances() == 10);
+    Assert(batch.getDrawCalls() == 0);
+
+    batch.flush();
+    Assert(batch.getPendingInstances() == 0);
+    Assert(batch.getDrawCalls() == 1);
+    Assert(batch.getInstances() == 10);
+
+    //Changing the texture flushes. The font texture is never in the atlas
+    Sprite@ font = Sprite();
+    font.setTexture(Hash("fontMainTex"));
+    batch.resetCounters();
+    batch.add(font);
+    batch.add(arrow);
+    batch.add(font);
+    batch.flush();
+    Assert(batch.getInstances() == 3);
+    Assert(batch.getDrawCalls() == 3);
+
+    //Unless the textures share an atlas page
+    Assert(AddTextureArea(Hash("test.areaA"), Hash("fontMainTex"), Vector2i(0, 0), Vector2i(8, 8)));
+    Assert(AddTextureArea(Hash("test.areaB"), Hash("fontMainTex"), Vector2i(8, 0), Vector2i(8, 8)));
+    Assert(!AddTextureArea(Hash("test.areaA"), Hash("fontMainTex"), Vector2i(0, 0), Vector2i(8, 8)));
+    Assert(!AddTextureArea(Hash("test.areaC"), Hash("test.areaA"), Vector2i(0, 0), Vector2i(4, 4)));
+
+    Sprite@ areaA = Sprite();
+    areaA.setTexture(Hash("test.areaA"));
+    Sprite@ areaB = Sprite();
+    areaB.setTexture(Hash("test.areaB"));
+    batch.resetCounters();
+    batch.add(areaA);
+    batch.add(areaB);
+    batch.add(areaA);
+    batch.flush();
+    Assert(batch.getInstances() == 3);
+    Assert(batch.getDrawCalls() == 1);
+
+    //Flushing an empty batch draws nothing
+    batch.resetCounters();
+    batch.flush();
+    Assert(batch.getDrawCalls() == 0);
+}
+
 }
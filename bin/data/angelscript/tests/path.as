@@ -0,0 +1,360 @@
+namespace Pathfinding
+{
+
+Map::Layer@ CreateWallLayer(int size)
+{
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(size, size);
+
+    //Vertical walls with a gap alternating between the top and the bottom
+    for (int x = 4; x < size - 4; x += 8)
+    {
+        if ((x / 8) % 2 == 0)
+            layer.fill(Vector2i(x, 0), Vector2i(x + 1, size - 2), 1);
+        else
+            layer.fill(Vector2i(x, 2), Vector2i(x + 1, size), 1);
+    }
+    return layer;
+}
+
+Map::Layer@ CreateRoomLayer(int size)
+{
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(size, size);
+
+    //Square rooms with a door on every wall
+    for (int i = 32; i < size; i += 32)
+    {
+        layer.fill(Vector2i(i, 0), Vector2i(i + 1, size), 1);
+        layer.fill(Vector2i(0, i), Vector2i(size, i + 1), 1);
+    }
+    for (int i = 32; i < size; i += 32)
+    for (int j = 0; j < size; j += 32)
+    {
+        layer.fill(Vector2i(i, j + 14), Vector2i(i + 1, j + 18), 0);
+        layer.fill(Vector2i(j + 14, i), Vector2i(j + 18, i + 1), 0);
+    }
+    return layer;
+}
+
+[Test]
+void TestStraightPath()
+{
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(16, 16);
+
+    Path p;
+    Assert(p.find(layer, Vector2i(1, 1), Vector2i(10, 1)));
+    Assert(p.getLength() == 2);
+    Assert(p.getPoint(0) == Vector2i(1, 1));
+    Assert(p.getPoint(1) == Vector2i(10, 1));
+    Assert(EqualsDelta(p.getCost(), 9.0, 0.001));
+}
+
+[Test]
+void TestBlockedGoal()
+{
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(16, 16);
+    layer.set(Vector2i(5, 5), 1);
+
+    Path p;
+    Assert(p.find(layer, Vector2i(1, 1), Vector2i(5, 5)) == false);
+    Assert(p.isAtEnd());
+
+    //Wall the goal in
+    layer.set(Vector2i(5, 5), 0);
+    layer.fill(Vector2i(4, 4), Vector2i(7, 5), 1);
+    layer.fill(Vector2i(4, 6), Vector2i(7, 7), 1);
+    layer.set(Vector2i(4, 5), 1);
+    layer.set(Vector2i(6, 5), 1);
+    Assert(p.find(layer, Vector2i(1, 1), Vector2i(5, 5)) == false);
+}
+
+[Test]
+void TestJumpPointsMatchAStar()
+{
+    Map::Layer@ layer = CreateWallLayer(64);
+
+    Path astar;
+    Path jps;
+    jps.setJumpPoints(true);
+
+    Assert(astar.find(layer, Vector2i(1, 1), Vector2i(62, 62)));
+    Assert(jps.find(layer, Vector2i(1, 1), Vector2i(62, 62)));
+    Assert(EqualsDelta(astar.getCost(), jps.getCost(), 0.01));
+    Assert(jps.getExpanded() < astar.getExpanded());
+
+    uint count = 0;
+    while (!jps.isAtEnd())
+    {
+        jps.advance();
+        count++;
+    }
+    Assert(count == jps.getLength());
+}
+
+[Test]
+void TestJumpPointsMatchAStarRandom()
+{
+    RandomGenerator rng;
+    rng.seed(1234);
+
+    //Scattered walls, blocking about a third of the cells
+    const uint size = 48;
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(int(size), int(size));
+    for (uint y = 0; y < size; y++)
+    for (uint x = 0; x < size; x++)
+    {
+        if (rng.getD() < 0.3)
+            layer.set(Vector2i(int(x), int(y)), 1);
+    }
+
+    Path astar;
+    Path jps;
+    jps.setJumpPoints(true);
+
+    uint found = 0;
+    for (int i = 0; i < 32; i++)
+    {
+        Vector2i start(int(rng.getU() % size), int(rng.getU() % size));
+        Vector2i goal(int(rng.getU() % size), int(rng.getU() % size));
+        layer.set(start, 0);
+        layer.set(goal, 0);
+
+        bool a = astar.find(layer, start, goal);
+        Assert(jps.find(layer, start, goal) == a);
+        if (!a)
+            continue;
+
+        found++;
+        Assert(EqualsDelta(astar.getCost(), jps.getCost(), 0.01));
+        Assert(jps.getPoint(0) == start);
+        Assert(jps.getPoint(jps.getLength() - 1) == goal);
+    }
+
+    //Some of the pairs must be connected for the test to mean anything
+    Assert(found > 0);
+}
+
+[Test]
+void BenchmarkPath512()
+{
+    Map::Layer@ layer = CreateWallLayer(512);
+
+    Path astar;
+    Path jps;
+    jps.setJumpPoints(true);
+
+    for (int i = 0; i < 4; i++)
+    {
+        Vector2i start(1, 1 + i);
+        Vector2i goal(510, 510 - i);
+        Assert(astar.find(layer, start, goal));
+        Assert(jps.find(layer, start, goal));
+        Assert(EqualsDelta(astar.getCost(), jps.getCost(), 0.01));
+    }
+}
+
+uint callbackCount = 0;
+
+void CountCallback(PathRequest@ req)
+{
+    Assert(req.isDone());
+    callbackCount++;
+}
+
+[Test]
+void TestPathService()
+{
+    Map::Layer@ layer = CreateWallLayer(64);
+    callbackCount = 0;
+
+    PathRequest@ a = PathService::Request(layer, Vector2i(1, 1), Vector2i(62, 62), CountCallback);
+    PathRequest@ blocked = PathService::Request(layer, Vector2i(1, 1), Vector2i(4, 4), CountCallback, 1, 10);
+    PathRequest@ cancelled = PathService::Request(layer, Vector2i(1, 1), Vector2i(30, 30), CountCallback);
+    cancelled.cancel();
+
+    PathService::Flush();
+    Assert(PathService::GetQueued() == 0);
+    Assert(callbackCount == 2);
+
+    Assert(a.isDone() && a.isFound());
+    Assert(blocked.isDone() && !blocked.isFound());
+    Assert(!cancelled.isDone());
+
+    Path p;
+    Assert(p.find(layer, Vector2i(1, 1), Vector2i(62, 62)));
+    Assert(EqualsDelta(a.getCost(), p.getCost(), 0.01));
+
+    //The same request is served from the cache
+    PathRequest@ b = PathService::Request(layer, Vector2i(1, 1), Vector2i(62, 62));
+    PathService::Flush();
+    Assert(b.isCached());
+    Assert(b.getLength() == a.getLength());
+
+    //Modifying the layer invalidates the cache
+    layer.set(Vector2i(40, 40), 1);
+    PathRequest@ c = PathService::Request(layer, Vector2i(1, 1), Vector2i(62, 62));
+    PathService::Flush();
+    Assert(c.isFound() && !c.isCached());
+}
+
+[Test]
+void TestPathServiceCachesOnlyFound()
+{
+    Map::Layer@ layer = CreateWallLayer(64);
+
+    //A walled in goal
+    layer.fill(Vector2i(40, 40), Vector2i(43, 43), 1);
+    layer.set(Vector2i(41, 41), 0);
+
+    PathRequest@ a = PathService::Request(layer, Vector2i(1, 1), Vector2i(41, 41));
+    PathService::Flush();
+    Assert(a.isDone() && !a.isFound());
+
+    //Failures are searched again
+    PathRequest@ b = PathService::Request(layer, Vector2i(1, 1), Vector2i(41, 41));
+    PathService::Flush();
+    Assert(b.isDone() && !b.isFound() && !b.isCached());
+}
+
+[Test]
+void TestPathServiceAgentSize()
+{
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(8, 8);
+
+    //A wall with a gap of a single cell
+    layer.fill(Vector2i(4, 0), Vector2i(5, 8), 1);
+    layer.set(Vector2i(4, 4), 0);
+
+    PathRequest@ small = PathService::Request(layer, Vector2i(0, 0), Vector2i(6, 6), 1);
+    PathRequest@ big = PathService::Request(layer, Vector2i(0, 0), Vector2i(6, 6), 2);
+    PathService::Flush();
+
+    Assert(small.isFound());
+    Assert(big.isDone() && !big.isFound());
+}
+
+[Test]
+void TestHierarchicalPath()
+{
+    Map::Layer@ layer = CreateWallLayer(128);
+
+    Path astar;
+    Path hpa;
+    hpa.setHierarchical(true);
+
+    Assert(astar.find(layer, Vector2i(1, 1), Vector2i(126, 126)));
+    Assert(hpa.find(layer, Vector2i(1, 1), Vector2i(126, 126)));
+    Assert(hpa.getCost() >= astar.getCost() - 0.01);
+    Assert(hpa.getCost() <= astar.getCost() * 1.2);
+
+    //Close the gap of the first wall, the hierarchy is repaired
+    layer.fill(Vector2i(4, 126), Vector2i(5, 128), 1);
+    Assert(!astar.find(layer, Vector2i(1, 1), Vector2i(126, 126)));
+    Assert(!hpa.find(layer, Vector2i(1, 1), Vector2i(126, 126)));
+
+    layer.set(Vector2i(4, 127), 0);
+    Assert(hpa.find(layer, Vector2i(1, 1), Vector2i(126, 126)));
+    Assert(hpa.getPoint(0) == Vector2i(1, 1));
+    Assert(hpa.getPoint(hpa.getLength() - 1) == Vector2i(126, 126));
+}
+
+Vector2i FollowFlowField(FlowField@ field, Vector2i start, uint maxSteps)
+{
+    Vector2i p = start;
+    for (uint i = 0; i < maxSteps; i++)
+    {
+        Vector2i d = field.getDirection(p);
+        if (d == Vector2i(0, 0))
+            break;
+        p = p + d;
+    }
+    return p;
+}
+
+[Test]
+void TestFlowField()
+{
+    Map::Layer@ layer = CreateWallLayer(64);
+
+    FlowField field;
+    field.setGoal(Vector2i(62, 62));
+    field.update(layer);
+    field.wait();
+    Assert(field.update(layer));
+    Assert(field.isReady() && field.wasFullSearch());
+
+    Path p;
+    Assert(p.find(layer, Vector2i(1, 1), Vector2i(62, 62)));
+    Assert(EqualsDelta(field.getCost(Vector2i(1, 1)), p.getCost(), 0.01));
+    Assert(FollowFlowField(field, Vector2i(1, 1), 1000) == Vector2i(62, 62));
+    Assert(field.getCost(Vector2i(4, 4)) < 0);
+
+    //A small move is patched around the goal
+    field.setGoal(Vector2i(61, 60));
+    field.update(layer);
+    field.wait();
+    Assert(field.update(layer));
+    Assert(!field.wasFullSearch());
+    Assert(field.getGeneration() == 2);
+    Assert(FollowFlowField(field, Vector2i(1, 1), 1000) == Vector2i(61, 60));
+
+    //Two goals, the nearest one is followed
+    Vector2i[] goals = {Vector2i(1, 60), Vector2i(62, 1)};
+    field.setGoals(goals);
+    field.update(layer);
+    field.wait();
+    Assert(field.update(layer));
+    Assert(field.wasFullSearch());
+    Assert(FollowFlowField(field, Vector2i(0, 62), 1000) == Vector2i(1, 60));
+}
+
+[Test]
+void TestFlowFieldAgentSize()
+{
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(16, 16);
+
+    //A wall with a gap of two cells
+    layer.fill(Vector2i(8, 0), Vector2i(9, 16), 1);
+    layer.fill(Vector2i(8, 6), Vector2i(9, 8), 0);
+
+    FlowField field;
+    field.setAgentSize(2);
+    field.setGoal(Vector2i(12, 12));
+    field.update(layer);
+    field.wait();
+    field.update(layer);
+    Assert(FollowFlowField(field, Vector2i(1, 1), 100) == Vector2i(12, 12));
+
+    //Too narrow after the gap is halved
+    layer.set(Vector2i(8, 7), 1);
+    field.update(layer);
+    field.wait();
+    field.update(layer);
+    Assert(field.getCost(Vector2i(1, 1)) < 0);
+    Assert(field.getCost(Vector2i(10, 10)) >= 0);
+}
+
+[Test]
+void BenchmarkHierarchicalPath1024()
+{
+    Map::Layer@ layer = CreateRoomLayer(1024);
+
+    Path hpa;
+    hpa.setHierarchical(true);
+    hpa.setHeuristicWeight(1.5);
+
+    //The first search builds the hierarchy, the edits repair it
+    for (int i = 0; i < 16; i++)
+    {
+        Assert(hpa.find(layer, Vector2i(1, 1 + i), Vector2i(1022, 1022 - i)));
+        layer.set(Vector2i(100 + i * 8, 500 + i), i % 2);
+    }
+}
+
+}
@@ -0,0 +1,179 @@
+namespace Tilemap
+{
+
+/*
+    Testcases for the chunked tile storage of Map::Layer
+*/
+
+[Test]
+void TestSparseLayer()
+{
+    Map::Layer@ layer = Map::Layer();
+    layer.resize(4096, 4096);
+    Assert(layer.getAllocatedChunks() == 0);
+    Assert(layer.getValueBits() == 8);
+
+    layer.set(Vector2i(4000, 10), 3);
+    layer.set(Vector2i(4001, 11), 4);
+    Assert(layer.getAllocatedChunks() == 1);
+    Assert(layer.getTile(Vector2i(4000, 10)) == 3);
+    Assert(layer.getTile(Vector2i(4001, 11)) == 4);
+    Assert(layer.getTile(Vector2i(10, 4000)) == 0);
+
+    //Values that don't fit widen the layer
+    layer.set(Vector2i(0, 0), 1000);
+    Assert(layer.getValueBits() == 16);
+    Assert(layer.getAllocatedChunks() == 2);
+    Assert(layer.getTile(Vector2i(0, 0)) == 1000);
+    Assert(layer.getTile(Vector2i(4000, 10)) == 3);
+
+    //Chunks are freed once they are empty again
+    layer.set(Vector2i(0, 0), 0);
+    Assert(layer.getAllocatedChunks() == 1);
+    layer.fill(Vector2i(3990, 0), Vector2i(4010, 20), 0);
+    Assert(layer.getAllocatedChunks() == 0);
+
+    layer.fill(Vector2i(0, 0), Vector2i(64, 64), 1);
+    Assert(layer.getAllocatedChunks() == 4);
+    layer.clear();
+    Assert(layer.getAllocatedChunks() == 0);
+}
+
+/*
+    Testcases for the .tsmap conversion and streaming. The version 1 map
+    assets/test.tsmap is 100x70 tiles, so the edge chunks are partial.
+*/
+
+const array<string> MapLayers = {"fg", "bg", "tfg", "meta"};
+
+void AssertSameTiles(Map@ a, Map@ b)
+{
+    for (uint i = 0; i < MapLayers.length(); i++)
+    {
+        Map::Layer@ la = a.getLayer(Hash(MapLayers[i]));
+        Map::Layer@ lb = b.getLayer(Hash(MapLayers[i]));
+        Assert(la !is null && lb !is null);
+        Assert(la.getSize() == lb.getSize());
+
+        Vector2i size = la.getSize();
+        uint differing = 0;
+        for (int y = 0; y < size.y; y++)
+        for (int x = 0; x < size.x; x++)
+        {
+            if (la.getTile(Vector2i(x, y)) != lb.getTile(Vector2i(x, y)))
+                differing++;
+        }
+        Assert(differing == 0);
+    }
+}
+
+[Test]
+void TestConvertRoundTrip()
+{
+    Map@ original = Map::LoadTSMap("assets/test.tsmap");
+    Assert(original !is null);
+    Assert(original.getLayer(Hash("fg")).getSize() == Vector2i(100, 70));
+
+    Assert(Map::ConvertTSMap("assets/test.tsmap", "user/data/test_v2.tsmap"));
+    Map@ converted = Map::LoadTSMap("user/data/test_v2.tsmap");
+    Assert(converted !is null);
+    AssertSameTiles(original, converted);
+
+    Assert(Map::ConvertTSMap("assets/test.tsmap", "user/data/test_v3.tsmap", true));
+    Map@ chunked = Map::LoadTSMap("user/data/test_v3.tsmap");
+    Assert(chunked !is null);
+    AssertSameTiles(original, chunked);
+
+    Assert(converted.getObjectCount() == original.getObjectCount());
+    for (uint i = 0; i < original.getObjectCount(); i++)
+    {
+        Map::Object@ a = original.getObject(i);
+        Map::Object@ b = converted.getObject(i);
+        Assert(a.x == b.x && a.y == b.y);
+        Assert(a.name == b.name && a.type == b.type);
+        Assert(a.getPropertyCount() == b.getPropertyCount());
+    }
+}
+
+
+[Test]
+void TestStreamerKeepsModifiedChunks()
+{
+    Assert(Map::ConvertTSMap("assets/test.tsmap", "user/data/test_stream.tsmap", true));
+
+    //The map is 4x3 chunks, only the chunk of the center is kept
+    Map::Streamer@ streamer = Map::Streamer();
+    Assert(streamer.open("user/data/test_stream.tsmap"));
+    streamer.setRadius(0);
+    streamer.setChunkBudget(1);
+    Assert(streamer.getRadius() == 0);
+    Assert(streamer.getChunkBudget() == 1);
+
+    Map::Layer@ fg = streamer.getMap().getLayer(Hash("fg"));
+    streamer.update(Vector2i(0, 0));
+    streamer.wait();
+    Assert(streamer.update(Vector2i(0, 0)) == 1);
+    Assert(streamer.getResidentChunks() == 1);
+
+    fg.set(Vector2i(5, 5), 77);
+
+    //The first chunk is out of the radius and over the budget, but modified
+    streamer.update(Vector2i(99, 69));
+    streamer.wait();
+    Assert(streamer.update(Vector2i(99, 69)) == 1);
+    Assert(streamer.getResidentChunks() == 2);
+    Assert(fg.getTile(Vector2i(5, 5)) == 77);
+
+    //The unmodified corner chunk is evicted instead
+    streamer.update(Vector2i(40, 0));
+    streamer.wait();
+    Assert(streamer.update(Vector2i(40, 0)) == 1);
+    Assert(streamer.getResidentChunks() == 2);
+    Assert(streamer.getFailedChunks() == 0);
+    Assert(fg.getTile(Vector2i(5, 5)) == 77);
+}
+
+uint AllocatedChunks(Map@ map)
+{
+    uint chunks = 0;
+    for (uint i = 0; i < MapLayers.length(); i++)
+        chunks += map.getLayer(Hash(MapLayers[i])).getAllocatedChunks();
+    return chunks;
+}
+
+[Test]
+void BenchmarkMapLoad()
+{
+    Assert(Map::ConvertTSMap("assets/test.tsmap", "user/data/bench_v2.tsmap"));
+    Assert(Map::ConvertTSMap("assets/test.tsmap", "user/data/bench_v3.tsmap", true));
+
+    uint v2Chunks = 0;
+    uint v3Chunks = 0;
+    uint streamedChunks = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        Map@ v2 = Map::LoadTSMap("user/data/bench_v2.tsmap");
+        Assert(v2 !is null);
+        v2Chunks = AllocatedChunks(v2);
+
+        Map@ v3 = Map::LoadTSMap("user/data/bench_v3.tsmap");
+        Assert(v3 !is null);
+        v3Chunks = AllocatedChunks(v3);
+
+        //Only the chunk of the center is resident
+        Map::Streamer@ streamer = Map::Streamer();
+        Assert(streamer.open("user/data/bench_v3.tsmap"));
+        streamer.setRadius(0);
+        streamer.update(Vector2i(50, 35));
+        streamer.wait();
+        streamer.update(Vector2i(50, 35));
+        Assert(streamer.getFailedChunks() == 0);
+        streamedChunks = AllocatedChunks(streamer.getMap());
+    }
+
+    Assert(v2Chunks == v3Chunks);
+    Assert(streamedChunks < v3Chunks);
+    Print("Map load, allocated chunks: v2 " + v2Chunks + ", v3 " + v3Chunks + ", v3 streamed " + streamedChunks);
+}
+
+}
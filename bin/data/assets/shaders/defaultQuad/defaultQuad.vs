@@ -11,6 +11,10 @@ uniform vec2 Position;
 uniform float Depth;
 uniform float Rotation;
 
+//The area of the texture, see Texture::getUVMin
+uniform vec2 MinUV = vec2(0.0, 0.0);
+uniform vec2 MaxUV = vec2(1.0, 1.0);
+
 out vec2 texCoord;
 
 void main()
@@ -23,6 +27,6 @@ void main()
     pos += Position;
 
 	gl_Position = MatProjection * vec4(pos - Camera, Depth, 1);
-	texCoord = VertexUV;
+	texCoord = mix(MinUV, MaxUV, VertexUV);
 }
 
@@ -10,6 +10,10 @@ uniform vec2 Position;
 uniform float Depth;
 uniform float Rotation;
 
+//The area of the texture, see Texture::getUVMin
+uniform vec2 MinUV = vec2(0.0, 0.0);
+uniform vec2 MaxUV = vec2(1.0, 1.0);
+
 out vec2 texCoord;
 
 void main()
@@ -22,6 +26,6 @@ void main()
     pos += Position;
 
 	gl_Position = MatProjection * vec4(pos, Depth, 1);
-	texCoord = VertexUV;
+	texCoord = mix(MinUV, MaxUV, VertexUV);
 }
 
@@ -0,0 +1,34 @@
+#version 330 core
+layout(location = 0) in vec2 VertexPosition;
+layout(location = 1) in vec2 VertexUV;
+
+//Per instance, see SpriteInstance
+layout(location = 2) in vec4 InstanceRect;
+layout(location = 3) in vec2 InstanceRotationDepth;
+layout(location = 4) in vec4 InstanceUV;
+layout(location = 5) in vec4 InstanceColor;
+layout(location = 6) in vec4 InstanceFade;
+
+
+uniform mat4 MatProjection;
+uniform vec2 Camera;
+
+out vec2 texCoord;
+flat out vec4 instanceColor;
+flat out vec4 instanceFade;
+
+void main()
+{
+    float rotation = InstanceRotationDepth.x;
+    mat2 rotationMatrix = mat2(cos(rotation), -sin(rotation), sin(rotation), cos(rotation));
+    vec2 pos =  VertexPosition.xy;
+    pos *= InstanceRect.zw / 2.0;
+    pos = rotationMatrix * pos;
+
+    pos += InstanceRect.xy;
+
+	gl_Position = MatProjection * vec4(pos - Camera, InstanceRotationDepth.y, 1);
+	texCoord = mix(InstanceUV.xy, InstanceUV.zw, VertexUV);
+	instanceColor = InstanceColor;
+	instanceFade = InstanceFade;
+}
@@ -0,0 +1,23 @@
+#version 330 core
+layout(location = 0) out vec4 color;
+
+#if GFXS_Normal==1
+    layout(location = 1) out vec4 normal;
+#endif
+
+#if GFXS_Specular==1
+    layout(location = 2) out vec4 specular;
+#endif
+
+flat in vec4 instanceColor;
+
+void main()
+{
+	color = instanceColor;
+    #if GFXS_Normal==1
+	    normal = vec4(0.5,0.5,1,0);
+    #endif
+    #if GFXS_Specular==1
+	    specular = instanceColor;
+    #endif
+}
@@ -0,0 +1,35 @@
+#version 330 core
+layout(location = 0) out vec4 color;
+
+#if GFXS_Normal==1
+    layout(location = 1) out vec4 normal;
+    uniform sampler2D TextureNormal;
+#endif
+
+#if GFXS_Specular==1
+    layout(location = 2) out vec4 specular;
+    uniform sampler2D TextureSpecular;
+#endif
+
+uniform sampler2D Texture;
+
+in vec2 texCoord;
+flat in vec4 instanceColor;
+flat in vec4 instanceFade;
+void main()
+{
+	color = texture(Texture,texCoord) * instanceColor;
+	
+	if (color.a == 0.0f)
+		discard;
+
+    color.rgb = mix(color.rgb, instanceFade.rgb, instanceFade.a);
+		
+	#if GFXS_Normal==1
+        normal = texture(TextureNormal,texCoord);
+    #endif
+
+    #if GFXS_Specular==1
+	    specular = texture(TextureSpecular,texCoord);
+    #endif
+}
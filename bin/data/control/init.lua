@@ -32,6 +32,7 @@ require("resources").load();
 require("scene").load();
 
 require("console").load();
+require("loading").load();
 require("particles").load();
 
 --[[
@@ -70,6 +71,40 @@ end
 -- Will prevent fast objects moving through other things sometimes
 GameVar.NewInteger("Collision.Passes", 1)
 
+-- How many threads are used for the narrow phase collision detection
+-- 0 uses all hardware threads, 1 runs everything on the main thread
+GameVar.NewInteger("Collision.Threads", 0)
+
+-- For actors with contact events, call collide every N frames while
+-- the contact persists. 0 disables the repeated calls
+GameVar.NewInteger("Collision.StayInterval", 0)
+
+-- How many frames an actor must stay in place before it is put to sleep.
+-- Sleeping actors are only tested against moving ones. 0 disables sleeping
+-- for actors that are not static
+GameVar.NewInteger("Collision.SleepFrames", 60)
+
+-- Measure the collision detection stages and the quadtree shape. The
+-- results of each update are published as Collision.Stats.* variables, and
+-- are available to scripts through Collision::GetStatistics
+GameVar.NewInteger("Collision.Stats", 0)
+
+
+-- Worker threads for the PathService. 0 searches the paths on the main
+-- thread when they are requested. The flow fields share one extra thread,
+-- which is not created either if this is 0
+GameVar.NewInteger("Path.Threads", 2)
+
+-- Maximum amount of PathService results delivered per step, 0 for no limit
+GameVar.NewInteger("Path.CompletionBudget", 16)
+
+-- Amount of paths kept in the PathService cache
+GameVar.NewInteger("Path.CacheSize", 256)
+
+-- The start and the goal are quantised to cells of this size for the path
+-- cache. Values larger than 1 share the paths between nearby cells
+GameVar.NewInteger("Path.CacheQuantum", 1)
+
 
 -- At what point the engine starts sleeping using a spinlock.
 -- The value is in microseconds: if the time to sleep is greater than the
@@ -90,6 +125,18 @@ GameVar.NewInteger("Engine.ForceDeltaTimeToOne", 1)
 -- The time multiplier, can be used as a simple way to slow things down
 GameVar.NewNumber("Engine.TimeMultiplier", 1.0)
 
+-- Physics steps per second. The physics is run in fixed steps, independent
+-- of the frame rate, and the drawables are interpolated between the steps.
+-- 0 runs one physics step per frame with the frame delta time
+GameVar.NewInteger("Engine.PhysicsRate", 60)
+
+-- Every physics step is split into this many smaller steps
+GameVar.NewInteger("Engine.PhysicsSubsteps", 1)
+
+-- Maximum physics steps per frame. If the game runs slower than this, the
+-- extra time is dropped and the game slows down instead
+GameVar.NewInteger("Engine.PhysicsMaxSteps", 5)
+
 -- Scripts recompilation behaviour
 -- 	0: never compile scripts, always load bytecode
 --	1: compile scripts when no bytecode is present
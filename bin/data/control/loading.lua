@@ -0,0 +1,27 @@
+function f_load()
+
+-- Shows the progress while the textures are loaded in the background
+
+NodeOrder.Loading = 5800
+local node = GraphicsNode.New(NodeOrder.Loading)
+
+local loadingFont = Assets.GetFont("fontMain")
+local wsize = Graphics.GetScreenSize()
+
+local nodeTraverse = function (self)
+    if not Graphics.IsLoading() then
+        return
+    end
+
+    local scale = GameVar.GetNumber(GameVar.Get("Graphics.RenderScale"))
+    local percent = math.floor(Graphics.GetLoadingProgress() * 100)
+    GraphicsDrawing.DrawText(loadingFont, "Loading " .. percent .. "%", {wsize[1] / 2, wsize[2] / 2}, 0, 1.0 / scale, 0, true);
+end
+
+GraphicsNode.SetShader(node, Assets.GetShader("staticQuadTexturedCameraSpace"))
+GraphicsNode.SetShadingSettings(node, false, GL.SrcAlpha, GL.OneMinusSrcAlpha, GL.FuncAdd, false)
+GraphicsNode.SetTraverseMethod(node, nodeTraverse)
+
+end
+
+return {load = f_load}
@@ -55,6 +55,8 @@ PrintPerf = function ()
         print (n .. " - " .. tostring(v) .. "ns")
         
     end
+
+    print ("Sprites - " .. tostring(Graphics.GetSpriteInstances()) .. " in " .. tostring(Graphics.GetSpriteDrawCalls()) .. " draw calls")
 end
 
 ToggleConsole = function ()
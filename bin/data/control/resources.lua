@@ -16,6 +16,10 @@ function f_load()
 
     Assets.CreateShader("colored", "colored.fs", "defaultQuad/defaultQuad.vs", "")
     Assets.CreateShader("coloredCameraSpace", "colored.fs", "defaultQuad/defaultQuadCameraSpace.vs", "")
+
+    --Drawn by the sprite batch
+    Assets.CreateShader("texturedInstanced", "instanced/textured.fs", "defaultQuad/instancedQuad.vs", "")
+    Assets.CreateShader("coloredInstanced", "instanced/colored.fs", "defaultQuad/instancedQuad.vs", "")
     
     Assets.CreateShader("deferred", "deferred.fs", "deferred.vs", "")
     Assets.CreateShader("deferredPointLight", "deferredPointLight.fs", "deferredPointLight.vs", "")
@@ -0,0 +1,118 @@
+#include "asyncFile.hpp"
+#include "workerPool.hpp"
+
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+
+
+static std::unique_ptr<WorkerPool> IOWorkers;
+static std::mutex FinishedMutex;
+static std::condition_variable FinishedCv;
+
+//The pending files are referenced only from the main thread
+static std::vector<ReferenceHolder<AsyncFile>> PendingFiles;
+
+AsyncFile::AsyncFile(const std::string& f) : filename(f)
+{
+}
+
+AsyncFile::~AsyncFile()
+{
+}
+
+std::string AsyncFile::getString() const
+{
+    if (!isReady() || !view)
+        return std::string();
+    return std::string(view->getData(), view->getSize());
+}
+
+void AsyncFile::complete()
+{
+    //Empty files have no view, but are not failures
+    failed = !view && !handle;
+    handle.reset();
+    ready.store(true, std::memory_order_release);
+}
+
+void AsyncFile::wait()
+{
+    if (isReady())
+        return;
+    {
+        std::unique_lock<std::mutex> lock(FinishedMutex);
+        FinishedCv.wait(lock, [this]()
+        {
+            return finished;
+        });
+    }
+    complete();
+}
+
+AsyncFile* ReadFileAsync(const std::string& filename)
+{
+    //The reference of the caller
+    AsyncFile* file = new AsyncFile(filename);
+    file->handle = GetFileStream(filename);
+    if (!file->handle)
+    {
+        file->failed = true;
+        file->ready.store(true, std::memory_order_release);
+        return file;
+    }
+
+    //Kept alive by PendingFiles until finished
+    PendingFiles.push_back(ReferenceHolder<AsyncFile>::create(file));
+    auto task = [file]()
+    {
+        auto view = MapFileContents(*file->handle);
+        bool empty = !view && file->handle->getSize() == 0;
+
+        std::lock_guard<std::mutex> lock(FinishedMutex);
+        file->view = std::move(view);
+        if (!file->view && !empty)
+            file->handle.reset();
+        file->finished = true;
+        FinishedCv.notify_all();
+    };
+
+    if (IOWorkers)
+        IOWorkers->submit(task);
+    else
+        task();
+    return file;
+}
+
+void PollAsyncFiles()
+{
+    std::lock_guard<std::mutex> lock(FinishedMutex);
+    size_t kept = 0;
+    for (size_t i = 0; i < PendingFiles.size(); i++)
+    {
+        auto& file = PendingFiles[i];
+        if (!file->finished)
+        {
+            if (kept != i)
+                PendingFiles[kept] = std::move(file);
+            kept++;
+            continue;
+        }
+        if (!file->isReady())
+            file->complete();
+    }
+    PendingFiles.resize(kept);
+}
+
+void AsyncFiles_Init(unsigned int threads)
+{
+    IOWorkers = std::unique_ptr<WorkerPool>(new WorkerPool(threads));
+}
+
+void AsyncFiles_Deinit()
+{
+    if (IOWorkers)
+        IOWorkers->waitTasks();
+    PollAsyncFiles();
+    IOWorkers.reset();
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "fileOperations.hpp"
+#include "reference.hpp"
+
+#include <memory>
+#include <string>
+#include <cstdint>
+#include <atomic>
+
+/*! \brief A file being read on the I/O threads, see ReadFileAsync
+ *
+ * The file is opened on the calling thread and then mapped, or read, by
+ * one of the I/O threads. The result becomes visible on the main thread
+ * when PollAsyncFiles is called once per frame, or right away with wait.
+ */
+class AsyncFile
+{
+    MixinReferenceCounted
+
+    std::string filename;
+    std::unique_ptr<FileHandle> handle;
+    std::unique_ptr<FileView> view;
+    bool failed = false;
+
+    //Set last by complete, the view and failed are only read after it
+    std::atomic<bool> ready {false};
+
+    //Set by the I/O thread, guarded by the queue mutex
+    bool finished = false;
+
+    friend AsyncFile* ReadFileAsync(const std::string&);
+    friend void PollAsyncFiles();
+    void complete();
+
+public:
+
+    //! Returns true once the file has been read or has failed
+    bool isReady() const {return ready.load(std::memory_order_acquire);}
+
+    //! Returns true if the file couldn't be read
+    bool isFailed() const {return failed;}
+
+    //! Get the contents, nullptr until ready or if empty
+    const char* getData() const {return isReady() && view ? view->getData() : nullptr;}
+
+    //! Get the size of the contents in bytes, 0 until ready
+    size_t getSize() const {return isReady() && view ? view->getSize() : 0;}
+
+    //! Get the contents as a string, empty until ready
+    std::string getString() const;
+
+    //! Get the name the file was requested with
+    const std::string& getFilename() const {return filename;}
+
+    //! Block until the file has been read, and make it ready
+    void wait();
+
+    AsyncFile(const std::string& filename);
+    ~AsyncFile();
+};
+
+/*! \brief Start reading \p filename on the I/O threads
+ *
+ * Increases the reference count of the returned file. Must be called from
+ * the main thread.
+ */
+AsyncFile* ReadFileAsync(const std::string& filename);
+
+//! Make the files read since the last call ready, called once per frame
+void PollAsyncFiles();
+
+//! Start the I/O threads, done by VFS_Init. With 0 threads the files are read immediately.
+void AsyncFiles_Init(unsigned int threads);
+
+//! Wait for the pending files and stop the I/O threads, done by VFS_Deinit
+void AsyncFiles_Deinit();
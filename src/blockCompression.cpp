@@ -0,0 +1,155 @@
+#include "blockCompression.hpp"
+#include <cstring>
+
+namespace
+{
+    const size_t MinMatch = 4;
+    //The last bytes of a block are always literals
+    const size_t LastLiterals = 5;
+    //No match may start within this many bytes from the end
+    const size_t MatchLimit = 12;
+    const size_t MaxOffset = 65535;
+    const int HashBits = 12;
+
+    uint32_t Read32(const uint8_t* p)
+    {
+        uint32_t v;
+        std::memcpy(&v, p, sizeof(v));
+        return v;
+    }
+
+    void WriteLength(std::vector<uint8_t>& out, size_t length)
+    {
+        while (length >= 255)
+        {
+            out.push_back(255);
+            length -= 255;
+        }
+        out.push_back(uint8_t(length));
+    }
+
+    void WriteSequence(std::vector<uint8_t>& out, const uint8_t* literals, size_t literalCount, size_t offset, size_t matchLength)
+    {
+        size_t extraMatch = matchLength - MinMatch;
+        uint8_t token = uint8_t((literalCount < 15 ? literalCount : 15) << 4);
+        if (offset)
+            token |= uint8_t(extraMatch < 15 ? extraMatch : 15);
+        out.push_back(token);
+
+        if (literalCount >= 15)
+            WriteLength(out, literalCount - 15);
+        out.insert(out.end(), literals, literals + literalCount);
+
+        if (!offset)
+            return;
+        out.push_back(uint8_t(offset));
+        out.push_back(uint8_t(offset >> 8));
+        if (extraMatch >= 15)
+            WriteLength(out, extraMatch - 15);
+    }
+}
+
+void BlockCompression::Compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out)
+{
+    out.clear();
+    out.reserve(size / 2 + 16);
+
+    //Positions plus one of the last occurence of each hashed 4 bytes
+    std::vector<uint32_t> table(size_t(1) << HashBits, 0);
+
+    size_t anchor = 0;
+    size_t i = 0;
+    if (size > MatchLimit)
+    {
+        size_t limit = size - MatchLimit;
+        while (i < limit)
+        {
+            uint32_t sequence = Read32(src + i);
+            uint32_t hash = (sequence * 2654435761u) >> (32 - HashBits);
+            size_t candidate = table[hash];
+            table[hash] = uint32_t(i + 1);
+
+            if (candidate == 0 || i - (candidate - 1) > MaxOffset || Read32(src + candidate - 1) != sequence)
+            {
+                i++;
+                continue;
+            }
+
+            size_t match = candidate - 1;
+            size_t length = MinMatch;
+            size_t maxLength = size - LastLiterals - i;
+            while (length < maxLength && src[match + length] == src[i + length])
+                length++;
+
+            WriteSequence(out, src + anchor, i - anchor, i - match, length);
+            i += length;
+            anchor = i;
+        }
+    }
+    WriteSequence(out, src + anchor, size - anchor, 0, MinMatch);
+}
+
+bool BlockCompression::Decompress(const uint8_t* src, size_t size, uint8_t* out, size_t outSize)
+{
+    const uint8_t* end = src + size;
+    size_t written = 0;
+
+    while (src < end)
+    {
+        uint8_t token = *src++;
+
+        size_t literals = token >> 4;
+        if (literals == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (src == end)
+                    return false;
+                b = *src++;
+                literals += b;
+            }
+            while (b == 255);
+        }
+        if (literals > size_t(end - src) || literals > outSize - written)
+            return false;
+        std::memcpy(out + written, src, literals);
+        src += literals;
+        written += literals;
+
+        //The last sequence has only literals
+        if (src == end)
+            break;
+
+        if (end - src < 2)
+            return false;
+        size_t offset = src[0] | size_t(src[1]) << 8;
+        src += 2;
+        if (offset == 0 || offset > written)
+            return false;
+
+        size_t length = token & 15;
+        if (length == 15)
+        {
+            uint8_t b;
+            do
+            {
+                if (src == end)
+                    return false;
+                b = *src++;
+                length += b;
+            }
+            while (b == 255);
+        }
+        length += MinMatch;
+        if (length > outSize - written)
+            return false;
+
+        //The match may overlap the bytes being written
+        const uint8_t* from = out + written - offset;
+        for (size_t k = 0; k < length; k++)
+            out[written + k] = from[k];
+        written += length;
+    }
+    return written == outSize;
+}
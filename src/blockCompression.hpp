@@ -0,0 +1,24 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+/*! \file blockCompression.hpp
+    \brief Fast LZ77 compression of independent blocks
+
+    The compressed data uses the LZ4 block format, so that it can also be
+    produced and read with the reference LZ4 library. The compressor is a
+    simple greedy one, favoring speed over ratio.
+*/
+namespace BlockCompression
+{
+    //! Compress \p size bytes from \p src, replacing the contents of \p out
+    void Compress(const uint8_t* src, size_t size, std::vector<uint8_t>& out);
+
+    /*! \brief Decompress a block of exactly \p outSize bytes to \p out
+
+        Returns false if the data is malformed or doesn't decompress to
+        exactly \p outSize bytes. Never reads or writes out of bounds.
+    */
+    bool Decompress(const uint8_t* src, size_t size, uint8_t* out, size_t outSize);
+}
@@ -59,6 +59,10 @@ luaL_Reg window_functions[] =
 luaL_Reg graphics_functions[] =
 {
     {"GetScreenSize", LuaClassMemberWrapStatic(Graphics, getScaledDimensions)},
+    {"GetLoadingProgress", LuaClassMemberWrapStatic(Graphics, getLoadingProgress)},
+    {"IsLoading", LuaClassMemberWrapStatic(Graphics, getIsLoading)},
+    {"GetSpriteDrawCalls", LuaClassMemberWrapStatic(Graphics, getSpriteDrawCalls)},
+    {"GetSpriteInstances", LuaClassMemberWrapStatic(Graphics, getSpriteInstances)},
     {0,0}
 };
 
@@ -276,17 +280,15 @@ void Control::init(ArgumentParser& args, GameVariableManager* var, Window* w, Gr
     {
         const char* name = luaL_checkstring(lua, 1);
 
-        size_t size;
         Log << "Required " << name << Trace(CHash("ControlLuaRequire"));
 
         std::string copy = name;
         std::transform(copy.begin(), copy.end(), copy.begin(), [](char a){return a == '.' ? '/' : a; });
 
-        char* s = GetFileContentsCopy(ControlScriptsFolder + "/" + copy + ".lua", &size);
+        auto s = MapFileContents(ControlScriptsFolder + "/" + copy + ".lua");
         if (s)
         {
-            luaL_loadbuffer(lua, s, size, copy.c_str());
-            delete[] s;
+            luaL_loadbuffer(lua, s->getData(), s->getSize(), copy.c_str());
             return 1;
         }
         return 0;
@@ -451,13 +453,11 @@ void Control::callAngelScriptInitHandlers(asIScriptEngine* ase)
 
 bool Control::runScript(const std::string& fname)
 {
-    size_t len;
-    char* s = GetFileContentsCopy(ControlScriptsFolder + "/" + fname, &len);
+    auto s = MapFileContents(ControlScriptsFolder + "/" + fname);
     if (s)
     {
 
-        int err = luaL_loadbuffer(lua, s, len, fname.c_str());
-        delete[] s;
+        int err = luaL_loadbuffer(lua, s->getData(), s->getSize(), fname.c_str());
         if (err)
         {
             Log << lua_tostring(lua, -1) << Trace(CHash("Warning"));
@@ -1,5 +1,6 @@
 #include "fileInterface.hpp"
 #include "fileOperations.hpp"
+#include "asyncFile.hpp"
 #include "gbvfs_file.hpp"
 #include "gbvfs.hpp"
 #include "control/crossFunctional.hpp"
@@ -10,6 +11,7 @@ struct LuaFileEntry
 };
 
 constexpr static const char* metaTableName = "FileInterface.File";
+constexpr static const char* asyncMetaTableName = "FileInterface.AsyncFile";
 
 
 
@@ -124,11 +126,84 @@ static int f_open(lua_State* lua)
 }
 
 
+static AsyncFile* checkAsync(lua_State* lua)
+{
+    AsyncFile** fp = (AsyncFile**)luaL_checkudata(lua, 1, asyncMetaTableName);
+    return fp ? *fp : nullptr;
+}
+
+static int af_isReady(lua_State* lua)
+{
+    AsyncFile* f = checkAsync(lua);
+    lua_pushboolean(lua, f && f->isReady());
+    return 1;
+}
+
+static int af_isFailed(lua_State* lua)
+{
+    AsyncFile* f = checkAsync(lua);
+    lua_pushboolean(lua, !f || f->isFailed());
+    return 1;
+}
+
+static int af_getData(lua_State* lua)
+{
+    AsyncFile* f = checkAsync(lua);
+    if (!f || !f->isReady() || f->isFailed())
+        return 0;
+
+    lua_pushlstring(lua, f->getData() ? f->getData() : "", f->getSize());
+    return 1;
+}
+
+static int af_getSize(lua_State* lua)
+{
+    AsyncFile* f = checkAsync(lua);
+    if (!f || !f->isReady())
+        return 0;
+
+    lua_pushinteger(lua, f->getSize());
+    return 1;
+}
+
+static int af_wait(lua_State* lua)
+{
+    AsyncFile* f = checkAsync(lua);
+    if (f)
+        f->wait();
+    return 0;
+}
+
+static int asyncFileGC(lua_State* lua)
+{
+    AsyncFile** fp = (AsyncFile**)luaL_checkudata(lua, 1, asyncMetaTableName);
+    if (fp && *fp)
+    {
+        (*fp)->release();
+        *fp = nullptr;
+    }
+    return 0;
+}
+
+static int f_readAsync(lua_State* lua)
+{
+    const char* fname = luaL_checkstring(lua, 1);
+
+    AsyncFile** fp = (AsyncFile**) lua_newuserdata(lua, sizeof (AsyncFile*));
+    *fp = ReadFileAsync(fname);
+
+    luaL_getmetatable(lua, asyncMetaTableName);
+    lua_setmetatable(lua, -2);
+
+    return 1;
+}
+
+
 std::vector<std::string> f_dirEntries(const std::string& dir, const std::string& ext)
 {
-	std::vector<std::string> vec;
-	GetFilesInDirectoryRecursive(dir, ext, vec);
-	return vec;
+    std::vector<std::string> vec;
+    GetFilesInDirectoryRecursive(dir, ext, vec);
+    return vec;
 }
 
 void RegisterFileFunctions(lua_State* lua)
@@ -173,6 +248,40 @@ void RegisterFileFunctions(lua_State* lua)
     lua_settable(lua, -3);
 
 
+    lua_rawset(lua, -3);
+
+    lua_pop(lua, 1);
+
+
+    luaL_newmetatable(lua, asyncMetaTableName);
+
+    lua_pushliteral(lua, "__gc");
+    lua_pushcfunction(lua, asyncFileGC);
+    lua_rawset(lua, -3);
+
+    lua_pushliteral(lua, "__index");
+    lua_newtable(lua);
+
+    lua_pushliteral(lua, "isReady");
+    lua_pushcfunction(lua, af_isReady);
+    lua_settable(lua, -3);
+
+    lua_pushliteral(lua, "isFailed");
+    lua_pushcfunction(lua, af_isFailed);
+    lua_settable(lua, -3);
+
+    lua_pushliteral(lua, "getData");
+    lua_pushcfunction(lua, af_getData);
+    lua_settable(lua, -3);
+
+    lua_pushliteral(lua, "getSize");
+    lua_pushcfunction(lua, af_getSize);
+    lua_settable(lua, -3);
+
+    lua_pushliteral(lua, "wait");
+    lua_pushcfunction(lua, af_wait);
+    lua_settable(lua, -3);
+
     lua_rawset(lua, -3);
 
     lua_pop(lua, 1);
@@ -181,6 +290,7 @@ void RegisterFileFunctions(lua_State* lua)
 luaL_Reg file_functions[] =
 {
     {"Open", f_open},
+    {"ReadAsync", f_readAsync},
     {"DirEntries", LuaCWrap(f_dirEntries)},
     {"Exists", LuaCWrap(FileExists)},
     {0, 0}
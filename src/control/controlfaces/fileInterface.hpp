@@ -1,6 +1,6 @@
 #pragma once
 #include <luawrap.hpp>
 
-extern luaL_Reg file_functions[4];
+extern luaL_Reg file_functions[5];
 
 void RegisterFileFunctions(lua_State*);
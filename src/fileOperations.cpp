@@ -1,6 +1,7 @@
 #include "fileOperations.hpp"
 #include "log.hpp"
 #include "argumentParser.hpp"
+#include "asyncFile.hpp"
 
 #include <unordered_map>
 #include <cstring>
@@ -8,6 +9,7 @@
 #define GBVFS_IMPLEMENTATION
 #include <gbvfs.hpp>
 #include <tinydir.h>
+#include "packFile.hpp"
 
 //Because tinydir sucks
 #define GFT_TYPE_FILE 1
@@ -31,9 +33,21 @@ static int GetFileType(const char* path)
 	return GFT_TYPE_FILE;
 }
 
+static bool GetRealFileStamp(const char* path, FileStamp& stamp)
+{
+	WIN32_FILE_ATTRIBUTE_DATA data;
+	if (!GetFileAttributesEx(path, GetFileExInfoStandard, &data) || (data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+		return false;
+	stamp.size = uint64_t(data.nFileSizeHigh) << 32 | data.nFileSizeLow;
+	stamp.modified = int64_t(uint64_t(data.ftLastWriteTime.dwHighDateTime) << 32 | data.ftLastWriteTime.dwLowDateTime);
+	return true;
+}
+
 #else
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
 #include <unistd.h>
 
 static int GetFileType(const char* path)
@@ -54,6 +68,16 @@ static int GetFileType(const char* path)
 	return 0;
 }
 
+static bool GetRealFileStamp(const char* path, FileStamp& stamp)
+{
+	struct stat fstat;
+	if (stat(path, &fstat) == -1 || !S_ISREG(fstat.st_mode))
+		return false;
+	stamp.size = fstat.st_size;
+	stamp.modified = fstat.st_mtime;
+	return true;
+}
+
 #endif
 
 
@@ -63,6 +87,7 @@ class CFile : public GBVFS::File
 {
     FILE* file;
     long size;
+    std::string path;
 public:
     bool isOpen;
 
@@ -103,7 +128,20 @@ public:
         isOpen = false;
     }
 
-    CFile(const char* fpath)
+    GBVFS::FileSpan map() override
+    {
+        GBVFS::FileSpan span;
+        std::shared_ptr<FileView> view = MapRealFileContents(path);
+        if (view)
+        {
+            span.data = view->getData();
+            span.size = view->getSize();
+            span.owner = view;
+        }
+        return span;
+    }
+
+    CFile(const char* fpath) : path(fpath)
     {
         size = 0;
         file = fopen(fpath, "rb");
@@ -250,8 +288,9 @@ std::string CanonicalizePath(const std::string& filename)
     return path.fullPath;
 }
 
-static std::unordered_map<std::string, std::pair<size_t, std::unique_ptr<char[]>>> MaintainedFiles;
+static std::unordered_map<std::string, std::unique_ptr<FileView>> MaintainedFiles;
 static std::unique_ptr<GBVFS::VFS> VFSInstance;
+static std::string CacheDirectory;
 
 void VFS_Init(ArgumentParser& args)
 {
@@ -282,6 +321,30 @@ void VFS_Init(ArgumentParser& args)
             Log << Trace(CHash("General"));
     };
 
+    //The pack is mounted first, so that the loose files in the folders
+    //mounted after it are found first and edits aren't hidden by a stale
+    //pack. Not when making a new pack from the folders.
+    std::string packfile = base_vfs + "data.pack";
+    args.getArgumentFullString("", "--pack", packfile);
+
+    if (!args.getArgument("", "--make-pack") && GetFileType(packfile.c_str()) == GFT_TYPE_FILE)
+    {
+        auto pack = std::make_unique<PackLoader>();
+        if (pack->open(packfile))
+        {
+            auto dirs = pack->getRootDirectories();
+            Log << "VFS pack \"" << packfile << "\": " << pack->getFileCount() << " files" << Trace(CHash("General"));
+
+            auto folderLoader = idx;
+            idx = VFSInstance->registerLoader(std::move(pack));
+            for (auto& d : dirs)
+                mounthelp(d, d);
+            idx = folderLoader;
+        }
+        else
+            Log << "VFS pack \"" << packfile << "\" is not a valid pack" << Trace(CHash("Warning"));
+    }
+
     std::string adir = wdir + "/" + "assets";
     std::string cdir = wdir + "/" + "control";
     std::string asdir = wdir + "/" + "angelscript";
@@ -315,10 +378,31 @@ void VFS_Init(ArgumentParser& args)
     
     mounthelp(cfgdir, "user/config", GBVFS::VFS::WRITEACCESS);
     mounthelp(userdatadir, "user/data", GBVFS::VFS::WRITEACCESS);
+
+    //Not mounted, the cache is read from any thread
+    std::string cachedir = base_usr + "cache";
+    args.getArgumentFullString("", "--dir-cache", cachedir);
+    if (GetFileType(cachedir.c_str()) == GFT_TYPE_DIR)
+        CacheDirectory = cachedir + "/";
+    else
+        CacheDirectory.clear();
+
+    //Threads reading the files requested with ReadFileAsync
+    unsigned int ioThreads = 2;
+    args.getArgument("", "--io-threads", ioThreads);
+    AsyncFiles_Init(ioThreads);
 }
 
 void VFS_Deinit()
 {
+    AsyncFiles_Deinit();
+
+    if (VFSInstance)
+    {
+        auto& stats = VFSInstance->getCacheStatistics();
+        Log << "VFS cache: " << stats.pathHits << " path hits, " << stats.pathMisses << " misses, "
+            << stats.listingHits << " listing hits, " << stats.listingMisses << " misses" << Trace(CHash("General"));
+    }
     VFSInstance = nullptr;
     MaintainedFiles.clear();
 }
@@ -379,34 +463,41 @@ std::unique_ptr<FileWriterHandle> GetFileWriter(const std::string& filename)
 }
 
 
+const std::string& GetCacheDirectory()
+{
+    return CacheDirectory;
+}
+
 std::string GetFileRealName(const std::string& f)
 {
     return VFSInstance->getRealPath(f.c_str());
 }
 
+bool GetFileStamp(const std::string& filename, FileStamp& stamp)
+{
+    GBVFS::FileEntry fe = VFSInstance->getFileEntry(filename.c_str());
+    if (!fe.exists || fe.directory)
+        return false;
+    return GetRealFileStamp(GetFileRealName(filename).c_str(), stamp);
+}
+
 const char* GetFileContentsMaintainedCopy(const std::string& filename_nonc, size_t* size)
 {
     GBVFS::Path path(filename_nonc);
     std::string filename = path.fullPath;
 
     auto it = MaintainedFiles.find(filename);
-    if (it != MaintainedFiles.end())
+    if (it == MaintainedFiles.end())
     {
-        if (size)
-            *size = it->second.first;
-        return it->second.second.get();
+        auto view = MapFileContents(filename);
+        if (!view)
+            return nullptr;
+        it = MaintainedFiles.emplace(filename, std::move(view)).first;
     }
-    size_t sz;
-    char* r = GetFileContentsCopy(filename, &sz);
 
     if (size)
-        *size = sz;
-    if (r)
-    {
-        MaintainedFiles[filename] = {sz, std::unique_ptr<char[]>(r)};
-        return r;
-    }
-    return nullptr;
+        *size = it->second->getSize();
+    return it->second->getData();
 }
 
 //Gets a copy of the file contents
@@ -446,6 +537,112 @@ char* GetFileContentsCopy(const std::string& filename, size_t* size)
     return nullptr;
 }
 
+#ifdef _MSC_VER
+
+FileView::~FileView()
+{
+    if (mapping)
+        UnmapViewOfFile(mapping);
+    if (mappingHandle)
+        CloseHandle(mappingHandle);
+    if (fileHandle)
+        CloseHandle(fileHandle);
+}
+
+//Map a real file, fills view and returns true on success
+static bool MapRealFile(const std::string& path, void*& mapping, void*& mappingHandle, void*& fileHandle, size_t& size)
+{
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+    fileHandle = file;
+
+    LARGE_INTEGER fsize;
+    if (!GetFileSizeEx(file, &fsize) || fsize.QuadPart == 0)
+        return false;
+    size = size_t(fsize.QuadPart);
+
+    mappingHandle = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (!mappingHandle)
+        return false;
+    mapping = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+    return mapping != nullptr;
+}
+
+#else
+
+FileView::~FileView()
+{
+    if (mapping)
+        munmap(mapping, size);
+}
+
+static bool MapRealFile(const std::string& path, void*& mapping, void*&, void*&, size_t& size)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd == -1)
+        return false;
+
+    struct stat fstat;
+    if (::fstat(fd, &fstat) == -1 || fstat.st_size == 0)
+    {
+        ::close(fd);
+        return false;
+    }
+    size = fstat.st_size;
+
+    //The mapping stays valid after the descriptor is closed
+    void* m = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (m == MAP_FAILED)
+        return false;
+    mapping = m;
+    return true;
+}
+
+#endif
+
+std::unique_ptr<FileView> MapRealFileContents(const std::string& path)
+{
+    auto view = std::make_unique<FileView>();
+    if (!MapRealFile(path, view->mapping, view->mappingHandle, view->fileHandle, view->size))
+        return nullptr;
+    view->data = static_cast<const char*>(view->mapping);
+    return view;
+}
+
+std::unique_ptr<FileView> MapFileContents(const std::string& filename)
+{
+    auto f = VFSInstance->openFile(filename.c_str());
+    if (!f)
+        return nullptr;
+    return MapFileContents(*f);
+}
+
+std::unique_ptr<FileView> MapFileContents(FileHandle& file)
+{
+    auto view = std::make_unique<FileView>();
+    GBVFS::FileSpan span = file.map();
+    if (span.data)
+    {
+        view->data = span.data;
+        view->size = span.size;
+        view->owner = std::move(span.owner);
+        return view;
+    }
+
+    size_t sz = file.getSize();
+    if (sz == 0)
+        return nullptr;
+    view->copy.reset(new char[sz]);
+    view->size = file.read(view->copy.get(), sz);
+    file.close();
+    if (view->size != sz)
+        return nullptr;
+    view->data = view->copy.get();
+    return view;
+}
+
 bool FileExists(const std::string& filename)
 {
     GBVFS::FileEntry fe = VFSInstance->getFileEntry(filename.c_str());
@@ -3,6 +3,7 @@
 #include <vector>
 #include <fstream>
 #include <memory>
+#include <cstdint>
 
 #include "gbvfs_file.hpp"
 
@@ -50,12 +51,94 @@ std::unique_ptr<FileWriterHandle> GetFileWriter(const std::string& filename);
 //! Load \p filename to memory. User must delete the returned buffer afterwards.
 char* GetFileContentsCopy(const std::string& filename, size_t* size = nullptr);
 
-//! Load \p filename to memory. User shouldn't delete or modify the returned buffer.
+/*! \brief Load \p filename to memory and keep it there
+ *
+ * The contents are mapped if possible, see MapFileContents, and aren't
+ * null terminated then. User shouldn't delete or modify the returned buffer.
+ */
 const char* GetFileContentsMaintainedCopy(const std::string& filename, size_t* size = nullptr);
 
+/*! \brief Read only view of the whole contents of a file
+ *
+ * See MapFileContents.
+ */
+class FileView
+{
+    const char* data = nullptr;
+    size_t size = 0;
+    std::unique_ptr<char[]> copy;
+    std::shared_ptr<const void> owner;
+    void* mapping = nullptr;
+    void* mappingHandle = nullptr;
+    void* fileHandle = nullptr;
+
+    friend std::unique_ptr<FileView> MapFileContents(FileHandle&);
+    friend std::unique_ptr<FileView> MapRealFileContents(const std::string&);
+public:
+    //! Get the contents, valid for the lifetime of the view
+    const char* getData() const {return data;}
+
+    //! Get the size of the contents in bytes
+    size_t getSize() const {return size;}
+
+    //! Returns true if the contents are memory mapped rather than copied
+    bool isMapped() const {return mapping != nullptr || owner != nullptr;}
+
+    FileView() = default;
+    FileView(const FileView&) = delete;
+    FileView& operator=(const FileView&) = delete;
+
+    //! Destructor, unmaps or frees the contents
+    ~FileView();
+};
+
+/*! \brief Get a read only view of \p filename
+ *
+ * The file is mapped with GBVFS::File::map, so that files on the real file
+ * system are memory mapped and only the pages actually read are loaded,
+ * and files in a pack are used in place. Files that can't be mapped are
+ * read into a copy. Returns nullptr if the file can't be read or is empty.
+ */
+std::unique_ptr<FileView> MapFileContents(const std::string& filename);
+
+/*! \brief Get a read only view of the already opened \p file
+ *
+ * Works like MapFileContents, and touches only \p file, so that it may
+ * be called from any thread.
+ */
+std::unique_ptr<FileView> MapFileContents(FileHandle& file);
+
+/*! \brief Memory map \p path on the real file system
+ *
+ * Returns nullptr if the file doesn't exist, is empty or can't be mapped.
+ */
+std::unique_ptr<FileView> MapRealFileContents(const std::string& path);
+
+/*! \brief Get the cache directory on the real file system
+ *
+ * The directory ends with a slash, or is empty if there is no cache. It is
+ * set by VFS_Init, and may be read from any thread after that.
+ */
+const std::string& GetCacheDirectory();
+
 //! Convert a VFS filename to real filesystem name (if possible)
 std::string GetFileRealName(const std::string& );
 
+//! Size and modification time of a file, see GetFileStamp
+struct FileStamp
+{
+    uint64_t size = 0;
+    //! In the units of the platform, only compared for equality
+    int64_t modified = 0;
+};
+
+/*! \brief Get the size and modification time of \p filename
+ *
+ * Only stats the file. Returns false if the file doesn't exist or isn't
+ * on the real file system, such as a file in a pack.
+ */
+bool GetFileStamp(const std::string& filename, FileStamp& stamp);
+
 //! Return the filename extension. Returns the part after the final dot.
 std::string GetFileExtension(const std::string& );
 
@@ -10,20 +10,46 @@
 #include <algorithm>
 
 #include <unordered_set>
+#include <cmath>
+#include <limits>
 
 
+void BroadPhase::updateTilemapCollisionMask()
+{
+    if (!tilemap)
+        return;
+
+    std::vector<Tileset::Value> callbackValues;
+    for (auto& p : tileCollisionCallbacks)
+        callbackValues.push_back(p.first);
+    tilemap->enableCollisionMask(callbackValues);
+}
+
 void BroadPhase::registerTileCollisionCallback(int meta, TileCollisionCallback* cb)
 {
 
     tileCollisionCallbacks[meta] = cb;
+    updateTilemapCollisionMask();
 }
 
 void BroadPhase::setTilemap(DefVector2 tsize, TilemapLayer* map)
 {
-    
+    if (tilemap && tilemap.get() != map)
+        tilemap->disableCollisionMask();
+
     tilemapTileSize = tsize;
     tilemap = ReferenceHolder<TilemapLayer>::create(map);
-    
+    updateTilemapCollisionMask();
+}
+
+unsigned int BroadPhase::getClearance(DefVector2 pos)
+{
+    if (!tilemap || tilemapTileSize.x <= 0 || tilemapTileSize.y <= 0)
+        return 0;
+
+    tilemapClearance.update(*tilemap);
+    Vector2i cell(std::floor(pos.x / tilemapTileSize.x), std::floor(pos.y / tilemapTileSize.y));
+    return tilemapClearance.getClearance(cell);
 }
     
 void BroadPhase::init()
@@ -53,6 +79,17 @@ void BroadPhase::scrLinkActor(void* ptr, int tid)
     }
     linkActor(p);
 }
+void BroadPhase::scrWakeActor(void* ptr, int tid)
+{
+    auto* p = pam->checkIsValidPhysicsActor(ptr,tid);
+    if (!p)
+    {
+        asGetActiveContext()->SetException("Collision::Wake called with illegal arguments");
+        return;
+    }
+    wakeActor(p);
+}
+
 void BroadPhase::scrRemoveActor(void* ptr, int tid)
 {
     auto* p = pam->checkIsValidPhysicsActor(ptr,tid);
@@ -79,8 +116,13 @@ void BroadPhase::clear()
         pam->releaseActor(a);
     physicsActorsToBeAdded.clear();
     physicsActorsToBeRemoved.clear();
+    nextActorOrder = 0;
+    contactCache.clear();
+    awakeEntities.clear();
+    sleepingEntities.clear();
 
     quadTree.clear();
+    staticTree.clear();
 }
 
 void BroadPhase::linkActor(PhysicsActorType* a)
@@ -101,14 +143,74 @@ void BroadPhase::removeActor(PhysicsActorType* a)
 }
 
 BroadPhase::BroadPhase(Engine* e)
-: quadTree(512, 4, 4)
+: quadTree(512, 4, 4), staticTree(512, 4, 4)
 {
     engine = e;
 
+    //The statistics are read-only for everyone else
+    std::pair<const char*, unsigned int BroadPhaseStatistics::*> stats[] =
+    {
+        {"Collision.Stats.Actors", &BroadPhaseStatistics::actors},
+        {"Collision.Stats.SleepingActors", &BroadPhaseStatistics::sleepingActors},
+        {"Collision.Stats.MovedActors", &BroadPhaseStatistics::movedActors},
+        {"Collision.Stats.Reinserts", &BroadPhaseStatistics::reinserts},
+        {"Collision.Stats.CandidatePairs", &BroadPhaseStatistics::candidatePairs},
+        {"Collision.Stats.Hits", &BroadPhaseStatistics::hits},
+        {"Collision.Stats.TileSweeps", &BroadPhaseStatistics::tileSweeps},
+        {"Collision.Stats.ScriptCallbacks", &BroadPhaseStatistics::scriptCallbacks},
+        {"Collision.Stats.MoveTime", &BroadPhaseStatistics::moveTime},
+        {"Collision.Stats.TilemapTime", &BroadPhaseStatistics::tilemapTime},
+        {"Collision.Stats.PairTime", &BroadPhaseStatistics::pairTime},
+        {"Collision.Stats.TreeNodes", &BroadPhaseStatistics::treeNodes},
+        {"Collision.Stats.TreeLeaves", &BroadPhaseStatistics::treeLeaves},
+        {"Collision.Stats.TreeMaxDepth", &BroadPhaseStatistics::treeMaxDepth},
+        {"Collision.Stats.TreeEntries", &BroadPhaseStatistics::treeEntries},
+        {"Collision.Stats.TreeMaxBucket", &BroadPhaseStatistics::treeMaxBucket}
+    };
+
+    GameVariableManager* var = engine->getVariableManager();
+    std::function<bool(const GameVariable&)> handler = [this](const GameVariable&)
+    {
+        return this->publishingStatistics;
+    };
+
+    publishingStatistics = true;
+    for (auto& p : stats)
+    {
+        //The variables outlive the BroadPhase, and are reused on restart
+        GameVariable* gv = var->getByString(p.first);
+        if (gv)
+        {
+            gv->replaceUpdateHandler(handler);
+            gv->setInteger(0);
+        }
+        else
+            gv = var->makeInteger(p.first, 0, handler);
+        gv->hideFromTrace();
+        statisticVariables.push_back({gv, p.second});
+    }
+    publishingStatistics = false;
+}
+
+void BroadPhase::publishStatistics()
+{
+    publishingStatistics = true;
+    for (auto& p : statisticVariables)
+        p.first->setInteger(statistics.*(p.second));
+    publishingStatistics = false;
 }
 
 BroadPhase::~BroadPhase()
 {
+    //The handlers refer to this, but the variables stay read-only
+    for (auto& p : statisticVariables)
+    {
+        p.first->replaceUpdateHandler(std::function<bool(const GameVariable&)>([](const GameVariable&)
+        {
+            return false;
+        }));
+    }
+
     for (auto it: actors)
         delete it.second;
     if (initialized)
@@ -116,190 +218,435 @@ BroadPhase::~BroadPhase()
 }
 
 
-void BroadPhase::narrowPhase(CollisionEntity* aent, CollisionEntity* bent)
+bool BroadPhase::narrowPhase(const CollisionEntity* aent, const CollisionEntity* bent, CollisionContact* contact)
 {
-    auto a = aent->actor;
-    auto b = bent->actor;
+    const PhysicsActorData& apad = aent->data;
+    const PhysicsActorData& bpad = bent->data;
+
     int aflags,awith,atype;
     int bflags,bwith,btype;
 
-    PhysicsActorData apad;
-    pam->getActorData(a, &apad);
-    PhysicsActorData bpad;
-    pam->getActorData(b, &bpad);
-
     aflags = apad.cflags; awith = apad.with; atype = apad.type;
     bflags = bpad.cflags; bwith = bpad.with; btype = bpad.type;
 
 
     if (!((awith & btype)||(bwith & atype)))
-        return;
+        return false;
 
+    //Projectiles are tested continuously: the line is swept in the frame of
+    //the target, so that a moving target can't skip over the projectile
     if (bflags&COLLISION_IS_PROJECTILE)
     {
-        BoxLineCollision bc = BoxLineCollision::FindCollision(apad.position, apad.size, bpad.position, bent->lastPos);
-        if (bc.found)
-        {
-            pam->collideActorWith(b, a, ActorCollisionInfo());
-        }
+        DefVector2 start = bent->lastPos + (aent->targetPos - aent->lastPos);
+        BoxLineCollision bc = BoxLineCollision::FindCollision(apad.position, apad.size, bpad.position, start);
+        if (!bc.found)
+            return false;
+
+        contact->projectile = true;
+        contact->a = const_cast<CollisionEntity*>(bent);
+        contact->b = const_cast<CollisionEntity*>(aent);
+        return true;
     }
     else if (aflags&COLLISION_IS_PROJECTILE)
     {
-        BoxLineCollision bc = BoxLineCollision::FindCollision(bpad.position, bpad.size, apad.position, aent->lastPos);
-        if (bc.found)
-        {
+        DefVector2 start = aent->lastPos + (bent->targetPos - bent->lastPos);
+        BoxLineCollision bc = BoxLineCollision::FindCollision(bpad.position, bpad.size, apad.position, start);
+        if (!bc.found)
+            return false;
+
+        contact->projectile = true;
+        contact->a = const_cast<CollisionEntity*>(aent);
+        contact->b = const_cast<CollisionEntity*>(bent);
+        return true;
+    }
+
+    BoxSweepCollision d = BoxSweepCollision::FindCollisionSlide(aent->lastPos, aent->targetPos, apad.size, bent->lastPos, bent->targetPos, bpad.size, aflags&COLLISION_IS_STATIC, bflags&COLLISION_IS_STATIC);
+    if (!d.found)
+        return false;
+
+    contact->projectile = false;
+    contact->a = const_cast<CollisionEntity*>(aent);
+    contact->b = const_cast<CollisionEntity*>(bent);
+    contact->o1NewCenter = d.o1NewCenter;
+    contact->o2NewCenter = d.o2NewCenter;
+    contact->o1Normal = d.o1Normal;
+    return true;
+}
+
+void BroadPhase::applyContact(const CollisionContact& contact)
+{
+    CollisionEntity* aent = contact.a;
+    CollisionEntity* bent = contact.b;
+    auto a = aent->actor;
+    auto b = bent->actor;
+
+    //Touching wakes up sleeping actors, but static actors stay asleep
+    if (aent->sleeping && !(aent->data.cflags&COLLISION_IS_STATIC))
+        wakeActor(a);
+    if (bent->sleeping && !(bent->data.cflags&COLLISION_IS_STATIC))
+        wakeActor(b);
+
+    if (contact.projectile)
+    {
+        if (aent->data.cflags&COLLISION_CONTACT_EVENTS)
+            updateContact(aent, bent, true, false, ActorCollisionInfo(), ActorCollisionInfo());
+        else
             pam->collideActorWith(a, b, ActorCollisionInfo());
-        }
+        return;
     }
-    else
+
+    int aflags = aent->data.cflags;
+    int bflags = bent->data.cflags;
+
+    if (!((aflags&COLLISION_IS_GHOST) || (bflags&COLLISION_IS_GHOST)))
     {
+        if (aflags&COLLISION_IS_STATIC)
+        {
+            if (bflags&COLLISION_IS_STATIC)
+            {
 
-        BoxSweepCollision d = BoxSweepCollision::FindCollisionSlide(aent->lastPos, aent->targetPos, apad.size, bent->lastPos, bent->targetPos, bpad.size, aflags&COLLISION_IS_STATIC, bflags&COLLISION_IS_STATIC);
-        if (d.found)
+            }
+            else
+            {
+                pam->setActorPosition(b, contact.o2NewCenter);
+                bent->targetPos = contact.o2NewCenter;
+                bent->stillFrames = 0;
+            }
+        }
+        else
         {
-            if (!((aflags&COLLISION_IS_GHOST) || (bflags&COLLISION_IS_GHOST)))
+            if (bflags&COLLISION_IS_STATIC)
             {
-                if (aflags&COLLISION_IS_STATIC)
-                {
-                    if (bflags&COLLISION_IS_STATIC)
-                    {
-
-                    }
-                    else
-                    {
-                        pam->setActorPosition(b, d.o2NewCenter);
-                        bent->targetPos = d.o2NewCenter;
-                    }
-                }
-                else
-                {
-                    if (bflags&COLLISION_IS_STATIC)
-                    {
-                        pam->setActorPosition(a, d.o1NewCenter);
-                        aent->targetPos = d.o1NewCenter;
-                    }
-                    else
-                    {
-                        pam->setActorPosition(a, d.o1NewCenter);
-                        pam->setActorPosition(b, d.o2NewCenter);
-                        aent->targetPos = d.o1NewCenter;
-                        bent->targetPos = d.o2NewCenter;
-                    }
-                }
+                pam->setActorPosition(a, contact.o1NewCenter);
+                aent->targetPos = contact.o1NewCenter;
+                aent->stillFrames = 0;
+            }
+            else
+            {
+                pam->setActorPosition(a, contact.o1NewCenter);
+                pam->setActorPosition(b, contact.o2NewCenter);
+                aent->targetPos = contact.o1NewCenter;
+                bent->targetPos = contact.o2NewCenter;
+                aent->stillFrames = 0;
+                bent->stillFrames = 0;
             }
-            ActorCollisionInfo aci;
-            aci.fix = d.o1NewCenter - aent->targetPos;
-            aci.normal = (d.o1Normal);
-
-            if (aflags&COLLISION_CALLBACK)
-                pam->collideActorWith(a, b, aci);
-
-            aci.fix = d.o2NewCenter - bent->targetPos;
-            aci.normal *= -1;
-            if (bflags&COLLISION_CALLBACK)
-                pam->collideActorWith(b, a, aci);
-            
         }
     }
-}
+    ActorCollisionInfo aci;
+    aci.fix = contact.o1NewCenter - aent->targetPos;
+    aci.normal = (contact.o1Normal);
 
+    ActorCollisionInfo bci;
+    bci.fix = contact.o2NewCenter - bent->targetPos;
+    bci.normal = aci.normal * -1;
 
+    bool aEvents = aflags&COLLISION_CONTACT_EVENTS;
+    bool bEvents = bflags&COLLISION_CONTACT_EVENTS;
 
-void BroadPhase::queryBoxCollision(DefVector2 center, DefVector2 size, BoxCollisionQuery* bcq)
-{
+    if (aEvents || bEvents)
+        updateContact(aent, bent, aEvents, bEvents, aci, bci);
 
-    DefVector2 min, max;
-    min = center - size;
-    max = center + size;
+    if ((aflags&COLLISION_CALLBACK) && !aEvents)
+        pam->collideActorWith(a, b, aci);
 
-    quadTree.areaFind(min, max, [&](BroadPhaseQuadTreeEntity * e)
+    if ((bflags&COLLISION_CALLBACK) && !bEvents)
+        pam->collideActorWith(b, a, bci);
+}
+
+void BroadPhase::updateContact(CollisionEntity* aent, CollisionEntity* bent, bool notifyA, bool notifyB, const ActorCollisionInfo& aci, const ActorCollisionInfo& bci)
+{
+    const ActorCollisionInfo* ai = &aci;
+    const ActorCollisionInfo* bi = &bci;
+    if (aent->order > bent->order)
     {
-        PhysicsActor* a = e->entity.actor;
+        std::swap(aent, bent);
+        std::swap(notifyA, notifyB);
+        std::swap(ai, bi);
+    }
 
-        PhysicsActorData pad;
-        pam->getActorData(a, &pad);
+    uint64_t key = (uint64_t(aent->order) << 32) | bent->order;
+    auto it = contactCache.find(key);
+    if (it == contactCache.end())
+    {
+        ContactCacheEntry entry;
+        entry.a = aent;
+        entry.b = bent;
+        entry.beginFrame = contactFrame;
+        entry.lastFrame = contactFrame;
+        entry.notifyA = notifyA;
+        entry.notifyB = notifyB;
+        contactCache.insert({key, entry});
+
+        if (notifyA)
+            pam->collideActorBegin(aent->actor, bent->actor, *ai);
+        if (notifyB)
+            pam->collideActorBegin(bent->actor, aent->actor, *bi);
+        return;
+    }
 
-        DefVector2 ap = pad.position;
-        DefVector2 as = pad.size;
+    ContactCacheEntry& entry = it->second;
 
-        BoxCollision bc = BoxCollision::FindCollision(center, size, ap, as);
+    //Already found on an earlier collision pass of this frame
+    if (entry.lastFrame == contactFrame)
+        return;
 
-        if (bc.found)
-            bcq->collision(a);
-    });
-}
+    entry.lastFrame = contactFrame;
+    entry.notifyA = notifyA;
+    entry.notifyB = notifyB;
 
+    if (contactStayInterval <= 0)
+        return;
+    if ((contactFrame - entry.beginFrame) % contactStayInterval != 0)
+        return;
 
-void BroadPhase::queryCircleCollision(DefVector2 center, float r, CircleCollisionQuery* c)
+    if (notifyA)
+        pam->collideActorWith(aent->actor, bent->actor, *ai);
+    if (notifyB)
+        pam->collideActorWith(bent->actor, aent->actor, *bi);
+}
+
+void BroadPhase::endContacts(const std::function<bool(const ContactCacheEntry&)>& predicate)
 {
+    endedContacts.clear();
+    for (auto it = contactCache.begin(); it != contactCache.end();)
+    {
+        if (predicate(it->second))
+        {
+            endedContacts.push_back(*it);
+            it = contactCache.erase(it);
+        }
+        else
+            it++;
+    }
 
-    DefVector2 min, max;
-    min.x = center.x-r;
-    min.y = center.y-r;
-    max.x = center.x+r;
-    max.y = center.y+r;
+    //Sort by key to keep the callback order deterministic
+    std::sort(endedContacts.begin(), endedContacts.end(),
+        [](const std::pair<uint64_t, ContactCacheEntry>& c1, const std::pair<uint64_t, ContactCacheEntry>& c2)
+    {
+        return c1.first < c2.first;
+    });
 
-    std::unordered_set<PhysicsActor*> factors;
-    quadTree.areaFind(min, max, [&](BroadPhaseQuadTreeEntity * e)
+    for (auto& c : endedContacts)
     {
-        factors.insert(e->entity.actor);
+        if (c.second.notifyA)
+            pam->collideActorEnd(c.second.a->actor, c.second.b->actor);
+        if (c.second.notifyB)
+            pam->collideActorEnd(c.second.b->actor, c.second.a->actor);
+    }
+    endedContacts.clear();
+}
+
+void BroadPhase::runNarrowPhasePass()
+{
+    //Gather the candidate pairs. An entity spanning multiple quadtree leaves
+    //may produce the same pair more than once, so the pairs are ordered
+    //by the actor insertion order and deduplicated.
+    candidatePairs.clear();
+    for (BroadPhaseQuadTreeEntity* e : awakeEntities)
+        e->entity.pairFrame = contactFrame;
+    quadTree.operatePairs([&](BroadPhaseQuadTreeEntity * a, BroadPhaseQuadTreeEntity * b)
+    {
+        CollisionEntity* ae = &a->entity;
+        CollisionEntity* be = &b->entity;
+        if (ae->order > be->order)
+            std::swap(ae, be);
+        candidatePairs.push_back({ae, be});
     });
 
-    for (PhysicsActor* a : factors)
+    //Sleeping and static actors are only tested against the awake ones
+    if (!sleepingEntities.empty())
     {
-        PhysicsActorData pad;
-        pam->getActorData(a, &pad);
+        for (BroadPhaseQuadTreeEntity* a : awakeEntities)
+        {
+            DefVector2 atl, abr;
+            a->getBounds(atl, abr);
+            staticTree.areaFind(atl, abr, [&](BroadPhaseQuadTreeEntity * b)
+            {
+                DefVector2 btl, bbr;
+                b->getBounds(btl, bbr);
+                if (bbr.x < atl.x || btl.x > abr.x || bbr.y < atl.y || btl.y > abr.y)
+                    return;
+
+                CollisionEntity* ae = &a->entity;
+                CollisionEntity* be = &b->entity;
+                if (ae->order > be->order)
+                    std::swap(ae, be);
+                candidatePairs.push_back({ae, be});
+            });
+        }
+    }
 
-        DefVector2 pos = pad.position;
-        DefVector2 size = pad.size/2;
+    auto pairLess = [](const std::pair<CollisionEntity*, CollisionEntity*>& p1,
+        const std::pair<CollisionEntity*, CollisionEntity*>& p2)
+    {
+        if (p1.first->order != p2.first->order)
+            return p1.first->order < p2.first->order;
+        return p1.second->order < p2.second->order;
+    };
+    std::sort(candidatePairs.begin(), candidatePairs.end(), pairLess);
+    candidatePairs.erase(std::unique(candidatePairs.begin(), candidatePairs.end()), candidatePairs.end());
+    statistics.candidatePairs += candidatePairs.size();
+
+    if (candidatePairs.empty())
+        return;
 
+    //Script callbacks of the previous pass might have changed the actors
+    snapshotStamp++;
+    for (auto& p : candidatePairs)
+    {
+        for (CollisionEntity* e : {p.first, p.second})
+        {
+            if (e->snapshotStamp == snapshotStamp)
+                continue;
+            e->snapshotStamp = snapshotStamp;
+            pam->getActorData(e->actor, &e->data);
+        }
+    }
 
-        //the circle must be within this rectangle for the collision
-        //to be possible
-        DefVector2 sizerad = pad.size/2;
-        sizerad.x += r;
-        sizerad.y += r;
+    int threadSetting = engine->getVariableManager()->getIntegerDefault(CHash("Collision.Threads"), 0);
+    unsigned int threads = threadSetting > 0 ? threadSetting : WorkerPool::getHardwareThreads();
 
-        DefVector2 delta = center-pos;
-        delta.x = fabs(delta.x);
-        delta.y = fabs(delta.y);
+    if (!narrowPhaseWorkers)
+        narrowPhaseWorkers = std::unique_ptr<WorkerPool>(new WorkerPool());
+    narrowPhaseWorkers->setThreadCount(threads - 1);
 
-        if (delta.x > sizerad.x)
-            continue;
+    //Small workloads are not worth the synchronization
+    const size_t pairsPerChunk = 256;
+    size_t chunks = 1;
+    if (threads > 1)
+        chunks = std::min<size_t>(threads * 4, (candidatePairs.size() + pairsPerChunk - 1) / pairsPerChunk);
+    if (chunks == 0)
+        chunks = 1;
 
-        if (delta.y > sizerad.y)
-            continue;
+    pairContacts.resize(candidatePairs.size());
+    pairHits.assign(candidatePairs.size(), 0);
 
-        //delta.x - radius < size.x
-        //If the circle is directly above, below, left or right to the
-        //box, a collision occurred
+    narrowPhaseWorkers->parallelFor(candidatePairs.size(), chunks, [&](size_t begin, size_t end, size_t)
+    {
+        for (size_t i = begin; i < end; i++)
+            pairHits[i] = narrowPhase(candidatePairs[i].first, candidatePairs[i].second, &pairContacts[i]);
+    });
 
-        if (delta.x < size.x)
-        {
-            c->collision(a, delta.length());
-            continue;
-        }
+    //The contacts are applied in the order of the sorted pairs, keeping the
+    //callback order independent of thread timing. A contact moves its actors,
+    //so the later pairs of an actor already in contact are tested again from
+    //the corrected positions, as if the pass ran on a single thread.
+    contactStamp++;
+    for (size_t i = 0; i < candidatePairs.size(); i++)
+    {
+        CollisionEntity* a = candidatePairs[i].first;
+        CollisionEntity* b = candidatePairs[i].second;
+        if (a->contactStamp == contactStamp || b->contactStamp == contactStamp)
+            pairHits[i] = narrowPhase(a, b, &pairContacts[i]);
 
-        if (delta.y < size.y)
-        {
-            c->collision(a, delta.length());
+        if (!pairHits[i])
             continue;
-        }
 
-        //Check corners next, need to actually calculate distances
+        statistics.hits++;
+        applyContact(pairContacts[i]);
 
-        DefVector2 delta2 = delta-size;
-        
-        //Compare squared distances for EFFICIENCY
-        if (delta2.x*delta2.x+delta2.y*delta2.y < r*r)
+        //The fixes and the script callbacks may have changed the actors
+        for (CollisionEntity* e : {a, b})
         {
-            c->collision(a, delta.length());
+            e->contactStamp = contactStamp;
+            pam->getActorData(e->actor, &e->data);
         }
     }
 }
 
 
 
+void BroadPhase::gatherQueryCandidates(DefVector2 min, DefVector2 max, std::vector<PhysicsActor*>& out)
+{
+    //An entity may be in multiple quadtree leaves; the stamp makes
+    //sure every actor is reported only once
+    queryStamp++;
+    auto visit = [&](BroadPhaseQuadTreeEntity * e)
+    {
+        if (e->entity.queryStamp == queryStamp)
+            return;
+        e->entity.queryStamp = queryStamp;
+        out.push_back(e->entity.actor);
+    };
+    quadTree.areaFind(min, max, visit);
+    staticTree.areaFind(min, max, visit);
+}
+
+static bool CircleHitsActor(DefVector2 center, float r, const PhysicsActorData& pad, float& distance)
+{
+    DefVector2 pos = pad.position;
+    DefVector2 size = pad.size/2;
+
+
+    //the circle must be within this rectangle for the collision
+    //to be possible
+    DefVector2 sizerad = pad.size/2;
+    sizerad.x += r;
+    sizerad.y += r;
+
+    DefVector2 delta = center-pos;
+    delta.x = fabs(delta.x);
+    delta.y = fabs(delta.y);
+
+    if (delta.x > sizerad.x)
+        return false;
+
+    if (delta.y > sizerad.y)
+        return false;
+
+    distance = delta.length();
+
+    //delta.x - radius < size.x
+    //If the circle is directly above, below, left or right to the
+    //box, a collision occurred
+
+    if (delta.x < size.x)
+        return true;
+
+    if (delta.y < size.y)
+        return true;
+
+    //Check corners next, need to actually calculate distances
+
+    DefVector2 delta2 = delta-size;
+    
+    //Compare squared distances for EFFICIENCY
+    return (delta2.x*delta2.x+delta2.y*delta2.y < r*r);
+}
+
+void BroadPhase::queryBoxCollision(DefVector2 center, DefVector2 size, BoxCollisionQuery* bcq)
+{
+    std::vector<PhysicsActor*> factors;
+    gatherQueryCandidates(center - size, center + size, factors);
+
+    for (PhysicsActor* a : factors)
+    {
+        PhysicsActorData pad;
+        pam->getActorData(a, &pad);
+
+        BoxCollision bc = BoxCollision::FindCollision(center, size, pad.position, pad.size);
+
+        if (bc.found)
+            bcq->collision(a);
+    }
+}
+
+
+void BroadPhase::queryCircleCollision(DefVector2 center, float r, CircleCollisionQuery* c)
+{
+    std::vector<PhysicsActor*> factors;
+    gatherQueryCandidates({center.x - r, center.y - r}, {center.x + r, center.y + r}, factors);
+
+    for (PhysicsActor* a : factors)
+    {
+        PhysicsActorData pad;
+        pam->getActorData(a, &pad);
+
+        float distance;
+        if (CircleHitsActor(center, r, pad, distance))
+            c->collision(a, distance);
+    }
+}
 
 
 void BroadPhase::queryLineCollision(DefVector2 p1, DefVector2 p2, LineCollisionQuery* c)
@@ -310,10 +657,11 @@ void BroadPhase::queryLineCollision(DefVector2 p1, DefVector2 p2, LineCollisionQ
     max.x = std::max(p1.x,p2.x);
     max.y = std::max(p1.y,p2.y);
 
-    quadTree.areaFind(min, max, [&](BroadPhaseQuadTreeEntity * e)
-    {
+    std::vector<PhysicsActor*> factors;
+    gatherQueryCandidates(min, max, factors);
 
-        PhysicsActor* a = e->entity.actor;
+    for (PhysicsActor* a : factors)
+    {
         PhysicsActorData pad;
         pam->getActorData(a, &pad);
         BoxLineCollision blc = BoxLineCollision::FindCollisionPoint(pad.position, pad.size, p1, p2);
@@ -321,20 +669,90 @@ void BroadPhase::queryLineCollision(DefVector2 p1, DefVector2 p2, LineCollisionQ
         {
             c->collision(a, blc.point);
         }
-    });
+    }
+}
+
+void BroadPhase::findBoxCollisions(DefVector2 center, DefVector2 size, const CollisionQueryFilter& filter, std::vector<PhysicsActor*>& out)
+{
+    queryScratch.clear();
+    gatherQueryCandidates(center - size, center + size, queryScratch);
+
+    for (PhysicsActor* a : queryScratch)
+    {
+        PhysicsActorData pad;
+        pam->getActorData(a, &pad);
+        if (!filter.accepts(pad))
+            continue;
 
-    /*
-    if (mapHandler)
+        if (BoxCollision::FindCollision(center, size, pad.position, pad.size).found)
+            out.push_back(a);
+    }
+}
+
+void BroadPhase::findCircleCollisions(DefVector2 center, float r, const CollisionQueryFilter& filter, std::vector<PhysicsActor*>& out, std::vector<float>* distances)
+{
+    queryScratch.clear();
+    gatherQueryCandidates({center.x - r, center.y - r}, {center.x + r, center.y + r}, queryScratch);
+
+    for (PhysicsActor* a : queryScratch)
     {
-        Vector2i ret = Vector2i(0,0);
-        if (mapHandler->getLineCollisionTile(p1, p2, ret))
+        PhysicsActorData pad;
+        pam->getActorData(a, &pad);
+        if (!filter.accepts(pad))
+            continue;
+
+        float distance;
+        if (CircleHitsActor(center, r, pad, distance))
         {
-            c->collision(nullptr, ret*mapHandler->getTileSize() + mapHandler->getTileSize() / 2);
+            out.push_back(a);
+            if (distances)
+                distances->push_back(distance);
         }
     }
-    */
 }
 
+void BroadPhase::findLineCollisions(DefVector2 p1, DefVector2 p2, const CollisionQueryFilter& filter, std::vector<PhysicsActor*>& out, std::vector<DefVector2>* points)
+{
+    DefVector2 min, max;
+    min.x = std::min(p1.x,p2.x);
+    min.y = std::min(p1.y,p2.y);
+    max.x = std::max(p1.x,p2.x);
+    max.y = std::max(p1.y,p2.y);
+
+    queryScratch.clear();
+    gatherQueryCandidates(min, max, queryScratch);
+
+    for (PhysicsActor* a : queryScratch)
+    {
+        PhysicsActorData pad;
+        pam->getActorData(a, &pad);
+        if (!filter.accepts(pad))
+            continue;
+
+        BoxLineCollision blc = BoxLineCollision::FindCollisionPoint(pad.position, pad.size, p1, p2);
+        if (blc.found)
+        {
+            out.push_back(a);
+            if (points)
+                points->push_back(blc.point);
+        }
+    }
+}
+
+
+static void AddToEntityList(std::vector<BroadPhaseQuadTreeEntity*>& list, BroadPhaseQuadTreeEntity* e)
+{
+    e->entity.listIndex = list.size();
+    list.push_back(e);
+}
+
+static void RemoveFromEntityList(std::vector<BroadPhaseQuadTreeEntity*>& list, BroadPhaseQuadTreeEntity* e)
+{
+    size_t i = e->entity.listIndex;
+    list[i] = list.back();
+    list[i]->entity.listIndex = i;
+    list.pop_back();
+}
 
 void BroadPhase::insertNewActorToQuadTree(std::pair< PhysicsActor* const, BroadPhaseQuadTreeEntity*>& p)
 {
@@ -353,10 +771,60 @@ void BroadPhase::insertNewActorToQuadTree(std::pair< PhysicsActor* const, BroadP
     cs->entity.lastPos = pos;
     cs->entity.targetPos = pos;
     cs->entity.actor = (PhysicsActor*) p.first;
+    cs->entity.order = nextActorOrder++;
+    cs->entity.data = pad;
     quadTree.insert(cs);
+    AddToEntityList(awakeEntities, cs);
     p.second = cs;
 }
 
+void BroadPhase::sleepEntity(BroadPhaseQuadTreeEntity* e)
+{
+    CollisionEntity& cc = e->entity;
+    if (cc.sleeping)
+        return;
+
+    quadTree.remove(e);
+    RemoveFromEntityList(awakeEntities, e);
+
+    //The entity no longer sweeps, so the bounds shrink to the actor
+    DefVector2 hs = cc.data.size/2;
+    cc.lastPos = cc.targetPos;
+    e->move(cc.targetPos-hs, cc.targetPos+hs);
+
+    cc.sleeping = true;
+    staticTree.insert(e);
+    statistics.reinserts++;
+    AddToEntityList(sleepingEntities, e);
+}
+
+void BroadPhase::wakeEntity(BroadPhaseQuadTreeEntity* e)
+{
+    CollisionEntity& cc = e->entity;
+    if (!cc.sleeping)
+        return;
+
+    staticTree.remove(e);
+    RemoveFromEntityList(sleepingEntities, e);
+
+    DefVector2 hs = cc.data.size/2;
+    e->move(cc.targetPos-hs, cc.targetPos+hs);
+
+    cc.sleeping = false;
+    cc.stillFrames = 0;
+    quadTree.insert(e);
+    statistics.reinserts++;
+    AddToEntityList(awakeEntities, e);
+}
+
+void BroadPhase::wakeActor(PhysicsActor* a)
+{
+    auto it = actors.find(a);
+    if (it == actors.end() || it->second == nullptr)
+        return;
+    wakeEntity(it->second);
+}
+
 void BroadPhase::setCollisionWorldSize(DefVector2 c)
 {
     collisionWorldSize = c;
@@ -369,6 +837,8 @@ void BroadPhase::setCollisionWorldSize(DefVector2 c)
     
     quadTree.clear();
     quadTree.create({0,0}, collisionWorldSize);
+    staticTree.clear();
+    staticTree.create({0,0}, collisionWorldSize);
 
     for (auto& p : actors)
     {
@@ -377,9 +847,13 @@ void BroadPhase::setCollisionWorldSize(DefVector2 c)
         {
             insertNewActorToQuadTree(p);
         }
+        else if (b->entity.sleeping)
+        {
+            staticTree.insert(b);
+        }
         else
         {
-            quadTree.insert(p.second);
+            quadTree.insert(b);
         }
     }
 }
@@ -393,6 +867,19 @@ void BroadPhase::update()
     if (!active)
         return;
     
+    if (!quadTree.isInitialized())
+        quadTree.create({0,0}, collisionWorldSize);
+    if (!staticTree.isInitialized())
+        staticTree.create({0,0}, collisionWorldSize);
+
+    bool measure = engine->getVariableManager()->getIntegerDefault(CHash("Collision.Stats"), 0) != 0;
+    statistics = BroadPhaseStatistics();
+    pam->resetCallbackCount();
+    unsigned int tileCallbacks = 0;
+    StopWatch stageTimer;
+
+    //Entities are created in the order the actors were added, giving
+    //them a deterministic ordering for the narrow phase
     for (PhysicsActorType* pat : physicsActorsToBeAdded)
     {
         auto it = actors.find(pat);
@@ -401,9 +888,12 @@ void BroadPhase::update()
             pam->releaseActor(pat);
         }
         else
-            actors.insert({pat,nullptr});
+            insertNewActorToQuadTree(*actors.insert({pat,nullptr}).first);
     }
 
+    //The removed entities are kept alive until their contacts have ended
+    std::unordered_set<CollisionEntity*> removedEntities;
+    std::vector<BroadPhaseQuadTreeEntity*> removedQuadTreeEntities;
     for (PhysicsActorType* pat : physicsActorsToBeRemoved)
     {
         auto it = actors.find(pat);
@@ -412,39 +902,71 @@ void BroadPhase::update()
             auto* st = it->second;
             if (st)
             {
-                quadTree.remove(st);
-                delete st;
-
+                if (st->entity.sleeping)
+                {
+                    staticTree.remove(st);
+                    RemoveFromEntityList(sleepingEntities, st);
+                }
+                else
+                {
+                    quadTree.remove(st);
+                    RemoveFromEntityList(awakeEntities, st);
+                }
+                removedEntities.insert(&st->entity);
+                removedQuadTreeEntities.push_back(st);
             }
-            pam->releaseActor(it->first);
+            else
+                pam->releaseActor(it->first);
             actors.erase(it);
         }
     }
     physicsActorsToBeRemoved.clear();
     physicsActorsToBeAdded.clear();
 
-    if (!quadTree.isInitialized())
-        quadTree.create({0,0}, collisionWorldSize);
+    if (!removedEntities.empty() && !contactCache.empty())
+    {
+        endContacts([&](const ContactCacheEntry& c)
+        {
+            return removedEntities.count(c.a) || removedEntities.count(c.b);
+        });
+    }
 
+    for (auto* st : removedQuadTreeEntities)
+    {
+        pam->releaseActor(st->entity.actor);
+        delete st;
+    }
 
-    for (auto& p : actors)
+    contactFrame++;
+    contactStayInterval = engine->getVariableManager()->getIntegerDefault(CHash("Collision.StayInterval"), 0);
+
+    if (measure)
+        stageTimer.start();
+
+    //Wake up the sleeping actors whose position was changed by a script,
+    //wherever they were moved. Only the positions are compared, the static
+    //tree is not touched.
+    entityScratch.clear();
+    for (BroadPhaseQuadTreeEntity* e : sleepingEntities)
     {
-        PhysicsActor* const a = p.first;
+        if (pam->getActorPosition(e->entity.actor) != e->entity.targetPos)
+            entityScratch.push_back(e);
+    }
+    for (BroadPhaseQuadTreeEntity* e : entityScratch)
+        wakeEntity(e);
 
-        if (p.second == nullptr)
-        {
-            insertNewActorToQuadTree(p);
-        }
 
-        PhysicsActorData pad;
-        pam->getActorData(a, &pad);
+    for (BroadPhaseQuadTreeEntity* e : awakeEntities)
+    {
+        CollisionEntity& cc = e->entity;
+        PhysicsActorData& pad = cc.data;
+        pam->getActorData(cc.actor, &pad);
 
 
         int flags = pad.cflags;
 
         DefVector2 pos = pad.position;
         DefVector2 hs = pad.size/2;
-        CollisionEntity& cc = p.second->entity;
 
         if (std::isnan(cc.targetPos.x) || std::isnan(cc.targetPos.y))
         {
@@ -461,12 +983,15 @@ void BroadPhase::update()
 
         if (cc.targetPos != pos)
         {
+            statistics.movedActors++;
+            statistics.reinserts++;
+            cc.stillFrames = 0;
             cc.targetPos = pos;
-            quadTree.remove(p.second);
+            quadTree.remove(e);
             if (flags & COLLISION_STEP_TELEPORT)
             {
                 cc.lastPos = pos;
-                p.second->move(pos-hs,pos+hs);
+                e->move(pos-hs,pos+hs);
             }
             else
             {
@@ -475,23 +1000,40 @@ void BroadPhase::update()
                 //the whole sweep
                 DefVector2 mins = {std::min(pos.x, cc.lastPos.x), std::min(pos.y, cc.lastPos.y)};
                 DefVector2 maxs = {std::max(pos.x, cc.lastPos.x), std::max(pos.y, cc.lastPos.y)};
-                p.second->move(mins-hs,maxs+hs);
+                e->move(mins-hs,maxs+hs);
             }
-            quadTree.insert(p.second);
+            quadTree.insert(e);
         }
+        else if (cc.stillFrames < std::numeric_limits<unsigned int>::max())
+            cc.stillFrames++;
     }
 
-
+    if (measure)
+        statistics.moveTime = stageTimer.sinceAndStart();
 
     if (tilemap)
     {
         DefVector2 offset = DefVector2(0,0);
         DefVector2 tileSize = tilemapTileSize;
-        if (tilemap)
-        for (auto it = actors.begin(); it != actors.end(); it++)
+
+        //Called only for the tiles that have a registered callback
+        PhysicsActor* tileCollisionActor = nullptr;
+        std::function<DefVector2(Vector2i, DefVector2)> func = [&](Vector2i tl, DefVector2 fix)
         {
-            PhysicsActor* const a = it->first;
-            CollisionEntity* ent = &it->second->entity;
+            auto t = tilemap->getTile({tl.x, tl.y});
+            auto at = tileCollisionCallbacks.find(t);
+            if (at != tileCollisionCallbacks.end())
+            {
+                tileCallbacks++;
+                return (*at).second->collide(tileCollisionActor, tl, fix);
+            }
+            return fix;
+        };
+
+        for (BroadPhaseQuadTreeEntity* e : awakeEntities)
+        {
+            CollisionEntity* ent = &e->entity;
+            PhysicsActor* const a = ent->actor;
 
             PhysicsActorData pad;
             pam->getActorData(a, &pad);
@@ -510,35 +1052,17 @@ void BroadPhase::update()
 
             if ((aflags&COLLISION_IS_PROJECTILE))
             {
-                DefVector2 p1,p2;
-
-                p1 = ent->lastPos;
-                p2 = ent->targetPos;
-                if (p1 == p2)
+                if (ent->lastPos == ent->targetPos)
                     continue;
-                TileMapLineCollision tmlc =  TileMapLineCollision::FindCollision(p1, p2, *tilemap, offset, tileSize);
-
-
-                if (tmlc.found)
-                {
-                    pam->setActorPosition(a, tmlc.position+tmlc.normal);
-                    pam->collideActorWithStatic(a, MapCollisionInfo());
-                }
+                statistics.tileSweeps++;
+                projectileActors.push_back(a);
+                projectileStarts.push_back(ent->lastPos - offset);
+                projectileEnds.push_back(ent->targetPos - offset);
                 continue;
             }
 
-            std::function<DefVector2(Vector2i, DefVector2)> func = [&](Vector2i tl, DefVector2 fix)
-            {
-                auto t = tilemap->getTile({tl.x, tl.y});
-                auto at = tileCollisionCallbacks.find(t);
-                if (at != tileCollisionCallbacks.end())
-                {
-                    return (*at).second->collide(a, tl, fix);
-                }
-                return fix;
-            };
-
-            
+            tileCollisionActor = a;
+            statistics.tileSweeps++;
             TileMapCollision d = TileMapCollision::FindSweepCollision(ent->lastPos, ent->targetPos, pad.size , *tilemap, offset, tileSize, func);
 
             if (d.found)
@@ -549,6 +1073,7 @@ void BroadPhase::update()
                     continue;
 
                 ent->targetPos = ent->targetPos + d.fix;
+                ent->stillFrames = 0;
                 ds = ds/ds.length();
                 MapCollisionInfo mci;
                 mci.normal = ds;
@@ -557,19 +1082,77 @@ void BroadPhase::update()
                 pam->collideActorWithStatic(a, mci);
             }
         }
+
+        projectileHits.resize(projectileActors.size());
+        TileMapLineCollision::FindCollisions(projectileStarts.data(), projectileEnds.data(), projectileActors.size(), *tilemap, tileSize, projectileHits.data());
+        for (size_t i = 0; i < projectileActors.size(); i++)
+        {
+            const TileMapLineCollision& tmlc = projectileHits[i];
+            if (!tmlc.found)
+                continue;
+            pam->setActorPosition(projectileActors[i], tmlc.position + offset + tmlc.normal);
+            pam->collideActorWithStatic(projectileActors[i], MapCollisionInfo());
+        }
+        projectileActors.clear();
+        projectileStarts.clear();
+        projectileEnds.clear();
     }
 
 
 
-    int c = 0;
+    if (measure)
+        statistics.tilemapTime = stageTimer.sinceAndStart();
+
     int collisionPassesCount = engine->getVariableManager()->getIntegerDefault(CHash("Collision.Passes"), 1);
     for (int i = 0; i < collisionPassesCount; i++)
     {
-        quadTree.operatePairs([&](BroadPhaseQuadTreeEntity * a, BroadPhaseQuadTreeEntity * b)
+        runNarrowPhasePass();
+    }
+
+    if (measure)
+        statistics.pairTime = stageTimer.since();
+
+    if (!contactCache.empty())
+    {
+        //Only the pairs with an actor that was awake when the pairs were
+        //gathered were tested. The contacts between sleeping actors are
+        //kept until one of them wakes up or is removed.
+        endContacts([&](const ContactCacheEntry& c)
         {
-            narrowPhase(&a->entity, &b->entity);
-            c++;
+            if (c.lastFrame == contactFrame)
+                return false;
+            return c.a->pairFrame == contactFrame || c.b->pairFrame == contactFrame;
         });
     }
 
+    //Put the actors that have stayed still to sleep. Static actors sleep
+    //right away, others after Collision.SleepFrames frames
+    int sleepFrames = engine->getVariableManager()->getIntegerDefault(CHash("Collision.SleepFrames"), 60);
+    entityScratch.clear();
+    for (BroadPhaseQuadTreeEntity* e : awakeEntities)
+    {
+        const CollisionEntity& cc = e->entity;
+        if (cc.stillFrames == 0 || (cc.data.cflags & COLLISION_IS_PROJECTILE))
+            continue;
+
+        if ((cc.data.cflags & COLLISION_IS_STATIC) || (sleepFrames > 0 && cc.stillFrames >= (unsigned int) sleepFrames))
+            entityScratch.push_back(e);
+    }
+    for (BroadPhaseQuadTreeEntity* e : entityScratch)
+        sleepEntity(e);
+
+    statistics.actors = actors.size();
+    statistics.sleepingActors = sleepingEntities.size();
+    statistics.scriptCallbacks = pam->getCallbackCount() + tileCallbacks;
+
+    if (measure)
+    {
+        QuadTreeStatistics tree = quadTree.getStatistics();
+        statistics.treeNodes = tree.nodes;
+        statistics.treeLeaves = tree.leaves;
+        statistics.treeMaxDepth = tree.maxDepth;
+        statistics.treeEntries = tree.entries;
+        statistics.treeMaxBucket = tree.maxBucket;
+        publishStatistics();
+    }
 }
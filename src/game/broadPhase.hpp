@@ -2,13 +2,18 @@
 #include <unordered_map>
 #include <memory>
 #include <vector>
+#include <functional>
+#include <cstdint>
 #include "game/engineDefs.hpp"
 
 #include "quadtree.hpp"
 #include "mapCollisionInfo.hpp"
 #include "game/tilemap.hpp"
+#include "game/clearance.hpp"
+#include "game/collision.hpp"
 
 #include "game/physicsActorManager.hpp"
+#include "workerPool.hpp"
 
 
 typedef DefVector2 PVector2;
@@ -49,9 +54,120 @@ public:
     DefVector2 lastPos;
     DefVector2 targetPos;
     PhysicsActor* actor;
+
+    //! Order in which the actor was added, used as a stable sort key
+    unsigned int order;
+
+    //! Snapshot of the actor data, taken before each narrow phase pass
+    PhysicsActorData data;
+
+    //! Stamp of the last query that visited this entity
+    unsigned int queryStamp = 0;
+
+    //! Stamp of the narrow phase pass that last took the snapshot
+    unsigned int snapshotStamp = 0;
+
+    //! Stamp of the narrow phase pass that last applied a contact to the entity
+    unsigned int contactStamp = 0;
+
+    //! Last contact frame when the entity was awake as the pairs were gathered
+    unsigned int pairFrame = 0;
+
+    //! Is the entity in the static tree
+    bool sleeping = false;
+
+    //! Frames the actor has stayed in place
+    unsigned int stillFrames = 0;
+
+    //! Index in the awake or sleeping entity list
+    size_t listIndex = 0;
+};
+
+/*! \brief Filter for the collision queries
+
+    The query acts like an actor with the collision type \ref type, which
+    collides with the types \ref with. An actor is accepted using the same
+    rule as in the narrow phase. The default filter accepts every actor,
+    including those whose type is 0.
+*/
+struct CollisionQueryFilter
+{
+    unsigned int with = ~0u;
+    unsigned int type = 0;
+
+    bool accepts(const PhysicsActorData& pad) const
+    {
+        if (with == ~0u && type == 0)
+            return true;
+        return (with & pad.type) || (pad.with & type);
+    }
+};
+
+/*! \brief Result of the geometric narrow phase
+
+    The contacts are computed in parallel and applied on the main thread
+    in the order of the candidate pairs. The pairs of an actor moved by an
+    earlier contact of the pass are computed again before applying.
+*/
+struct CollisionContact
+{
+    //! If set, actor a is a projectile that hit actor b
+    bool projectile;
+    CollisionEntity* a;
+    CollisionEntity* b;
+    DefVector2 o1NewCenter;
+    DefVector2 o2NewCenter;
+    DefVector2 o1Normal;
+};
+
+//! State of a pair of actors in contact, kept between frames
+struct ContactCacheEntry
+{
+    CollisionEntity* a;
+    CollisionEntity* b;
+
+    //! Frame when the contact began
+    unsigned int beginFrame;
+
+    //! Last frame when the contact was found
+    unsigned int lastFrame;
+
+    //! Which of the actors receive the contact events
+    bool notifyA;
+    bool notifyB;
 };
 
 
+/*! \brief Statistics of a single BroadPhase::update
+
+    Published as the read-only GameVariables Collision.Stats.* when
+    Collision.Stats is set. The timings are in microseconds, and the tree
+    shape is that of the dynamic quadtree.
+*/
+struct BroadPhaseStatistics
+{
+    unsigned int actors = 0;
+    unsigned int sleepingActors = 0;
+    unsigned int movedActors = 0;
+    unsigned int reinserts = 0;
+    unsigned int candidatePairs = 0;
+    unsigned int hits = 0;
+    unsigned int tileSweeps = 0;
+    unsigned int scriptCallbacks = 0;
+
+    unsigned int moveTime = 0;
+    unsigned int tilemapTime = 0;
+    unsigned int pairTime = 0;
+
+    unsigned int treeNodes = 0;
+    unsigned int treeLeaves = 0;
+    unsigned int treeMaxDepth = 0;
+    unsigned int treeEntries = 0;
+    unsigned int treeMaxBucket = 0;
+};
+
+class GameVariable;
+
 class TileCollisionCallback
 {
 public:
@@ -74,21 +190,70 @@ class BroadPhase
 {
     DefVector2 tilemapTileSize;
     ReferenceHolder<TilemapLayer> tilemap;
+    ClearanceMap tilemapClearance;
     DefVector2 collisionWorldSize {0,0};
     bool active = false;
     
     std::unordered_map<PhysicsActor*, BroadPhaseQuadTreeEntity*> actors;
     Engine* engine;
     BroadPhaseQuadTreeHolder quadTree;
-    void narrowPhase(CollisionEntity* a, CollisionEntity* b);
+    unsigned int nextActorOrder = 0;
+
+    //Static and sleeping actors are kept in their own tree, and are only
+    //tested against the awake actors
+    BroadPhaseQuadTreeHolder staticTree;
+    std::vector<BroadPhaseQuadTreeEntity*> awakeEntities;
+    std::vector<BroadPhaseQuadTreeEntity*> sleepingEntities;
+    std::vector<BroadPhaseQuadTreeEntity*> entityScratch;
+    void sleepEntity(BroadPhaseQuadTreeEntity*);
+    void wakeEntity(BroadPhaseQuadTreeEntity*);
+
+    //Narrow phase work buffers, kept between frames to avoid reallocation
+    std::vector<std::pair<CollisionEntity*, CollisionEntity*>> candidatePairs;
+    std::vector<CollisionContact> pairContacts;
+    std::vector<unsigned char> pairHits;
+
+    //Projectile lines cast against the tilemap in one batch
+    std::vector<PhysicsActor*> projectileActors;
+    std::vector<DefVector2> projectileStarts;
+    std::vector<DefVector2> projectileEnds;
+    std::vector<TileMapLineCollision> projectileHits;
+    std::unique_ptr<WorkerPool> narrowPhaseWorkers;
+
+    //Pure geometric test, safe to call from the worker threads
+    static bool narrowPhase(const CollisionEntity* a, const CollisionEntity* b, CollisionContact* contact);
+    void applyContact(const CollisionContact& contact);
+
+    //Contact cache for actors with COLLISION_CONTACT_EVENTS, keyed by the
+    //insertion orders of the actor pair
+    std::unordered_map<uint64_t, ContactCacheEntry> contactCache;
+    std::vector<std::pair<uint64_t, ContactCacheEntry>> endedContacts;
+    unsigned int contactFrame = 0;
+    int contactStayInterval = 0;
+    void updateContact(CollisionEntity* a, CollisionEntity* b, bool notifyA, bool notifyB, const ActorCollisionInfo& aci, const ActorCollisionInfo& bci);
+    void endContacts(const std::function<bool(const ContactCacheEntry&)>& predicate);
+
+    void runNarrowPhasePass();
+    unsigned int snapshotStamp = 0;
+    unsigned int contactStamp = 0;
+
+    unsigned int queryStamp = 0;
+    std::vector<PhysicsActor*> queryScratch;
+    void gatherQueryCandidates(DefVector2 min, DefVector2 max, std::vector<PhysicsActor*>& out);
     void insertNewActorToQuadTree(std::pair<PhysicsActor* const, BroadPhaseQuadTreeEntity*> & a );
 
     std::unordered_map<int, TileCollisionCallback*> tileCollisionCallbacks;
+    void updateTilemapCollisionMask();
     std::unique_ptr<PhysicsActorManager> pam;
     bool initialized = false;
 
     std::vector<PhysicsActorType*> physicsActorsToBeAdded;
     std::vector<PhysicsActorType*> physicsActorsToBeRemoved;
+
+    BroadPhaseStatistics statistics;
+    std::vector<std::pair<GameVariable*, unsigned int BroadPhaseStatistics::*>> statisticVariables;
+    bool publishingStatistics = false;
+    void publishStatistics();
 public:
     
     //! Register a TileCollisionCallback for the metatile of a certain type
@@ -103,12 +268,23 @@ public:
     //! Remove AngelScript object from the collision system
     void scrRemoveActor(void* ptr, int tid);
 
+    //! Wake up a sleeping AngelScript object
+    void scrWakeActor(void* ptr, int tid);
+
     //! Link a PhysicsActorType into the collision system
     void linkActor(PhysicsActorType* a);
     
     //! Remove a PhysicsActorType from the collision system
     void removeActor(PhysicsActorType* a);
 
+    /*! \brief Wake up a sleeping actor
+
+        Sleeping actors are woken automatically when their position
+        changes or when a contact is found. This is needed only if
+        other properties, such as the size, are changed.
+    */
+    void wakeActor(PhysicsActorType* a);
+
     //! Initialize the collision system
     void init();
     
@@ -129,12 +305,32 @@ public:
     
     //! Query a box for collisions
     void queryBoxCollision(DefVector2 center, DefVector2 size, BoxCollisionQuery*);
+
+    //! Append the actors intersecting a box and accepted by the filter to \p out
+    void findBoxCollisions(DefVector2 center, DefVector2 size, const CollisionQueryFilter& filter, std::vector<PhysicsActor*>& out);
+
+    //! Append the actors intersecting a circle and accepted by the filter to \p out
+    void findCircleCollisions(DefVector2 center, float radius, const CollisionQueryFilter& filter, std::vector<PhysicsActor*>& out, std::vector<float>* distances = nullptr);
+
+    //! Append the actors intersecting a line and accepted by the filter to \p out
+    void findLineCollisions(DefVector2 start, DefVector2 end, const CollisionQueryFilter& filter, std::vector<PhysicsActor*>& out, std::vector<DefVector2>* points = nullptr);
     
     //! Set the collision tilemap and tile size
     void setTilemap(DefVector2, TilemapLayer*);
+
+    /*! \brief Get the clearance of the collision tile at a position
+
+        Returns the size in tiles of the largest free square with the tile
+        at its top left corner, 0 if the tile is blocking or there is no
+        collision tilemap. See ClearanceMap.
+    */
+    unsigned int getClearance(DefVector2 pos);
     
     //! Set collision world size
     void setCollisionWorldSize(DefVector2);
+
+    //! Get the statistics of the latest update
+    const BroadPhaseStatistics& getStatistics() {return statistics;}
     
     //! Constructor
     BroadPhase(Engine* e);
@@ -150,3 +346,4 @@ public:
 #define COLLISION_IS_STATIC (1 << 3)
 #define COLLISION_CALLBACK (1 << 4)
 #define COLLISION_STEP_TELEPORT (1 << 5)
+#define COLLISION_CONTACT_EVENTS (1 << 6)
@@ -0,0 +1,128 @@
+#include "clearance.hpp"
+#include "pathfinding.hpp"
+#include "tilemap.hpp"
+
+void ClearanceMap::computeAll()
+{
+    values.assign(blocked.size(), 0);
+    for (int y = height - 1; y >= 0; y--)
+    for (int x = width - 1; x >= 0; x--)
+        values[x + y * width] = compute(x, y);
+}
+
+void ClearanceMap::build(const TilemapLayer& layer)
+{
+    Vector2i size = layer.getSize();
+    width = std::max(size.x, 0);
+    height = std::max(size.y, 0);
+    blocked.assign(size_t(width) * height, 0);
+
+    layer.forEachTile([this](Vector2i pos, Tileset::Value v)
+    {
+        blocked[pos.x + pos.y * width] = TilemapLayer::isBlockingValue(v);
+    });
+    computeAll();
+
+    source = &layer;
+    sourceRevision = layer.getRevision();
+}
+
+void ClearanceMap::build(const PathGrid& grid)
+{
+    width = grid.getWidth();
+    height = grid.getHeight();
+    blocked.resize(size_t(width) * height);
+
+    for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++)
+        blocked[x + y * width] = !grid.isWalkable(x, y);
+    computeAll();
+
+    source = nullptr;
+}
+
+bool ClearanceMap::update(const TilemapLayer& layer)
+{
+    if (source == &layer && sourceRevision == layer.getRevision())
+        return false;
+
+    std::vector<TilemapChange> changes;
+    Vector2i size = layer.getSize();
+    if (source != &layer || size.x != width || size.y != height ||
+        !layer.getChangesSince(sourceRevision, changes))
+    {
+        build(layer);
+        return true;
+    }
+    sourceRevision = layer.getRevision();
+
+    bool any = false;
+    for (auto& ch : changes)
+    {
+        Vector2i min = {std::max(ch.min.x, 0), std::max(ch.min.y, 0)};
+        Vector2i max = {std::min(ch.max.x, width - 1), std::min(ch.max.y, height - 1)};
+        if (min.x > max.x || min.y > max.y)
+            continue;
+
+        bool modified = false;
+        for (int y = min.y; y <= max.y; y++)
+        for (int x = min.x; x <= max.x; x++)
+        {
+            uint8_t b = layer.isCollisionTile({x, y});
+            if (blocked[x + y * width] != b)
+            {
+                blocked[x + y * width] = b;
+                modified = true;
+            }
+        }
+        if (modified)
+        {
+            repair(min, max);
+            any = true;
+        }
+    }
+    return any;
+}
+
+void ClearanceMap::repair(Vector2i min, Vector2i max)
+{
+    //A cell depends only on the cells to the right and below it, so the
+    //rows are repaired upwards. On each row, the cells above and to the
+    //left of the ones changed on the row below are recomputed, and the
+    //repair continues to the left while the values keep changing
+    int changedMin = 0;
+    int changedMax = -1;
+    for (int y = max.y; y >= 0; y--)
+    {
+        bool modifiedRow = y >= min.y;
+        if (!modifiedRow && changedMax < 0)
+            break;
+
+        int right = changedMax;
+        int left = changedMin - 1;
+        if (modifiedRow)
+        {
+            right = std::max(right, max.x);
+            left = changedMax < 0 ? min.x : std::min(left, min.x);
+        }
+
+        changedMin = width;
+        changedMax = -1;
+        bool previousChanged = false;
+        for (int x = right; x >= 0; x--)
+        {
+            if (x < left && !previousChanged)
+                break;
+
+            uint8_t v = compute(x, y);
+            uint8_t& old = values[x + y * width];
+            previousChanged = v != old;
+            if (previousChanged)
+            {
+                old = v;
+                changedMin = x;
+                changedMax = std::max(changedMax, x);
+            }
+        }
+    }
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include "engineDefs.hpp"
+#include "vector2.hpp"
+#include <algorithm>
+#include <vector>
+#include <cstdint>
+
+class TilemapLayer;
+class PathGrid;
+
+/*! \brief Clearance of every cell of a collision layer
+
+    The clearance of a cell is the size of the largest square of walkable
+    cells with the cell at its top left corner, which is the distance to
+    the nearest blocking cell to the right or below it. An agent of size
+    n, anchored the same way as in PathGrid::inflate, fits on the cell if
+    the clearance is at least n. Blocking cells have clearance 0, and the
+    cells outside the layer count as blocking.
+
+    The map is computed with a single backwards pass over the cells. When
+    built from a layer, update repairs only the cells above and to the left
+    of the modified tiles, until the values stop changing.
+*/
+class ClearanceMap
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> blocked;
+    std::vector<uint8_t> values;
+
+    const TilemapLayer* source = nullptr;
+    uint32_t sourceRevision = 0;
+
+    uint8_t compute(int x, int y) const
+    {
+        if (blocked[x + y * width])
+            return 0;
+        unsigned int right = x + 1 < width ? values[x + 1 + y * width] : 0;
+        unsigned int below = y + 1 < height ? values[x + (y + 1) * width] : 0;
+        unsigned int diagonal = (x + 1 < width && y + 1 < height) ? values[x + 1 + (y + 1) * width] : 0;
+        unsigned int c = 1 + std::min(right, std::min(below, diagonal));
+        return c > MaxClearance ? MaxClearance : c;
+    }
+
+    void computeAll();
+    void repair(Vector2i min, Vector2i max);
+
+public:
+    //! Clearances are capped to this value
+    static const unsigned int MaxClearance = 255;
+
+    //! Build the map from the blocking tiles of the layer
+    void build(const TilemapLayer& layer);
+
+    //! Build the map from the walkable cells of a grid
+    void build(const PathGrid& grid);
+
+    /*! \brief Bring the map up to date with the layer
+
+        Repairs the cells affected by the tiles modified after the last
+        update, or rebuilds everything if the layer is a different one or
+        the changes are no longer known. Returns true if anything was done.
+    */
+    bool update(const TilemapLayer& layer);
+
+    //! Get the clearance of a cell, 0 for blocking cells and cells out of bounds
+    unsigned int getClearance(Vector2i cell) const
+    {
+        if (cell.x < 0 || cell.y < 0 || cell.x >= width || cell.y >= height)
+            return 0;
+        return values[cell.x + cell.y * width];
+    }
+
+    int getWidth() const {return width;}
+    int getHeight() const {return height;}
+};
@@ -55,6 +55,15 @@ public:
     DefVector2 position;
     DefVector2 normal;
     static TileMapLineCollision FindCollision(DefVector2 p1, DefVector2 p2, TilemapLayer& map, DefVector2 mapOffset, DefVector2 tileSize);
+
+    /*! \brief Find the collisions of many lines at once
+     * 
+     * Writes the result of the line from starts[i] to ends[i] to out[i].
+     * The lines are walked through the tiles in groups, advancing every
+     * line of a group by one tile per round, which keeps several tile
+     * reads in flight instead of waiting for one line at a time.
+     */
+    static void FindCollisions(const DefVector2* starts, const DefVector2* ends, size_t count, TilemapLayer& map, DefVector2 tileSize, TileMapLineCollision* out);
 };
 
 class LineIntersection
@@ -1,5 +1,7 @@
 
 #include <algorithm>
+#include <cmath>
+#include <limits>
 #include "collision.hpp"
 #include "gridLine.hpp"
 #include "game/tilemap.hpp"
@@ -7,103 +9,133 @@
 
 TileMapLineCollision TileMapLineCollision::FindCollision(DefVector2 p1, DefVector2 p2, TilemapLayer& map, DefVector2 mapOffset, DefVector2 tileSize)
 {
-    DefVector2 minp;
-    DefVector2 maxp;
-    minp.x = std::min(p1.x,p2.x);
-    minp.y = std::min(p1.y,p2.y);
-    maxp.x = std::max(p1.x,p2.x);
-    maxp.y = std::max(p1.y,p2.y);
+    DefVector2 start = p1 - mapOffset;
+    DefVector2 end = p2 - mapOffset;
 
     TileMapLineCollision tmlc;
-    tmlc.found = false;
-    
-    Vector2i minb {-1, -1};
-    Vector2i maxb = map.getSize();
-    
-    auto inbounds = [&](const Vector2i& c)
-    {
-        return c.inside(minb, maxb);
-    };
-    
-    Vector2i lastp = Vector2i(p1/tileSize);
-    GridLine::gridIterateCellsOnLineScale(tileSize, p1, p2,[&](const Vector2i& curp)
+    FindCollisions(&start, &end, 1, map, tileSize, &tmlc);
+    if (tmlc.found)
+        tmlc.position = tmlc.position + mapOffset;
+    return tmlc;
+}
+
+void TileMapLineCollision::FindCollisions(const DefVector2* starts, const DefVector2* ends, size_t count, TilemapLayer& map, DefVector2 tileSize, TileMapLineCollision* out)
+{
+    const int Lanes = 8;
+    const double Infinity = std::numeric_limits<double>::infinity();
+
+    const Vector2i size = map.getSize();
+
+    //Grid traversal state of each line in the group, the times are
+    //fractions of the line
+    int cellX[Lanes], cellY[Lanes];
+    int stepX[Lanes], stepY[Lanes];
+    double nextX[Lanes], nextY[Lanes];
+    double deltaX[Lanes], deltaY[Lanes];
+    unsigned int remaining[Lanes];
+
+    for (size_t first = 0; first < count; first += Lanes)
     {
-        if (!inbounds(curp))
-            return false;
-        if (map.getTile(curp) == 1)
+        int lanes = (int) std::min<size_t>(Lanes, count - first);
+        int active = 0;
+
+        for (int i = 0; i < lanes; i++)
         {
-            tmlc.found = true;
-            DefVector2 min, max;
-            if (lastp.x != curp.x)
-            {
-                min.y = minp.y-1;
-                max.y = maxp.y+1;
+            out[first + i] = TileMapLineCollision();
 
-                tmlc.normal.x = 1;
-                tmlc.normal.y = 0;
+            DefVector2 a = starts[first + i] / tileSize;
+            DefVector2 b = ends[first + i] / tileSize;
+            DefVector2 d = b - a;
 
-                max.x = lastp.x*tileSize.x;
-                if (lastp.x < curp.x)
-                {
-                    max.x += tileSize.x;
-                    tmlc.normal.x = -1;
-                }
+            cellX[i] = (int) std::floor(a.x);
+            cellY[i] = (int) std::floor(a.y);
+            int endX = (int) std::floor(b.x);
+            int endY = (int) std::floor(b.y);
+
+            //The line ends after it has moved this many tiles, which
+            //stops it even if rounding makes it miss the end tile
+            remaining[i] = std::abs(endX - cellX[i]) + std::abs(endY - cellY[i]);
+            if (remaining[i] > 0)
+                active++;
 
-                min.x = max.x;
+            stepX[i] = d.x > 0 ? 1 : -1;
+            stepY[i] = d.y > 0 ? 1 : -1;
+
+            if (d.x != 0)
+            {
+                deltaX[i] = 1.0 / std::abs(d.x);
+                nextX[i] = (d.x > 0 ? cellX[i] + 1 - a.x : a.x - cellX[i]) * deltaX[i];
             }
             else
             {
-                min.x = minp.x-1;
-                max.x = maxp.x+1;
+                deltaX[i] = Infinity;
+                nextX[i] = Infinity;
+            }
 
-                tmlc.normal.x = 0;
-                tmlc.normal.y = 1;
+            if (d.y != 0)
+            {
+                deltaY[i] = 1.0 / std::abs(d.y);
+                nextY[i] = (d.y > 0 ? cellY[i] + 1 - a.y : a.y - cellY[i]) * deltaY[i];
+            }
+            else
+            {
+                deltaY[i] = Infinity;
+                nextY[i] = Infinity;
+            }
+        }
 
-                max.y = lastp.y*tileSize.y;
-                if (lastp.y < curp.y)
+        while (active > 0)
+        {
+            for (int i = 0; i < lanes; i++)
+            {
+                if (remaining[i] == 0)
+                    continue;
+
+                //The first tile is not checked, and on a tie the line
+                //moves horizontally first
+                bool vertical = nextY[i] < nextX[i];
+                double t;
+                if (vertical)
                 {
-                    max.y += tileSize.y;
-                    tmlc.normal.y = -1;
+                    t = nextY[i];
+                    cellY[i] += stepY[i];
+                    nextY[i] += deltaY[i];
                 }
+                else
+                {
+                    t = nextX[i];
+                    cellX[i] += stepX[i];
+                    nextX[i] += deltaX[i];
+                }
+                remaining[i]--;
 
-                min.y = max.y;
-            }
-
-
-            LineIntersection li = LineIntersection::FindCollision(p1,p2,min,max);
-
-            tmlc.position = li.pos;
+                bool inside = cellX[i] >= 0 && cellY[i] >= 0 && cellX[i] < size.x && cellY[i] < size.y;
+                bool hit = inside && map.getTile({cellX[i], cellY[i]}) == 1;
+                if (hit)
+                {
+                    TileMapLineCollision& r = out[first + i];
+                    r.found = true;
+                    r.position = starts[first + i] + (ends[first + i] - starts[first + i]) * t;
+                    if (vertical)
+                        r.normal = DefVector2(0, -stepY[i]);
+                    else
+                        r.normal = DefVector2(-stepX[i], 0);
+                }
 
-            return false;
+                //Lines leaving the map stop without a collision
+                if (hit || !inside)
+                    remaining[i] = 0;
+                if (remaining[i] == 0)
+                    active--;
+            }
         }
-        lastp = curp;
-        return true;
-    });
-    return tmlc;
+    }
 }
 
 TileMapCollision TileMapCollision::FindCollision(DefVector2 center, DefVector2 size, TilemapLayer& map, DefVector2 mapOffset, DefVector2 tileSize, std::function<DefVector2 (Vector2i,DefVector2)> callback, bool queryAll)
 {
     
     
-    Vector2i minb {-1, -1};
-    Vector2i maxb = map.getSize();
-    
-    auto inbounds = [&](const Vector2i& c)
-    {
-        return c.inside(minb, maxb);
-    };
-    
-    auto isblocking = [](const int i)
-    {
-        return i == 1;  
-    };
-    
-    auto iscallback = [](const int i)
-    {
-        return i >= 80;  
-    };
-    
     DefVector2 oCenter = center;
     TileMapCollision result;
     DefVector2 halfSize = size/2;
@@ -176,10 +208,7 @@ TileMapCollision TileMapCollision::FindCollision(DefVector2 center, DefVector2 s
                 continue;
             */
 
-            auto t = map.getTile({x,y});
-
-            if (inbounds({x,y}))
-            if (!(isblocking(t) || iscallback(t)))
+            if (!map.isCollisionTile({x,y}))
                 continue;
 
             //if (t->triggerCallback == true)
@@ -203,15 +232,11 @@ TileMapCollision TileMapCollision::FindCollision(DefVector2 center, DefVector2 s
             if (coll.found)
             {
 
-                if (inbounds({x,y}))
-                if (callback)
+                if (callback && map.isCollisionCallbackTile({x,y}))
                 {
-                    if (iscallback(t))
-                    {
-                        coll.fix = callback(Vector2i(x,y),coll.fix);
-                        if (coll.fix.x == 0 && coll.fix.y == 0)
-                            continue;
-                    }
+                    coll.fix = callback(Vector2i(x,y),coll.fix);
+                    if (coll.fix.x == 0 && coll.fix.y == 0)
+                        continue;
                 }
 
                 center += coll.fix;
@@ -232,24 +257,23 @@ TileMapCollision TileMapCollision::FindSweepCollision(DefVector2 c1, DefVector2
 {
     
     
-    Vector2i minb {-1, -1};
-    Vector2i maxb = map.getSize();
-    
-    auto inbounds = [&](const Vector2i& c)
-    {
-        return c.inside(minb, maxb);
-    };
-    
-    auto isblocking = [](const int i)
-    {
-        return i == 1;  
-    };
-    
-    auto iscallback = [](const int i)
+    DefVector2 halfSize = size/2;
+
+    //Fast path: if the cells under the whole sweep are free, there is
+    //nothing to collide with. One cell of margin covers touching edges.
+    if (map.hasCollisionMask())
     {
-        return i >= 80;  
-    };
-    
+        DefVector2 minp = {std::min(c1.x, c2.x), std::min(c1.y, c2.y)};
+        DefVector2 maxp = {std::max(c1.x, c2.x), std::max(c1.y, c2.y)};
+        minp = (minp - halfSize - mapOffset) / tileSize;
+        maxp = (maxp + halfSize - mapOffset) / tileSize;
+
+        Vector2i minCell = {(int) std::floor(minp.x) - 1, (int) std::floor(minp.y) - 1};
+        Vector2i maxCell = {(int) std::floor(maxp.x) + 1, (int) std::floor(maxp.y) + 1};
+        if (!map.anyCollisionTile(minCell, maxCell))
+            return TileMapCollision();
+    }
+
     //if the starting position is already inside map
     TileMapCollision result = FindCollision(c1, size, map, mapOffset, tileSize, callback);
     if (result.found)
@@ -263,8 +287,6 @@ TileMapCollision TileMapCollision::FindSweepCollision(DefVector2 c1, DefVector2
 
     result = TileMapCollision();
 
-    DefVector2 halfSize = size/2;
-
 
     //Vector2i mapDim = map->getDimensions();
 
@@ -285,12 +307,8 @@ TileMapCollision TileMapCollision::FindSweepCollision(DefVector2 c1, DefVector2
         for (auto curp : vec)
         {
             DefVector2 tcell = Vector2i(curp.x,curp.y);
-            
-
-            auto t = map.getTile(curp);
 
-            if (inbounds(curp))
-            if (!(isblocking(t) || iscallback(t)))
+            if (!map.isCollisionTile(curp))
                 continue;
             
             MapTileCollision coll = MapTileCollision::FindSweepCollision(cpd,diff,size,tcell,map,tileSize);
@@ -300,16 +318,11 @@ TileMapCollision TileMapCollision::FindSweepCollision(DefVector2 c1, DefVector2
             if (coll.found)
             {
 
-                if (inbounds(tcell))
-                if (callback)
+                if (callback && map.isCollisionCallbackTile(curp))
                 {
-                    if (iscallback(t))
-                    {
-                        coll.fix = callback(Vector2i(tcell),coll.fix);
-                        if (coll.fix.x == 0 && coll.fix.y == 0)
-                            continue;
-
-                    }
+                    coll.fix = callback(Vector2i(tcell),coll.fix);
+                    if (coll.fix.x == 0 && coll.fix.y == 0)
+                        continue;
                 }
                 //We put the new sweep start to the contact point of the collision
                 cpd = cpd + (diff - cpd) * coll.ratio;
@@ -0,0 +1,310 @@
+#include "flowField.hpp"
+#include "tilemap.hpp"
+#include "workerPool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+static const float DiagonalCost = 1.41421356f;
+static const float Unreached = std::numeric_limits<float>::infinity();
+
+const int FlowField::DirectionX[9] = {1, -1, 0, 0, 1, -1, 1, -1, 0};
+const int FlowField::DirectionY[9] = {0, 0, 1, -1, 1, 1, -1, -1, 0};
+const uint8_t FlowField::NoDirection;
+
+//Index of the opposite direction
+static const uint8_t Opposite[8] = {1, 0, 3, 2, 7, 6, 5, 4};
+
+//Start a new generation of stamps, clearing them when needed
+static uint32_t NextStamp(std::vector<uint32_t>& stamps, uint32_t& generation, size_t cells)
+{
+    if (stamps.size() != cells)
+    {
+        stamps.assign(cells, 0);
+        generation = 0;
+    }
+    generation++;
+    if (generation == 0)
+    {
+        std::fill(stamps.begin(), stamps.end(), 0);
+        generation = 1;
+    }
+    return generation;
+}
+
+FlowField::~FlowField()
+{
+    wait();
+}
+
+float FlowField::getCost(Vector2i cell) const
+{
+    if (cell.x < 0 || cell.y < 0 || cell.x >= front.width || cell.y >= front.height)
+        return -1.0f;
+    float c = front.costs[cell.x + cell.y * front.width];
+    return c == Unreached ? -1.0f : c;
+}
+
+void FlowField::setGoals(const std::vector<Vector2i>& g)
+{
+    if (g == goals)
+        return;
+    goals = g;
+    dirty = true;
+}
+
+void FlowField::setAgentSize(unsigned int size)
+{
+    size = std::max(size, 1u);
+    if (size == agentSize)
+        return;
+    agentSize = size;
+    grid = nullptr;
+}
+
+void FlowField::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCv.wait(lock, [this]()
+    {
+        return !busy;
+    });
+}
+
+bool FlowField::update(TilemapLayer& l, WorkerPool* workers)
+{
+    bool published = false;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (finished)
+        {
+            std::swap(front, back);
+            finished = false;
+            generation++;
+            published = true;
+        }
+        if (busy)
+            return published;
+    }
+
+    if (layer.get() != &l || layerRevision != l.getRevision() || !grid)
+    {
+        layer = ReferenceHolder<TilemapLayer>::create(&l);
+        layerRevision = l.getRevision();
+
+        PathGrid* g = new PathGrid();
+        if (agentSize > 1)
+        {
+            clearance.update(l);
+            g->inflate(clearance, agentSize);
+        }
+        else
+            g->build(l);
+        grid = std::shared_ptr<const PathGrid>(g);
+        dirty = true;
+    }
+
+    if (!dirty)
+        return published;
+    dirty = false;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        busy = true;
+    }
+
+    std::shared_ptr<const PathGrid> g = grid;
+    std::vector<Vector2i> gl = goals;
+    int radius = std::max(patchRadius, 0);
+    auto job = [this, g, gl, radius]()
+    {
+        run(g, gl, radius);
+    };
+
+    if (workers)
+        workers->submit(job);
+    else
+        job();
+    return published;
+}
+
+void FlowField::run(std::shared_ptr<const PathGrid> g, std::vector<Vector2i> gl, int radius)
+{
+    bool full = !baseGrid || baseGrid != g || anchors.size() != gl.size();
+    for (size_t i = 0; i < gl.size() && !full; i++)
+    {
+        int moved = std::max(std::abs(gl[i].x - anchors[i].x), std::abs(gl[i].y - anchors[i].y));
+        if (moved > radius)
+            full = true;
+    }
+
+    if (!full)
+    {
+        //The old paths lead to the old goals, which must be connected
+        //to the new ones within the window
+        markWindow(*g, gl, radius * 2);
+        for (size_t i = 0; i < gl.size() && !full; i++)
+            full = !isLinked(*g, gl[i], anchors[i]);
+    }
+
+    if (full)
+    {
+        search(*g, gl, base, false);
+        base.full = true;
+        anchors = gl;
+        baseGrid = g;
+        back = base;
+    }
+    else
+    {
+        back = base;
+        back.full = false;
+        search(*g, gl, back, true);
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finished = true;
+    busy = false;
+    doneCv.notify_all();
+}
+
+void FlowField::markWindow(const PathGrid& g, const std::vector<Vector2i>& gl, int radius)
+{
+    int w = g.getWidth();
+    int h = g.getHeight();
+    uint32_t gen = NextStamp(windowStamp, windowGeneration, size_t(w) * h);
+
+    for (auto& goal : gl)
+    {
+        int x0 = std::max(goal.x - radius, 0);
+        int y0 = std::max(goal.y - radius, 0);
+        int x1 = std::min(goal.x + radius, w - 1);
+        int y1 = std::min(goal.y + radius, h - 1);
+        for (int y = y0; y <= y1; y++)
+        for (int x = x0; x <= x1; x++)
+            windowStamp[x + y * w] = gen;
+    }
+}
+
+bool FlowField::isLinked(const PathGrid& g, Vector2i from, Vector2i to)
+{
+    bool a = g.isWalkable(from.x, from.y);
+    bool b = g.isWalkable(to.x, to.y);
+    if (!a || !b)
+        return a == b;
+
+    //Diagonal moves never cut corners, so the cells connected by the
+    //straight moves are the same
+    int w = g.getWidth();
+    uint32_t gen = NextStamp(floodStamp, floodGeneration, size_t(w) * g.getHeight());
+    uint32_t target = to.x + to.y * w;
+
+    flood.clear();
+    flood.push_back(from.x + from.y * w);
+    floodStamp[flood.back()] = gen;
+    while (!flood.empty())
+    {
+        uint32_t i = flood.back();
+        flood.pop_back();
+        if (i == target)
+            return true;
+
+        int x = i % w;
+        int y = i / w;
+        for (int d = 0; d < 4; d++)
+        {
+            int nx = x + DirectionX[d];
+            int ny = y + DirectionY[d];
+            if (!g.isWalkable(nx, ny))
+                continue;
+            uint32_t ni = nx + ny * w;
+            if (windowStamp[ni] != windowGeneration || floodStamp[ni] == gen)
+                continue;
+            floodStamp[ni] = gen;
+            flood.push_back(ni);
+        }
+    }
+    return false;
+}
+
+void FlowField::search(const PathGrid& g, const std::vector<Vector2i>& gl, Buffer& out, bool window)
+{
+    int w = g.getWidth();
+    int h = g.getHeight();
+    size_t cells = size_t(w) * h;
+
+    if (!window)
+    {
+        out.width = w;
+        out.height = h;
+        out.costs.assign(cells, Unreached);
+        out.directions.assign(cells, NoDirection);
+    }
+
+    dist.resize(cells);
+    const uint32_t gen = NextStamp(distStamp, searchGeneration, cells);
+
+    auto compare = [](const HeapNode& a, const HeapNode& b)
+    {
+        return a.cost > b.cost;
+    };
+
+    heap.clear();
+    for (auto& goal : gl)
+    {
+        if (!g.isWalkable(goal.x, goal.y))
+            continue;
+        uint32_t i = goal.x + goal.y * w;
+        distStamp[i] = gen;
+        dist[i] = 0.0f;
+        out.costs[i] = 0.0f;
+        out.directions[i] = NoDirection;
+        heap.push_back({0.0f, i});
+    }
+    std::make_heap(heap.begin(), heap.end(), compare);
+
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), compare);
+        HeapNode node = heap.back();
+        heap.pop_back();
+        if (node.cost > dist[node.index])
+            continue;
+
+        int x = node.index % w;
+        int y = node.index / w;
+        for (uint8_t d = 0; d < 8; d++)
+        {
+            int dx = DirectionX[d];
+            int dy = DirectionY[d];
+            int nx = x + dx;
+            int ny = y + dy;
+            if (!g.isWalkable(nx, ny))
+                continue;
+
+            float step = 1.0f;
+            if (dx != 0 && dy != 0)
+            {
+                if (!g.isWalkable(x + dx, y) || !g.isWalkable(x, y + dy))
+                    continue;
+                step = DiagonalCost;
+            }
+
+            uint32_t ni = nx + ny * w;
+            if (window && windowStamp[ni] != windowGeneration)
+                continue;
+
+            float c = node.cost + step;
+            if (distStamp[ni] == gen && dist[ni] <= c)
+                continue;
+
+            distStamp[ni] = gen;
+            dist[ni] = c;
+            out.costs[ni] = c;
+            out.directions[ni] = Opposite[d];
+            heap.push_back({c, ni});
+            std::push_heap(heap.begin(), heap.end(), compare);
+        }
+    }
+}
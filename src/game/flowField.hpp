@@ -0,0 +1,148 @@
+#pragma once
+#include "pathfinding.hpp"
+#include "clearance.hpp"
+#include "reference.hpp"
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <cstdint>
+
+class TilemapLayer;
+class WorkerPool;
+
+/*! \brief Shared movement directions towards a set of goals
+
+    The integration field holds the cost from every cell to the nearest
+    goal, and the direction field the first step of that path. Both are
+    computed with a multi-source Dijkstra search on a worker thread, and
+    double buffered: the queries always read the latest finished result
+    while the next one is being computed.
+
+    When the goals move at most patchRadius cells from where they were at
+    the last full search, only a window around the goals is searched
+    again. Outside the window the old directions still lead into it, so
+    following the field always reaches a goal, but the costs there are
+    those of the old goals until the next full search. A full search is
+    done when the goals move further, their amount changes, a goal is not
+    connected to its old position within the window or the layer changes.
+
+    Apart from the worker thread, the flow field must be used only from
+    the main thread.
+*/
+class FlowField
+{
+public:
+    //! Step of each direction index, the index 8 means no direction
+    static const int DirectionX[9];
+    static const int DirectionY[9];
+    static const uint8_t NoDirection = 8;
+
+private:
+    struct Buffer
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<float> costs;
+        std::vector<uint8_t> directions;
+        bool full = false;
+    };
+
+    //Read by the queries
+    Buffer front;
+    unsigned int generation = 0;
+
+    //Written by the worker
+    Buffer back;
+    Buffer base;
+    std::vector<Vector2i> anchors;
+    std::shared_ptr<const PathGrid> baseGrid;
+    std::vector<uint32_t> windowStamp;
+    uint32_t windowGeneration = 0;
+    std::vector<uint32_t> floodStamp;
+    uint32_t floodGeneration = 0;
+    std::vector<uint32_t> flood;
+    std::vector<uint32_t> distStamp;
+    std::vector<float> dist;
+    uint32_t searchGeneration = 0;
+
+    struct HeapNode
+    {
+        float cost;
+        uint32_t index;
+    };
+    std::vector<HeapNode> heap;
+
+    //Job state, guarded by mutex
+    std::mutex mutex;
+    std::condition_variable doneCv;
+    bool busy = false;
+    bool finished = false;
+
+    //Main thread state
+    ReferenceHolder<TilemapLayer> layer;
+    uint32_t layerRevision = 0;
+    std::shared_ptr<const PathGrid> grid;
+    ClearanceMap clearance;
+    unsigned int agentSize = 1;
+    std::vector<Vector2i> goals;
+    bool dirty = false;
+
+    void run(std::shared_ptr<const PathGrid> grid, std::vector<Vector2i> goals, int radius);
+    void markWindow(const PathGrid& grid, const std::vector<Vector2i>& goals, int radius);
+    bool isLinked(const PathGrid& grid, Vector2i from, Vector2i to);
+    void search(const PathGrid& grid, const std::vector<Vector2i>& goals, Buffer& out, bool window);
+
+public:
+
+    //! Maximum distance in cells the goals may move before a full search
+    int patchRadius = 8;
+
+    //! Set the goals
+    void setGoals(const std::vector<Vector2i>& goals);
+
+    //! Set the size of the agents in cells, see PathGrid::inflate
+    void setAgentSize(unsigned int size);
+
+    /*! \brief Publish the finished result and start the next search
+
+        A new search is started if the goals or the layer have changed
+        and no search is running. Returns true if a new result was made
+        visible to the queries.
+    */
+    bool update(TilemapLayer& layer, WorkerPool* workers);
+
+    //! Wait until the running search has finished
+    void wait();
+
+    //! Returns true once the first result is available
+    bool isReady() const {return generation != 0;}
+
+    //! Amount of results published so far
+    unsigned int getGeneration() const {return generation;}
+
+    //! Returns true if the latest published result was a full search
+    bool wasFullSearch() const {return front.full;}
+
+    //! Get the direction index of a cell, NoDirection for goals and unreachable cells
+    uint8_t getDirectionIndex(Vector2i cell) const
+    {
+        if (cell.x < 0 || cell.y < 0 || cell.x >= front.width || cell.y >= front.height)
+            return NoDirection;
+        return front.directions[cell.x + cell.y * front.width];
+    }
+
+    //! Get the step towards the nearest goal, (0, 0) if there is none
+    Vector2i getDirection(Vector2i cell) const
+    {
+        uint8_t d = getDirectionIndex(cell);
+        return {DirectionX[d], DirectionY[d]};
+    }
+
+    //! Get the cost to the nearest goal, negative if unreachable
+    float getCost(Vector2i cell) const;
+
+    //! Destructor, waits for the running search
+    ~FlowField();
+};
@@ -119,8 +119,53 @@ void Engine::deInit()
     broadPhase = nullptr;
     scriptEngine = nullptr;
 }
+void Engine::updatePhysicsSteps(double frameTicks)
+{
+    int rate = variableManager->getIntegerDefault(CHash("Engine.PhysicsRate"), 0);
+    if (rate <= 0)
+    {
+        //Variable step: one physics step per frame
+        physicsAccumulator = 0.0;
+        physicsSteps = 1;
+        physicsSubsteps = 1;
+        physicsDeltaTime = deltaTime;
+        physicsAlpha = 1.0;
+        return;
+    }
+
+    int tickrate = variableManager->getIntegerDefault(CHash("Engine.Tickrate"), 60);
+    int substeps = variableManager->getIntegerDefault(CHash("Engine.PhysicsSubsteps"), 1);
+    int maxSteps = variableManager->getIntegerDefault(CHash("Engine.PhysicsMaxSteps"), 5);
+    if (substeps < 1)
+        substeps = 1;
+    if (maxSteps < 1)
+        maxSteps = 1;
+
+    //Step length in engine time units
+    double step = double(tickrate) / double(rate);
+
+    physicsAccumulator += frameTicks;
+    int steps = 0;
+    while (physicsAccumulator >= step && steps < maxSteps)
+    {
+        physicsAccumulator -= step;
+        steps++;
+    }
+
+    //If the frame took too long, the rest of the time is dropped instead
+    //of trying to catch up on it during the following frames
+    if (physicsAccumulator >= step)
+        physicsAccumulator = std::fmod(physicsAccumulator, step);
+
+    physicsSteps = steps * substeps;
+    physicsSubsteps = substeps;
+    physicsDeltaTime = step / substeps;
+    physicsAlpha = physicsAccumulator / step;
+}
+
 void Engine::update()
 {
+    double frameTicks = 1.0;
     if (!isFirstStep)
     {
         long int timerSpinLockThreshold; //microseconds
@@ -185,6 +230,7 @@ void Engine::update()
         if (!timeLocked)
         {
             deltaTime = difference * tickrate;
+            frameTicks = deltaTime;
             if (deltaTime > 1.0)
                 deltaTime = 1.0;
         }
@@ -204,8 +250,14 @@ void Engine::update()
 
     double timeMultiplier = variableManager->getNumberDefault(CHash("Engine.TimeMultiplier"), 1.0);
     deltaTime *= timeMultiplier;
+    frameTicks *= timeMultiplier;
     if (gamePaused)
+    {
         deltaTime = 0.0;
+        frameTicks = 0.0;
+    }
+
+    updatePhysicsSteps(frameTicks);
     
     mainStepCounter += deltaTime;
     isMainStep = false;
@@ -216,6 +268,7 @@ void Engine::update()
     }
 
     graphics->setDeltaTime(deltaTime);
+    graphics->setInterpolationAlpha(physicsAlpha);
 
         
     if (gameOn && !gamePaused)
@@ -94,6 +94,22 @@ class Engine
     
     double mainStepCounter = 0.0f;
 
+    /*! \brief Fixed physics step state
+
+        If Engine.PhysicsRate is set, the elapsed time is accumulated and
+        consumed in fixed steps. physicsSteps tells how many steps the
+        scripts should run this frame, counting every substep, and
+        physicsAlpha how far the time is between the last full step and the
+        next one.
+     */
+    double physicsAccumulator = 0.0;
+    unsigned int physicsSteps = 1;
+    unsigned int physicsSubsteps = 1;
+    double physicsDeltaTime = 1.0;
+    double physicsAlpha = 1.0;
+
+    void updatePhysicsSteps(double frameTicks);
+
     bool gameOn = false;
     bool gamePaused = false;
     bool shutGameDown = false;
@@ -134,6 +150,22 @@ public:
 
     double getTime() {return time;};
 
+    //! Amount of physics steps to run during this frame
+    unsigned int getPhysicsSteps() {return physicsSteps;}
+
+    /*! \brief Amount of substeps in a full physics step
+
+        The drawables should be stepped only after the last substep of a
+        full step, since getPhysicsAlpha is measured in full steps.
+    */
+    unsigned int getPhysicsSubsteps() {return physicsSubsteps;}
+
+    //! Delta time of a single physics step
+    double getPhysicsDeltaTime() {return physicsDeltaTime;}
+
+    //! Fraction of a physics step elapsed after the last step
+    double getPhysicsAlpha() {return physicsAlpha;}
+
     bool getGameOn() { return gameOn; }
 
     void setGameOn();
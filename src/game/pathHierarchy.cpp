@@ -0,0 +1,539 @@
+#include "pathHierarchy.hpp"
+#include "tilemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+static const float DiagonalCost = 1.41421356f;
+static const float Unreached = std::numeric_limits<float>::infinity();
+
+//Openings at least this long get an entrance at both ends
+static const int EntranceSplitLength = 6;
+
+static bool HeapGreater(float af, float ag, float bf, float bg)
+{
+    if (af != bf)
+        return af > bf;
+    return ag < bg;
+}
+
+static float OctileDistance(Vector2i a, Vector2i b)
+{
+    float dx = std::abs(a.x - b.x);
+    float dy = std::abs(a.y - b.y);
+    return (dx + dy) + (DiagonalCost - 2.0f) * std::min(dx, dy);
+}
+
+static void AddTransitions(std::vector<int>& border, int first, int last)
+{
+    if (last - first + 1 < EntranceSplitLength)
+    {
+        border.push_back((first + last) / 2);
+        return;
+    }
+    border.push_back(first);
+    border.push_back(last);
+}
+
+void PathHierarchy::setClusterSize(int size)
+{
+    size = std::max(size, 2);
+    if (size != clusterSize)
+        source = nullptr;
+    clusterSize = size;
+}
+
+int PathHierarchy::clusterAt(Vector2i pos) const
+{
+    return (pos.x / clusterSize) + (pos.y / clusterSize) * clustersX;
+}
+
+void PathHierarchy::buildBorders(int cx, int cy)
+{
+    int c = cx + cy * clustersX;
+    int cs = clusterSize;
+
+    auto& east = eastBorders[c];
+    east.clear();
+    if (cx + 1 < clustersX)
+    {
+        int x = (cx + 1) * cs - 1;
+        int first = cy * cs;
+        int end = std::min(first + cs, grid.getHeight());
+        int run = -1;
+        for (int y = first; y <= end; y++)
+        {
+            bool open = y < end && grid.isWalkable(x, y) && grid.isWalkable(x + 1, y);
+            if (open && run < 0)
+                run = y;
+            else if (!open && run >= 0)
+            {
+                AddTransitions(east, run, y - 1);
+                run = -1;
+            }
+        }
+    }
+
+    auto& south = southBorders[c];
+    south.clear();
+    if (cy + 1 < clustersY)
+    {
+        int y = (cy + 1) * cs - 1;
+        int first = cx * cs;
+        int end = std::min(first + cs, grid.getWidth());
+        int run = -1;
+        for (int x = first; x <= end; x++)
+        {
+            bool open = x < end && grid.isWalkable(x, y) && grid.isWalkable(x, y + 1);
+            if (open && run < 0)
+                run = x;
+            else if (!open && run >= 0)
+            {
+                AddTransitions(south, run, x - 1);
+                run = -1;
+            }
+        }
+    }
+}
+
+void PathHierarchy::searchCluster(int cluster, Vector2i from, const Vector2i* target)
+{
+    int cs = clusterSize;
+    int x0 = (cluster % clustersX) * cs;
+    int y0 = (cluster / clustersX) * cs;
+    int x1 = std::min(x0 + cs, grid.getWidth());
+    int y1 = std::min(y0 + cs, grid.getHeight());
+
+    localDist.assign(cs * cs, Unreached);
+    localParent.assign(cs * cs, -1);
+    localHeap.clear();
+
+    auto compare = [](const HeapNode& a, const HeapNode& b)
+    {
+        return HeapGreater(a.f, a.g, b.f, b.g);
+    };
+
+    //Without a target, the distances to every cell are searched
+    uint32_t first = (from.x - x0) + (from.y - y0) * cs;
+    uint32_t last = target ? (target->x - x0) + (target->y - y0) * cs : ~0u;
+    localDist[first] = 0.0f;
+    localHeap.push_back({target ? OctileDistance(from, *target) : 0.0f, 0.0f, first});
+
+    static const int dirs[8][2] = {{1,0},{-1,0},{0,1},{0,-1},{1,1},{-1,1},{1,-1},{-1,-1}};
+    while (!localHeap.empty())
+    {
+        std::pop_heap(localHeap.begin(), localHeap.end(), compare);
+        HeapNode node = localHeap.back();
+        localHeap.pop_back();
+        if (node.g > localDist[node.index])
+            continue;
+        if (node.index == last)
+            return;
+
+        int x = x0 + node.index % cs;
+        int y = y0 + node.index / cs;
+        for (int i = 0; i < 8; i++)
+        {
+            int dx = dirs[i][0];
+            int dy = dirs[i][1];
+            int nx = x + dx;
+            int ny = y + dy;
+            if (nx < x0 || nx >= x1 || ny < y0 || ny >= y1 || !grid.isWalkable(nx, ny))
+                continue;
+
+            float step = 1.0f;
+            if (dx != 0 && dy != 0)
+            {
+                if (!grid.isWalkable(x + dx, y) || !grid.isWalkable(x, y + dy))
+                    continue;
+                step = DiagonalCost;
+            }
+
+            uint32_t ni = (nx - x0) + (ny - y0) * cs;
+            float d = node.g + step;
+            if (d < localDist[ni])
+            {
+                localDist[ni] = d;
+                localParent[ni] = node.index;
+                localHeap.push_back({target ? d + OctileDistance({nx, ny}, *target) : d, d, ni});
+                std::push_heap(localHeap.begin(), localHeap.end(), compare);
+            }
+        }
+    }
+}
+
+float PathHierarchy::getLocalDistance(int cluster, Vector2i to) const
+{
+    int x0 = (cluster % clustersX) * clusterSize;
+    int y0 = (cluster / clustersX) * clusterSize;
+    float d = localDist[(to.x - x0) + (to.y - y0) * clusterSize];
+    return d == Unreached ? -1.0f : d;
+}
+
+void PathHierarchy::appendLocalPath(int cluster, Vector2i to, std::vector<Vector2i>& out) const
+{
+    int cs = clusterSize;
+    int x0 = (cluster % clustersX) * cs;
+    int y0 = (cluster / clustersX) * cs;
+
+    size_t begin = out.size();
+    for (int32_t i = (to.x - x0) + (to.y - y0) * cs; localParent[i] >= 0; i = localParent[i])
+        out.push_back({x0 + i % cs, y0 + i / cs});
+    std::reverse(out.begin() + begin, out.end());
+}
+
+void PathHierarchy::buildCluster(int c)
+{
+    int cx = c % clustersX;
+    int cy = c / clustersX;
+    int cs = clusterSize;
+    Cluster& cl = clusters[c];
+
+    cl.nodes.clear();
+    for (int y : eastBorders[c])
+        cl.nodes.push_back({(cx + 1) * cs - 1, y});
+
+    cl.westOffset = cl.nodes.size();
+    if (cx > 0)
+    {
+        for (int y : eastBorders[c - 1])
+            cl.nodes.push_back({cx * cs, y});
+    }
+
+    cl.southOffset = cl.nodes.size();
+    for (int x : southBorders[c])
+        cl.nodes.push_back({x, (cy + 1) * cs - 1});
+
+    cl.northOffset = cl.nodes.size();
+    if (cy > 0)
+    {
+        for (int x : southBorders[c - clustersX])
+            cl.nodes.push_back({x, cy * cs});
+    }
+
+    //The costs are symmetric, the last entrance needs no search of its own
+    size_t n = cl.nodes.size();
+    cl.costs.assign(n * n, -1.0f);
+    for (size_t i = 0; i + 1 < n; i++)
+    {
+        cl.costs[i * n + i] = 0.0f;
+        searchCluster(c, cl.nodes[i]);
+        for (size_t j = i + 1; j < n; j++)
+        {
+            float d = getLocalDistance(c, cl.nodes[j]);
+            cl.costs[i * n + j] = d;
+            cl.costs[j * n + i] = d;
+        }
+    }
+    if (n > 0)
+        cl.costs[n * n - 1] = 0.0f;
+}
+
+void PathHierarchy::buildIndex()
+{
+    nodeBase.resize(clusters.size());
+    nodeCount = 0;
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        nodeBase[c] = nodeCount;
+        nodeCount += clusters[c].nodes.size();
+    }
+
+    nodeCluster.resize(nodeCount);
+    for (size_t c = 0; c < clusters.size(); c++)
+        std::fill(nodeCluster.begin() + nodeBase[c], nodeCluster.begin() + nodeBase[c] + clusters[c].nodes.size(), c);
+
+    //The start and the goal are the two extra nodes
+    if (openStamp.size() != nodeCount + 2)
+    {
+        openStamp.assign(nodeCount + 2, 0);
+        closedStamp.assign(nodeCount + 2, 0);
+        gCost.resize(nodeCount + 2);
+        parent.resize(nodeCount + 2);
+        generation = 0;
+    }
+}
+
+uint32_t PathHierarchy::getLink(int c, unsigned int i, int& linked) const
+{
+    const Cluster& cl = clusters[c];
+    if (i < cl.westOffset)
+    {
+        linked = c + 1;
+        return clusters[linked].westOffset + i;
+    }
+    if (i < cl.southOffset)
+    {
+        linked = c - 1;
+        return i - cl.westOffset;
+    }
+    if (i < cl.northOffset)
+    {
+        linked = c + clustersX;
+        return clusters[linked].northOffset + (i - cl.southOffset);
+    }
+    linked = c - clustersX;
+    return clusters[linked].southOffset + (i - cl.northOffset);
+}
+
+void PathHierarchy::build(const TilemapLayer& layer)
+{
+    grid.build(layer);
+    source = &layer;
+    sourceRevision = layer.getRevision();
+
+    clustersX = (grid.getWidth() + clusterSize - 1) / clusterSize;
+    clustersY = (grid.getHeight() + clusterSize - 1) / clusterSize;
+    size_t count = size_t(clustersX) * clustersY;
+
+    eastBorders.assign(count, std::vector<int>());
+    southBorders.assign(count, std::vector<int>());
+    clusters.assign(count, Cluster());
+
+    for (int cy = 0; cy < clustersY; cy++)
+    for (int cx = 0; cx < clustersX; cx++)
+        buildBorders(cx, cy);
+
+    for (size_t c = 0; c < count; c++)
+        buildCluster(c);
+
+    buildIndex();
+    repairedClusters = count;
+}
+
+bool PathHierarchy::update(const TilemapLayer& layer)
+{
+    repairedClusters = 0;
+
+    std::vector<TilemapChange> changes;
+    Vector2i size = layer.getSize();
+    if (source != &layer || size.x != grid.getWidth() || size.y != grid.getHeight() ||
+        !layer.getChangesSince(sourceRevision, changes))
+    {
+        build(layer);
+        return true;
+    }
+
+    sourceRevision = layer.getRevision();
+    if (changes.empty())
+        return false;
+
+    //The borders depend on the cells on both sides, so the clusters next
+    //to the modified cells are included
+    std::vector<uint8_t> touched(clusters.size(), 0);
+    bool anyTouched = false;
+    for (auto& ch : changes)
+    {
+        for (int y = ch.min.y; y <= ch.max.y; y++)
+        for (int x = ch.min.x; x <= ch.max.x; x++)
+        {
+            bool walkable = !layer.isCollisionTile({x, y});
+            if (walkable == grid.isWalkable(x, y))
+                continue;
+            grid.setBlocked({x, y}, !walkable);
+
+            int cx0 = std::max(x - 1, 0) / clusterSize;
+            int cy0 = std::max(y - 1, 0) / clusterSize;
+            int cx1 = std::min(x + 1, grid.getWidth() - 1) / clusterSize;
+            int cy1 = std::min(y + 1, grid.getHeight() - 1) / clusterSize;
+            for (int cy = cy0; cy <= cy1; cy++)
+            for (int cx = cx0; cx <= cx1; cx++)
+                touched[cx + cy * clustersX] = 1;
+            anyTouched = true;
+        }
+    }
+    if (!anyTouched)
+        return false;
+
+    //A changed east or south border of a touched cluster changes the
+    //entrances of the cluster on the other side as well
+    std::vector<uint8_t> rebuild(touched);
+    std::vector<int> oldEast, oldSouth;
+    for (int cy = 0; cy < clustersY; cy++)
+    for (int cx = 0; cx < clustersX; cx++)
+    {
+        int c = cx + cy * clustersX;
+        if (!touched[c])
+            continue;
+
+        oldEast.swap(eastBorders[c]);
+        oldSouth.swap(southBorders[c]);
+        buildBorders(cx, cy);
+        if (cx + 1 < clustersX && oldEast != eastBorders[c])
+            rebuild[c + 1] = 1;
+        if (cy + 1 < clustersY && oldSouth != southBorders[c])
+            rebuild[c + clustersX] = 1;
+    }
+
+    for (size_t c = 0; c < clusters.size(); c++)
+    {
+        if (rebuild[c])
+        {
+            buildCluster(c);
+            repairedClusters++;
+        }
+    }
+
+    buildIndex();
+    return true;
+}
+
+Vector2i PathHierarchy::getNodePosition(uint32_t node, Vector2i start, Vector2i goal) const
+{
+    if (node == nodeCount)
+        return start;
+    if (node == nodeCount + 1)
+        return goal;
+    uint32_t c = nodeCluster[node];
+    return clusters[c].nodes[node - nodeBase[c]];
+}
+
+void PathHierarchy::push(uint32_t node, uint32_t from, float g, Vector2i position, Vector2i goal)
+{
+    if (closedStamp[node] == generation)
+        return;
+    if (openStamp[node] == generation && gCost[node] <= g)
+        return;
+
+    openStamp[node] = generation;
+    gCost[node] = g;
+    parent[node] = from;
+
+    heap.push_back({g + heuristicWeight * OctileDistance(position, goal), g, node});
+    std::push_heap(heap.begin(), heap.end(), [](const HeapNode& a, const HeapNode& b)
+    {
+        return HeapGreater(a.f, a.g, b.f, b.g);
+    });
+}
+
+PathResult PathHierarchy::find(Vector2i start, Vector2i goal, std::vector<Vector2i>& out, bool refine)
+{
+    out.clear();
+    expanded = 0;
+    cost = 0.0f;
+    if (!grid.isWalkable(start.x, start.y) || !grid.isWalkable(goal.x, goal.y))
+        return PathResult::Invalid;
+
+    int sc = clusterAt(start);
+    int gc = clusterAt(goal);
+    const uint32_t startNode = nodeCount;
+    const uint32_t goalNode = nodeCount + 1;
+
+    //Connect the start and the goal to the entrances of their clusters.
+    //The moves are symmetric, so the goal costs are searched from the goal
+    searchCluster(gc, goal);
+    const Cluster& gcl = clusters[gc];
+    goalCosts.resize(gcl.nodes.size());
+    for (size_t i = 0; i < gcl.nodes.size(); i++)
+        goalCosts[i] = getLocalDistance(gc, gcl.nodes[i]);
+    float direct = (sc == gc) ? getLocalDistance(gc, start) : -1.0f;
+
+    searchCluster(sc, start);
+    const Cluster& scl = clusters[sc];
+    startCosts.resize(scl.nodes.size());
+    for (size_t i = 0; i < scl.nodes.size(); i++)
+        startCosts[i] = getLocalDistance(sc, scl.nodes[i]);
+
+    generation++;
+    if (generation == 0)
+    {
+        std::fill(openStamp.begin(), openStamp.end(), 0);
+        std::fill(closedStamp.begin(), closedStamp.end(), 0);
+        generation = 1;
+    }
+    heap.clear();
+
+    auto compare = [](const HeapNode& a, const HeapNode& b)
+    {
+        return HeapGreater(a.f, a.g, b.f, b.g);
+    };
+
+    push(startNode, startNode, 0.0f, start, goal);
+    bool found = false;
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), compare);
+        HeapNode node = heap.back();
+        heap.pop_back();
+
+        uint32_t index = node.index;
+        if (closedStamp[index] == generation || node.g > gCost[index])
+            continue;
+        closedStamp[index] = generation;
+
+        if (index == goalNode)
+        {
+            found = true;
+            break;
+        }
+        expanded++;
+
+        float g = gCost[index];
+        if (index == startNode)
+        {
+            for (size_t i = 0; i < startCosts.size(); i++)
+            {
+                if (startCosts[i] >= 0.0f)
+                    push(nodeBase[sc] + i, index, startCosts[i], scl.nodes[i], goal);
+            }
+            if (direct >= 0.0f)
+                push(goalNode, index, direct, goal, goal);
+            continue;
+        }
+
+        uint32_t c = nodeCluster[index];
+        uint32_t i = index - nodeBase[c];
+        const Cluster& cl = clusters[c];
+        size_t n = cl.nodes.size();
+        for (size_t j = 0; j < n; j++)
+        {
+            float step = cl.costs[i * n + j];
+            if (j != i && step >= 0.0f)
+                push(nodeBase[c] + j, index, g + step, cl.nodes[j], goal);
+        }
+
+        int linked;
+        uint32_t li = getLink(c, i, linked);
+        push(nodeBase[linked] + li, index, g + 1.0f, clusters[linked].nodes[li], goal);
+
+        if (int(c) == gc && goalCosts[i] >= 0.0f)
+            push(goalNode, index, g + goalCosts[i], goal, goal);
+    }
+
+    if (!found)
+        return PathResult::NotFound;
+    cost = gCost[goalNode];
+
+    std::vector<uint32_t> chain;
+    for (uint32_t n = goalNode; n != startNode; n = parent[n])
+        chain.push_back(n);
+    chain.push_back(startNode);
+    std::reverse(chain.begin(), chain.end());
+
+    out.push_back(start);
+    for (size_t k = 1; k < chain.size(); k++)
+    {
+        Vector2i a = getNodePosition(chain[k - 1], start, goal);
+        Vector2i b = getNodePosition(chain[k], start, goal);
+        if (!refine)
+        {
+            if (b != out.back())
+                out.push_back(b);
+            continue;
+        }
+
+        int c = clusterAt(a);
+        if (c != clusterAt(b))
+        {
+            out.push_back(b);
+            continue;
+        }
+        searchCluster(c, a, &b);
+        appendLocalPath(c, b, out);
+    }
+
+    if (refine)
+        CompressPath(out);
+    return PathResult::Found;
+}
@@ -0,0 +1,140 @@
+#pragma once
+#include "pathfinding.hpp"
+#include <vector>
+#include <cstdint>
+
+class TilemapLayer;
+struct TilemapChange;
+
+/*! \brief Hierarchical pathfinding (HPA*) over the collision tiles of a layer
+
+    The map is divided into square clusters. Where two neighbouring
+    clusters are connected, entrance nodes are placed on both sides of the
+    border: one in the middle of short openings, and one at both ends of
+    long ones. The costs between the entrances of each cluster are
+    precomputed, which makes a small abstract graph that long searches run
+    on. The abstract path is then refined into cells one cluster at a time.
+
+    When the layer is modified, only the clusters touching the modified
+    tiles and their neighbours are rebuilt, using the change log of the
+    layer. The paths are optimal within the abstract graph, which makes
+    them slightly longer than the ones of GridPathfinder. Diagonal moves
+    are always allowed and never cut corners.
+*/
+class PathHierarchy
+{
+    struct Cluster
+    {
+        //Entrance cells, grouped by the east, west, south and north borders
+        std::vector<Vector2i> nodes;
+        unsigned int westOffset = 0;
+        unsigned int southOffset = 0;
+        unsigned int northOffset = 0;
+
+        //Cost between every pair of entrances, negative if not connected
+        std::vector<float> costs;
+    };
+
+    struct HeapNode
+    {
+        float f;
+        float g;
+        uint32_t index;
+    };
+
+    int clusterSize = 16;
+    int clustersX = 0;
+    int clustersY = 0;
+    PathGrid grid;
+
+    const TilemapLayer* source = nullptr;
+    uint32_t sourceRevision = 0;
+
+    //The transitions from cluster (x, y) to (x + 1, y) as rows, and to
+    //(x, y + 1) as columns
+    std::vector<std::vector<int>> eastBorders;
+    std::vector<std::vector<int>> southBorders;
+
+    std::vector<Cluster> clusters;
+    std::vector<uint32_t> nodeBase;
+    std::vector<uint32_t> nodeCluster;
+    uint32_t nodeCount = 0;
+
+    //Bounded search within a single cluster
+    std::vector<float> localDist;
+    std::vector<int32_t> localParent;
+    std::vector<HeapNode> localHeap;
+    void searchCluster(int cluster, Vector2i from, const Vector2i* target = nullptr);
+    float getLocalDistance(int cluster, Vector2i to) const;
+    void appendLocalPath(int cluster, Vector2i to, std::vector<Vector2i>& out) const;
+
+    //Abstract graph search state
+    std::vector<HeapNode> heap;
+    std::vector<float> gCost;
+    std::vector<uint32_t> parent;
+    std::vector<uint32_t> openStamp;
+    std::vector<uint32_t> closedStamp;
+    uint32_t generation = 0;
+    std::vector<float> startCosts;
+    std::vector<float> goalCosts;
+
+    unsigned int expanded = 0;
+    float cost = 0.0f;
+    unsigned int repairedClusters = 0;
+
+    int clusterAt(Vector2i pos) const;
+    void buildBorders(int cx, int cy);
+    void buildCluster(int cluster);
+    void buildIndex();
+    uint32_t getLink(int cluster, unsigned int node, int& linkedCluster) const;
+    Vector2i getNodePosition(uint32_t node, Vector2i start, Vector2i goal) const;
+    void push(uint32_t node, uint32_t from, float g, Vector2i position, Vector2i goal);
+
+public:
+
+    /*! \brief Weight of the heuristic in the abstract search
+
+        Values above 1 expand far fewer nodes on long searches, at the
+        cost of paths up to that many times longer. In practice the paths
+        are only a few percent longer.
+    */
+    float heuristicWeight = 1.0f;
+
+    //! Build the hierarchy from scratch
+    void build(const TilemapLayer& layer);
+
+    /*! \brief Bring the hierarchy up to date with the layer
+
+        Repairs the clusters modified after the last update, or rebuilds
+        everything if the layer is a different one or the changes are no
+        longer known. Returns true if anything was done.
+    */
+    bool update(const TilemapLayer& layer);
+
+    //! Set the width and the height of the clusters, takes effect on the next build
+    void setClusterSize(int size);
+
+    /*! \brief Find a path between two cells
+
+        The waypoints are written to \p out, which is cleared first. If
+        \p refine is false, only the start, the entrances and the goal
+        are written, and the straight lines between them may not be
+        walkable.
+    */
+    PathResult find(Vector2i start, Vector2i goal, std::vector<Vector2i>& out, bool refine = true);
+
+    //! Amount of abstract nodes expanded during the last search
+    unsigned int getExpanded() const {return expanded;}
+
+    //! Cost of the last path found, a diagonal step costs sqrt(2)
+    float getCost() const {return cost;}
+
+    //! Amount of entrance nodes in the abstract graph
+    unsigned int getNodeCount() const {return nodeCount;}
+
+    //! Amount of clusters rebuilt by the last update
+    unsigned int getRepairedClusters() const {return repairedClusters;}
+
+    //! Get the walkability grid the hierarchy was built from
+    const PathGrid& getGrid() const {return grid;}
+};
@@ -0,0 +1,361 @@
+#include "pathService.hpp"
+#include "tilemap.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+//Orders the queue heap: highest priority first, then the oldest request
+bool PathService::queueLess(const std::shared_ptr<PathTicket>& a, const std::shared_ptr<PathTicket>& b)
+{
+    if (a->query.priority != b->query.priority)
+        return a->query.priority < b->query.priority;
+    return a->order > b->order;
+}
+
+PathService::PathService(unsigned int threads) : workers(threads)
+{
+}
+
+PathService::~PathService()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& t : queue)
+            t->cancelled = true;
+    }
+    workers.waitTasks();
+}
+
+std::shared_ptr<const PathGrid> PathService::getSnapshot(TilemapLayer& l, unsigned int agentSize)
+{
+    if (layer.get() != &l || layerRevision != l.getRevision())
+    {
+        layer = ReferenceHolder<TilemapLayer>::create(&l);
+        layerRevision = l.getRevision();
+        snapshots.clear();
+        clearCache();
+    }
+
+    if (agentSize == 0)
+        agentSize = 1;
+    if (snapshots.size() < agentSize)
+        snapshots.resize(agentSize);
+
+    auto& snapshot = snapshots[agentSize - 1];
+    if (!snapshot)
+    {
+        PathGrid* grid = new PathGrid();
+        if (agentSize == 1)
+            grid->build(l);
+        else
+        {
+            clearance.update(l);
+            grid->inflate(clearance, agentSize);
+        }
+        snapshot = std::shared_ptr<const PathGrid>(grid);
+    }
+    return snapshot;
+}
+
+bool PathService::makeCacheKey(const PathQuery& q, CacheKey& key) const
+{
+    if (cacheCapacity == 0 || q.agentSize > 15)
+        return false;
+    if (q.start.x < 0 || q.start.y < 0 || q.goal.x < 0 || q.goal.y < 0)
+        return false;
+
+    uint64_t coords[4] = {
+        uint64_t(q.start.x / cacheQuantum), uint64_t(q.start.y / cacheQuantum),
+        uint64_t(q.goal.x / cacheQuantum), uint64_t(q.goal.y / cacheQuantum)};
+
+    //14 bits per coordinate, 4 bits for the size and one for each movement rule
+    key.cells = 0;
+    for (uint64_t c : coords)
+    {
+        if (c >= (1 << 14))
+            return false;
+        key.cells = (key.cells << 14) | c;
+    }
+    key.cells = (key.cells << 4) | q.agentSize;
+    key.cells = (key.cells << 1) | (q.diagonal ? 1 : 0);
+    key.cells = (key.cells << 1) | (q.jumpPoints ? 1 : 0);
+    key.maxExpanded = q.maxExpanded;
+    return true;
+}
+
+/*
+    Returns true if the straight line between the centers of two cells
+    crosses only walkable cells. Where the line passes exactly through a
+    corner, both cells beside the corner must be walkable, like with the
+    diagonal moves of GridPathfinder.
+*/
+static bool LineOfSight(const PathGrid& grid, Vector2i a, Vector2i b)
+{
+    int dx = std::abs(b.x - a.x);
+    int dy = std::abs(b.y - a.y);
+    int sx = b.x > a.x ? 1 : -1;
+    int sy = b.y > a.y ? 1 : -1;
+
+    int x = a.x;
+    int y = a.y;
+    int error = dx - dy;
+    for (int n = dx + dy; ; n--)
+    {
+        if (!grid.isWalkable(x, y))
+            return false;
+        if (n <= 0)
+            return true;
+
+        if (error > 0)
+        {
+            x += sx;
+            error -= dy * 2;
+        }
+        else if (error < 0)
+        {
+            y += sy;
+            error += dx * 2;
+        }
+        else
+        {
+            if (!grid.isWalkable(x + sx, y) || !grid.isWalkable(x, y + sy))
+                return false;
+            x += sx;
+            y += sy;
+            error += (dx - dy) * 2;
+            n--;
+        }
+    }
+}
+
+//Cost of the cheapest walk between two cells on an open grid
+static float OctileDistance(Vector2i a, Vector2i b)
+{
+    int dx = std::abs(b.x - a.x);
+    int dy = std::abs(b.y - a.y);
+    return std::max(dx, dy) + (std::sqrt(2.0f) - 1.0f) * std::min(dx, dy);
+}
+
+bool PathService::findCached(PathTicket& ticket, const PathGrid& grid)
+{
+    CacheKey key;
+    if (!makeCacheKey(ticket.query, key))
+        return false;
+
+    auto it = cacheIndex.find(key);
+    if (it == cacheIndex.end())
+    {
+        cacheMisses++;
+        return false;
+    }
+
+    const CacheEntry& e = *it->second;
+    const PathQuery& q = ticket.query;
+
+    //The path of a nearby start or goal must be reachable in a straight line
+    Vector2i front = e.points.front();
+    Vector2i back = e.points.back();
+    if ((front != q.start && !LineOfSight(grid, q.start, front)) ||
+        (back != q.goal && !LineOfSight(grid, back, q.goal)))
+    {
+        cacheMisses++;
+        return false;
+    }
+    cacheHits++;
+
+    //Move to the front of the LRU list
+    cache.splice(cache.begin(), cache, it->second);
+
+    ticket.result = PathResult::Found;
+    ticket.points = e.points;
+    ticket.cost = e.cost;
+    ticket.cached = true;
+
+    if (front != q.start)
+    {
+        ticket.points.insert(ticket.points.begin(), q.start);
+        ticket.cost += OctileDistance(q.start, front);
+    }
+    if (back != q.goal)
+    {
+        ticket.points.push_back(q.goal);
+        ticket.cost += OctileDistance(back, q.goal);
+    }
+    return true;
+}
+
+void PathService::storeCached(const PathTicket& ticket)
+{
+    //A failed search says nothing about the other cells sharing the key
+    if (ticket.cached || ticket.result != PathResult::Found || ticket.points.empty())
+        return;
+
+    //Results searched on an older snapshot are not cached
+    if (layer.get() == nullptr || ticket.revision != layerRevision)
+        return;
+
+    CacheKey key;
+    if (!makeCacheKey(ticket.query, key))
+        return;
+
+    auto it = cacheIndex.find(key);
+    if (it != cacheIndex.end())
+    {
+        cache.splice(cache.begin(), cache, it->second);
+        return;
+    }
+
+    cache.push_front({key, ticket.points, ticket.cost});
+    cacheIndex[key] = cache.begin();
+
+    while (cache.size() > cacheCapacity)
+    {
+        cacheIndex.erase(cache.back().key);
+        cache.pop_back();
+    }
+}
+
+void PathService::setCacheCapacity(size_t capacity)
+{
+    cacheCapacity = capacity;
+    while (cache.size() > cacheCapacity)
+    {
+        cacheIndex.erase(cache.back().key);
+        cache.pop_back();
+    }
+}
+
+void PathService::setCacheQuantum(int quantum)
+{
+    quantum = std::max(quantum, 1);
+    if (quantum != cacheQuantum)
+        clearCache();
+    cacheQuantum = quantum;
+}
+
+void PathService::clearCache()
+{
+    cache.clear();
+    cacheIndex.clear();
+}
+
+std::shared_ptr<PathTicket> PathService::request(TilemapLayer& l, const PathQuery& query)
+{
+    auto ticket = std::make_shared<PathTicket>();
+    ticket->query = query;
+    if (ticket->query.agentSize == 0)
+        ticket->query.agentSize = 1;
+
+    //Taking the snapshot also clears the cache if the layer has changed
+    auto grid = getSnapshot(l, ticket->query.agentSize);
+    ticket->revision = layerRevision;
+
+    if (findCached(*ticket, *grid))
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        completed.push_back(ticket);
+        return ticket;
+    }
+
+    ticket->grid = grid;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ticket->order = nextOrder++;
+        queue.push_back(ticket);
+        std::push_heap(queue.begin(), queue.end(), queueLess);
+        queued++;
+    }
+
+    //Every task searches the most important request in the queue
+    workers.submit([this]()
+    {
+        runQueued();
+    });
+    return ticket;
+}
+
+void PathService::runQueued()
+{
+    std::shared_ptr<PathTicket> ticket;
+    std::unique_ptr<GridPathfinder> pathfinder;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (queue.empty())
+            return;
+
+        std::pop_heap(queue.begin(), queue.end(), queueLess);
+        ticket = std::move(queue.back());
+        queue.pop_back();
+
+        if (ticket->cancelled)
+        {
+            queued--;
+            return;
+        }
+
+        if (idlePathfinders.empty())
+        {
+            pathfinder = std::unique_ptr<GridPathfinder>(new GridPathfinder());
+        }
+        else
+        {
+            pathfinder = std::move(idlePathfinders.back());
+            idlePathfinders.pop_back();
+        }
+    }
+
+    const PathQuery& q = ticket->query;
+    pathfinder->diagonal = q.diagonal;
+    pathfinder->jumpPoints = q.jumpPoints;
+    pathfinder->maxExpanded = q.maxExpanded;
+
+    ticket->result = pathfinder->find(*ticket->grid, q.start, q.goal, ticket->points);
+    ticket->expanded = pathfinder->getExpanded();
+    ticket->cost = (ticket->result == PathResult::Found) ? pathfinder->getCost() : 0.0f;
+    ticket->grid.reset();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    idlePathfinders.push_back(std::move(pathfinder));
+    completed.push_back(std::move(ticket));
+    queued--;
+}
+
+void PathService::cancel(PathTicket& ticket)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    ticket.cancelled = true;
+}
+
+unsigned int PathService::update(unsigned int budget)
+{
+    std::vector<std::shared_ptr<PathTicket>> ready;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        while (!completed.empty() && (budget == 0 || ready.size() < budget))
+        {
+            //Cancelled requests don't use up the budget
+            if (!completed.front()->cancelled)
+                ready.push_back(std::move(completed.front()));
+            completed.pop_front();
+        }
+    }
+
+    for (auto& t : ready)
+    {
+        storeCached(*t);
+        t->delivered = true;
+    }
+    return ready.size();
+}
+
+void PathService::flush()
+{
+    workers.waitTasks();
+    update(0);
+}
+
+unsigned int PathService::getQueued()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return queued;
+}
@@ -0,0 +1,189 @@
+#pragma once
+#include "pathfinding.hpp"
+#include "clearance.hpp"
+#include "reference.hpp"
+#include "workerPool.hpp"
+
+#include <memory>
+#include <mutex>
+#include <deque>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+class TilemapLayer;
+
+//! Parameters of a PathService request
+struct PathQuery
+{
+    Vector2i start;
+    Vector2i goal;
+
+    //! Size of the agent in cells, see PathGrid::inflate
+    unsigned int agentSize = 1;
+
+    //! Requests with a higher priority are searched first
+    int priority = 0;
+
+    bool diagonal = true;
+    bool jumpPoints = true;
+    unsigned int maxExpanded = 0;
+};
+
+/*! \brief A path request handed out by PathService
+
+    The result is written by a worker thread and must be read only after
+    isDone returns true, which happens when PathService::update delivers
+    the result on the main thread.
+*/
+class PathTicket
+{
+    friend class PathService;
+
+    std::shared_ptr<const PathGrid> grid;
+    uint32_t revision = 0;
+    unsigned int order = 0;
+    bool delivered = false;
+    bool cancelled = false;
+public:
+    PathQuery query;
+
+    PathResult result = PathResult::NotFound;
+    std::vector<Vector2i> points;
+    float cost = 0.0f;
+    unsigned int expanded = 0;
+
+    //! The result was taken from the path cache
+    bool cached = false;
+
+    //! Returns true when the result has been delivered
+    bool isDone() const {return delivered;}
+
+    //! Returns true if the request was cancelled
+    bool isCancelled() const {return cancelled;}
+};
+
+/*! \brief Runs path searches on background threads
+
+    The searches are done against immutable snapshots of the collision
+    layer. A new snapshot is taken when a request is made after the layer
+    has changed, and the searches in flight keep using the old one.
+
+    The finished requests are delivered by update, which is called once
+    per frame on the main thread. The amount of deliveries per call can be
+    limited, the rest are left for the next frames.
+
+    Found paths are kept in an LRU cache keyed by the start and the goal
+    quantised to cacheQuantum cells, the agent size and the search
+    settings. The cache is cleared when the layer changes. With a quantum
+    larger than one, a cached path is shared by nearby cells and the
+    requested start and goal are joined to its ends, if the joining lines
+    are clear. Otherwise the path is searched again.
+
+    Apart from the worker threads, the service must be used only from the
+    main thread.
+*/
+class PathService
+{
+    WorkerPool workers;
+
+    //Guards the queue, the completed tickets and the idle pathfinders
+    std::mutex mutex;
+    std::vector<std::shared_ptr<PathTicket>> queue;
+    std::deque<std::shared_ptr<PathTicket>> completed;
+    std::vector<std::unique_ptr<GridPathfinder>> idlePathfinders;
+    unsigned int queued = 0;
+    unsigned int nextOrder = 0;
+
+    void runQueued();
+    static bool queueLess(const std::shared_ptr<PathTicket>& a, const std::shared_ptr<PathTicket>& b);
+
+    //Snapshots of the layer, one per agent size. The larger sizes are
+    //made from the clearance map, which is repaired as the layer changes
+    ReferenceHolder<TilemapLayer> layer;
+    uint32_t layerRevision = 0;
+    std::vector<std::shared_ptr<const PathGrid>> snapshots;
+    ClearanceMap clearance;
+    std::shared_ptr<const PathGrid> getSnapshot(TilemapLayer& layer, unsigned int agentSize);
+
+    struct CacheKey
+    {
+        //The quantised cells, the agent size and the movement rules
+        uint64_t cells;
+        unsigned int maxExpanded;
+
+        bool operator==(const CacheKey& other) const
+        {
+            return cells == other.cells && maxExpanded == other.maxExpanded;
+        }
+    };
+
+    struct CacheKeyHash
+    {
+        size_t operator()(const CacheKey& k) const
+        {
+            return std::hash<uint64_t>()(k.cells ^ (uint64_t(k.maxExpanded) * 0x9E3779B97F4A7C15ull));
+        }
+    };
+
+    struct CacheEntry
+    {
+        CacheKey key;
+        std::vector<Vector2i> points;
+        float cost;
+    };
+
+    std::list<CacheEntry> cache;
+    std::unordered_map<CacheKey, std::list<CacheEntry>::iterator, CacheKeyHash> cacheIndex;
+    size_t cacheCapacity = 256;
+    int cacheQuantum = 1;
+    unsigned int cacheHits = 0;
+    unsigned int cacheMisses = 0;
+
+    bool makeCacheKey(const PathQuery& q, CacheKey& key) const;
+    bool findCached(PathTicket& ticket, const PathGrid& grid);
+    void storeCached(const PathTicket& ticket);
+
+public:
+
+    /*! \brief Request a path
+
+        The request is searched on a worker thread, or taken from the
+        cache, and delivered by a later call to update.
+    */
+    std::shared_ptr<PathTicket> request(TilemapLayer& layer, const PathQuery& query);
+
+    //! Cancel a request, it will never be delivered
+    void cancel(PathTicket& ticket);
+
+    /*! \brief Deliver the finished requests
+
+        \param budget maximum amount of requests delivered, 0 for no limit
+        \return the amount of requests delivered
+    */
+    unsigned int update(unsigned int budget);
+
+    //! Wait for all the requests to finish and deliver them
+    void flush();
+
+    //! Set the maximum amount of cached paths, 0 disables the cache
+    void setCacheCapacity(size_t capacity);
+
+    //! Set the size of the cells the start and the goal are quantised to
+    void setCacheQuantum(int quantum);
+
+    //! Remove all the cached paths
+    void clearCache();
+
+    //! Get the amount of requests waiting for a worker or running
+    unsigned int getQueued();
+
+    unsigned int getCacheHits() const {return cacheHits;}
+    unsigned int getCacheMisses() const {return cacheMisses;}
+
+    //! Constructor, \p threads is the amount of worker threads
+    PathService(unsigned int threads);
+
+    //! Destructor, waits for the running searches
+    ~PathService();
+};
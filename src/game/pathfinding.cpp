@@ -1,205 +1,360 @@
 #include "pathfinding.hpp"
+#include "clearance.hpp"
+#include "tilemap.hpp"
 
-#include "log.hpp"
-#include <cassert>
-#include <set>
+#include <algorithm>
+#include <cmath>
 
-/*
+static const float DiagonalCost = 1.41421356f;
 
-//Pathfinding
-
-class PathfindingCell
+void PathGrid::resize(int w, int h)
 {
-    int value;
-public:
-    const Vector2i cell;
-    const Vector2i target;
-    const int iteration;
-    const Vector2i master;
+    width = std::max(w, 0);
+    height = std::max(h, 0);
+    blocked.assign(width * height, 0);
+    source = nullptr;
+}
 
+void PathGrid::build(const TilemapLayer& layer)
+{
+    Vector2i size = layer.getSize();
+    resize(size.x, size.y);
 
-    PathfindingCell(Vector2i a, Vector2i b, int c, Vector2i d) : cell(a), target(b), iteration(c), master(d)
+    layer.forEachTile([this](Vector2i pos, Tileset::Value v)
     {
-        value = (b-a).length()+iteration;
-    }
+        blocked[pos.x + pos.y * width] = TilemapLayer::isBlockingValue(v);
+    });
+
+    source = &layer;
+    sourceRevision = layer.getRevision();
+}
 
-    int getValue() const
+bool PathGrid::refresh(const TilemapLayer& layer)
+{
+    if (source == &layer && sourceRevision == layer.getRevision())
+        return false;
+    build(layer);
+    return true;
+}
+
+void PathGrid::inflate(const PathGrid& base, int size)
+{
+    if (size <= 1)
     {
-        return value;
+        resize(base.width, base.height);
+        blocked = base.blocked;
+        return;
     }
-};
-bool operator > (const PathfindingCell a,const PathfindingCell b) {return (a.getValue()>b.getValue());};
-bool operator < (const PathfindingCell a, const PathfindingCell b) {return (a.getValue()<b.getValue());};
-bool operator == (const PathfindingCell a, const PathfindingCell b) {return (a.getValue()==b.getValue());};
 
-class ClosedPathfindingCell
+    ClearanceMap clearance;
+    clearance.build(base);
+    inflate(clearance, size);
+}
+
+void PathGrid::inflate(const ClearanceMap& clearance, int size)
 {
-public:
-    const Vector2i cell;
-    const Vector2i master;
-    ClosedPathfindingCell(Vector2i a, Vector2i b) : cell(a), master(b) {};
-    ClosedPathfindingCell(PathfindingCell& b) : cell(b.cell), master(b.master) {};
-};
-bool operator > (const ClosedPathfindingCell a, const ClosedPathfindingCell b)
+    resize(clearance.getWidth(), clearance.getHeight());
+
+    unsigned int required = std::max(size, 1);
+    for (int y = 0; y < height; y++)
+    for (int x = 0; x < width; x++)
+        blocked[x + y * width] = clearance.getClearance({x, y}) < required;
+}
+
+//Orders the heap by the smallest f, preferring the deeper node on ties
+static bool HeapGreater(const float af, const float ag, const float bf, const float bg)
 {
-    if (a.cell.x == b.cell.x)
-        return (a.cell.y>b.cell.y);
-    return a.cell.x > b.cell.x;
+    if (af != bf)
+        return af > bf;
+    return ag < bg;
 }
-bool operator < (const ClosedPathfindingCell a, const ClosedPathfindingCell b)  {return (b > a);};
-bool operator == (const ClosedPathfindingCell a, const ClosedPathfindingCell b) {return (a.cell == b.cell);};
 
-void Pathfinder::pathfind()
+void GridPathfinder::prepare(const PathGrid& g)
 {
-    Vector2i ec = mapHandler->getTilePosition(begin);
-    Vector2i bc = mapHandler->getTilePosition(end);
-    points.clear();
+    grid = &g;
+    width = g.getWidth();
 
-    if (!mapHandler->getMap()->getTileExists(ec))
-        return;
-    if (!mapHandler->getMap()->getTileExists(bc))
-        return;
+    size_t cells = size_t(g.getWidth()) * g.getHeight();
+    if (openStamp.size() != cells)
+    {
+        openStamp.assign(cells, 0);
+        closedStamp.assign(cells, 0);
+        gCost.resize(cells);
+        parent.resize(cells);
+        generation = 0;
+    }
 
-    if (mapHandler->getTileIsBlocking(ec))
-        return;
-    if (mapHandler->getTileIsBlocking(bc))
-        return;
-    std::multiset<PathfindingCell> ocells;
-    std::set<ClosedPathfindingCell> ccells;
+    generation++;
+    if (generation == 0)
+    {
+        //The counter wrapped around, the stamps have to be reset once
+        std::fill(openStamp.begin(), openStamp.end(), 0);
+        std::fill(closedStamp.begin(), closedStamp.end(), 0);
+        generation = 1;
+    }
 
-    ocells.insert(PathfindingCell(bc,ec,0,bc));
-    ccells.insert(ClosedPathfindingCell(bc,bc));
-    bool found = false;
-    PathfindingCell* fCell = nullptr;
+    heap.clear();
+    expanded = 0;
+    cost = 0.0f;
+}
 
-    int depth = 0;
+float GridPathfinder::heuristic(int x, int y) const
+{
+    float dx = std::abs(x - goal.x);
+    float dy = std::abs(y - goal.y);
+    if (!diagonal)
+        return dx + dy;
 
-    while (ocells.size())
-    {
-        depth++;
-        if (depth > maximumDepth)
-            return;
-        auto it = ocells.begin();
+    //Octile distance
+    return (dx + dy) + (DiagonalCost - 2.0f) * std::min(dx, dy);
+}
 
-        PathfindingCell cell = *it;
+void GridPathfinder::push(int32_t index, int32_t from, float g)
+{
+    if (closedStamp[index] == generation)
+        return;
+    if (openStamp[index] == generation && gCost[index] <= g)
+        return;
 
-        if (cell.cell == ec)
-        {
-            found = true;
-            fCell = &cell;
-            break;
-        }
+    openStamp[index] = generation;
+    gCost[index] = g;
+    parent[index] = from;
 
+    //Outdated heap entries are skipped when popped
+    HeapNode node = {g + heuristic(index % width, index / width), g, index};
+    heap.push_back(node);
+    std::push_heap(heap.begin(), heap.end(), [](const HeapNode& a, const HeapNode& b)
+    {
+        return HeapGreater(a.f, a.g, b.f, b.g);
+    });
+}
 
-        Vector2i dirs[] = {{0,1},{1,0},{0,-1},{-1,0}};
+void GridPathfinder::expandNeighbours(int32_t index)
+{
+    int x = index % width;
+    int y = index / width;
+    float g = gCost[index];
 
-        for (int i = 0; i < 4; i++)
+    static const int dirs[8][2] = {{1,0},{-1,0},{0,1},{0,-1},{1,1},{-1,1},{1,-1},{-1,-1}};
+    int count = diagonal ? 8 : 4;
+    for (int i = 0; i < count; i++)
+    {
+        int dx = dirs[i][0];
+        int dy = dirs[i][1];
+        int nx = x + dx;
+        int ny = y + dy;
+        if (!grid->isWalkable(nx, ny))
+            continue;
+
+        float step = 1.0f;
+        if (dx != 0 && dy != 0)
         {
-            Vector2i p = cell.cell+dirs[i];
-
-            if (ccells.count(ClosedPathfindingCell(p,cell.cell)))
-            {
+            if (!grid->isWalkable(x + dx, y) || !grid->isWalkable(x, y + dy))
                 continue;
-            }
-            if (!mapHandler->getMap()->getTileExists(p))
-                continue;
-            if (mapHandler->getTileIsBlocking(p))
-                continue;
-
-            ccells.insert(ClosedPathfindingCell(p,cell.cell));
-            ocells.insert(PathfindingCell(p,ec,cell.iteration+1,cell.cell));
+            step = DiagonalCost;
         }
-
-        ocells.erase(it);
+        push(nx + ny * width, index, g + step);
     }
+}
 
-    if (found == true && fCell)
+int32_t GridPathfinder::jump(int x, int y, int dx, int dy) const
+{
+    while (true)
     {
-        Vector2i addi = fCell->master;
+        if (!grid->isWalkable(x, y))
+            return -1;
+        if (x == goal.x && y == goal.y)
+            return x + y * width;
 
-        while (true)
+        if (dx != 0 && dy != 0)
         {
-            DefVector2 addf = (addi * mapHandler->getTileSize()) + mapHandler->getTileSize()/2;
-            points.push_back(addf);
-
-            ClosedPathfindingCell c(addi,addi);
-
-            auto it = ccells.find(c);
-            if (it == ccells.end())
-                assert(false && "no master cell found");
-
-            if (addi == (*it).master)
-                break;
-
-            addi = (*it).master;
+            //A diagonal jump stops where a straight jump would find something
+            if (jump(x + dx, y, dx, 0) >= 0 || jump(x, y + dy, 0, dy) >= 0)
+                return x + y * width;
+        }
+        else if (dx != 0)
+        {
+            if ((grid->isWalkable(x, y - 1) && !grid->isWalkable(x - dx, y - 1)) ||
+                (grid->isWalkable(x, y + 1) && !grid->isWalkable(x - dx, y + 1)))
+                return x + y * width;
+        }
+        else
+        {
+            if ((grid->isWalkable(x - 1, y) && !grid->isWalkable(x - 1, y - dy)) ||
+                (grid->isWalkable(x + 1, y) && !grid->isWalkable(x + 1, y - dy)))
+                return x + y * width;
         }
-        points.push_back(end);
-    }
 
+        //Diagonal moves must not cut corners
+        if (!grid->isWalkable(x + dx, y) || !grid->isWalkable(x, y + dy))
+            return -1;
+        x += dx;
+        y += dy;
+    }
 }
 
-void Pathfinder::setBegin(DefVector2 b)
+void GridPathfinder::pushJump(int32_t index, int dx, int dy)
 {
-    begin = b;
-}
+    int x = index % width;
+    int y = index / width;
 
+    int32_t j = jump(x + dx, y + dy, dx, dy);
+    if (j < 0)
+        return;
 
-void Pathfinder::setPathSize(DefVector2 s)
-{
-    size = s/2;
-    if (size.length() > 4)
-        checkForSize = true;
+    //The jump is a straight or diagonal line, the cost is the octile distance
+    float ax = std::abs(j % width - x);
+    float ay = std::abs(j / width - y);
+    push(j, index, gCost[index] + (ax + ay) + (DiagonalCost - 2.0f) * std::min(ax, ay));
 }
 
-void Pathfinder::setEnd(DefVector2 e)
+void GridPathfinder::expandJumpPoints(int32_t index)
 {
-    end = e;
-}
+    int x = index % width;
+    int y = index / width;
 
-void Pathfinder::update()
-{
+    int32_t from = parent[index];
+    if (from < 0)
+    {
+        //The start node searches to every direction
+        static const int dirs[8][2] = {{1,0},{-1,0},{0,1},{0,-1},{1,1},{-1,1},{1,-1},{-1,-1}};
+        for (int i = 0; i < 8; i++)
+        {
+            int dx = dirs[i][0];
+            int dy = dirs[i][1];
+            if (dx != 0 && dy != 0 && (!grid->isWalkable(x + dx, y) || !grid->isWalkable(x, y + dy)))
+                continue;
+            pushJump(index, dx, dy);
+        }
+        return;
+    }
+
+    int px = from % width;
+    int py = from / width;
+    int dx = (x > px) - (x < px);
+    int dy = (y > py) - (y < py);
 
-    points.clear();
-    points.push_back(end);
-    direct = false;
-    if (!checkForSize)
+    //Pruned neighbours, matching the rules in jump
+    if (dx != 0 && dy != 0)
     {
-        if (!mapHandler->getLineCollision(begin, end))
+        bool vertical = grid->isWalkable(x, y + dy);
+        bool horizontal = grid->isWalkable(x + dx, y);
+        if (vertical)
+            pushJump(index, 0, dy);
+        if (horizontal)
+            pushJump(index, dx, 0);
+        if (vertical && horizontal)
+            pushJump(index, dx, dy);
+    }
+    else if (dx != 0)
+    {
+        bool up = grid->isWalkable(x, y - 1);
+        bool down = grid->isWalkable(x, y + 1);
+        if (grid->isWalkable(x + dx, y))
         {
-            direct = true;
-            return;
+            pushJump(index, dx, 0);
+            if (up)
+                pushJump(index, dx, -1);
+            if (down)
+                pushJump(index, dx, 1);
         }
+        if (up)
+            pushJump(index, 0, -1);
+        if (down)
+            pushJump(index, 0, 1);
     }
     else
     {
-        direct = false;
-        if (!mapHandler->getLineCollision(begin-size, end))
-            if (!mapHandler->getLineCollision(begin-size, end))
-                if (!mapHandler->getLineCollision(begin-DefVector2(size.x,-size.y), end))
-                    if (!mapHandler->getLineCollision(begin+DefVector2(size.x,-size.y), end))
-                    {
-                        direct = true;
-                        return;
-                    }
+        bool left = grid->isWalkable(x - 1, y);
+        bool right = grid->isWalkable(x + 1, y);
+        if (grid->isWalkable(x, y + dy))
+        {
+            pushJump(index, 0, dy);
+            if (left)
+                pushJump(index, -1, dy);
+            if (right)
+                pushJump(index, 1, dy);
+        }
+        if (left)
+            pushJump(index, -1, 0);
+        if (right)
+            pushJump(index, 1, 0);
     }
+}
 
-    pathfind();
-
+void CompressPath(std::vector<Vector2i>& out)
+{
+    if (out.size() <= 2)
+        return;
 
+    size_t w = 1;
+    for (size_t i = 1; i + 1 < out.size(); i++)
+    {
+        Vector2i d1 = out[i] - out[w - 1];
+        Vector2i d2 = out[i + 1] - out[i];
+        d1 = {(d1.x > 0) - (d1.x < 0), (d1.y > 0) - (d1.y < 0)};
+        d2 = {(d2.x > 0) - (d2.x < 0), (d2.y > 0) - (d2.y < 0)};
+        if (d1 != d2)
+            out[w++] = out[i];
+    }
+    out[w++] = out.back();
+    out.resize(w);
 }
 
-bool Pathfinder::isDirect()
+void GridPathfinder::buildPath(int32_t index, std::vector<Vector2i>& out) const
 {
-    return direct;
-}
+    for (int32_t i = index; i >= 0; i = parent[i])
+        out.push_back({i % width, i / width});
+    std::reverse(out.begin(), out.end());
 
+    //Keep only the cells where the direction changes
+    CompressPath(out);
+}
 
-DefVector2 Pathfinder::getTargetPosition()
+PathResult GridPathfinder::find(const PathGrid& g, Vector2i start, Vector2i target, std::vector<Vector2i>& out)
 {
-    if (direct)
-        return end;
-    return end;
-}
+    out.clear();
+    if (!g.isWalkable(start.x, start.y) || !g.isWalkable(target.x, target.y))
+        return PathResult::Invalid;
+
+    prepare(g);
+    goal = target;
+    bool jps = jumpPoints && diagonal;
 
+    push(start.x + start.y * width, -1, 0.0f);
+    int32_t goalIndex = target.x + target.y * width;
 
-*/
+    auto compare = [](const HeapNode& a, const HeapNode& b)
+    {
+        return HeapGreater(a.f, a.g, b.f, b.g);
+    };
+
+    while (!heap.empty())
+    {
+        std::pop_heap(heap.begin(), heap.end(), compare);
+        HeapNode node = heap.back();
+        heap.pop_back();
+
+        int32_t index = node.index;
+        if (closedStamp[index] == generation || node.g > gCost[index])
+            continue;
+        closedStamp[index] = generation;
+
+        if (index == goalIndex)
+        {
+            cost = gCost[index];
+            buildPath(index, out);
+            return PathResult::Found;
+        }
+
+        expanded++;
+        if (maxExpanded != 0 && expanded > maxExpanded)
+            return PathResult::LimitReached;
+
+        if (jps)
+            expandJumpPoints(index);
+        else
+            expandNeighbours(index);
+    }
+    return PathResult::NotFound;
+}
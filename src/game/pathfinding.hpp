@@ -1,27 +1,151 @@
 #pragma once
 #include "engineDefs.hpp"
-#include <list>
-class GameMapHandler;
+#include "vector2.hpp"
+#include <vector>
+#include <cstdint>
 
-class Pathfinder
+class TilemapLayer;
+class ClearanceMap;
+
+/*! \brief Walkability grid used by GridPathfinder
+
+    A flat copy of the blocking tiles of a TilemapLayer. The grid remembers
+    the revision of the layer it was built from, so it can be rebuilt only
+    when the layer has changed.
+*/
+class PathGrid
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> blocked;
+
+    const TilemapLayer* source = nullptr;
+    uint32_t sourceRevision = 0;
+public:
+
+    //! Build the grid from the blocking tiles of the layer
+    void build(const TilemapLayer& layer);
+
+    //! Rebuild the grid if it was not built from the current revision of the layer
+    bool refresh(const TilemapLayer& layer);
+
+    /*! \brief Build the grid for agents larger than a single cell
+
+        A cell is walkable if the \p size x \p size square of cells with
+        the cell at its top left corner is walkable in \p base.
+    */
+    void inflate(const PathGrid& base, int size);
+
+    //! Build the grid for agents of \p size cells from the clearances of the cells
+    void inflate(const ClearanceMap& clearance, int size);
+
+    //! Resize the grid, all cells become walkable
+    void resize(int width, int height);
+
+    //! Set a cell blocking or walkable
+    void setBlocked(Vector2i pos, bool b)
+    {
+        if (contains(pos))
+            blocked[pos.x + pos.y * width] = b;
+    }
+
+    //! Returns true if the cell can be walked on. Cells out of bounds are not walkable
+    bool isWalkable(int x, int y) const
+    {
+        if (x < 0 || x >= width || y < 0 || y >= height)
+            return false;
+        return !blocked[x + y * width];
+    }
+
+    //! Returns true if the cell is within the grid
+    bool contains(Vector2i pos) const
+    {
+        return pos.x >= 0 && pos.x < width && pos.y >= 0 && pos.y < height;
+    }
+
+    int getWidth() const {return width;}
+    int getHeight() const {return height;}
+};
+
+//! Remove the cells of a path where the direction doesn't change, keeping the end points
+void CompressPath(std::vector<Vector2i>& path);
+
+//! Outcome of a GridPathfinder search
+enum class PathResult
 {
-protected:
-    GameMapHandler* mapHandler;
-    DefVector2 begin;
-    DefVector2 end;
-    DefVector2 size = {0,0};
-    bool direct = false;
-    bool checkForSize = false;
-    void pathfind();
+    Found,
+    NotFound,
+    //! The start or the goal is blocked or out of bounds
+    Invalid,
+    //! The search expanded more nodes than allowed
+    LimitReached
+};
+
+/*! \brief A* and Jump Point Search over a PathGrid
+
+    The per-cell search state is kept in flat arrays sized to the grid.
+    The arrays are never cleared: every search increments a generation
+    counter, and a cell whose stamp doesn't match the current generation
+    is treated as unvisited. The open list is a binary heap.
+
+    Diagonal moves are allowed only if both adjacent orthogonal cells are
+    walkable, so paths never cut corners. Jump Point Search is valid only
+    with diagonal moves, and is ignored otherwise.
+
+    The resulting path is a list of waypoint cells, from the start to the
+    goal, containing only the cells where the direction changes.
+*/
+class GridPathfinder
+{
+    struct HeapNode
+    {
+        float f;
+        float g;
+        int32_t index;
+    };
+
+    std::vector<HeapNode> heap;
+    std::vector<uint32_t> openStamp;
+    std::vector<uint32_t> closedStamp;
+    std::vector<float> gCost;
+    std::vector<int32_t> parent;
+    uint32_t generation = 0;
+
+    const PathGrid* grid = nullptr;
+    int width = 0;
+    Vector2i goal;
+
+    unsigned int expanded = 0;
+    float cost = 0.0f;
+
+    void prepare(const PathGrid& grid);
+    float heuristic(int x, int y) const;
+    void push(int32_t index, int32_t from, float g);
+    void expandNeighbours(int32_t index);
+    void expandJumpPoints(int32_t index);
+    void pushJump(int32_t index, int dx, int dy);
+    int32_t jump(int x, int y, int dx, int dy) const;
+    void buildPath(int32_t index, std::vector<Vector2i>& out) const;
+
 public:
-    int maximumDepth = 6000;
-    std::list<DefVector2> points;
-    Pathfinder(GameMapHandler* map) : mapHandler(map) {};
-    void setEnd(DefVector2);
-    void setBegin(DefVector2);
-    void setPathSize(DefVector2);
-    void update();
-    bool isDirect();
-    DefVector2 getTargetPosition();
+    //! Allow diagonal moves
+    bool diagonal = true;
+
+    //! Use Jump Point Search, requires diagonal moves
+    bool jumpPoints = false;
+
+    //! Maximum amount of expanded nodes, 0 for no limit
+    unsigned int maxExpanded = 0;
+
+    /*! \brief Find a path between two cells
+
+        The waypoints are written to \p out, which is cleared first.
+    */
+    PathResult find(const PathGrid& grid, Vector2i start, Vector2i goal, std::vector<Vector2i>& out);
+
+    //! Amount of nodes expanded during the last search
+    unsigned int getExpanded() const {return expanded;}
 
+    //! Cost of the last path found, a diagonal step costs sqrt(2)
+    float getCost() const {return cost;}
 };
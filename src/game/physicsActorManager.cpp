@@ -6,7 +6,9 @@
 PhysicsActorManager::PhysicsActorManager(ScriptEngine* se) :
     actorTypeInfo(nullptr),
     collide(nullptr),
-    collideStatic(nullptr)
+    collideStatic(nullptr),
+    collisionBegin(nullptr),
+    collisionEnd(nullptr)
 {
     if (se == nullptr)
         throw std::runtime_error("nullptr passed to PhysicsActorManager constructor");
@@ -44,6 +46,14 @@ PhysicsActorManager::~PhysicsActorManager()
     if (collideStatic)
         collideStatic->Release();
     collideStatic = nullptr;
+
+    if (collisionBegin)
+        collisionBegin->Release();
+    collisionBegin = nullptr;
+
+    if (collisionEnd)
+        collisionEnd->Release();
+    collisionEnd = nullptr;
 }
 
 void PhysicsActorManager::rstCallback(const RequiredScriptType& rst)
@@ -63,6 +73,14 @@ void PhysicsActorManager::rstCallback(const RequiredScriptType& rst)
 
     collide->AddRef();
     collideStatic->AddRef();
+
+    collisionBegin = actorTypeInfo->GetMethodByDecl("void onCollisionBegin(PhysicsActor@, const Collision::ActorCollisionInfo&)");
+    collisionEnd = actorTypeInfo->GetMethodByDecl("void onCollisionEnd(PhysicsActor@)");
+
+    if (collisionBegin)
+        collisionBegin->AddRef();
+    if (collisionEnd)
+        collisionEnd->AddRef();
 }
 
 PhysicsActorType* PhysicsActorManager::checkIsValidPhysicsActor(void *ptr, int tid)
@@ -96,6 +114,7 @@ void PhysicsActorManager::collideActorWith(PhysicsActorType* actor, PhysicsActor
     ctx->SetArgObject(1,&aci);
     ctx->SetObject(actor);
     ctx->Execute();
+    callbackCount++;
 }
 
 
@@ -107,7 +126,45 @@ void PhysicsActorManager::collideActorWithStatic(PhysicsActorType* actor, MapCol
     ctx->SetArgObject(0,&mci);
     ctx->SetObject(actor);
     ctx->Execute();
+    callbackCount++;
+
+}
+
+void PhysicsActorManager::collideActorBegin(PhysicsActorType* actor, PhysicsActorType* with, ActorCollisionInfo aci)
+{
+    if (collisionBegin == nullptr)
+    {
+        collideActorWith(actor, with, aci);
+        return;
+    }
+
+    asIScriptContext* ctx = scriptEngine->getContext();
+
+    ctx->Prepare(collisionBegin);
+    ctx->SetArgObject(0,with);
+    ctx->SetArgObject(1,&aci);
+    ctx->SetObject(actor);
+    ctx->Execute();
+    callbackCount++;
+}
 
+void PhysicsActorManager::collideActorEnd(PhysicsActorType* actor, PhysicsActorType* with)
+{
+    if (collisionEnd == nullptr)
+        return;
+
+    asIScriptContext* ctx = scriptEngine->getContext();
+
+    ctx->Prepare(collisionEnd);
+    ctx->SetArgObject(0,with);
+    ctx->SetObject(actor);
+    ctx->Execute();
+    callbackCount++;
+}
+
+DefVector2 PhysicsActorManager::getActorPosition(PhysicsActorType* actor)
+{
+    return ActorOffset(actor, positionOffset, DefVector2) + ActorOffset(actor, offsetOffset, DefVector2);
 }
 
 void PhysicsActorManager::setActorPosition(PhysicsActorType* actor, DefVector2 pos)
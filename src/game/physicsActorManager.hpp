@@ -37,10 +37,16 @@ class PhysicsActorManager
     asIScriptFunction* collide;
     asIScriptFunction* collideStatic;
 
+    //Optional contact event methods, nullptr if not defined in script
+    asIScriptFunction* collisionBegin;
+    asIScriptFunction* collisionEnd;
+
 
     asITypeInfo* actorTypeInfo;
     ScriptEngine* scriptEngine;
     void rstCallback(const RequiredScriptType&);
+
+    unsigned int callbackCount = 0;
 public:
     PhysicsActorManager(ScriptEngine*);
     ~PhysicsActorManager();
@@ -55,8 +61,19 @@ public:
     // positions have offsets applied
     void getActorData(PhysicsActorType* actor, PhysicsActorData* pad);
     void setActorPosition(PhysicsActorType* actor, DefVector2 position);
+    // only reads the position, with the offset applied
+    DefVector2 getActorPosition(PhysicsActorType* actor);
 
     void collideActorWith(PhysicsActorType* actor, PhysicsActorType* with, ActorCollisionInfo aci);
     void collideActorWithStatic(PhysicsActorType* actor, MapCollisionInfo aci);
 
+    //Contact events, see COLLISION_CONTACT_EVENTS. If onCollisionBegin
+    //is not defined, collide is called instead
+    void collideActorBegin(PhysicsActorType* actor, PhysicsActorType* with, ActorCollisionInfo aci);
+    void collideActorEnd(PhysicsActorType* actor, PhysicsActorType* with);
+
+    //! Amount of script callbacks executed since the last reset
+    unsigned int getCallbackCount() {return callbackCount;}
+    void resetCallbackCount() {callbackCount = 0;}
+
 };
\ No newline at end of file
@@ -347,13 +347,14 @@ bool ScriptEngine::initEngine()
 
     defineGameFunctions();
 
-    definePath();
-
     defineSound();
 
     defineFormatString();
 
     defineMap();
+
+    //Path depends on Map::Layer
+    definePath();
     
     defineCollisionFunctions();
 
@@ -573,14 +574,10 @@ bool ScriptEngine::buildModuleSave(const std::vector<std::string>& sourceFiles,
 
     for (auto& s : sourceFiles)
     {
-        size_t len;
         std::string realName = GetFileRealName(s);
-        char* fcode = GetFileContentsCopy(s, &len);
+        auto fcode = MapFileContents(s);
         if (fcode)
-        {
-            r = builder.AddSectionFromMemory(realName.c_str(), fcode, len, 0);
-            delete[] fcode;
-        }
+            r = builder.AddSectionFromMemory(realName.c_str(), fcode->getData(), fcode->getSize(), 0);
         if (!fcode || r < 0)
         {
             Log << "Failed to load file " << realName << " for module " << name << Trace(CHash("AngelScriptError"));
@@ -738,6 +735,8 @@ void ScriptEngine::deInit()
         delete a;  
     tileCollisionCallbacks.clear();
 
+    releasePathfinding();
+
     for (auto& b : scriptCallbackEndStep)
         b.release();
     scriptCallbackEndStep.clear();
@@ -814,6 +813,8 @@ void ScriptEngine::update()
 
 void ScriptEngine::endStep()
 {
+    updatePathService();
+
     scriptCallbackEndStep.remove_if([this](ScriptCallback& cb)
     {
         mainContext->Prepare(cb.callback);
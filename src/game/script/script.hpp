@@ -48,6 +48,7 @@ class asIScriptFunction;
 //AngelScript extensions
 
 class CScriptDictionary;
+class CScriptArray;
 class CScriptBuilder;
 
 class ScriptDataTable;
@@ -84,9 +85,13 @@ public:
 
 class RefDrawableText;
 class RefDrawableSprite;
+class RefSpriteBatch;
 class RefDrawableFillSprite;
 class RefCharacterAnimator;
 class RefPathfinder;
+class ScriptPathfinding;
+class RefPathRequest;
+class RefFlowField;
 class RefDrawableStaticQuad;
 class RefDrawableLine;
 class RefSoundSource;
@@ -232,6 +237,15 @@ class ScriptEngine
     void defineDrawables();
 
     void definePath();
+    ScriptPathfinding* pathfinding = nullptr;
+    void releasePathfinding();
+    void updatePathService();
+    void runPathCallbacks();
+    RefPathRequest* scrRequestPath(TilemapLayer& layer, Vector2i start, Vector2i goal, unsigned int agentSize, int priority);
+    RefPathRequest* scrRequestPathCallback(TilemapLayer& layer, Vector2i start, Vector2i goal, asIScriptFunction* cb, unsigned int agentSize, int priority);
+    void scrFlushPaths();
+    unsigned int scrGetQueuedPaths();
+    void scrClearPathCache();
     void defineSound();
     void defineMap();
     void defineFile();
@@ -256,6 +270,12 @@ class ScriptEngine
     void scrBoxCollisionQuery(DefVector2 p1, DefVector2 p2, asIScriptFunction *cb);
     void scrCircleCollisionQuery(DefVector2,float, asIScriptFunction *cb);
 
+    unsigned int scrBoxCollisionQueryArray(DefVector2 center, DefVector2 size, CScriptArray* actors, unsigned int with, unsigned int type);
+    unsigned int scrCircleCollisionQueryArray(DefVector2 center, float r, CScriptArray* actors, CScriptArray* distances, unsigned int with, unsigned int type);
+    unsigned int scrLineCollisionQueryArray(DefVector2 p1, DefVector2 p2, CScriptArray* actors, CScriptArray* points, unsigned int with, unsigned int type);
+    unsigned int scrBoxCollisionQueryBatch(CScriptArray* centers, CScriptArray* sizes, CScriptArray* actors, CScriptArray* offsets, unsigned int with, unsigned int type);
+    unsigned int scrCircleCollisionQueryBatch(CScriptArray* centers, CScriptArray* radii, CScriptArray* actors, CScriptArray* offsets, CScriptArray* distances, unsigned int with, unsigned int type);
+
     void scrRegisterMapCollisionCallback(int,asIScriptFunction* cb);
     void scrRegisterMapParamCallback(asIScriptFunction* cb);
     void scrRegisterMapSpawnObjectCallback(asIScriptFunction* cb);
@@ -264,6 +284,7 @@ class ScriptEngine
     bool scrGetTileIsBlocking(DefVector2);
 
     DefVector2 scrGetWindowDimensions();
+    bool scrAddTextureArea(Hash::HashUInt name, Hash::HashUInt page, Vector2i position, Vector2i size);
 
     asIScriptFunction* mapParamCallback = nullptr;
     asIScriptFunction* mapSpawnObjectCallback = nullptr;
@@ -271,8 +292,10 @@ class ScriptEngine
     RefDrawableText* factoryDrawableText();
     RefCharacterAnimator* factoryCharacterAnimator();
     RefDrawableSprite* factoryDrawableSprite();
+    RefSpriteBatch* factorySpriteBatch();
     RefDrawableFillSprite* factoryDrawableFillSprite();
     RefPathfinder* factoryPathfinder();
+    RefFlowField* factoryFlowField();
     RefDrawableLine* factoryDrawableLine();
     RefPointLight* factoryPointLight();
     RefSoundSource* factorySoundSource(Sound*);
@@ -18,6 +18,7 @@
 #include "regHelper.hpp"
 
 #include <scripthandle/scripthandle.h>
+#include <scriptarray/scriptarray.h>
 #include <angelscript.h>
 #include <cassert>
 #include <cmath>
@@ -192,6 +193,139 @@ void ScriptEngine::scrBoxCollisionQuery(DefVector2 cent, DefVector2 size, asIScr
 
 
 
+//Fills an array<ref> with the actors, replacing the old contents
+static void FillActorArray(CScriptArray* arr, const std::vector<PhysicsActor*>& actors)
+{
+    arr->Resize(actors.size());
+    for (size_t i = 0; i < actors.size(); i++)
+    {
+        CScriptHandle* handle = (CScriptHandle*) arr->At(i);
+        handle->Set(actors[i], actors[i]->GetObjectType());
+    }
+}
+
+unsigned int ScriptEngine::scrBoxCollisionQueryArray(DefVector2 cent, DefVector2 size, CScriptArray* actors, unsigned int with, unsigned int type)
+{
+    CollisionQueryFilter filter;
+    filter.with = with;
+    filter.type = type;
+
+    std::vector<PhysicsActor*> found;
+    engine->getBroadPhase()->findBoxCollisions(cent, size, filter, found);
+    FillActorArray(actors, found);
+    return found.size();
+}
+
+unsigned int ScriptEngine::scrCircleCollisionQueryArray(DefVector2 pos, float r, CScriptArray* actors, CScriptArray* distances, unsigned int with, unsigned int type)
+{
+    CollisionQueryFilter filter;
+    filter.with = with;
+    filter.type = type;
+
+    std::vector<PhysicsActor*> found;
+    std::vector<float> dist;
+    engine->getBroadPhase()->findCircleCollisions(pos, r, filter, found, distances ? &dist : nullptr);
+    FillActorArray(actors, found);
+
+    if (distances)
+    {
+        distances->Resize(dist.size());
+        for (size_t i = 0; i < dist.size(); i++)
+            *((float*) distances->At(i)) = dist[i];
+        distances->Release();
+    }
+    return found.size();
+}
+
+unsigned int ScriptEngine::scrLineCollisionQueryArray(DefVector2 p1, DefVector2 p2, CScriptArray* actors, CScriptArray* points, unsigned int with, unsigned int type)
+{
+    CollisionQueryFilter filter;
+    filter.with = with;
+    filter.type = type;
+
+    std::vector<PhysicsActor*> found;
+    std::vector<DefVector2> pts;
+    engine->getBroadPhase()->findLineCollisions(p1, p2, filter, found, points ? &pts : nullptr);
+    FillActorArray(actors, found);
+
+    if (points)
+    {
+        points->Resize(pts.size());
+        for (size_t i = 0; i < pts.size(); i++)
+            *((DefVector2*) points->At(i)) = pts[i];
+        points->Release();
+    }
+    return found.size();
+}
+
+unsigned int ScriptEngine::scrBoxCollisionQueryBatch(CScriptArray* centers, CScriptArray* sizes, CScriptArray* actors, CScriptArray* offsets, unsigned int with, unsigned int type)
+{
+    if (centers->GetSize() != sizes->GetSize())
+    {
+        asGetActiveContext()->SetException("Collision::QueryBoxes called with arrays of different lengths");
+        return 0;
+    }
+
+    CollisionQueryFilter filter;
+    filter.with = with;
+    filter.type = type;
+
+    BroadPhase* bp = engine->getBroadPhase();
+    std::vector<PhysicsActor*> found;
+
+    //offsets[i] is the index of the first result of query i,
+    //the last element is the total count of results
+    offsets->Resize(centers->GetSize() + 1);
+    for (asUINT i = 0; i < centers->GetSize(); i++)
+    {
+        *((asUINT*) offsets->At(i)) = found.size();
+        bp->findBoxCollisions(*(DefVector2*) centers->At(i), *(DefVector2*) sizes->At(i), filter, found);
+    }
+    *((asUINT*) offsets->At(centers->GetSize())) = found.size();
+
+    FillActorArray(actors, found);
+    return found.size();
+}
+
+unsigned int ScriptEngine::scrCircleCollisionQueryBatch(CScriptArray* centers, CScriptArray* radii, CScriptArray* actors, CScriptArray* offsets, CScriptArray* distances, unsigned int with, unsigned int type)
+{
+    if (centers->GetSize() != radii->GetSize())
+    {
+        if (distances)
+            distances->Release();
+        asGetActiveContext()->SetException("Collision::QueryCircles called with arrays of different lengths");
+        return 0;
+    }
+
+    CollisionQueryFilter filter;
+    filter.with = with;
+    filter.type = type;
+
+    BroadPhase* bp = engine->getBroadPhase();
+    std::vector<PhysicsActor*> found;
+    std::vector<float> dist;
+
+    offsets->Resize(centers->GetSize() + 1);
+    for (asUINT i = 0; i < centers->GetSize(); i++)
+    {
+        *((asUINT*) offsets->At(i)) = found.size();
+        bp->findCircleCollisions(*(DefVector2*) centers->At(i), *(float*) radii->At(i), filter, found, distances ? &dist : nullptr);
+    }
+    *((asUINT*) offsets->At(centers->GetSize())) = found.size();
+
+    FillActorArray(actors, found);
+
+    if (distances)
+    {
+        distances->Resize(dist.size());
+        for (size_t i = 0; i < dist.size(); i++)
+            *((float*) distances->At(i)) = dist[i];
+        distances->Release();
+    }
+    return found.size();
+}
+
+
 bool FindTilemapLineCollision(DefVector2 p1, DefVector2 p2, TilemapLayer& map, DefVector2 tileSize,  DefVector2& pos, DefVector2& norm)
 {
     auto t = TileMapLineCollision::FindCollision(p1, p2, map, {0,0}, tileSize);
@@ -206,6 +340,35 @@ bool FindTilemapLineCollision(DefVector2 p1, DefVector2 p2, TilemapLayer& map, D
     return false;
 }
 
+unsigned int FindTilemapLineCollisions(CScriptArray* starts, CScriptArray* ends, TilemapLayer& map, DefVector2 tileSize, CScriptArray* hits, CScriptArray* points, CScriptArray* normals)
+{
+    if (starts->GetSize() != ends->GetSize())
+    {
+        asGetActiveContext()->SetException("Collision::MapLines called with arrays of different lengths");
+        return 0;
+    }
+
+    asUINT count = starts->GetSize();
+    std::vector<TileMapLineCollision> results(count);
+    if (count > 0)
+        TileMapLineCollision::FindCollisions((DefVector2*) starts->At(0), (DefVector2*) ends->At(0), count, map, tileSize, results.data());
+
+    hits->Resize(count);
+    points->Resize(count);
+    normals->Resize(count);
+
+    unsigned int found = 0;
+    for (asUINT i = 0; i < count; i++)
+    {
+        *((bool*) hits->At(i)) = results[i].found;
+        *((DefVector2*) points->At(i)) = results[i].found ? results[i].position : *((DefVector2*) ends->At(i));
+        *((DefVector2*) normals->At(i)) = results[i].normal;
+        if (results[i].found)
+            found++;
+    }
+    return found;
+}
+
 
 void ScriptEngine::defineCollisionFunctions()
 {
@@ -236,12 +399,18 @@ void ScriptEngine::defineCollisionFunctions()
     r = registerGlobalFunctionAux(this,"void Remove(?&in)", asMETHOD(BroadPhase, scrRemoveActor), asCALL_THISCALL_ASGLOBAL, broadPhase);
     assert (r >= 0);
 
+    r = registerGlobalFunctionAux(this,"void Wake(?&in)", asMETHOD(BroadPhase, scrWakeActor), asCALL_THISCALL_ASGLOBAL, broadPhase);
+    assert (r >= 0);
+
     r = registerGlobalFunctionAux(this,"void SetMap(Vector2 tileSize, Map::Layer& map)", asMETHOD(BroadPhase, setTilemap), asCALL_THISCALL_ASGLOBAL, broadPhase);
     assert (r >= 0);
     
     r = registerGlobalFunctionAux(this,"void SetWorldSize(Vector2)", asMETHOD(BroadPhase, setCollisionWorldSize), asCALL_THISCALL_ASGLOBAL, broadPhase);
     assert (r >= 0);
 
+    r = registerGlobalFunctionAux(this,"uint GetClearance(Vector2 pos)", asMETHOD(BroadPhase, getClearance), asCALL_THISCALL_ASGLOBAL, broadPhase);
+    assert (r >= 0);
+
     r = ase->RegisterFuncdef("void QueryCircleCallback(ref @, float)");
     assert (r >= 0);
 
@@ -260,6 +429,24 @@ void ScriptEngine::defineCollisionFunctions()
     r = registerGlobalFunctionAux(this,"void Query(Vector2, Vector2, QueryBoxCallback@)", asMETHOD(ScriptEngine, scrBoxCollisionQuery), asCALL_THISCALL_ASGLOBAL, this);
     assert(r >= 0);
 
+    //Array variants: results are written into the arrays instead of
+    //calling back into script. The with and type masks filter the actors
+    //the same way as collisionWith and collisionType of an actor
+    r = registerGlobalFunctionAux(this,"uint QueryBox(Vector2 center, Vector2 size, ref[]& actors, uint with = 0xFFFFFFFF, uint type = 0)", asMETHOD(ScriptEngine, scrBoxCollisionQueryArray), asCALL_THISCALL_ASGLOBAL, this);
+    assert(r >= 0);
+
+    r = registerGlobalFunctionAux(this,"uint QueryCircle(Vector2 center, float radius, ref[]& actors, float[]@ distances = null, uint with = 0xFFFFFFFF, uint type = 0)", asMETHOD(ScriptEngine, scrCircleCollisionQueryArray), asCALL_THISCALL_ASGLOBAL, this);
+    assert(r >= 0);
+
+    r = registerGlobalFunctionAux(this,"uint QueryLine(Vector2 start, Vector2 end, ref[]& actors, Vector2[]@ points = null, uint with = 0xFFFFFFFF, uint type = 0)", asMETHOD(ScriptEngine, scrLineCollisionQueryArray), asCALL_THISCALL_ASGLOBAL, this);
+    assert(r >= 0);
+
+    r = registerGlobalFunctionAux(this,"uint QueryBoxes(const Vector2[]& centers, const Vector2[]& sizes, ref[]& actors, uint[]& offsets, uint with = 0xFFFFFFFF, uint type = 0)", asMETHOD(ScriptEngine, scrBoxCollisionQueryBatch), asCALL_THISCALL_ASGLOBAL, this);
+    assert(r >= 0);
+
+    r = registerGlobalFunctionAux(this,"uint QueryCircles(const Vector2[]& centers, const float[]& radii, ref[]& actors, uint[]& offsets, float[]@ distances = null, uint with = 0xFFFFFFFF, uint type = 0)", asMETHOD(ScriptEngine, scrCircleCollisionQueryBatch), asCALL_THISCALL_ASGLOBAL, this);
+    assert(r >= 0);
+
 
     r = ase->RegisterObjectType("MapCollisionInfo",0, asOBJ_REF | asOBJ_NOCOUNT);
     assert (r >= 0);
@@ -278,6 +465,39 @@ void ScriptEngine::defineCollisionFunctions()
 
     r = ase->RegisterObjectProperty("ActorCollisionInfo","Vector2 fix",asOFFSET(ActorCollisionInfo,fix));
     assert (r >= 0);
+
+    r = ase->RegisterObjectType("Statistics",0, asOBJ_REF | asOBJ_NOCOUNT);
+    assert (r >= 0);
+
+    {
+        std::pair<const char*, int> stats[] =
+        {
+            {"const uint actors", asOFFSET(BroadPhaseStatistics, actors)},
+            {"const uint sleepingActors", asOFFSET(BroadPhaseStatistics, sleepingActors)},
+            {"const uint movedActors", asOFFSET(BroadPhaseStatistics, movedActors)},
+            {"const uint reinserts", asOFFSET(BroadPhaseStatistics, reinserts)},
+            {"const uint candidatePairs", asOFFSET(BroadPhaseStatistics, candidatePairs)},
+            {"const uint hits", asOFFSET(BroadPhaseStatistics, hits)},
+            {"const uint tileSweeps", asOFFSET(BroadPhaseStatistics, tileSweeps)},
+            {"const uint scriptCallbacks", asOFFSET(BroadPhaseStatistics, scriptCallbacks)},
+            {"const uint moveTime", asOFFSET(BroadPhaseStatistics, moveTime)},
+            {"const uint tilemapTime", asOFFSET(BroadPhaseStatistics, tilemapTime)},
+            {"const uint pairTime", asOFFSET(BroadPhaseStatistics, pairTime)},
+            {"const uint treeNodes", asOFFSET(BroadPhaseStatistics, treeNodes)},
+            {"const uint treeLeaves", asOFFSET(BroadPhaseStatistics, treeLeaves)},
+            {"const uint treeMaxDepth", asOFFSET(BroadPhaseStatistics, treeMaxDepth)},
+            {"const uint treeEntries", asOFFSET(BroadPhaseStatistics, treeEntries)},
+            {"const uint treeMaxBucket", asOFFSET(BroadPhaseStatistics, treeMaxBucket)}
+        };
+        for (auto& p : stats)
+        {
+            r = ase->RegisterObjectProperty("Statistics", p.first, p.second);
+            assert (r >= 0);
+        }
+    }
+
+    r = registerGlobalFunctionAux(this,"const Statistics& GetStatistics()", asMETHOD(BroadPhase, getStatistics), asCALL_THISCALL_ASGLOBAL, broadPhase);
+    assert (r >= 0);
     
     
 
@@ -286,6 +506,11 @@ void ScriptEngine::defineCollisionFunctions()
 
     r = registerGlobalFunctionAux(this,"bool MapLine(Vector2, Vector2, Map::Layer&, Vector2, Vector2 &out pos, Vector2 &out norm)", asFUNCTION(FindTilemapLineCollision), asCALL_CDECL);
     assert (r >= 0);
+
+    //Batch variant of MapLine, returns the amount of lines that hit. The
+    //points of the lines that don't hit are their end points
+    r = registerGlobalFunctionAux(this,"uint MapLines(const Vector2[]& starts, const Vector2[]& ends, Map::Layer&, Vector2 tileSize, bool[]& hits, Vector2[]& points, Vector2[]& normals)", asFUNCTION(FindTilemapLineCollisions), asCALL_CDECL);
+    assert (r >= 0);
     
     
     r = ase->SetDefaultNamespace("");
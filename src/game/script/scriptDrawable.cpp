@@ -10,10 +10,13 @@
 #include "graphics/characterAnimator.hpp"
 #include "graphics/drawableTilemap.hpp"
 #include "graphics/uniformMap.hpp"
+#include "graphics/spriteBatch.hpp"
 
 
 #include "regHelper.hpp"
 
+#include <scriptarray/scriptarray.h>
+
 
 #define MixinGraphicsRegister \
     void registerToGraphics(int layer)\
@@ -93,6 +96,30 @@ public:
     }
 };
 
+//! A SpriteBatch of its own, which only counts the draw calls the sprites would take
+class RefSpriteBatch : public SpriteBatch
+{
+    MixinReferenceCounted;
+public:
+
+    Graphics* graphics;
+    RefSpriteBatch(Graphics* g) : SpriteBatch(g, false)
+    {
+        graphics = g;
+    }
+
+    void addSprite(RefDrawableSprite* sprite)
+    {
+        if (sprite)
+            sprite->addToBatch(graphics, this);
+    }
+
+    unsigned int getPending()
+    {
+        return getPendingInstances();
+    }
+};
+
 class RefDrawableFillSprite : public DrawableFillSprite
 {
 public:
@@ -160,6 +187,17 @@ public:
         graphics = g;
     }
 
+    bool getTileVerticesArray(Vector2i tile, CScriptArray* out)
+    {
+        out->Resize(FloatsPerTile);
+        if (!readTileVertices(tile, (float*) out->At(0)))
+        {
+            out->Resize(0);
+            return false;
+        }
+        return true;
+    }
+
 };
 
 
@@ -205,6 +243,8 @@ void regDrawableSprite(asIScriptEngine* ase, const char* name)
 
     r = ase->RegisterObjectMethod(name, "void setPosition(Vector2)", asMETHOD(T,setPosition), asCALL_THISCALL);
     assert( r >= 0 );
+    r = ase->RegisterObjectMethod(name, "void stepPosition(Vector2)", asMETHOD(T,stepPosition), asCALL_THISCALL);
+    assert( r >= 0 );
     r = ase->RegisterObjectMethod(name, "void setScale(Vector2)", asMETHOD(T,setScale), asCALL_THISCALL);
     assert( r >= 0 );
     r = ase->RegisterObjectMethod(name, "void setTexture(hash_t)", asMETHOD(T,setTextureFromHash), asCALL_THISCALL);
@@ -234,6 +274,8 @@ void regDrawableStaticQuad(asIScriptEngine* ase, const char* name)
     assert( r >= 0 );
     r = ase->RegisterObjectMethod(name, "void setPosition(Vector2)", asMETHOD(T,setPosition), asCALL_THISCALL);
     assert( r >= 0 );
+    r = ase->RegisterObjectMethod(name, "void stepPosition(Vector2)", asMETHOD(T,stepPosition), asCALL_THISCALL);
+    assert( r >= 0 );
     r = ase->RegisterObjectMethod(name, "void setSize(Vector2)", asMETHOD(T,setSize), asCALL_THISCALL);
     assert( r >= 0 );
     r = ase->RegisterObjectMethod(name, "void setColor(Color, float)", asMETHOD(T,setColor), asCALL_THISCALL);
@@ -296,6 +338,15 @@ void regDrawableTilemap(asIScriptEngine* ase, const char* name)
     
     r = ase->RegisterObjectMethod(name, "void setUniforms(UniformMap&)", asMETHOD(T, setUniforms), asCALL_THISCALL);
     assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod(name, "uint updateTiles()", asMETHOD(T, updateTiles), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod(name, "uint getUploadedSpans() const", asMETHOD(T, getUploadedSpans), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod(name, "bool getTileVertices(Vector2i, float[]&)", asMETHOD(T, getTileVerticesArray), asCALL_THISCALL);
+    assert( r >= 0 );
     
     (void)(r);
 }
@@ -308,6 +359,8 @@ void regCharacterAnimator(asIScriptEngine* ase, const char* name)
     int r;
     r = ase->RegisterObjectMethod(name, "void setPosition(Vector2)", asMETHOD(T,setPosition), asCALL_THISCALL);
     assert( r >= 0 );
+    r = ase->RegisterObjectMethod(name, "void stepPosition(Vector2)", asMETHOD(T,stepPosition), asCALL_THISCALL);
+    assert( r >= 0 );
     r = ase->RegisterObjectMethod(name, "void setAnimationSet(hash_t)", asMETHOD(T,setAnimationSetFromHash), asCALL_THISCALL);
     assert( r >= 0 );
     r = ase->RegisterObjectMethod(name, "void setBgSpeed(float)", asMETHOD(T,setBgSpeed), asCALL_THISCALL);
@@ -395,6 +448,16 @@ RefDrawableSprite* ScriptEngine::factoryDrawableSprite()
     return new RefDrawableSprite(engine->getGraphics());
 }
 
+RefSpriteBatch* ScriptEngine::factorySpriteBatch()
+{
+    return new RefSpriteBatch(engine->getGraphics());
+}
+
+bool ScriptEngine::scrAddTextureArea(Hash::HashUInt name, Hash::HashUInt page, Vector2i position, Vector2i size)
+{
+    return engine->getGraphics()->getAssets()->textures.addArea(Hash(name), Hash(page), position, size) != nullptr;
+}
+
 RefDrawableStaticQuad* ScriptEngine::factoryDrawableStaticQuad()
 {
     return new RefDrawableStaticQuad(engine->getGraphics());
@@ -479,6 +542,36 @@ void ScriptEngine::defineDrawables()
 
     regDrawableSprite<RefDrawableSprite>(ase, "Sprite");
 
+    // SpriteBatch
+
+    r = ase->RegisterObjectType("SpriteBatch", 0, asOBJ_REF);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectBehaviour("SpriteBatch", asBEHAVE_FACTORY, "SpriteBatch@ f()", asMETHOD(ScriptEngine,factorySpriteBatch), asCALL_THISCALL_ASGLOBAL,this);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectBehaviour("SpriteBatch", asBEHAVE_ADDREF, "void f()", asMETHOD(RefSpriteBatch,addRef), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectBehaviour("SpriteBatch", asBEHAVE_RELEASE, "void f()", asMETHOD(RefSpriteBatch,release), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("SpriteBatch", "void add(Sprite@)", asMETHOD(RefSpriteBatch,addSprite), asCALL_THISCALL);
+    assert( r >= 0 );
+    r = ase->RegisterObjectMethod("SpriteBatch", "void flush()", asMETHOD(RefSpriteBatch,flush), asCALL_THISCALL);
+    assert( r >= 0 );
+    r = ase->RegisterObjectMethod("SpriteBatch", "uint getPendingInstances()", asMETHOD(RefSpriteBatch,getPending), asCALL_THISCALL);
+    assert( r >= 0 );
+    r = ase->RegisterObjectMethod("SpriteBatch", "uint getDrawCalls()", asMETHOD(RefSpriteBatch,getDrawCalls), asCALL_THISCALL);
+    assert( r >= 0 );
+    r = ase->RegisterObjectMethod("SpriteBatch", "uint getInstances()", asMETHOD(RefSpriteBatch,getInstances), asCALL_THISCALL);
+    assert( r >= 0 );
+    r = ase->RegisterObjectMethod("SpriteBatch", "void resetCounters()", asMETHOD(RefSpriteBatch,resetCounters), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = registerGlobalFunctionAux(this,"bool AddTextureArea(hash_t name, hash_t page, Vector2i position, Vector2i size)", asMETHOD(ScriptEngine,scrAddTextureArea), asCALL_THISCALL_ASGLOBAL, this);
+    assert( r >= 0 );
+
     // DrawableFillSprite
 
     r = ase->RegisterObjectType("FillSprite", 0, asOBJ_REF);
@@ -1,5 +1,8 @@
 #include "script.hpp"
 #include "log.hpp"
+#include "asyncFile.hpp"
+
+#include "regHelper.hpp"
 
 #include <cstddef>
 #include <angelscript.h>
@@ -67,6 +70,41 @@ void ScriptEngine::defineFile()
 
     r = ase->RegisterObjectMethod("File","void writeInt8(int8)", asMETHODPR(ScriptFile,write<int8_t>, (int8_t), void), asCALL_THISCALL);
     assert (r >= 0);
+
+    r = ase->SetDefaultNamespace("Files");
+    assert (r >= 0);
+
+    r = ase->RegisterObjectType("AsyncFile",0, asOBJ_REF);
+    assert (r >= 0);
+
+    r = ase->RegisterObjectBehaviour("AsyncFile", asBEHAVE_ADDREF, "void f()", asMETHOD(AsyncFile, addRef), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectBehaviour("AsyncFile", asBEHAVE_RELEASE, "void f()", asMETHOD(AsyncFile, release), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("AsyncFile", "bool isReady() const", asMETHOD(AsyncFile, isReady), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("AsyncFile", "bool isFailed() const", asMETHOD(AsyncFile, isFailed), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("AsyncFile", "size_t getSize() const", asMETHOD(AsyncFile, getSize), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("AsyncFile", "string getData() const", asMETHOD(AsyncFile, getString), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("AsyncFile", "const string& getFilename() const", asMETHOD(AsyncFile, getFilename), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("AsyncFile", "void wait()", asMETHOD(AsyncFile, wait), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = registerGlobalFunctionAux(this,"AsyncFile@ ReadAsync(const string &in)", asFUNCTION(ReadFileAsync), asCALL_CDECL);
+    assert(r >= 0);
+
+    ase->SetDefaultNamespace("");
     (void)(r);
 
 }
@@ -242,6 +242,18 @@ void ScriptEngine::defineGameFunctions()
     r = registerGlobalFunctionAux(this,"double GetDeltaTime()", asMETHOD(Engine, getDeltaTime), asCALL_THISCALL_ASGLOBAL, engine);
     assert (r >= 0);
 
+    r = registerGlobalFunctionAux(this,"uint GetPhysicsSteps()", asMETHOD(Engine, getPhysicsSteps), asCALL_THISCALL_ASGLOBAL, engine);
+    assert (r >= 0);
+
+    r = registerGlobalFunctionAux(this,"uint GetPhysicsSubsteps()", asMETHOD(Engine, getPhysicsSubsteps), asCALL_THISCALL_ASGLOBAL, engine);
+    assert (r >= 0);
+
+    r = registerGlobalFunctionAux(this,"double GetPhysicsDeltaTime()", asMETHOD(Engine, getPhysicsDeltaTime), asCALL_THISCALL_ASGLOBAL, engine);
+    assert (r >= 0);
+
+    r = registerGlobalFunctionAux(this,"double GetPhysicsAlpha()", asMETHOD(Engine, getPhysicsAlpha), asCALL_THISCALL_ASGLOBAL, engine);
+    assert (r >= 0);
+
     r = registerGlobalFunctionAux(this,"bool GetAnyKey()", asMETHOD(Window, getAnyKeyPressed), asCALL_THISCALL_ASGLOBAL, window);
     assert (r >= 0);
 
@@ -4,6 +4,7 @@
 
 #include "game/tilemapLoading.hpp"
 #include "game/tilemap.hpp"
+#include "game/tilemapStreamer.hpp"
 #include "game/game.hpp"
 
 #include "regHelper.hpp"
@@ -105,6 +106,11 @@ Tileset* factoryTileset()
     return new Tileset();
 }
 
+TilemapStreamer* factoryTilemapStreamer()
+{
+    return new TilemapStreamer();
+}
+
 
 void ScriptEngine::defineMap()
 {
@@ -199,7 +205,7 @@ void ScriptEngine::defineMap()
     r = ase->RegisterObjectMethod("Layer", "int getTile(Vector2i pos)", asMETHOD(TilemapLayer, getTile), asCALL_THISCALL);
     assert( r >= 0 );
     
-    r = ase->RegisterObjectMethod("Layer", "Vector2i getSize()", asMETHOD(TilemapLayer, getSize), asCALL_THISCALL);
+    r = ase->RegisterObjectMethod("Layer", "Vector2i getSize() const", asMETHOD(TilemapLayer, getSize), asCALL_THISCALL);
     assert( r >= 0 );
     
     r = ase->RegisterObjectMethod("Layer", "void fill(Vector2i min, Vector2i to, int value)", asMETHOD(TilemapLayer, fill), asCALL_THISCALL);
@@ -207,6 +213,15 @@ void ScriptEngine::defineMap()
     
     r = ase->RegisterObjectMethod("Layer", "void setTileset(Map::Tileset&)", asMETHOD(TilemapLayer, setTileset), asCALL_THISCALL);
     assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Layer", "void setValueBits(uint bits)", asMETHOD(TilemapLayer, setValueBits), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Layer", "uint getValueBits() const", asMETHOD(TilemapLayer, getValueBits), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Layer", "uint getAllocatedChunks() const", asMETHOD(TilemapLayer, getAllocatedChunks), asCALL_THISCALL);
+    assert( r >= 0 );
     
         
     r = ase->RegisterObjectType("Object",0, asOBJ_REF);
@@ -273,6 +288,54 @@ void ScriptEngine::defineMap()
     
     r = registerGlobalFunctionAux(this,"Map@ LoadTSMap(const string &in )", asFUNCTION(TilemapLoading::LoadTSMap), asCALL_CDECL);
     assert(r >= 0);
+
+    r = registerGlobalFunctionAux(this,"bool ConvertTSMap(const string &in from, const string &in to, bool chunked = false)", asFUNCTION(TilemapLoading::ConvertTSMap), asCALL_CDECL);
+    assert(r >= 0);
+
+    r = ase->RegisterObjectType("Streamer",0, asOBJ_REF);
+    assert (r >= 0);
+
+    r = ase->RegisterObjectBehaviour("Streamer", asBEHAVE_FACTORY, "Streamer@ f()", asFUNCTION(factoryTilemapStreamer), asCALL_CDECL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectBehaviour("Streamer", asBEHAVE_ADDREF, "void f()", asMETHOD(TilemapStreamer, addRef), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectBehaviour("Streamer", asBEHAVE_RELEASE, "void f()", asMETHOD(TilemapStreamer, release), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "void setRadius(int chunks)", asMETHOD(TilemapStreamer, setRadius), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "int getRadius() const", asMETHOD(TilemapStreamer, getRadius), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "void setChunkBudget(uint chunks)", asMETHOD(TilemapStreamer, setChunkBudget), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "uint getChunkBudget() const", asMETHOD(TilemapStreamer, getChunkBudget), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "bool open(const string &in)", asMETHOD(TilemapStreamer, open), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "Map@ getMap()", asMETHOD(TilemapStreamer, getMap), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "uint update(Vector2i center)", asMETHOD(TilemapStreamer, update), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "void wait()", asMETHOD(TilemapStreamer, wait), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "uint getResidentChunks() const", asMETHOD(TilemapStreamer, getResidentChunks), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "uint getPendingChunks()", asMETHOD(TilemapStreamer, getPendingChunks), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Streamer", "uint getFailedChunks() const", asMETHOD(TilemapStreamer, getFailedChunks), asCALL_THISCALL);
+    assert( r >= 0 );
     
     ase->SetDefaultNamespace("");
     
@@ -1,17 +1,110 @@
 #include "script.hpp"
 #include "game/game.hpp"
+#include "game/flowField.hpp"
 #include "game/pathfinding.hpp"
+#include "game/pathHierarchy.hpp"
+#include "game/pathService.hpp"
+#include "game/tilemap.hpp"
+#include "variable.hpp"
 
 #include "log.hpp"
+#include "regHelper.hpp"
 
+#include <scriptarray/scriptarray.h>
 #include <angelscript.h>
 #include <cassert>
+#include <algorithm>
 
-/*
-class RefPathfinder : public Pathfinder
+class RefPathRequest;
+
+//! Pathfinding state shared by all the Path objects and the PathService
+class ScriptPathfinding
+{
+    ReferenceHolder<TilemapLayer> layer;
+    ReferenceHolder<TilemapLayer> hierarchyLayer;
+    std::unique_ptr<PathService> service;
+    std::unique_ptr<WorkerPool> flowWorkers;
+public:
+    GridPathfinder pathfinder;
+    PathGrid grid;
+    PathHierarchy hierarchy;
+
+    //! Requests with a callback, waiting for the delivery
+    std::vector<RefPathRequest*> callbackRequests;
+
+    //! Get the walkability grid of the layer, rebuilt only when the layer has changed
+    const PathGrid& getGrid(TilemapLayer* l)
+    {
+        if (layer.get() != l)
+            layer = ReferenceHolder<TilemapLayer>::create(l);
+        grid.refresh(*l);
+        return grid;
+    }
+
+    //! Get the hierarchy of the layer, repaired if the layer has changed
+    PathHierarchy& getHierarchy(TilemapLayer* l)
+    {
+        if (hierarchyLayer.get() != l)
+            hierarchyLayer = ReferenceHolder<TilemapLayer>::create(l);
+        hierarchy.update(*l);
+        return hierarchy;
+    }
+
+    //! Get the PathService, created on the first use
+    PathService* getService(Engine* engine)
+    {
+        if (!service)
+        {
+            auto* vm = engine->getVariableManager();
+            int threads = vm->getIntegerDefault(CHash("Path.Threads"), 1);
+            service = std::unique_ptr<PathService>(new PathService(std::max(threads, 0)));
+            service->setCacheCapacity(std::max<int>(vm->getIntegerDefault(CHash("Path.CacheSize"), 256), 0));
+            service->setCacheQuantum(vm->getIntegerDefault(CHash("Path.CacheQuantum"), 1));
+        }
+        return service.get();
+    }
+
+    //! Returns the PathService if it has been created
+    PathService* findService()
+    {
+        return service.get();
+    }
+
+    //! Get the worker the flow fields are computed on, created on the first use
+    WorkerPool* getFlowWorkers(Engine* engine)
+    {
+        if (!flowWorkers)
+        {
+            //With no path threads the flow fields are computed immediately
+            int threads = engine->getVariableManager()->getIntegerDefault(CHash("Path.Threads"), 1);
+            flowWorkers = std::unique_ptr<WorkerPool>(new WorkerPool(threads > 0 ? 1 : 0));
+        }
+        return flowWorkers.get();
+    }
+
+    ~ScriptPathfinding()
+    {
+        //A flow field waits for its search, which must not be left in the queue
+        if (flowWorkers)
+            flowWorkers->waitTasks();
+    }
+};
+
+class RefPathfinder
 {
     int ref;
+    ScriptPathfinding* shared;
+
+    std::vector<Vector2i> points;
+    size_t next = 0;
+    float cost = 0.0f;
+    unsigned int expanded = 0;
 public:
+    bool diagonal = true;
+    bool jumpPoints = false;
+    bool hierarchical = false;
+    float heuristicWeight = 1.0f;
+    unsigned int maxExpanded = 0;
 
     void addRef()
     {
@@ -27,82 +120,479 @@ public:
         }
     }
 
-    RefPathfinder(GameMapHandler* ga) : Pathfinder(ga)
+    RefPathfinder(ScriptPathfinding* s) : shared(s)
     {
         ref = 1;
     }
 
-    DefVector2 getTargetPoint()
+    bool find(TilemapLayer& layer, Vector2i start, Vector2i goal)
     {
-        if (isDirect())
-            return end;
-        if (points.size() > 0)
+        if (hierarchical)
+        {
+            PathHierarchy& h = shared->getHierarchy(&layer);
+            h.heuristicWeight = heuristicWeight;
+
+            PathResult r = h.find(start, goal, points);
+            next = 0;
+            expanded = h.getExpanded();
+            cost = h.getCost();
+            return r == PathResult::Found;
+        }
+
+        GridPathfinder& pf = shared->pathfinder;
+        pf.diagonal = diagonal;
+        pf.jumpPoints = jumpPoints;
+        pf.maxExpanded = maxExpanded;
+
+        PathResult r = pf.find(shared->getGrid(&layer), start, goal, points);
+        next = 0;
+        expanded = pf.getExpanded();
+        cost = (r == PathResult::Found) ? pf.getCost() : 0.0f;
+        return r == PathResult::Found;
+    }
+
+    void setDiagonal(bool b) {diagonal = b;}
+    void setJumpPoints(bool b) {jumpPoints = b;}
+    void setMaxExpanded(unsigned int m) {maxExpanded = m;}
+    void setHierarchical(bool b) {hierarchical = b;}
+    void setHeuristicWeight(float w) {heuristicWeight = std::max(w, 1.0f);}
+
+    unsigned int getLength() {return points.size();}
+    float getCost() {return cost;}
+    unsigned int getExpanded() {return expanded;}
+
+    Vector2i getPoint(unsigned int i)
+    {
+        if (i >= points.size())
         {
-            return *points.begin();
+            asGetActiveContext()->SetException("Path point index out of bounds");
+            return {0, 0};
         }
-        else
-            return end;
+        return points[i];
+    }
+
+    Vector2i getNext()
+    {
+        if (next < points.size())
+            return points[next];
+        if (points.size() > 0)
+            return points.back();
+        return {0, 0};
     }
 
     bool isAtEnd()
     {
-        return (points.size()==0);
+        return next >= points.size();
     }
 
     void advance()
     {
-        if (points.size() > 0)
-            points.pop_front();
+        if (next < points.size())
+            next++;
     }
 };
 
+class RefPathRequest
+{
+    int ref;
+    ScriptCallback callback;
+public:
+    std::shared_ptr<PathTicket> ticket;
+    PathService* service;
+
+    void addRef()
+    {
+        ref++;
+    }
+
+    void release()
+    {
+        ref--;
+        if (ref <= 0)
+        {
+            delete this;
+        }
+    }
+
+    RefPathRequest(asIScriptEngine* ase, PathService* s, std::shared_ptr<PathTicket> t) : callback(ase), ticket(t), service(s)
+    {
+        ref = 1;
+    }
+
+    ~RefPathRequest()
+    {
+        callback.release();
+    }
+
+    void setCallback(asIScriptFunction* cb)
+    {
+        callback.set(cb);
+    }
+
+    //! Call the script callback once, returns false if there is none
+    bool runCallback(asIScriptContext* ctx)
+    {
+        if (!callback.callback)
+            return false;
+
+        ctx->Prepare(callback.callback);
+        if (callback.object)
+            ctx->SetObject(callback.object);
+        ctx->SetArgObject(0, this);
+        ctx->Execute();
+
+        callback.release();
+        return true;
+    }
+
+    bool isDone() {return ticket->isDone();}
+    bool isFound() {return ticket->isDone() && ticket->result == PathResult::Found;}
+    bool isCached() {return ticket->isDone() && ticket->cached;}
+    float getCost() {return isDone() ? ticket->cost : 0.0f;}
+    unsigned int getExpanded() {return isDone() ? ticket->expanded : 0;}
+    unsigned int getLength() {return isDone() ? ticket->points.size() : 0;}
+
+    Vector2i getPoint(unsigned int i)
+    {
+        if (i >= getLength())
+        {
+            asGetActiveContext()->SetException("Path point index out of bounds");
+            return {0, 0};
+        }
+        return ticket->points[i];
+    }
+
+    void cancel()
+    {
+        if (!ticket->isDone())
+            service->cancel(*ticket);
+    }
+};
+
+class RefFlowField
+{
+    int ref;
+    ScriptPathfinding* shared;
+    Engine* engine;
+    std::vector<Vector2i> goals;
+public:
+    FlowField field;
+
+    void addRef()
+    {
+        ref++;
+    }
+
+    void release()
+    {
+        ref--;
+        if (ref <= 0)
+        {
+            delete this;
+        }
+    }
+
+    RefFlowField(ScriptPathfinding* s, Engine* e) : shared(s), engine(e)
+    {
+        ref = 1;
+    }
+
+    void setGoal(Vector2i goal)
+    {
+        goals.assign(1, goal);
+        field.setGoals(goals);
+    }
+
+    void setGoals(CScriptArray* arr)
+    {
+        goals.resize(arr->GetSize());
+        for (asUINT i = 0; i < arr->GetSize(); i++)
+            goals[i] = *(Vector2i*) arr->At(i);
+        field.setGoals(goals);
+    }
+
+    bool update(TilemapLayer& layer)
+    {
+        return field.update(layer, shared->getFlowWorkers(engine));
+    }
+
+    void setPatchRadius(int r) {field.patchRadius = std::max(r, 0);}
+    void setAgentSize(unsigned int size) {field.setAgentSize(size);}
+    void wait() {field.wait();}
+    bool isReady() {return field.isReady();}
+    bool wasFullSearch() {return field.wasFullSearch();}
+    unsigned int getGeneration() {return field.getGeneration();}
+    Vector2i getDirection(Vector2i cell) {return field.getDirection(cell);}
+    float getCost(Vector2i cell) {return field.getCost(cell);}
+};
+
+RefFlowField* ScriptEngine::factoryFlowField()
+{
+    return new RefFlowField(pathfinding, engine);
+}
+
 RefPathfinder* ScriptEngine::factoryPathfinder()
 {
-    return new RefPathfinder(engine->getMapHandler());
+    return new RefPathfinder(pathfinding);
+}
+
+RefPathRequest* ScriptEngine::scrRequestPath(TilemapLayer& layer, Vector2i start, Vector2i goal, unsigned int agentSize, int priority)
+{
+    PathQuery query;
+    query.start = start;
+    query.goal = goal;
+    query.agentSize = agentSize;
+    query.priority = priority;
+
+    PathService* service = pathfinding->getService(engine);
+    return new RefPathRequest(ase, service, service->request(layer, query));
+}
+
+RefPathRequest* ScriptEngine::scrRequestPathCallback(TilemapLayer& layer, Vector2i start, Vector2i goal, asIScriptFunction* cb, unsigned int agentSize, int priority)
+{
+    RefPathRequest* req = scrRequestPath(layer, start, goal, agentSize, priority);
+    if (cb)
+    {
+        //The service keeps the request alive until the callback is called
+        req->setCallback(cb);
+        req->addRef();
+        pathfinding->callbackRequests.push_back(req);
+    }
+    return req;
+}
+
+void ScriptEngine::runPathCallbacks()
+{
+    auto& pending = pathfinding->callbackRequests;
+    std::vector<RefPathRequest*> ready;
+    size_t w = 0;
+    for (size_t i = 0; i < pending.size(); i++)
+    {
+        RefPathRequest* req = pending[i];
+        if (req->ticket->isDone() || req->ticket->isCancelled())
+            ready.push_back(req);
+        else
+            pending[w++] = req;
+    }
+    pending.resize(w);
+
+    if (ready.empty())
+        return;
+
+    //The callbacks may request new paths
+    auto* ctx = ase->RequestContext();
+    for (RefPathRequest* req : ready)
+    {
+        if (req->ticket->isDone())
+            req->runCallback(ctx);
+        req->release();
+    }
+    ase->ReturnContext(ctx);
+}
+
+void ScriptEngine::updatePathService()
+{
+    PathService* service = pathfinding ? pathfinding->findService() : nullptr;
+    if (!service)
+        return;
+
+    int budget = engine->getVariableManager()->getIntegerDefault(CHash("Path.CompletionBudget"), 0);
+    service->update(std::max(budget, 0));
+    runPathCallbacks();
+}
+
+void ScriptEngine::scrFlushPaths()
+{
+    PathService* service = pathfinding->findService();
+    if (!service)
+        return;
+    service->flush();
+    runPathCallbacks();
+}
+
+unsigned int ScriptEngine::scrGetQueuedPaths()
+{
+    PathService* service = pathfinding->findService();
+    return service ? service->getQueued() : 0;
+}
+
+void ScriptEngine::scrClearPathCache()
+{
+    PathService* service = pathfinding->findService();
+    if (service)
+        service->clearCache();
+}
+
+void ScriptEngine::releasePathfinding()
+{
+    if (!pathfinding)
+        return;
+
+    for (RefPathRequest* req : pathfinding->callbackRequests)
+        req->release();
+    pathfinding->callbackRequests.clear();
+
+    delete pathfinding;
+    pathfinding = nullptr;
 }
-*/
 
 void ScriptEngine::definePath()
 {
-    /*
+    pathfinding = new ScriptPathfinding();
+
     int r;
-    r = ase->RegisterObjectType("Path",sizeof(RefPathfinder), asOBJ_REF);
+    r = ase->RegisterObjectType("Path",0, asOBJ_REF);
     assert (r >= 0);
 
-    ase->RegisterObjectBehaviour("Path", asBEHAVE_FACTORY, "Path@ f()", asMETHOD(ScriptEngine,factoryPathfinder), asCALL_THISCALL_ASGLOBAL,this);
+    r = ase->RegisterObjectBehaviour("Path", asBEHAVE_FACTORY, "Path@ f()", asMETHOD(ScriptEngine,factoryPathfinder), asCALL_THISCALL_ASGLOBAL,this);
     assert( r >= 0 );
 
-    ase->RegisterObjectBehaviour("Path", asBEHAVE_ADDREF, "void f()", asMETHOD(RefPathfinder,addRef), asCALL_THISCALL);
+    r = ase->RegisterObjectBehaviour("Path", asBEHAVE_ADDREF, "void f()", asMETHOD(RefPathfinder,addRef), asCALL_THISCALL);
     assert( r >= 0 );
 
-    ase->RegisterObjectBehaviour("Path", asBEHAVE_RELEASE, "void f()", asMETHOD(RefPathfinder,release), asCALL_THISCALL);
+    r = ase->RegisterObjectBehaviour("Path", asBEHAVE_RELEASE, "void f()", asMETHOD(RefPathfinder,release), asCALL_THISCALL);
     assert( r >= 0 );
 
-    r = ase->RegisterObjectMethod("Path", "void setEnd(Vector2)", asMETHOD(RefPathfinder,setEnd), asCALL_THISCALL);
+    r = ase->RegisterObjectMethod("Path", "bool find(Map::Layer& layer, Vector2i start, Vector2i goal)", asMETHOD(RefPathfinder,find), asCALL_THISCALL);
     assert( r >= 0 );
 
-    r = ase->RegisterObjectMethod("Path", "void setBegin(Vector2)", asMETHOD(RefPathfinder,setBegin), asCALL_THISCALL);
+    r = ase->RegisterObjectMethod("Path", "void setDiagonal(bool)", asMETHOD(RefPathfinder,setDiagonal), asCALL_THISCALL);
     assert( r >= 0 );
 
-    r = ase->RegisterObjectMethod("Path", "Vector2 getNext()", asMETHOD(RefPathfinder,getTargetPoint), asCALL_THISCALL);
+    r = ase->RegisterObjectMethod("Path", "void setJumpPoints(bool)", asMETHOD(RefPathfinder,setJumpPoints), asCALL_THISCALL);
     assert( r >= 0 );
 
-    r = ase->RegisterObjectMethod("Path", "bool isAtEnd()", asMETHOD(RefPathfinder,isAtEnd), asCALL_THISCALL);
+    r = ase->RegisterObjectMethod("Path", "void setMaxExpanded(uint)", asMETHOD(RefPathfinder,setMaxExpanded), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Path", "void setHierarchical(bool)", asMETHOD(RefPathfinder,setHierarchical), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Path", "void setHeuristicWeight(float)", asMETHOD(RefPathfinder,setHeuristicWeight), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Path", "uint getLength()", asMETHOD(RefPathfinder,getLength), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Path", "Vector2i getPoint(uint)", asMETHOD(RefPathfinder,getPoint), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Path", "float getCost()", asMETHOD(RefPathfinder,getCost), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Path", "uint getExpanded()", asMETHOD(RefPathfinder,getExpanded), asCALL_THISCALL);
     assert( r >= 0 );
 
-    r = ase->RegisterObjectMethod("Path", "bool isDirect()", asMETHOD(RefPathfinder,isDirect), asCALL_THISCALL);
+    r = ase->RegisterObjectMethod("Path", "Vector2i getNext()", asMETHOD(RefPathfinder,getNext), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("Path", "bool isAtEnd()", asMETHOD(RefPathfinder,isAtEnd), asCALL_THISCALL);
     assert( r >= 0 );
 
     r = ase->RegisterObjectMethod("Path", "void advance()", asMETHOD(RefPathfinder,advance), asCALL_THISCALL);
     assert( r >= 0 );
 
-    r = ase->RegisterObjectMethod("Path", "void update()", asMETHOD(RefPathfinder,update), asCALL_THISCALL);
+    r = ase->RegisterObjectType("PathRequest",0, asOBJ_REF);
+    assert (r >= 0);
+
+    r = ase->RegisterObjectBehaviour("PathRequest", asBEHAVE_ADDREF, "void f()", asMETHOD(RefPathRequest,addRef), asCALL_THISCALL);
     assert( r >= 0 );
 
-    r = ase->RegisterObjectMethod("Path", "void setPathSize(Vector2)", asMETHOD(RefPathfinder,setPathSize), asCALL_THISCALL);
+    r = ase->RegisterObjectBehaviour("PathRequest", asBEHAVE_RELEASE, "void f()", asMETHOD(RefPathRequest,release), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("PathRequest", "bool isDone()", asMETHOD(RefPathRequest,isDone), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("PathRequest", "bool isFound()", asMETHOD(RefPathRequest,isFound), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("PathRequest", "bool isCached()", asMETHOD(RefPathRequest,isCached), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("PathRequest", "uint getLength()", asMETHOD(RefPathRequest,getLength), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("PathRequest", "Vector2i getPoint(uint)", asMETHOD(RefPathRequest,getPoint), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("PathRequest", "float getCost()", asMETHOD(RefPathRequest,getCost), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("PathRequest", "uint getExpanded()", asMETHOD(RefPathRequest,getExpanded), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("PathRequest", "void cancel()", asMETHOD(RefPathRequest,cancel), asCALL_THISCALL);
     assert( r >= 0 );
-    (void)(r);
-    */
-}
 
+    r = ase->RegisterObjectType("FlowField",0, asOBJ_REF);
+    assert (r >= 0);
 
+    r = ase->RegisterObjectBehaviour("FlowField", asBEHAVE_FACTORY, "FlowField@ f()", asMETHOD(ScriptEngine,factoryFlowField), asCALL_THISCALL_ASGLOBAL,this);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectBehaviour("FlowField", asBEHAVE_ADDREF, "void f()", asMETHOD(RefFlowField,addRef), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectBehaviour("FlowField", asBEHAVE_RELEASE, "void f()", asMETHOD(RefFlowField,release), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "void setGoal(Vector2i)", asMETHOD(RefFlowField,setGoal), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "void setGoals(const Vector2i[]&)", asMETHOD(RefFlowField,setGoals), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "bool update(Map::Layer& layer)", asMETHOD(RefFlowField,update), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "void setPatchRadius(int)", asMETHOD(RefFlowField,setPatchRadius), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "void setAgentSize(uint)", asMETHOD(RefFlowField,setAgentSize), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "void wait()", asMETHOD(RefFlowField,wait), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "bool isReady()", asMETHOD(RefFlowField,isReady), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "bool wasFullSearch()", asMETHOD(RefFlowField,wasFullSearch), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "uint getGeneration()", asMETHOD(RefFlowField,getGeneration), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "Vector2i getDirection(Vector2i)", asMETHOD(RefFlowField,getDirection), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterObjectMethod("FlowField", "float getCost(Vector2i)", asMETHOD(RefFlowField,getCost), asCALL_THISCALL);
+    assert( r >= 0 );
+
+    r = ase->RegisterFuncdef("void PathCallback(PathRequest@)");
+    assert( r >= 0 );
+
+    //Asynchronous requests, delivered at the end of the step
+    r = ase->SetDefaultNamespace("PathService");
+    assert( r >= 0 );
+
+    r = registerGlobalFunctionAux(this, "PathRequest@ Request(Map::Layer& layer, Vector2i start, Vector2i goal, uint agentSize = 1, int priority = 0)", asMETHOD(ScriptEngine, scrRequestPath), asCALL_THISCALL_ASGLOBAL, this);
+    assert( r >= 0 );
+
+    r = registerGlobalFunctionAux(this, "PathRequest@ Request(Map::Layer& layer, Vector2i start, Vector2i goal, PathCallback@ cb, uint agentSize = 1, int priority = 0)", asMETHOD(ScriptEngine, scrRequestPathCallback), asCALL_THISCALL_ASGLOBAL, this);
+    assert( r >= 0 );
+
+    r = registerGlobalFunctionAux(this, "void Flush()", asMETHOD(ScriptEngine, scrFlushPaths), asCALL_THISCALL_ASGLOBAL, this);
+    assert( r >= 0 );
+
+    r = registerGlobalFunctionAux(this, "uint GetQueued()", asMETHOD(ScriptEngine, scrGetQueuedPaths), asCALL_THISCALL_ASGLOBAL, this);
+    assert( r >= 0 );
+
+    r = registerGlobalFunctionAux(this, "void ClearCache()", asMETHOD(ScriptEngine, scrClearPathCache), asCALL_THISCALL_ASGLOBAL, this);
+    assert( r >= 0 );
+
+    r = ase->SetDefaultNamespace("");
+    assert( r >= 0 );
+    (void)(r);
+}
@@ -194,6 +194,9 @@ void define_vector2(asIScriptEngine* ase, const std::string& tname, const std::s
     r = ase->RegisterObjectBehaviour(tname.c_str(), asBEHAVE_LIST_CONSTRUCT, (std::string("void f(const int &in) {")+uname+","+uname+"}").c_str(), asFUNCTION(funs::froml), asCALL_CDECL_OBJLAST);
     assert( r >= 0 );
 
+    r = ase->RegisterObjectMethod(tname.c_str(), ("bool opEquals(const "+tname+" &in) const").c_str(), asMETHODPR(Type, operator==, (const Type&) const, bool), asCALL_THISCALL);
+    assert (r >= 0);
+
     r = ase->RegisterObjectMethod(tname.c_str(), (tname + " opAdd(const "+tname+" &in) const").c_str(), asMETHODPR(Type, operator+, (const Type&) const, Type), asCALL_THISCALL);
     assert (r >= 0);
     r = ase->RegisterObjectMethod(tname.c_str(), (tname + " opSub(const "+tname+" &in) const").c_str(), asMETHODPR(Type, operator-, (const Type&) const, Type), asCALL_THISCALL);
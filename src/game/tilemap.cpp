@@ -2,16 +2,156 @@
 #include <algorithm>
 
 
+//Read by the chunks without any non-zero tiles, large enough for any value width
+static const uint32_t EmptyChunk[TilemapLayer::ChunkArea] = {};
+
+void TilemapLayer::releaseChunks()
+{
+    const uint8_t* empty = reinterpret_cast<const uint8_t*>(EmptyChunk);
+    std::fill(chunkTiles.begin(), chunkTiles.end(), empty);
+    for (auto& c : chunkStorage)
+        c.reset();
+    std::fill(chunkUsed.begin(), chunkUsed.end(), 0);
+    allocatedChunks = 0;
+}
+
+unsigned int TilemapLayer::BytesFor(Tileset::Value value)
+{
+    if (value >= 0 && value <= 0xFF)
+        return 1;
+    if (value >= 0 && value <= 0xFFFF)
+        return 2;
+    return 4;
+}
+
+void TilemapLayer::widenFor(Tileset::Value value)
+{
+    unsigned int bytes = BytesFor(value);
+    if (bytes > valueBytes)
+        setValueBits(bytes * 8);
+}
+
+void TilemapLayer::setValueBits(unsigned int bits)
+{
+    unsigned int bytes = bits <= 8 ? 1 : (bits <= 16 ? 2 : 4);
+    bytes = std::max(bytes, std::max(BytesFor(minimum), BytesFor(maximum)));
+    if (bytes == valueBytes)
+        return;
+
+    for (size_t c = 0; c < chunkStorage.size(); c++)
+    {
+        if (!chunkStorage[c])
+            continue;
+
+        std::unique_ptr<uint8_t[]> wide(new uint8_t[ChunkArea * bytes]);
+        for (int i = 0; i < ChunkArea; i++)
+        {
+            Tileset::Value v = readTile(chunkStorage[c].get(), i);
+            switch (bytes)
+            {
+            case 1:
+                wide[i] = v;
+                break;
+            case 2:
+                reinterpret_cast<uint16_t*>(wide.get())[i] = v;
+                break;
+            default:
+                reinterpret_cast<int32_t*>(wide.get())[i] = v;
+            }
+        }
+        chunkStorage[c] = std::move(wide);
+        chunkTiles[c] = chunkStorage[c].get();
+    }
+    valueBytes = bytes;
+}
+
+void TilemapLayer::writeTile(int x, int y, Tileset::Value value)
+{
+    widenFor(value);
+
+    int c = (x >> ChunkShift) + (y >> ChunkShift) * chunksX;
+    int i = (x & (ChunkSize - 1)) + ((y & (ChunkSize - 1)) << ChunkShift);
+    Tileset::Value old = readTile(chunkTiles[c], i);
+    if (old == value)
+        return;
+
+    uint8_t* chunk = chunkStorage[c] ? chunkStorage[c].get() : allocateChunk(c);
+    switch (valueBytes)
+    {
+    case 1:
+        chunk[i] = value;
+        break;
+    case 2:
+        reinterpret_cast<uint16_t*>(chunk)[i] = value;
+        break;
+    default:
+        reinterpret_cast<int32_t*>(chunk)[i] = value;
+    }
+
+    if (old == 0)
+        chunkUsed[c]++;
+    else if (value == 0 && --chunkUsed[c] == 0)
+        releaseChunk(c);
+}
+
+void TilemapLayer::releaseChunk(int c)
+{
+    if (!chunkStorage[c])
+        return;
+    chunkStorage[c].reset();
+    chunkTiles[c] = reinterpret_cast<const uint8_t*>(EmptyChunk);
+    chunkUsed[c] = 0;
+    allocatedChunks--;
+}
+
+void TilemapLayer::chunkModified(Vector2i chunk)
+{
+    Vector2i min = {chunk.x << ChunkShift, chunk.y << ChunkShift};
+    Vector2i max = {std::min(min.x + ChunkSize, width) - 1, std::min(min.y + ChunkSize, height) - 1};
+    revision++;
+    recordChange(min, max);
+
+    if (collisionMaskEnabled)
+    {
+        for (int y = min.y; y <= max.y; y++)
+        for (int x = min.x; x <= max.x; x++)
+            updateCollisionMask(x, y, getTile({x, y}));
+    }
+}
+
+void TilemapLayer::clearChunk(Vector2i chunk)
+{
+    if (chunk.x < 0 || chunk.y < 0 || chunk.x >= chunksX || chunk.y >= chunksY)
+        return;
+    releaseChunk(chunk.x + chunk.y * chunksX);
+    chunkModified(chunk);
+}
+
+uint8_t* TilemapLayer::allocateChunk(int c)
+{
+    chunkStorage[c].reset(new uint8_t[ChunkArea * valueBytes]());
+    chunkTiles[c] = chunkStorage[c].get();
+    allocatedChunks++;
+    return chunkStorage[c].get();
+}
+
 void TilemapLayer::clear()
 {
-    for (auto& v : data)
-        v = 0;
+    releaseChunks();
     minimum = 0;
     maximum = 0;
+    revision++;
+    resetChanges();
+
+    if (collisionMaskEnabled)
+    {
+        std::fill(solidMask.begin(), solidMask.end(), 0);
+        std::fill(callbackMask.begin(), callbackMask.end(), 0);
+    }
 }
 
 
-Vector2i TilemapLayer::getSize()
+Vector2i TilemapLayer::getSize() const
 {
     return  {width, height};
 }
@@ -24,8 +164,20 @@ void TilemapLayer::resize(int width, int height)
     }
     this->width = width;
     this->height = height;
-    
-    data.resize(width * height);
+
+    chunksX = (width + ChunkSize - 1) >> ChunkShift;
+    chunksY = (height + ChunkSize - 1) >> ChunkShift;
+    size_t chunks = size_t(chunksX) * chunksY;
+    chunkTiles.resize(chunks);
+    chunkStorage.resize(chunks);
+    chunkUsed.resize(chunks);
+
+    if (collisionMaskEnabled)
+    {
+        maskStride = (width + 63) / 64;
+        solidMask.resize(maskStride * height);
+        callbackMask.resize(maskStride * height);
+    }
     clear();
 }
 
@@ -55,7 +207,12 @@ void TilemapLayer::set(Vector2i pos, Tileset::Value value)
     if (value > maximum)
         maximum = value;
     
-    data[pos.x + pos.y * width] = value;
+    writeTile(pos.x, pos.y, value);
+    revision++;
+    recordChange(pos, pos);
+
+    if (collisionMaskEnabled)
+        updateCollisionMask(pos.x, pos.y, value);
 }
 
 void TilemapLayer::fill(Vector2i min, Vector2i to, Tileset::Value value)
@@ -75,14 +232,80 @@ void TilemapLayer::fill(Vector2i min, Vector2i to, Tileset::Value value)
     
     
     for (int y = min.y; y < to.y; y++)
+    for (int x = min.x; x < to.x; x++)
     {
-        auto* offset = data.data() + (y * width);
+        //Nothing to clear in the empty chunks
+        if (value == 0 && chunkUsed[(x >> ChunkShift) + (y >> ChunkShift) * chunksX] == 0)
+        {
+            x |= ChunkSize - 1;
+            continue;
+        }
+        writeTile(x, y, value);
+    }
+    revision++;
+    if (min.x < to.x && min.y < to.y)
+        recordChange(min, {to.x - 1, to.y - 1});
+
+    if (collisionMaskEnabled)
+    {
+        for (int y = min.y; y < to.y; y++)
         for (int x = min.x; x < to.x; x++)
+            updateCollisionMask(x, y, value);
+    }
+
+}
+
+void TilemapLayer::recordChange(Vector2i min, Vector2i max)
+{
+    //Small changes next to each other, such as consecutive set calls,
+    //are merged into a single area
+    const int mergeArea = 64;
+    if (!changes.empty())
+    {
+        TilemapChange& last = changes.back();
+        Vector2i umin = {std::min(min.x, last.min.x), std::min(min.y, last.min.y)};
+        Vector2i umax = {std::max(max.x, last.max.x), std::max(max.y, last.max.y)};
+        int area = (umax.x - umin.x + 1) * (umax.y - umin.y + 1);
+        bool contained = umin == last.min && umax == last.max;
+        if (contained || area <= mergeArea)
         {
-            offset[x] = value;
+            last.min = umin;
+            last.max = umax;
+            last.revision = revision;
+            return;
         }
     }
-    
+
+    changes.push_back({min, max, revision});
+
+    const size_t maxChanges = 128;
+    if (changes.size() > maxChanges)
+    {
+        size_t drop = maxChanges / 2;
+        changesFrom = changes[drop - 1].revision;
+        changes.erase(changes.begin(), changes.begin() + drop);
+    }
+}
+
+void TilemapLayer::resetChanges()
+{
+    changes.clear();
+    changesFrom = revision;
+}
+
+bool TilemapLayer::getChangesSince(uint32_t since, std::vector<TilemapChange>& out) const
+{
+    if (since == revision)
+        return true;
+    if (since < changesFrom || since > revision)
+        return false;
+
+    for (auto& c : changes)
+    {
+        if (c.revision > since)
+            out.push_back(c);
+    }
+    return true;
 }
 
 void TilemapLayer::setTileset(Tileset* tileset)
@@ -90,3 +313,92 @@ void TilemapLayer::setTileset(Tileset* tileset)
     this->tileset = ReferenceHolder<Tileset>::create(tileset);
     validate();
 }
+
+void TilemapLayer::updateCollisionMask(int x, int y, Tileset::Value value)
+{
+    size_t word = y * maskStride + (x >> 6);
+    uint64_t bit = uint64_t(1) << (x & 63);
+
+    if (isBlockingValue(value))
+        solidMask[word] |= bit;
+    else
+        solidMask[word] &= ~bit;
+
+    bool callback = isCallbackValue(value) &&
+        std::binary_search(callbackValues.begin(), callbackValues.end(), value);
+
+    if (callback)
+        callbackMask[word] |= bit;
+    else
+        callbackMask[word] &= ~bit;
+}
+
+void TilemapLayer::rebuildCollisionMask()
+{
+    maskStride = (width + 63) / 64;
+    solidMask.assign(maskStride * height, 0);
+    callbackMask.assign(maskStride * height, 0);
+
+    //The zero tiles have no bits set
+    forEachTile([this](Vector2i pos, Tileset::Value v)
+    {
+        updateCollisionMask(pos.x, pos.y, v);
+    });
+}
+
+void TilemapLayer::enableCollisionMask(const std::vector<Tileset::Value>& callbacks)
+{
+    callbackValues = callbacks;
+    std::sort(callbackValues.begin(), callbackValues.end());
+    collisionMaskEnabled = true;
+    rebuildCollisionMask();
+}
+
+void TilemapLayer::disableCollisionMask()
+{
+    collisionMaskEnabled = false;
+    maskStride = 0;
+    solidMask = std::vector<uint64_t>();
+    callbackMask = std::vector<uint64_t>();
+    callbackValues.clear();
+}
+
+bool TilemapLayer::anyCollisionTile(Vector2i min, Vector2i max) const
+{
+    if (min.x < 0 || min.y < 0 || max.x >= width || max.y >= height)
+        return true;
+
+    if (!collisionMaskEnabled)
+    {
+        for (int y = min.y; y <= max.y; y++)
+        for (int x = min.x; x <= max.x; x++)
+            if (isBlockingValue(getTile({x, y})))
+                return true;
+        return false;
+    }
+
+    int firstWord = min.x >> 6;
+    int lastWord = max.x >> 6;
+    uint64_t firstBits = ~uint64_t(0) << (min.x & 63);
+    uint64_t lastBits = ~uint64_t(0) >> (63 - (max.x & 63));
+
+    for (int y = min.y; y <= max.y; y++)
+    {
+        const uint64_t* row = solidMask.data() + y * maskStride;
+        if (firstWord == lastWord)
+        {
+            if (row[firstWord] & firstBits & lastBits)
+                return true;
+            continue;
+        }
+
+        if (row[firstWord] & firstBits)
+            return true;
+        for (int w = firstWord + 1; w < lastWord; w++)
+            if (row[w])
+                return true;
+        if (row[lastWord] & lastBits)
+            return true;
+    }
+    return false;
+}
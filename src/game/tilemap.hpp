@@ -1,6 +1,9 @@
 #pragma once
 #include <vector>
 #include <unordered_map>
+#include <memory>
+#include <algorithm>
+#include <cstdint>
 #include "vector2.hpp"
 #include "hash.hpp"
 #include "mapObject.hpp"
@@ -62,23 +65,121 @@ private:
     friend class DrawableTilemap;
 };
 
-//! Single tilemap
+//! A modified area of a TilemapLayer, see TilemapLayer::getChangesSince
+struct TilemapChange
+{
+    //! Inclusive bounds of the modified tiles
+    Vector2i min;
+    Vector2i max;
+
+    //! Revision of the layer after the change
+    uint32_t revision;
+};
+
+/*! \brief Single tilemap
+ * 
+ * The tiles are stored in chunks of ChunkSize x ChunkSize tiles. The
+ * chunks are allocated when a non-zero tile is written to them and freed
+ * when all of their tiles are zero again, and the unallocated ones read
+ * from a shared chunk of zeros. The values are stored with 8 bits per
+ * tile until a value that doesn't fit is written, and are then widened
+ * to 16 bits, or to 32 bits for values outside of 0 - 65535.
+ */
 class TilemapLayer
 {
     MixinReferenceCounted
-    
-    std::vector<Tileset::Value> data;
+public:
+    static const int ChunkShift = 5;
+    static const int ChunkSize = 1 << ChunkShift;
+    static const int ChunkArea = ChunkSize * ChunkSize;
+
+private:
+    //Tiles of each chunk, pointing to the shared empty chunk until allocated
+    std::vector<const uint8_t*> chunkTiles;
+    std::vector<std::unique_ptr<uint8_t[]>> chunkStorage;
+    //Amount of non-zero tiles in each chunk
+    std::vector<uint16_t> chunkUsed;
+    unsigned int allocatedChunks = 0;
+    int chunksX = 0, chunksY = 0;
+    unsigned int valueBytes = 1;
+
     int width = 0, height = 0;
     Tileset::Value minimum = 0, maximum = 0;
     bool tilesetValidated = false;
     ReferenceHolder<Tileset> tileset;
+
+    Tileset::Value readTile(const uint8_t* chunk, int index) const
+    {
+        switch (valueBytes)
+        {
+        case 1:
+            return chunk[index];
+        case 2:
+            return reinterpret_cast<const uint16_t*>(chunk)[index];
+        default:
+            return reinterpret_cast<const int32_t*>(chunk)[index];
+        }
+    }
+
+    template <typename D, typename T>
+    static void CopyRow(D* chunk, int index, const T* row, int count)
+    {
+        for (int i = 0; i < count; i++)
+            chunk[index + i] = D(row[i]);
+    }
+
+    //Write a tile within the bounds, allocating or freeing the chunk
+    void writeTile(int x, int y, Tileset::Value value);
+    //Allocate the zeroed storage of an empty chunk
+    uint8_t* allocateChunk(int chunk);
+    //Free the storage of a chunk, reading zeros afterwards
+    void releaseChunk(int chunk);
+    //Record a whole chunk as modified
+    void chunkModified(Vector2i chunk);
+    void releaseChunks();
+    void widenFor(Tileset::Value value);
+    static unsigned int BytesFor(Tileset::Value value);
+
+    //Incremented on every change to the tile data
+    uint32_t revision = 0;
+
+    //Areas modified by set and fill. The log covers every revision after
+    //changesFrom, older changes are dropped when the log grows too long
+    std::vector<TilemapChange> changes;
+    uint32_t changesFrom = 0;
+    void recordChange(Vector2i min, Vector2i max);
+    void resetChanges();
+
+    //Packed collision bits, maintained only when enabled with
+    //enableCollisionMask. Each row is padded to whole words.
+    bool collisionMaskEnabled = false;
+    int maskStride = 0;
+    std::vector<uint64_t> solidMask;
+    std::vector<uint64_t> callbackMask;
+    std::vector<Tileset::Value> callbackValues;
+
+    void updateCollisionMask(int x, int y, Tileset::Value);
+    void rebuildCollisionMask();
     
     friend class DrawableTilemap;
 public:
+
+    //! Returns true if tiles of value block movement in collision detection
+    static bool isBlockingValue(Tileset::Value v)
+    {
+        return v == 1 || v >= 80;
+    }
+
+    //! Returns true if tiles of value may have a tile collision callback
+    static bool isCallbackValue(Tileset::Value v)
+    {
+        return v >= 80;
+    }
+
     //! Clears the map to 0
     void clear();
     //! Get the size of the map
-    Vector2i getSize();
+    Vector2i getSize() const;
     //! Resize the map
     void resize(int width, int height);
     //! Validate the map for tileset transformation
@@ -92,32 +193,258 @@ public:
     /*! \brief Load map data in bulk
      * 
      * ptr must be a pointer to an array with at least height times width
-     * elements.
+     * elements. The chunks without any non-zero values are skipped, the
+     * rows of the others are copied in one go.
      */
     template <typename T>
-    void loadBulk(T* ptr)
+    void loadBulk(const T* ptr)
     {
         minimum = 0;
         maximum = 0;
-        for (auto& v : data)
+        size_t count = size_t(width) * height;
+        for (size_t i = 0; i < count; i++)
+        {
+            if (ptr[i] < minimum)
+                minimum = ptr[i];
+            if (ptr[i] > maximum)
+                maximum = ptr[i];
+        }
+
+        releaseChunks();
+        widenFor(minimum);
+        widenFor(maximum);
+        for (int cy = 0; cy < chunksY; cy++)
+        for (int cx = 0; cx < chunksX; cx++)
+        {
+            int x0 = cx << ChunkShift;
+            int y0 = cy << ChunkShift;
+            int w = std::min(width - x0, int(ChunkSize));
+            int h = std::min(height - y0, int(ChunkSize));
+
+            unsigned int used = 0;
+            for (int y = 0; y < h; y++)
+            {
+                const T* row = ptr + x0 + size_t(y0 + y) * width;
+                for (int x = 0; x < w; x++)
+                    used += row[x] != 0;
+            }
+            if (used == 0)
+                continue;
+
+            int c = cx + cy * chunksX;
+            uint8_t* chunk = allocateChunk(c);
+            chunkUsed[c] = used;
+            for (int y = 0; y < h; y++)
+            {
+                const T* row = ptr + x0 + size_t(y0 + y) * width;
+                switch (valueBytes)
+                {
+                case 1:
+                    CopyRow(chunk, y << ChunkShift, row, w);
+                    break;
+                case 2:
+                    CopyRow(reinterpret_cast<uint16_t*>(chunk), y << ChunkShift, row, w);
+                    break;
+                default:
+                    CopyRow(reinterpret_cast<int32_t*>(chunk), y << ChunkShift, row, w);
+                }
+            }
+        }
+        revision++;
+        resetChanges();
+        if (collisionMaskEnabled)
+            rebuildCollisionMask();
+    }
+
+    /*! \brief Replace the tiles of a single chunk
+     * 
+     * \p tiles must hold ChunkArea values, row by row. The values falling
+     * outside of the map are ignored. The chunk is recorded in the change
+     * log as modified.
+     */
+    template <typename T>
+    void loadChunk(Vector2i chunk, const T* tiles)
+    {
+        if (chunk.x < 0 || chunk.y < 0 || chunk.x >= chunksX || chunk.y >= chunksY)
+            return;
+
+        int c = chunk.x + chunk.y * chunksX;
+        int w = std::min(width - (chunk.x << ChunkShift), int(ChunkSize));
+        int h = std::min(height - (chunk.y << ChunkShift), int(ChunkSize));
+
+        unsigned int used = 0;
+        Tileset::Value lo = 0, hi = 0;
+        for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            Tileset::Value v = tiles[x + (y << ChunkShift)];
+            used += v != 0;
+            lo = std::min(lo, v);
+            hi = std::max(hi, v);
+        }
+        minimum = std::min(minimum, lo);
+        maximum = std::max(maximum, hi);
+        widenFor(lo);
+        widenFor(hi);
+
+        releaseChunk(c);
+        if (used != 0)
         {
-            v = *ptr;
-            if (*ptr < minimum)
-                minimum = *ptr;
-            if (*ptr > maximum)
-                maximum = *ptr;
-            ++ptr;
+            uint8_t* storage = allocateChunk(c);
+            chunkUsed[c] = used;
+            for (int y = 0; y < h; y++)
+            {
+                const T* row = tiles + (y << ChunkShift);
+                switch (valueBytes)
+                {
+                case 1:
+                    CopyRow(storage, y << ChunkShift, row, w);
+                    break;
+                case 2:
+                    CopyRow(reinterpret_cast<uint16_t*>(storage), y << ChunkShift, row, w);
+                    break;
+                default:
+                    CopyRow(reinterpret_cast<int32_t*>(storage), y << ChunkShift, row, w);
+                }
+            }
         }
+        chunkModified(chunk);
     }
+
+    //! Clear the tiles of a single chunk to 0, see loadChunk
+    void clearChunk(Vector2i chunk);
+
+    //! Get the amount of chunks in each direction
+    Vector2i getChunkCount() const
+    {
+        return {chunksX, chunksY};
+    }
+
+    /*! \brief Set the amount of bits stored per tile
+     * 
+     * Either 8, 16 or 32. The layer is widened further if the values
+     * already on it don't fit.
+     */
+    void setValueBits(unsigned int bits);
+
+    //! Get the amount of bits stored per tile
+    unsigned int getValueBits() const
+    {
+        return valueBytes * 8;
+    }
+
+    //! Get the amount of chunks holding non-zero tiles
+    unsigned int getAllocatedChunks() const
+    {
+        return allocatedChunks;
+    }
+
+    /*! \brief Call \p func for every non-zero tile
+     * 
+     * The function is called with the position and the value of the tile,
+     * row by row within each chunk. The empty chunks are skipped.
+     */
+    template <typename Func>
+    void forEachTile(Func func) const
+    {
+        for (int cy = 0; cy < chunksY; cy++)
+        for (int cx = 0; cx < chunksX; cx++)
+        {
+            int c = cx + cy * chunksX;
+            if (chunkUsed[c] == 0)
+                continue;
+
+            const uint8_t* chunk = chunkTiles[c];
+            int x0 = cx << ChunkShift;
+            int y0 = cy << ChunkShift;
+            int x1 = std::min(x0 + ChunkSize, width);
+            int y1 = std::min(y0 + ChunkSize, height);
+            for (int y = y0; y < y1; y++)
+            for (int x = x0; x < x1; x++)
+            {
+                Tileset::Value v = readTile(chunk, (x - x0) + ((y - y0) << ChunkShift));
+                if (v != 0)
+                    func(Vector2i(x, y), v);
+            }
+        }
+    }
+
+    /*! \brief Get the revision of the tile data
+     * 
+     * The revision changes whenever the tiles are modified, so that data
+     * derived from the map can be checked for staleness.
+     */
+    uint32_t getRevision() const
+    {
+        return revision;
+    }
+
+    /*! \brief Get the areas modified after revision \p since
+     * 
+     * Appends the changes to \p out. Returns false if the changes are
+     * no longer known, either because the whole map was replaced or
+     * because the log has been trimmed. Data derived from the map must be
+     * rebuilt completely in that case.
+     */
+    bool getChangesSince(uint32_t since, std::vector<TilemapChange>& out) const;
+
+    /*! \brief Enable the packed collision mask
+     * 
+     * After enabling, a bit mask of blocking tiles and of tiles with
+     * collision callbacks is kept up to date with the tile data.
+     * Only the tiles with values in \p callbacks are marked as callback
+     * tiles. Calling this again updates the callback values.
+     */
+    void enableCollisionMask(const std::vector<Tileset::Value>& callbacks);
+
+    //! Disable the packed collision mask and free it
+    void disableCollisionMask();
+
+    //! Returns true if the collision mask is enabled
+    bool hasCollisionMask() const
+    {
+        return collisionMaskEnabled;
+    }
+
+    //! Returns true if the tile is blocking. Tiles out of bounds are blocking
+    bool isCollisionTile(Vector2i pos) const
+    {
+        if (pos.x < 0 || pos.x >= width || pos.y < 0 || pos.y >= height)
+            return true;
+        if (!collisionMaskEnabled)
+            return isBlockingValue(getTile(pos));
+        return (solidMask[pos.y * maskStride + (pos.x >> 6)] >> (pos.x & 63)) & 1;
+    }
+
+    /*! \brief Returns true if the tile has a collision callback
+     * 
+     * Without the collision mask, all tiles of isCallbackValue are
+     * reported.
+     */
+    bool isCollisionCallbackTile(Vector2i pos) const
+    {
+        if (pos.x < 0 || pos.x >= width || pos.y < 0 || pos.y >= height)
+            return false;
+        if (!collisionMaskEnabled)
+            return isCallbackValue(getTile(pos));
+        return (callbackMask[pos.y * maskStride + (pos.x >> 6)] >> (pos.x & 63)) & 1;
+    }
+
+    /*! \brief Returns true if any tile in the inclusive area is blocking
+     * 
+     * If the area is not completely within the map, returns true.
+     */
+    bool anyCollisionTile(Vector2i min, Vector2i max) const;
     
-    //! Get tile at position
-    int getTile(Vector2i pos)
+    //! Get tile at position, 0 out of bounds
+    int getTile(Vector2i pos) const
     {
         if (pos.x < 0 || pos.x >= width)
             return 0;
         if (pos.y < 0 || pos.y >= height)
             return 0;
-        return data[pos.x + pos.y * width];
+        const uint8_t* chunk = chunkTiles[(pos.x >> ChunkShift) + (pos.y >> ChunkShift) * chunksX];
+        return readTile(chunk, (pos.x & (ChunkSize - 1)) + ((pos.y & (ChunkSize - 1)) << ChunkShift));
     }
 };
 
@@ -0,0 +1,249 @@
+#include "tilemapFormat.hpp"
+#include "tilemap.hpp"
+#include "blockCompression.hpp"
+
+#include <cstring>
+
+
+static bool IsLittleEndian()
+{
+    const uint16_t probe = 1;
+    return *reinterpret_cast<const uint8_t*>(&probe) == 1;
+}
+
+//Bounds checked little-endian reader
+class MapReader
+{
+    const uint8_t* data;
+    size_t size;
+    size_t position = 0;
+public:
+    bool failed = false;
+
+    MapReader(const uint8_t* d, size_t s) : data(d), size(s)
+    {
+    }
+
+    void seek(uint64_t offset)
+    {
+        if (offset > size)
+            failed = true;
+        else
+            position = offset;
+    }
+
+    const uint8_t* take(uint64_t bytes)
+    {
+        if (failed || bytes > size - position)
+        {
+            failed = true;
+            return nullptr;
+        }
+        const uint8_t* p = data + position;
+        position += bytes;
+        return p;
+    }
+
+    uint32_t u32()
+    {
+        const uint8_t* p = take(4);
+        if (!p)
+            return 0;
+        return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+    }
+
+    uint64_t u64()
+    {
+        uint64_t low = u32();
+        return low | uint64_t(u32()) << 32;
+    }
+
+    std::string string()
+    {
+        uint32_t len = u32();
+        const uint8_t* p = take((uint64_t(len) + 3) & ~uint64_t(3));
+        if (!p)
+            return "";
+        return std::string(reinterpret_cast<const char*>(p), len);
+    }
+};
+
+uint32_t TSMap::GetVersion(const char* data, size_t size)
+{
+    MapReader reader(reinterpret_cast<const uint8_t*>(data), size);
+    uint32_t magic = reader.u32();
+    uint32_t version = reader.u32();
+    if (reader.failed || magic != Magic)
+        return 0;
+    return version;
+}
+
+bool TSMap::Parse(const char* data, size_t size, Contents& out)
+{
+    out.file = reinterpret_cast<const uint8_t*>(data);
+    out.fileSize = size;
+    MapReader reader(out.file, size);
+
+    Header& header = out.header;
+    header.magic = reader.u32();
+    header.version = reader.u32();
+    header.width = reader.u32();
+    header.height = reader.u32();
+    header.tileDefCount = reader.u32();
+    header.layerCount = reader.u32();
+    header.objectCount = reader.u32();
+    header.chunkSize = reader.u32();
+    header.tileDefOffset = reader.u64();
+    header.layerTableOffset = reader.u64();
+    header.objectOffset = reader.u64();
+    header.fileSize = reader.u64();
+
+    if (reader.failed || header.magic != Magic || header.fileSize > size)
+        return false;
+    if (header.version != Version2 && header.version != Version3)
+        return false;
+    if (header.version == Version3 && header.chunkSize != uint32_t(TilemapLayer::ChunkSize))
+        return false;
+    if (header.width > 0xFFFF || header.height > 0xFFFF)
+        return false;
+
+    size_t tiles = size_t(header.width) * header.height;
+    out.chunksX = (header.width + TilemapLayer::ChunkSize - 1) >> TilemapLayer::ChunkShift;
+    out.chunksY = (header.height + TilemapLayer::ChunkSize - 1) >> TilemapLayer::ChunkShift;
+    size_t chunks = size_t(out.chunksX) * out.chunksY;
+
+    reader.seek(header.tileDefOffset);
+    for (uint32_t i = 0; i < header.tileDefCount && !reader.failed; i++)
+        out.tileDefs.push_back(reader.string());
+
+    for (uint32_t i = 0; i < header.layerCount && !reader.failed; i++)
+    {
+        reader.seek(header.layerTableOffset + uint64_t(i) * sizeof(Layer));
+        const uint8_t* name = reader.take(sizeof(Layer::name));
+        LayerInfo layer;
+        layer.valueBytes = reader.u32();
+        layer.flags = reader.u32();
+        uint64_t offset = reader.u64();
+        if (reader.failed)
+            break;
+
+        if (layer.valueBytes != 1 && layer.valueBytes != 2 && layer.valueBytes != 4)
+            return false;
+
+        const char* n = reinterpret_cast<const char*>(name);
+        layer.name = std::string(n, strnlen(n, sizeof(Layer::name)));
+
+        reader.seek(offset);
+        if (header.version == Version2)
+        {
+            //Read in place, so the values must be aligned
+            if (offset % layer.valueBytes != 0)
+                return false;
+            layer.data = reader.take(tiles * layer.valueBytes);
+        }
+        else
+            layer.data = reader.take(chunks * sizeof(Chunk));
+        out.layers.push_back(layer);
+    }
+
+    reader.seek(header.objectOffset);
+    for (uint32_t i = 0; i < header.objectCount && !reader.failed; i++)
+    {
+        ObjectInfo obj;
+        obj.x = int32_t(reader.u32());
+        obj.y = int32_t(reader.u32());
+        obj.type = reader.string();
+        obj.name = reader.string();
+        uint32_t count = reader.u32();
+        for (uint32_t j = 0; j < count && !reader.failed; j++)
+        {
+            std::string key = reader.string();
+            obj.properties.push_back({key, reader.string()});
+        }
+        out.objects.push_back(std::move(obj));
+    }
+
+    return !reader.failed;
+}
+
+bool TSMap::ReadChunk(const Contents& contents, const LayerInfo& layer, int chunk, uint8_t* out)
+{
+    size_t bytes = size_t(TilemapLayer::ChunkArea) * layer.valueBytes;
+
+    MapReader index(layer.data + size_t(chunk) * sizeof(Chunk), sizeof(Chunk));
+    uint64_t offset = index.u64();
+    uint32_t compressedSize = index.u32();
+    if (offset == 0)
+    {
+        std::memset(out, 0, bytes);
+        return true;
+    }
+
+    MapReader reader(contents.file, contents.fileSize);
+    reader.seek(offset);
+    const uint8_t* p = reader.take(compressedSize);
+    if (!p)
+        return false;
+    return BlockCompression::Decompress(p, compressedSize, out, bytes);
+}
+
+//Convert little-endian values to the host byte order
+static std::vector<int32_t> SwapValues(const uint8_t* p, size_t count, uint32_t valueBytes)
+{
+    std::vector<int32_t> values(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t* v = p + i * valueBytes;
+        if (valueBytes == 2)
+            values[i] = uint16_t(v[0] | v[1] << 8);
+        else
+            values[i] = int32_t(uint32_t(v[0]) | uint32_t(v[1]) << 8 | uint32_t(v[2]) << 16 | uint32_t(v[3]) << 24);
+    }
+    return values;
+}
+
+void TSMap::LoadLayer(TilemapLayer& layer, const uint8_t* p, uint32_t valueBytes)
+{
+    layer.setValueBits(valueBytes * 8);
+
+    //Read in place when the byte order matches
+    if (IsLittleEndian() || valueBytes == 1)
+    {
+        switch (valueBytes)
+        {
+        case 1:
+            layer.loadBulk(p);
+            break;
+        case 2:
+            layer.loadBulk(reinterpret_cast<const uint16_t*>(p));
+            break;
+        default:
+            layer.loadBulk(reinterpret_cast<const int32_t*>(p));
+        }
+        return;
+    }
+
+    Vector2i size = layer.getSize();
+    layer.loadBulk(SwapValues(p, size_t(size.x) * size.y, valueBytes).data());
+}
+
+void TSMap::LoadChunk(TilemapLayer& layer, Vector2i chunk, const uint8_t* p, uint32_t valueBytes)
+{
+    if (IsLittleEndian() || valueBytes == 1)
+    {
+        switch (valueBytes)
+        {
+        case 1:
+            layer.loadChunk(chunk, p);
+            break;
+        case 2:
+            layer.loadChunk(chunk, reinterpret_cast<const uint16_t*>(p));
+            break;
+        default:
+            layer.loadChunk(chunk, reinterpret_cast<const int32_t*>(p));
+        }
+        return;
+    }
+
+    layer.loadChunk(chunk, SwapValues(p, TilemapLayer::ChunkArea, valueBytes).data());
+}
@@ -0,0 +1,145 @@
+#pragma once
+#include "vector2.hpp"
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+class TilemapLayer;
+
+/*! \file tilemapFormat.hpp
+    \brief Layout of the version 2 .tsmap files
+
+    All values are little-endian. The file starts with TSMap::Header, and
+    all offsets are from the beginning of the file. Every section starts
+    at a multiple of TSMap::Alignment bytes, so that the layers of a
+    memory mapped file can be read in place:
+
+    - Tile definitions: tileDefCount strings, the definition n + 1 first
+    - Layer table: layerCount TSMap::Layer entries
+    - Layer data: width * height values of valueBytes bytes each, row by
+      row. 1 and 2 byte values are unsigned, 4 byte values signed.
+    - Objects: objectCount objects, each being x and y as int32, the type
+      and the name strings, the amount of properties as uint32 and then
+      the name and the value strings of every property
+
+    A string is its length as uint32 followed by the characters, padded
+    with zeros to a multiple of 4 bytes.
+
+    Version 3 files are laid out the same way, except that the offset of
+    each layer points to an index of TSMap::Chunk entries, one for every
+    chunk of chunkSize x chunkSize tiles row by row. Each chunk is
+    compressed separately with BlockCompression, and decompresses to
+    chunkSize * chunkSize values, including the ones past the edges of the
+    map, which are zero. Empty chunks are not stored at all, so that the
+    chunks can be loaded on demand, see TilemapStreamer.
+
+    Version 1 files start with the same magic number, followed by
+    Version1. They are read with GMS::LoadMap.
+*/
+namespace TSMap
+{
+    const uint32_t Magic = 13456556;
+    const uint32_t Version1 = 102;
+    const uint32_t Version2 = 200;
+    const uint32_t Version3 = 300;
+    const uint32_t Alignment = 64;
+
+    //! The layer uses the tile definitions of the map
+    const uint32_t LayerUsesTileset = 1;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t tileDefCount;
+        uint32_t layerCount;
+        uint32_t objectCount;
+        //! Width and height of the chunks in version 3, 0 otherwise
+        uint32_t chunkSize;
+        uint64_t tileDefOffset;
+        uint64_t layerTableOffset;
+        uint64_t objectOffset;
+        uint64_t fileSize;
+    };
+
+    struct Layer
+    {
+        //! Name of the layer, padded with zeros
+        char name[24];
+        uint32_t valueBytes;
+        uint32_t flags;
+        uint64_t offset;
+        uint64_t reserved;
+    };
+
+    struct Chunk
+    {
+        //! Offset of the compressed data, 0 for empty chunks
+        uint64_t offset;
+        uint32_t compressedSize;
+        uint32_t reserved;
+    };
+
+    static_assert(sizeof(Chunk) == 16, "TSMap::Chunk must match the file layout");
+    static_assert(sizeof(Header) == 64, "TSMap::Header must match the file layout");
+    static_assert(sizeof(Layer) == 48, "TSMap::Layer must match the file layout");
+
+    //! A layer of a parsed file
+    struct LayerInfo
+    {
+        std::string name;
+        uint32_t valueBytes;
+        uint32_t flags;
+        //! The tiles in version 2, the chunk index in version 3
+        const uint8_t* data;
+    };
+
+    //! An object of a parsed file
+    struct ObjectInfo
+    {
+        int32_t x, y;
+        std::string type;
+        std::string name;
+        std::vector<std::pair<std::string, std::string>> properties;
+    };
+
+    //! Contents of a version 2 or 3 file, pointing into the file data
+    struct Contents
+    {
+        Header header;
+        std::vector<std::string> tileDefs;
+        std::vector<LayerInfo> layers;
+        std::vector<ObjectInfo> objects;
+        const uint8_t* file = nullptr;
+        size_t fileSize = 0;
+        int chunksX = 0;
+        int chunksY = 0;
+    };
+
+    //! Get the version of the file, 0 if it isn't a .tsmap file
+    uint32_t GetVersion(const char* data, size_t size);
+
+    /*! \brief Parse a version 2 or 3 file
+
+        Checks the offsets of all the sections against the size. Version 3
+        files must use the chunk size of TilemapLayer.
+    */
+    bool Parse(const char* data, size_t size, Contents& out);
+
+    /*! \brief Decompress a chunk of a version 3 layer
+
+        \p out must have room for the values of a whole chunk. Empty
+        chunks are filled with zeros. Returns false if the chunk data is
+        malformed.
+    */
+    bool ReadChunk(const Contents& contents, const LayerInfo& layer, int chunk, uint8_t* out);
+
+    //! Load the little-endian values of a whole layer, see TilemapLayer::loadBulk
+    void LoadLayer(TilemapLayer& layer, const uint8_t* values, uint32_t valueBytes);
+
+    //! Load the little-endian values of a chunk, see TilemapLayer::loadChunk
+    void LoadChunk(TilemapLayer& layer, Vector2i chunk, const uint8_t* values, uint32_t valueBytes);
+}
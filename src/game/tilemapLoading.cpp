@@ -1,38 +1,162 @@
-
 #define GMS_USE_NAMESPACE
 #define GMS_CREATE_IMPLEMENTATION
 #include "gameMapSaving.hpp"
 
 #include "fileOperations.hpp"
-#include "fileStreambuf.hpp"
 #include "game/tilemap.hpp"
 #include "game/tilemapLoading.hpp"
+#include "game/tilemapFormat.hpp"
+#include "blockCompression.hpp"
+
+#include <cstring>
+#include <streambuf>
+
+
+//std::streambuf reading from memory
+class MemoryStreambuf : public std::streambuf
+{
+public:
+    MemoryStreambuf(const char* data, size_t size)
+    {
+        char* p = const_cast<char*>(data);
+        setg(p, p, p + size);
+    }
+};
+
+//Little-endian writer for the version 2 and 3 files
+class MapWriter
+{
+public:
+    std::vector<char> data;
+
+    void u32(uint32_t v)
+    {
+        for (int i = 0; i < 4; i++)
+            data.push_back(char(v >> (i * 8)));
+    }
 
+    void u64(uint64_t v)
+    {
+        u32(uint32_t(v));
+        u32(uint32_t(v >> 32));
+    }
 
+    void string(const std::string& s)
+    {
+        u32(s.size());
+        data.insert(data.end(), s.begin(), s.end());
+        data.resize((data.size() + 3) & ~size_t(3), 0);
+    }
+
+    void align()
+    {
+        data.resize((data.size() + TSMap::Alignment - 1) & ~size_t(TSMap::Alignment - 1), 0);
+    }
+
+    void patch64(size_t at, uint64_t v)
+    {
+        for (int i = 0; i < 8; i++)
+            data[at + i] = char(v >> (i * 8));
+    }
+};
+
+//Build a Tilemap from a version 2 or 3 file
+static Tilemap* LoadContents(const TSMap::Contents& contents)
+{
+    auto set = ReferenceHolder<Tileset>::construct();
+    for (auto& def : contents.tileDefs)
+        set->addDef(Hash(def));
+
+    const TSMap::Header& header = contents.header;
+    std::vector<uint8_t> chunk;
+
+    auto tm = ReferenceHolder<Tilemap>::construct();
+    for (auto& info : contents.layers)
+    {
+        auto layer = ReferenceHolder<TilemapLayer>::construct();
+        if (info.flags & TSMap::LayerUsesTileset)
+            layer->setTileset(set.get());
+        layer->resize(header.width, header.height);
+
+        if (header.version == TSMap::Version2)
+            TSMap::LoadLayer(*layer, info.data, info.valueBytes);
+        else
+        {
+            layer->setValueBits(info.valueBytes * 8);
+            chunk.resize(TilemapLayer::ChunkArea * info.valueBytes);
+            for (int i = 0; i < contents.chunksX * contents.chunksY; i++)
+            {
+                if (!TSMap::ReadChunk(contents, info, i, chunk.data()))
+                    return nullptr;
+                TSMap::LoadChunk(*layer, {i % contents.chunksX, i / contents.chunksX}, chunk.data(), info.valueBytes);
+            }
+        }
+
+        tm->addLayer(Hash(info.name), layer.get());
+    }
+
+    for (auto& o : contents.objects)
+    {
+        auto obj = ReferenceHolder<MapObject>::construct();
+        obj->x = o.x;
+        obj->y = o.y;
+        obj->type = o.type;
+        obj->name = o.name;
+        obj->properties = o.properties;
+        tm->addObject(obj.get());
+    }
+
+    tm->addRef();
+    return tm.get();
+}
+
+static bool LoadVersion1(const FileView& view, GMS::MapData& md)
+{
+    md.failed = true;
+    MemoryStreambuf buf(view.getData(), view.getSize());
+    std::istream istream(&buf);
+    GMS::LoadMap(md, istream);
+    if (md.failed)
+        return false;
+
+    //Map format defines: if fg[x] is non 0 and collsion[x] is zero,
+    //collision[x] gets set to 1
+    for (size_t i = 0; i < md.collision.size(); i++)
+    {
+        if (md.collision[i] == 0)
+            if (md.fg[i] != 0)
+                md.collision[i] = 1;
+            
+    }
+    return true;
+}
 
 Tilemap* TilemapLoading::LoadTSMap(const std::string& fn)
 {
+    auto view = MapFileContents(fn);
+    if (!view || view->getSize() < 8)
+        return nullptr;
+
+    uint32_t version = TSMap::GetVersion(view->getData(), view->getSize());
+    if (version == TSMap::Version2 || version == TSMap::Version3)
+    {
+        TSMap::Contents contents;
+        if (!TSMap::Parse(view->getData(), view->getSize(), contents))
+            return nullptr;
+        return LoadContents(contents);
+    }
+
     GMS::MapData md;
-    
     try
     {
-        auto f = GetFileStream(fn);
-        if (!f)
+        if (!LoadVersion1(*view, md))
             return nullptr;
-     
-        auto m = std::make_unique<FileStreambuf>(std::move(f));
-        std::istream istream(m.get());
-        
-        GMS::LoadMap(md, istream);
     }
     catch (...)
     {
         return nullptr;
     }
     
-    if (md.failed)
-        return nullptr;
-    
     auto set = ReferenceHolder<Tileset>::construct();
     for (int i = 1; i < md.tileNames.size(); i++)
         set->addDef(Hash(md.tileNames[i]));
@@ -54,16 +178,6 @@ Tilemap* TilemapLoading::LoadTSMap(const std::string& fn)
     
     auto meta = ReferenceHolder<TilemapLayer>::construct();
     meta->resize(md.width, md.height);
-    
-    //Map format defines: if fg[x] is non 0 and collsion[x] is zero,
-    //collision[x] gets set to 1
-    for (size_t i = 0; i < md.collision.size(); i++)
-    {
-        if (md.collision[i] == 0)
-            if (md.fg[i] != 0)
-                md.collision[i] = 1;
-            
-    }
     meta->loadBulk(md.collision.data());
     
     Tilemap* tm = new Tilemap();
@@ -86,3 +200,193 @@ Tilemap* TilemapLoading::LoadTSMap(const std::string& fn)
     }
     return tm;
 }
+
+//Narrowest value width of TilemapLayer that fits the values
+template <typename T>
+static uint32_t ValueBytesFor(const std::vector<T>& values)
+{
+    uint32_t bytes = 1;
+    for (T v : values)
+    {
+        if (v < 0)
+            return 4;
+        if (v > 0xFF)
+            bytes = 2;
+    }
+    return bytes;
+}
+
+template <typename T>
+static void WriteValues(std::vector<char>& out, const T* values, size_t count, uint32_t valueBytes)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        for (uint32_t b = 0; b < valueBytes; b++)
+            out.push_back(char(uint32_t(int32_t(values[i])) >> (b * 8)));
+    }
+}
+
+//Write the chunk index and the compressed chunks of a layer
+template <typename T>
+static void WriteChunks(MapWriter& w, const std::vector<T>& values, int width, int height, uint32_t valueBytes)
+{
+    const int size = TilemapLayer::ChunkSize;
+    int chunksX = (width + size - 1) / size;
+    int chunksY = (height + size - 1) / size;
+
+    size_t index = w.data.size();
+    w.data.resize(index + size_t(chunksX) * chunksY * sizeof(TSMap::Chunk), 0);
+
+    std::vector<T> tiles(TilemapLayer::ChunkArea);
+    std::vector<char> raw;
+    std::vector<uint8_t> compressed;
+    for (int cy = 0; cy < chunksY; cy++)
+    for (int cx = 0; cx < chunksX; cx++)
+    {
+        bool empty = true;
+        std::fill(tiles.begin(), tiles.end(), 0);
+        for (int y = 0; y < size && cy * size + y < height; y++)
+        for (int x = 0; x < size && cx * size + x < width; x++)
+        {
+            T v = values[(cx * size + x) + size_t(cy * size + y) * width];
+            tiles[x + y * size] = v;
+            empty = empty && v == 0;
+        }
+        if (empty)
+            continue;
+
+        raw.clear();
+        WriteValues(raw, tiles.data(), tiles.size(), valueBytes);
+        BlockCompression::Compress(reinterpret_cast<const uint8_t*>(raw.data()), raw.size(), compressed);
+
+        MapWriter entry;
+        entry.u64(w.data.size());
+        entry.u32(compressed.size());
+        std::copy(entry.data.begin(), entry.data.end(), w.data.begin() + index + (cx + size_t(cy) * chunksX) * sizeof(TSMap::Chunk));
+        w.data.insert(w.data.end(), compressed.begin(), compressed.end());
+    }
+}
+
+bool TilemapLoading::ConvertTSMap(const std::string& from, const std::string& to, bool chunked)
+{
+    auto view = MapFileContents(from);
+    if (!view)
+        return false;
+
+    GMS::MapData md;
+    try
+    {
+        if (!LoadVersion1(*view, md))
+            return false;
+    }
+    catch (...)
+    {
+        return false;
+    }
+
+    size_t tiles = size_t(md.width) * md.height;
+    if (md.width < 0 || md.height < 0 || md.bg.size() != tiles || md.fg.size() != tiles ||
+        md.tfg.size() != tiles || md.collision.size() != tiles)
+        return false;
+
+    //The collision layer is stored as the loaded values, which are never negative
+    std::vector<int32_t> meta(md.collision.begin(), md.collision.end());
+
+    struct LayerSource
+    {
+        const char* name;
+        uint32_t flags;
+        uint32_t valueBytes;
+    };
+    LayerSource layers[] = {
+        {"fg", TSMap::LayerUsesTileset, ValueBytesFor(md.fg)},
+        {"bg", TSMap::LayerUsesTileset, ValueBytesFor(md.bg)},
+        {"tfg", TSMap::LayerUsesTileset, ValueBytesFor(md.tfg)},
+        {"meta", 0, ValueBytesFor(meta)}
+    };
+    const uint32_t layerCount = sizeof(layers) / sizeof(layers[0]);
+
+    MapWriter w;
+    w.u32(TSMap::Magic);
+    w.u32(chunked ? TSMap::Version3 : TSMap::Version2);
+    w.u32(md.width);
+    w.u32(md.height);
+    w.u32(md.tileNames.size() > 0 ? md.tileNames.size() - 1 : 0);
+    w.u32(layerCount);
+    w.u32(md.objects.size());
+    w.u32(chunked ? TilemapLayer::ChunkSize : 0);
+    size_t offsets = w.data.size();
+    w.u64(0);
+    w.u64(0);
+    w.u64(0);
+    w.u64(0);
+
+    w.align();
+    w.patch64(offsets, w.data.size());
+    for (size_t i = 1; i < md.tileNames.size(); i++)
+        w.string(md.tileNames[i]);
+
+    w.align();
+    size_t table = w.data.size();
+    w.patch64(offsets + 8, table);
+    w.data.resize(table + layerCount * sizeof(TSMap::Layer), 0);
+
+    for (uint32_t i = 0; i < layerCount; i++)
+    {
+        w.align();
+        size_t entry = table + i * sizeof(TSMap::Layer);
+        std::strncpy(&w.data[entry], layers[i].name, sizeof(TSMap::Layer::name));
+
+        MapWriter e;
+        e.u32(layers[i].valueBytes);
+        e.u32(layers[i].flags);
+        e.u64(w.data.size());
+        std::copy(e.data.begin(), e.data.end(), w.data.begin() + entry + sizeof(TSMap::Layer::name));
+
+        auto write = [&](auto& values)
+        {
+            if (chunked)
+                WriteChunks(w, values, md.width, md.height, layers[i].valueBytes);
+            else
+                WriteValues(w.data, values.data(), values.size(), layers[i].valueBytes);
+        };
+        switch (i)
+        {
+        case 0:
+            write(md.fg);
+            break;
+        case 1:
+            write(md.bg);
+            break;
+        case 2:
+            write(md.tfg);
+            break;
+        default:
+            write(meta);
+        }
+    }
+
+    w.align();
+    w.patch64(offsets + 16, w.data.size());
+    for (auto& o : md.objects)
+    {
+        w.u32(o.x);
+        w.u32(o.y);
+        w.string(o.type);
+        w.string(o.name);
+        w.u32(o.properties.size());
+        for (auto& p : o.properties)
+        {
+            w.string(p.first);
+            w.string(p.second);
+        }
+    }
+    w.patch64(offsets + 24, w.data.size());
+
+    auto file = GetFileWriter(to);
+    if (!file)
+        return false;
+    bool ok = file->write(w.data.data(), w.data.size()) == w.data.size();
+    file->close();
+    return ok;
+}
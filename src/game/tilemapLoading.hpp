@@ -6,6 +6,20 @@ class TilemapLoading
 {
 public:
     
-    //! Loads a .tsmap file to a new Tilemap
+    /*! \brief Loads a .tsmap file to a new Tilemap
+     * 
+     * All of version 1, 2 and 3 files are supported. The files are memory
+     * mapped, and the layers of version 2 copied straight into the chunks
+     * of the new layers, see tilemapFormat.hpp. All the chunks of
+     * version 3 files are loaded.
+     */
     static Tilemap* LoadTSMap(const std::string& file);
+
+    /*! \brief Converts a version 1 .tsmap file, returns true on success
+     * 
+     * Writes version 2, or the compressed and chunked version 3 if
+     * \p chunked is set. See TilemapStreamer for loading the chunks of
+     * version 3 files on demand.
+     */
+    static bool ConvertTSMap(const std::string& from, const std::string& to, bool chunked = false);
 };
@@ -0,0 +1,251 @@
+#include "tilemapStreamer.hpp"
+#include "fileOperations.hpp"
+#include "workerPool.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+
+
+TilemapStreamer::TilemapStreamer(unsigned int threads)
+{
+    workers = std::unique_ptr<WorkerPool>(new WorkerPool(threads));
+}
+
+TilemapStreamer::~TilemapStreamer()
+{
+    wait();
+    workers.reset();
+}
+
+void TilemapStreamer::wait()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCv.wait(lock, [this]()
+    {
+        return finished.size() >= pendingChunks;
+    });
+}
+
+unsigned int TilemapStreamer::getPendingChunks()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pendingChunks;
+}
+
+Tilemap* TilemapStreamer::getMap()
+{
+    if (!map)
+        return nullptr;
+    map->addRef();
+    return map.get();
+}
+
+bool TilemapStreamer::open(const std::string& file)
+{
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.clear();
+        pendingChunks = 0;
+    }
+
+    map = ReferenceHolder<Tilemap>();
+    layers.clear();
+    state.clear();
+    modified.clear();
+    residentChunks = 0;
+    failedChunks = 0;
+    contents = TSMap::Contents();
+
+    view = MapFileContents(file);
+    if (!view)
+        return false;
+
+    if (TSMap::GetVersion(view->getData(), view->getSize()) != TSMap::Version3 ||
+        !TSMap::Parse(view->getData(), view->getSize(), contents))
+    {
+        view.reset();
+        contents = TSMap::Contents();
+        return false;
+    }
+
+    auto set = ReferenceHolder<Tileset>::construct();
+    for (auto& def : contents.tileDefs)
+        set->addDef(Hash(def));
+
+    map = ReferenceHolder<Tilemap>::construct();
+    layerOffsets.clear();
+    chunkBytes = 0;
+    for (auto& info : contents.layers)
+    {
+        auto layer = ReferenceHolder<TilemapLayer>::construct();
+        if (info.flags & TSMap::LayerUsesTileset)
+            layer->setTileset(set.get());
+        layer->resize(contents.header.width, contents.header.height);
+        layer->setValueBits(info.valueBytes * 8);
+        map->addLayer(Hash(info.name), layer.get());
+
+        layers.push_back(layer);
+        layerOffsets.push_back(chunkBytes);
+        chunkBytes += size_t(TilemapLayer::ChunkArea) * info.valueBytes;
+    }
+
+    for (auto& o : contents.objects)
+    {
+        auto obj = ReferenceHolder<MapObject>::construct();
+        obj->x = o.x;
+        obj->y = o.y;
+        obj->type = o.type;
+        obj->name = o.name;
+        obj->properties = o.properties;
+        map->addObject(obj.get());
+    }
+
+    size_t chunks = size_t(contents.chunksX) * contents.chunksY;
+    state.assign(chunks, Unloaded);
+    modified.assign(chunks, 0);
+    layerRevisions.resize(layers.size());
+    for (size_t i = 0; i < layers.size(); i++)
+        layerRevisions[i] = layers[i]->getRevision();
+    return true;
+}
+
+void TilemapStreamer::load(int chunk)
+{
+    state[chunk] = Pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pendingChunks++;
+    }
+
+    //The contents stay unchanged until all the pending chunks are done
+    auto job = [this, chunk]()
+    {
+        LoadedChunk loaded;
+        loaded.chunk = chunk;
+        loaded.failed = false;
+        loaded.data.resize(chunkBytes);
+        for (size_t i = 0; i < contents.layers.size(); i++)
+        {
+            if (!TSMap::ReadChunk(contents, contents.layers[i], chunk, loaded.data.data() + layerOffsets[i]))
+                loaded.failed = true;
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        finished.push_back(std::move(loaded));
+        doneCv.notify_all();
+    };
+    workers->submit(job);
+}
+
+void TilemapStreamer::markModified()
+{
+    const int shift = TilemapLayer::ChunkShift;
+    for (size_t i = 0; i < layers.size(); i++)
+    {
+        changes.clear();
+        if (!layers[i]->getChangesSince(layerRevisions[i], changes))
+        {
+            for (size_t c = 0; c < state.size(); c++)
+                modified[c] |= state[c] == Resident;
+        }
+
+        for (auto& change : changes)
+        {
+            for (int cy = change.min.y >> shift; cy <= change.max.y >> shift; cy++)
+            for (int cx = change.min.x >> shift; cx <= change.max.x >> shift; cx++)
+            {
+                int c = cx + cy * contents.chunksX;
+                modified[c] |= state[c] == Resident;
+            }
+        }
+        layerRevisions[i] = layers[i]->getRevision();
+    }
+}
+
+unsigned int TilemapStreamer::update(Vector2i center)
+{
+    if (!map)
+        return 0;
+
+    //Edits by the game since the last update pin the chunks
+    markModified();
+
+    std::vector<LoadedChunk> done;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done.swap(finished);
+        pendingChunks -= done.size();
+    }
+
+    unsigned int applied = 0;
+    for (auto& loaded : done)
+    {
+        if (loaded.failed)
+        {
+            //Not requested again
+            state[loaded.chunk] = Failed;
+            failedChunks++;
+            continue;
+        }
+
+        Vector2i chunk = {loaded.chunk % contents.chunksX, loaded.chunk / contents.chunksX};
+        for (size_t i = 0; i < layers.size(); i++)
+            TSMap::LoadChunk(*layers[i], chunk, loaded.data.data() + layerOffsets[i], contents.layers[i].valueBytes);
+        state[loaded.chunk] = Resident;
+        residentChunks++;
+        applied++;
+    }
+
+    Vector2i c = {center.x >> TilemapLayer::ChunkShift, center.y >> TilemapLayer::ChunkShift};
+    int r = std::max(radius, 0);
+
+    //Request the missing chunks nearest first
+    std::vector<std::pair<int, int>> wanted;
+    for (int y = std::max(c.y - r, 0); y <= std::min(c.y + r, contents.chunksY - 1); y++)
+    for (int x = std::max(c.x - r, 0); x <= std::min(c.x + r, contents.chunksX - 1); x++)
+    {
+        int index = x + y * contents.chunksX;
+        if (state[index] == Unloaded)
+            wanted.push_back({std::max(std::abs(x - c.x), std::abs(y - c.y)), index});
+    }
+    std::sort(wanted.begin(), wanted.end());
+    for (auto& w : wanted)
+        load(w.second);
+
+    evict(c);
+
+    //Neither the loaded nor the evicted chunks count as edits
+    for (size_t i = 0; i < layers.size(); i++)
+        layerRevisions[i] = layers[i]->getRevision();
+    return applied;
+}
+
+void TilemapStreamer::evict(Vector2i center)
+{
+    if (residentChunks <= chunkBudget)
+        return;
+
+    std::vector<std::pair<int, int>> candidates;
+    for (int y = 0; y < contents.chunksY; y++)
+    for (int x = 0; x < contents.chunksX; x++)
+    {
+        int index = x + y * contents.chunksX;
+        int distance = std::max(std::abs(x - center.x), std::abs(y - center.y));
+        if (state[index] == Resident && !modified[index] && distance > radius)
+            candidates.push_back({distance, index});
+    }
+    std::sort(candidates.begin(), candidates.end(), std::greater<std::pair<int, int>>());
+
+    for (auto& candidate : candidates)
+    {
+        if (residentChunks <= chunkBudget)
+            break;
+        Vector2i chunk = {candidate.second % contents.chunksX, candidate.second / contents.chunksX};
+        for (auto& layer : layers)
+            layer->clearChunk(chunk);
+        state[candidate.second] = Unloaded;
+        residentChunks--;
+    }
+}
@@ -0,0 +1,136 @@
+#pragma once
+#include "tilemap.hpp"
+#include "tilemapFormat.hpp"
+#include "reference.hpp"
+
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class FileView;
+class WorkerPool;
+
+/*! \brief Loads the chunks of a version 3 .tsmap file on demand
+
+    The map is opened with all of its layers in full size but empty. Each
+    update, the chunks within the radius of the given tile are queued to
+    be decompressed on a worker thread, nearest first, and the finished
+    ones are copied into the layers. A chunk covers the same tiles on
+    every layer.
+
+    When more chunks than the budget are resident, the ones furthest away
+    and outside of the radius are cleared from the layers again. The
+    chunks modified after loading are never evicted, so that no edits are
+    lost. Tiles set on chunks that are not yet loaded are overwritten when
+    the chunk is loaded.
+
+    The file stays memory mapped while the streamer exists, so only the
+    pages of the loaded chunks are ever read. Apart from the worker
+    thread, the streamer must be used only from the main thread.
+*/
+class TilemapStreamer
+{
+    MixinReferenceCounted
+
+    enum ChunkState : uint8_t
+    {
+        Unloaded,
+        Pending,
+        Resident,
+        Failed
+    };
+
+    struct LoadedChunk
+    {
+        int chunk;
+        bool failed;
+        //The values of every layer one after another
+        std::vector<uint8_t> data;
+    };
+
+    std::unique_ptr<FileView> view;
+    TSMap::Contents contents;
+    std::vector<size_t> layerOffsets;
+    size_t chunkBytes = 0;
+
+    ReferenceHolder<Tilemap> map;
+    std::vector<ReferenceHolder<TilemapLayer>> layers;
+    std::vector<uint32_t> layerRevisions;
+    std::vector<TilemapChange> changes;
+
+    std::vector<uint8_t> state;
+    std::vector<uint8_t> modified;
+    unsigned int residentChunks = 0;
+    unsigned int failedChunks = 0;
+
+    std::unique_ptr<WorkerPool> workers;
+
+    //Guarded by mutex
+    std::mutex mutex;
+    std::condition_variable doneCv;
+    std::vector<LoadedChunk> finished;
+    unsigned int pendingChunks = 0;
+
+    int radius = 2;
+    unsigned int chunkBudget = 256;
+
+    void load(int chunk);
+    void markModified();
+    void evict(Vector2i center);
+
+public:
+
+    //! Set the radius in chunks around the center that is kept loaded
+    void setRadius(int r) {radius = r;}
+
+    //! Get the radius in chunks around the center that is kept loaded
+    int getRadius() const {return radius;}
+
+    //! Set the amount of resident chunks above which the distant ones are evicted
+    void setChunkBudget(unsigned int budget) {chunkBudget = budget;}
+
+    //! Get the amount of resident chunks above which the distant ones are evicted
+    unsigned int getChunkBudget() const {return chunkBudget;}
+
+    /*! \brief Open a version 3 .tsmap file
+
+        Returns false if the file can't be read or isn't a valid version
+        3 file. Waits for the chunks of the previous file first.
+    */
+    bool open(const std::string& file);
+
+    /*! \brief Get the map the chunks are loaded into
+
+        Increases the reference count of the returned map. Returns
+        nullptr if no file is open.
+    */
+    Tilemap* getMap();
+
+    /*! \brief Apply the loaded chunks and request the ones around \p center
+
+        \p center is a tile position. Returns the amount of chunks copied
+        into the layers.
+    */
+    unsigned int update(Vector2i center);
+
+    //! Wait until all the requested chunks have been decompressed
+    void wait();
+
+    //! Amount of chunks copied into the layers
+    unsigned int getResidentChunks() const {return residentChunks;}
+
+    //! Amount of chunks requested but not yet copied into the layers
+    unsigned int getPendingChunks();
+
+    //! Amount of chunks that failed to decompress
+    unsigned int getFailedChunks() const {return failedChunks;}
+
+    //! Constructor, decompresses on \p threads worker threads or immediately if 0
+    TilemapStreamer(unsigned int threads = 1);
+
+    //! Destructor, waits for the pending chunks
+    ~TilemapStreamer();
+};
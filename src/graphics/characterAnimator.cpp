@@ -5,6 +5,7 @@
 #include "graphics.hpp"
 #include "glState.hpp"
 #include "graphicsData.hpp"
+#include "spriteBatch.hpp"
 
 #include "separatedFile.hpp"
 
@@ -183,30 +184,27 @@ void CharacterAnimator::draw(Graphics * g)
     
     size *= scale;
 
-    if (fadeTime > 0.0f)
-    {
-        ShaderBinder shaderBinder(g, g->getAssets()->shaders.getElement(CHash("texturedColor")));
-        TextureBinder textureBinder(g, tex);
-
-        #ifndef COPPERY_HEADLESS
-        glUniform4f(g->getGLState()->currentShader->uniforms.ulocFadeColor, fadeColor.r, fadeColor.g, fadeColor.b, fadeTime/maxFadeTime);
-        #endif
+    Shader* shader = g->getAssets()->shaders.getElement(CHash("texturedInstanced"));
+    if (!shader)
+        return;
 
-        Drawing::drawQuadRotated(g, pos, size, direction, depth);
+    SpriteInstance instance;
+    instance.position = getDrawPosition(g);
+    instance.size = size;
+    instance.rotation = -direction * 3.1415f / 180.f;
+    instance.depth = depth;
+    instance.uvMin = tex->getUVMin();
+    instance.uvMax = tex->getUVMax();
 
+    if (fadeTime > 0.0f)
+    {
+        instance.fade = fadeColor;
+        instance.fadeAmount = fadeTime/maxFadeTime;
     }
     else
-    {
-        ShaderBinder shaderBinder(g, g->getAssets()->shaders.getElement(CHash("texturedShaded")));
-        TextureBinder textureBinder(g,tex);
-        
-        #ifndef COPPERY_HEADLESS
-        glUniform4f(g->getGLState()->currentShader->uniforms.ulocFadeColor, 1.0, 1.0, 1.0, alpha);
-        #endif
-        
-        Drawing::drawQuadRotated(g, pos, size, direction, depth);
+        instance.alpha = alpha;
 
-    }
+    g->getSpriteBatch()->add(shader, tex, instance);
 }
 
 void CharacterAnimator::setDirection(float dir)
@@ -0,0 +1,186 @@
+#include "cookedTexture.hpp"
+#include "hash.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+
+uint64_t CookedTexture::HashContents(const char* data, size_t size)
+{
+    uint64_t h = HashParameters<8>::Base;
+    for (size_t i = 0; i < size; i++)
+    {
+        h ^= uint64_t(uint8_t(data[i]));
+        h *= HashParameters<8>::Prime;
+    }
+    return h;
+}
+
+std::string CookedTexture::GetFileName(uint64_t sourceHash)
+{
+    const char* digits = "0123456789abcdef";
+    std::string name(16, '0');
+    for (int i = 15; i >= 0; i--)
+    {
+        name[i] = digits[sourceHash & 15];
+        sourceHash >>= 4;
+    }
+    return name + ".ctex";
+}
+
+unsigned int CookedTexture::GetLevelCount(Vector2i dim)
+{
+    unsigned int count = 1;
+    while (dim.x > 1 || dim.y > 1)
+    {
+        dim.x = std::max(dim.x / 2, 1);
+        dim.y = std::max(dim.y / 2, 1);
+        count++;
+    }
+    return count;
+}
+
+bool CookedTexture::Parse(const char* data, size_t size, uint64_t sourceHash, std::vector<LevelInfo>& out)
+{
+    out.clear();
+    Header header;
+    if (size < sizeof(Header))
+        return false;
+    memcpy(&header, data, sizeof(Header));
+
+    if (header.magic != Magic || header.version != Version || header.format != FormatRGBA8 ||
+        header.sourceHash != sourceHash || header.fileSize != size ||
+        header.width == 0 || header.height == 0 || header.width > 65536 || header.height > 65536)
+        return false;
+
+    Vector2i dim(header.width, header.height);
+    if (header.levelCount != GetLevelCount(dim) ||
+        header.levelCount > (size - sizeof(Header)) / sizeof(Level))
+        return false;
+
+    for (uint32_t i = 0; i < header.levelCount; i++)
+    {
+        Level level;
+        memcpy(&level, data + sizeof(Header) + i * sizeof(Level), sizeof(Level));
+
+        uint64_t bytes = uint64_t(dim.x) * dim.y * 4;
+        if (level.width != uint32_t(dim.x) || level.height != uint32_t(dim.y) || level.size != bytes ||
+            level.offset > size || bytes > size - level.offset)
+        {
+            out.clear();
+            return false;
+        }
+
+        LevelInfo info;
+        info.dimensions = dim;
+        info.pixels = reinterpret_cast<const unsigned char*>(data + level.offset);
+        out.push_back(info);
+
+        dim.x = std::max(dim.x / 2, 1);
+        dim.y = std::max(dim.y / 2, 1);
+    }
+    return true;
+}
+
+//Average 2 x 2 pixels of \p src into every pixel of \p dst
+static void Downsample(const unsigned char* src, Vector2i srcDim, unsigned char* dst, Vector2i dstDim)
+{
+    for (int y = 0; y < dstDim.y; y++)
+    for (int x = 0; x < dstDim.x; x++)
+    {
+        int x0 = std::min(x * 2, srcDim.x - 1);
+        int x1 = std::min(x * 2 + 1, srcDim.x - 1);
+        int y0 = std::min(y * 2, srcDim.y - 1);
+        int y1 = std::min(y * 2 + 1, srcDim.y - 1);
+        for (int c = 0; c < 4; c++)
+        {
+            int sum = src[(x0 + y0 * srcDim.x) * 4 + c] + src[(x1 + y0 * srcDim.x) * 4 + c] +
+                src[(x0 + y1 * srcDim.x) * 4 + c] + src[(x1 + y1 * srcDim.x) * 4 + c];
+            dst[(x + y * dstDim.x) * 4 + c] = (sum + 2) / 4;
+        }
+    }
+}
+
+bool CookedTexture::Write(const std::string& realPath, const unsigned char* rgba, Vector2i dim, uint64_t sourceHash)
+{
+    if (dim.x <= 0 || dim.y <= 0)
+        return false;
+
+    unsigned int count = GetLevelCount(dim);
+    std::vector<Level> levels(count);
+    std::vector<std::vector<unsigned char>> pixels(count);
+
+    uint64_t position = sizeof(Header) + count * sizeof(Level);
+    Vector2i levelDim = dim;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        pixels[i].resize(size_t(levelDim.x) * levelDim.y * 4);
+        if (i == 0)
+            memcpy(pixels[i].data(), rgba, pixels[i].size());
+        else
+        {
+            Vector2i prev(levels[i - 1].width, levels[i - 1].height);
+            Downsample(pixels[i - 1].data(), prev, pixels[i].data(), levelDim);
+        }
+
+        position = (position + Alignment - 1) & ~uint64_t(Alignment - 1);
+        levels[i].width = levelDim.x;
+        levels[i].height = levelDim.y;
+        levels[i].offset = position;
+        levels[i].size = pixels[i].size();
+        position += pixels[i].size();
+
+        levelDim.x = std::max(levelDim.x / 2, 1);
+        levelDim.y = std::max(levelDim.y / 2, 1);
+    }
+
+    Header header;
+    header.magic = Magic;
+    header.version = Version;
+    header.width = dim.x;
+    header.height = dim.y;
+    header.levelCount = count;
+    header.format = FormatRGBA8;
+    header.sourceHash = sourceHash;
+    header.fileSize = position;
+
+    //Written under another name first, so that a partial file is never read
+    std::string temporary = realPath + ".tmp";
+    std::ofstream out(temporary, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        LogError << "Can't open " << temporary << " for writing" << Message();
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&header), sizeof(Header));
+    out.write(reinterpret_cast<const char*>(levels.data()), count * sizeof(Level));
+    uint64_t written = sizeof(Header) + count * sizeof(Level);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        std::vector<char> padding(levels[i].offset - written, 0);
+        out.write(padding.data(), padding.size());
+        out.write(reinterpret_cast<const char*>(pixels[i].data()), pixels[i].size());
+        written = levels[i].offset + levels[i].size;
+    }
+
+    out.close();
+    if (!out)
+    {
+        LogError << "Failed to write " << temporary << Message();
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    std::remove(realPath.c_str());
+    if (std::rename(temporary.c_str(), realPath.c_str()) != 0)
+    {
+        LogError << "Failed to rename " << temporary << " to " << realPath << Message();
+        std::remove(temporary.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include "vector2.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*! \file cookedTexture.hpp
+    \brief Decoded images cached in the cache directory
+
+    A cooked texture is an image file decoded to RGBA, together with its
+    whole chain of mip levels, so that it can be uploaded without decoding
+    or generating the mipmaps. The cooked texture of an image file is
+    stored in the cache directory, see GetCacheDirectory, named by the hash
+    of the contents of the image file. An edited image simply doesn't find
+    its cooked texture anymore.
+
+    The file starts with CookedTexture::Header, followed by levelCount
+    CookedTexture::Level entries, and the pixels of every level starting
+    at a multiple of CookedTexture::Alignment bytes. Each level is half
+    the size of the previous one, rounded down but at least 1, down to
+    1 x 1. The values are in the native byte order, as the cache is never
+    moved to another machine.
+*/
+namespace CookedTexture
+{
+    const uint32_t Magic = 0x58455443;
+    const uint32_t Version = 1;
+    const uint32_t Alignment = 64;
+
+    //! 8 bits per channel RGBA
+    const uint32_t FormatRGBA8 = 0;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t levelCount;
+        uint32_t format;
+        //! Hash of the image file, see HashContents
+        uint64_t sourceHash;
+        uint64_t fileSize;
+    };
+
+    struct Level
+    {
+        uint32_t width;
+        uint32_t height;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static_assert(sizeof(Header) == 40, "CookedTexture::Header must match the file layout");
+    static_assert(sizeof(Level) == 24, "CookedTexture::Level must match the file layout");
+
+    //! A level of a parsed file
+    struct LevelInfo
+    {
+        Vector2i dimensions;
+        const unsigned char* pixels;
+    };
+
+    //! Get the 64 bit FNV-1a hash of the contents of an image file
+    uint64_t HashContents(const char* data, size_t size);
+
+    //! Get the name of the cooked texture of an image file with the hash \p sourceHash
+    std::string GetFileName(uint64_t sourceHash);
+
+    //! Get the amount of mip levels of an image, including the image itself
+    unsigned int GetLevelCount(Vector2i dimensions);
+
+    /*! \brief Parse a cooked texture of the image file with the hash \p sourceHash
+
+        Checks the header and that all the levels are within \p size.
+        \p out points into \p data.
+    */
+    bool Parse(const char* data, size_t size, uint64_t sourceHash, std::vector<LevelInfo>& out);
+
+    /*! \brief Write the cooked texture of an image to \p realPath
+
+        \p rgba are the decoded pixels of the image with the hash
+        \p sourceHash. The mip levels are generated by averaging 2 x 2
+        pixels. \p realPath is a path on the real file system.
+    */
+    bool Write(const std::string& realPath, const unsigned char* rgba, Vector2i dimensions, uint64_t sourceHash);
+}
@@ -7,6 +7,7 @@
 #include "glState.hpp"
 #include "shader.hpp"
 #include "scene.hpp"
+#include "spriteBatch.hpp"
 #include <cassert>
 
 
@@ -36,36 +37,47 @@ bool SceneDrawableLeaf::traverse()
 }
 
 
+Vector2f DrawableTranslatable::getDrawPosition(Graphics* g)
+{
+    float a = g->getInterpolationAlpha();
+    return prevPos + (pos - prevPos) * a;
+}
+
 void DrawableSprite::setTexture(Texture* t)
 {
     tex =  t;
 }
 
-void DrawableSprite::draw(Graphics* g)
+void DrawableSprite::addToBatch(Graphics* g, SpriteBatch* batch)
 {
     if (tex == nullptr)
         return;
-    Hash shaderHash = CHash("texturedShaded");
+    Hash shaderHash = CHash("texturedInstanced");
     Shader* shader = g->getAssets()->shaders.getElement(shaderHash);
     if (shader)
     {
-        ShaderBinder shaderBinder(g, shader);
-        TextureBinder texturer(g,tex);
-
-        #ifndef COPPERY_HEADLESS
-        glUniform4f(g->getGLState()->currentShader->uniforms.ulocFadeColor,color.r,color.g,color.b,alpha);
-        #endif
-
-        Vector2f rPos = pos;
+        SpriteInstance instance;
+        instance.position = getDrawPosition(g);
         if (!cameraSpace)
-            rPos += g->getTopLeft();
-        if (rotation != 0.0f)
-            Drawing::drawQuadRotated(g,rPos,tex->getDimensions()*scale,rotation,depth);
-        else
-            Drawing::drawQuad(g,rPos,tex->getDimensions()*scale,depth);
+            instance.position += g->getTopLeft();
+        instance.size = tex->getDimensions()*scale;
+        instance.rotation = -rotation * 3.1415f / 180.f;
+        instance.depth = depth;
+
+        //The texture may be an area of an atlas page
+        instance.uvMin = tex->getUVMin();
+        instance.uvMax = tex->getUVMax();
+        instance.color = color;
+        instance.alpha = alpha;
+        batch->add(shader, tex, instance);
     }
 }
 
+void DrawableSprite::draw(Graphics* g)
+{
+    addToBatch(g, g->getSpriteBatch());
+}
+
 void DrawableLine::setPoints(DefVector2 _p1, DefVector2 _p2)
 {
     p1 = _p1;
@@ -86,55 +98,46 @@ void DrawableLine::draw(Graphics* g)
 void DrawableQuad::draw(Graphics* g)
 {
 
-    Hash shaderHash = CHash("colored");
+    Hash shaderHash = CHash("coloredInstanced");
     Shader* shader = g->getAssets()->shaders.getElement(shaderHash);
     if (shader)
     {
-        ShaderBinder shaderBinder(g, shader);
-        Vector2f rPos = pos;
+        SpriteInstance instance;
+        instance.position = getDrawPosition(g);
         if (!cameraSpace)
-            rPos += g->getTopLeft();
-        Drawing::drawQuadColored(g,rPos,size,fillColor,depth);
+            instance.position += g->getTopLeft();
+        instance.size = size;
+        instance.depth = depth;
+        instance.color = fillColor;
+        g->getSpriteBatch()->add(shader, nullptr, instance);
     }
 }
 
 void DrawableStaticQuad::draw(Graphics* g)
 {
-    Hash shaderHash = CHash("staticQuadTexturedColor");
+    Hash shaderHash = CHash("texturedInstanced");
     Shader* shader = g->getAssets()->shaders.getElement(shaderHash);
     if (shader)
     {
-        ShaderBinder shaderBinder(g, shader);
-        Vector2f rPos = pos;
+        SpriteInstance instance;
+        instance.position = getDrawPosition(g);
         if (!cameraSpace)
-            rPos += g->getTopLeft();
-
-        TextureBinder texbinder(g, tex);
-
-        #ifndef COPPERY_HEADLESS
-
-        glUniform4f(shader->getUniform(CHash("FadeColor")),
-            color.r, color.g, color.b, colorAlpha);
-
-        int uid;
-        uid = shader->getUniform(CHash("Position"));
-        glUniform2f(uid, rPos.x , rPos.y);
-
-        uid = shader->getUniform(CHash("Size"));
-        glUniform2f(uid, size.x, size.y);
-
-        uid = shader->getUniform(CHash("Depth"));
-        glUniform1f(uid, depth);
-
-        uid = shader->getUniform(CHash("MinUV"));
-        glUniform2f(uid, uv1.x, uv1.y);
-
-        uid = shader->getUniform(CHash("MaxUV"));
-        glUniform2f(uid, uv2.x, uv2.y);
-
-        glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-
-        #endif
+            instance.position += g->getTopLeft();
+
+        //Not moved by the camera
+        instance.position += g->getGLState()->camera;
+        instance.size = size;
+        instance.depth = depth;
+
+        instance.uvMin = uv1;
+        instance.uvMax = uv2;
+        if (tex)
+        {
+            instance.uvMin = tex->mapUV(uv1);
+            instance.uvMax = tex->mapUV(uv2);
+        }
+        instance.fade = color;
+        instance.fadeAmount = colorAlpha;
+        g->getSpriteBatch()->add(shader, tex, instance);
     }
 }
-
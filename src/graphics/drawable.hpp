@@ -7,6 +7,7 @@
 
 class Graphics;
 class Texture;
+class SpriteBatch;
 
 class SceneDrawableLeaf;
 
@@ -61,6 +62,9 @@ class DrawableTranslatable : public Drawable
 protected:
     //! Position of the drawable
     Vector2f pos = {0,0};
+
+    //! Position at the previous physics step, for interpolation
+    Vector2f prevPos = {0,0};
     
     //! Depth/Z-coordinate of the drawable
     float depth = 0.0f; 
@@ -87,12 +91,28 @@ public:
         return depth;
     }
 
-    //! Setter for position
+    //! Setter for position, disables interpolation until the next step
     void setPosition(DefVector2 p)
     {
         pos = p;
+        prevPos = p;
+    }
+
+    /*! \brief Set the position of the drawable at a physics step
+
+        The drawable is drawn interpolated between the positions of the
+        two latest steps, using Graphics::getInterpolationAlpha. Call this
+        once per full physics step, not for every substep.
+    */
+    void stepPosition(DefVector2 p)
+    {
+        prevPos = pos;
+        pos = p;
     }
 
+    //! Get the interpolated position used for drawing
+    Vector2f getDrawPosition(Graphics* g);
+
     //! Getter for position
     Vector2f getPosition()
     {
@@ -125,6 +145,9 @@ public:
 
     void setTexture(Texture* t);
 
+    //! Add the quad of the sprite to \p batch, draw adds it to Graphics::getSpriteBatch
+    void addToBatch(Graphics* g, SpriteBatch* batch);
+
     virtual void draw(Graphics*);
 
     virtual ~DrawableSprite(){};
@@ -14,6 +14,7 @@
 
 #include <algorithm>
 
+const size_t DrawableTilemap::FloatsPerTile;
 
 DrawableTilemap::DrawableTilemap(Graphics* g)
 {
@@ -60,12 +61,15 @@ void DrawableTilemap::constructFromTilemap(TilemapLayer* tmap, DefVector2 tsize,
 }
 
 
-//vec must point to an array of floats with size of at least 20 * sizeof(float)
+//vec must point to an array of at least FloatsPerTile floats
 void DrawableTilemap::writeTileData(Vector2i til, float* vec)
 {
     int t = tilemap->getTile(til);
     
-    unsigned int id = tileTransformation.data[t];
+    //Values set after the tileset was validated may be out of its range
+    unsigned int id = 0;
+    if (t >= 0 && size_t(t) < tileTransformation.size)
+        id = tileTransformation.data[t];
 
     Vector2f base, end;
     Vector2f ubase = sheet->getUVBase(id);
@@ -114,25 +118,121 @@ void DrawableTilemap::writeTileData(Vector2i til, float* vec)
 }
 
 
-void DrawableTilemap::updateAllTiles()
+unsigned int DrawableTilemap::updateAllTiles()
 {
-    std::vector<float> verts;
-    verts.resize(mapSize.x * mapSize.y * 5 * 4);
+    mapSize = tilemap->getSize();
+    uploadedRevision = tilemap->getRevision();
+
+    size_t tiles = size_t(mapSize.x) * mapSize.y;
+    vertexData.resize(tiles * FloatsPerTile);
 
     size_t offset = 0;
-    size_t tilesize = 5 * 4;
     for (int j = 0; j < mapSize.y; j++)
     for (int i = 0; i < mapSize.x; i++)
     {
-        writeTileData(Vector2i(i,j), verts.data() + offset);
-        offset += tilesize;
+        writeTileData(Vector2i(i,j), vertexData.data() + offset);
+        offset += FloatsPerTile;
     }
     
     #ifndef COPPERY_HEADLESS
     glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*verts.size(), &verts[0], GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(float)*vertexData.size(), vertexData.data(), GL_DYNAMIC_DRAW);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
+    #else
+    headlessBuffer.swap(vertexData);
+    #endif
+
+    //The scratch space is only needed for the partial updates from now on
+    std::vector<float>().swap(vertexData);
+    uploadedSpans = 1;
+    return tiles;
+}
+
+//Generate and upload count consecutive tiles, continuing on the next rows
+//if they reach past the end of the row. The buffer must be bound.
+void DrawableTilemap::uploadSpan(Vector2i first, size_t count)
+{
+    vertexData.resize(count * FloatsPerTile);
+
+    Vector2i til = first;
+    for (size_t i = 0; i < count; i++)
+    {
+        writeTileData(til, vertexData.data() + i * FloatsPerTile);
+        if (++til.x == mapSize.x)
+        {
+            til.x = 0;
+            til.y++;
+        }
+    }
+
+    size_t offset = (size_t(first.y) * mapSize.x + first.x) * FloatsPerTile;
+    #ifndef COPPERY_HEADLESS
+    glBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * offset, sizeof(float) * vertexData.size(), vertexData.data());
+    #else
+    std::copy(vertexData.begin(), vertexData.end(), headlessBuffer.begin() + offset);
     #endif
+    uploadedSpans++;
+}
+
+unsigned int DrawableTilemap::updateTiles()
+{
+    uploadedSpans = 0;
+    if (!vbo || !tilemap)
+        return 0;
+
+    uint32_t revision = tilemap->getRevision();
+    if (revision == uploadedRevision)
+        return 0;
+
+    changes.clear();
+    if (!(tilemap->getSize() == mapSize) || !tilemap->getChangesSince(uploadedRevision, changes))
+        return updateAllTiles();
+    uploadedRevision = revision;
+
+    #ifndef COPPERY_HEADLESS
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    #endif
+
+    unsigned int tiles = 0;
+    for (auto& c : changes)
+    {
+        size_t width = c.max.x - c.min.x + 1;
+        if (c.min.y == c.max.y || width * 2 >= size_t(mapSize.x))
+        {
+            //Wide areas are uploaded in one go along with the tiles
+            //between their rows
+            size_t count = size_t(c.max.y - c.min.y) * mapSize.x + width;
+            uploadSpan(c.min, count);
+            tiles += count;
+        }
+        else
+        {
+            for (int y = c.min.y; y <= c.max.y; y++)
+                uploadSpan({c.min.x, y}, width);
+            tiles += width * (c.max.y - c.min.y + 1);
+        }
+    }
+
+    #ifndef COPPERY_HEADLESS
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    #endif
+    return tiles;
+}
+
+bool DrawableTilemap::readTileVertices(Vector2i tile, float* out)
+{
+    if (!vbo || tile.x < 0 || tile.y < 0 || tile.x >= mapSize.x || tile.y >= mapSize.y)
+        return false;
+
+    size_t offset = (size_t(tile.y) * mapSize.x + tile.x) * FloatsPerTile;
+    #ifndef COPPERY_HEADLESS
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glGetBufferSubData(GL_ARRAY_BUFFER, sizeof(float) * offset, sizeof(float) * FloatsPerTile, out);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    #else
+    std::copy(headlessBuffer.begin() + offset, headlessBuffer.begin() + offset + FloatsPerTile, out);
+    #endif
+    return true;
 }
 
 void DrawableTilemap::freeBuffer()
@@ -141,6 +241,8 @@ void DrawableTilemap::freeBuffer()
     {
         #ifndef COPPERY_HEADLESS
         glDeleteBuffers(1,&vbo);
+        #else
+        std::vector<float>().swap(headlessBuffer);
         #endif
         vbo = 0;
     }
@@ -162,6 +264,8 @@ void DrawableTilemap::draw(Graphics* g)
     if (!vbo || !sheet)
         return;
 
+    updateTiles();
+
     g->getGLState()->disableDefaultAttribs();
 
     Vector2f offset = Vector2f(0,0);
@@ -12,6 +12,10 @@ class TextureSheet;
 
 /*! \brief Drawable for Tilemap
 
+    The vertices of every tile are kept in a single vertex buffer. When
+    the layer is modified, only the areas in its change log are generated
+    again and uploaded with glBufferSubData, the whole buffer is rebuilt
+    only if the log no longer covers the changes or the layer is resized.
 */
 class DrawableTilemap : public Drawable
 {
@@ -31,17 +35,48 @@ class DrawableTilemap : public Drawable
     unsigned int vbo = 0;
     ReferenceHolder<TilemapLayer> tilemap;
 
+    //Revision of the layer the buffer is up to date with
+    uint32_t uploadedRevision = 0;
+    std::vector<TilemapChange> changes;
+    std::vector<float> vertexData;
+    unsigned int uploadedSpans = 0;
+
+    #ifdef COPPERY_HEADLESS
+    //Stands in for the vertex buffer
+    std::vector<float> headlessBuffer;
+    #endif
+
     void writeTileData(Vector2i til, float* data);
-    void updateAllTiles();
+    void uploadSpan(Vector2i first, size_t count);
+    unsigned int updateAllTiles();
     void freeBuffer();
 
 public:
+    //! Amount of floats in the vertices of a single tile
+    static const size_t FloatsPerTile = 4 * 5;
+
     void setUniforms(const UniformMap& uniforms);
     
     void draw(Graphics*);
 
     void constructFromTilemap(TilemapLayer* tmap, DefVector2 tileSize, float depth);
 
+    /*! \brief Upload the tiles modified since the last update
+
+        Called by draw, returns the amount of tiles generated again.
+    */
+    unsigned int updateTiles();
+
+    //! Amount of buffer updates done by the last updateTiles call
+    unsigned int getUploadedSpans() const {return uploadedSpans;}
+
+    /*! \brief Read the vertices of a tile back from the buffer
+
+        \p out must have room for FloatsPerTile floats. Returns false if
+        the tile is out of bounds or there is no buffer.
+    */
+    bool readTileVertices(Vector2i tile, float* out);
+
     /*! \brief Constructor
     */
     DrawableTilemap(Graphics* g);
@@ -8,6 +8,8 @@ void Font::load(GraphicsData* assets)
     texture = assets->textures.getElement(Hash(textureName));
     if (texture)
     {
+        //The dimensions are needed right away
+        assets->textureLoader.loadNow(texture);
         characterDimensions = Vector2f(texture->getDimensions())/16.f;
         fontSize = Vector2f(texture->getDimensions());	
     }
@@ -3,6 +3,7 @@
 #include <cstring>
 
 #include "glUtilities.hpp"
+#include "spriteBatch.hpp"
 #include "font.hpp"
 #include "graphics.hpp"
 #include "graphicsData.hpp"
@@ -56,12 +57,21 @@ TextureBinder::~TextureBinder()
     //glBindTexture(GL_TEXTURE_2D,0);
 }
 
+//Draw the batched sprites before anything else
+static void FlushSprites(Graphics* g)
+{
+    if (g->getSpriteBatch())
+        g->getSpriteBatch()->flush();
+}
+
 ShaderBinder::ShaderBinder(Graphics* g, Hash key)
 {
     Shader* t = g->getAssets()->shaders.getElement(key);
     if (!t)
         return;
 
+    FlushSprites(g);
+
 
     active = true;
     state = g->getGLState();
@@ -81,6 +91,8 @@ ShaderBinder::ShaderBinder(Graphics* g, Shader* key)
     if (!key)
         return;
 
+    FlushSprites(g);
+
     active = true;
     state = g->getGLState();
     oldShader = state->currentShader;
@@ -178,7 +190,7 @@ void Drawing::drawQuadColored(Graphics* g, Vector2f p, Vector2f size, Color colo
     #endif
 }
 
-void Drawing::drawQuad(Graphics* g, Vector2f p, Vector2f size, float depth)
+void Drawing::drawQuad(Graphics* g, Vector2f p, Vector2f size, float depth, Vector2f uvMin, Vector2f uvMax)
 {
     auto shader = g->getGLState()->currentShader;
     assert(shader != nullptr);
@@ -198,6 +210,12 @@ void Drawing::drawQuad(Graphics* g, Vector2f p, Vector2f size, float depth)
 
     uid = shader->getUniform(CHash("Rotation"));
     glUniform1f(uid, 0);
+
+    uid = shader->getUniform(CHash("MinUV"));
+    glUniform2f(uid, uvMin.x, uvMin.y);
+
+    uid = shader->getUniform(CHash("MaxUV"));
+    glUniform2f(uid, uvMax.x, uvMax.y);
     
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
@@ -205,7 +223,7 @@ void Drawing::drawQuad(Graphics* g, Vector2f p, Vector2f size, float depth)
 }
 
 
-void Drawing::drawQuadRotated(Graphics* g, Vector2f pos, Vector2f size, float rotation, float depth)
+void Drawing::drawQuadRotated(Graphics* g, Vector2f pos, Vector2f size, float rotation, float depth, Vector2f uvMin, Vector2f uvMax)
 {
     auto shader = g->getGLState()->currentShader;
     assert(shader != nullptr);
@@ -228,6 +246,12 @@ void Drawing::drawQuadRotated(Graphics* g, Vector2f pos, Vector2f size, float ro
     uid = shader->getUniform(CHash("Rotation"));
     glUniform1f(uid, rad);
 
+    uid = shader->getUniform(CHash("MinUV"));
+    glUniform2f(uid, uvMin.x, uvMin.y);
+
+    uid = shader->getUniform(CHash("MaxUV"));
+    glUniform2f(uid, uvMax.x, uvMax.y);
+
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
 
     #endif /* COPPERY_HEADLESS */
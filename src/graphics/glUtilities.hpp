@@ -85,12 +85,16 @@ public:
         \param pos center
         \param size size
         \param depth depth
+        \param uvMin UV coordinates of the top left corner, see Texture::getUVMin
+        \param uvMax UV coordinates of the bottom right corner
     */
-    static void drawQuad(Graphics* g,Vector2f pos,Vector2f size, float depth = 0.0f);
+    static void drawQuad(Graphics* g,Vector2f pos,Vector2f size, float depth = 0.0f,
+        Vector2f uvMin = Vector2f(0, 0), Vector2f uvMax = Vector2f(1, 1));
 
     static void drawQuadColored(Graphics* g,Vector2f pos,Vector2f size, Color color, float depth = 0.0f);
 
-    static void drawQuadRotated(Graphics* g, Vector2f pos, Vector2f size, float rotation, float depth = 0.0f);
+    static void drawQuadRotated(Graphics* g, Vector2f pos, Vector2f size, float rotation, float depth = 0.0f,
+        Vector2f uvMin = Vector2f(0, 0), Vector2f uvMax = Vector2f(1, 1));
   
     static void drawRectStatic(Graphics* g,Texture* t,Vector2f p1,Vector2f p2, float depth = 0.0f);
 
@@ -5,6 +5,7 @@
 #include "graphicsData.hpp"
 #include "oGL.hpp"
 #include "glUtilities.hpp"
+#include "spriteBatch.hpp"
 #include "gfxFlags.hpp"
 #include "drawable.hpp"
 #include "drawableUI.hpp"
@@ -39,6 +40,11 @@ void Graphics::init(GameVariableManager* var, Window * w)
             this->minFrameTime = gv.getNumber();
             return true;
         })));
+    gvars.push_back(var->makeNumber("Graphics.AssetUploadTime", 4.0, std::function<bool(const GameVariable&)>([this](const GameVariable& gv)
+        {
+            this->assetUploadTime = gv.getNumber();
+            return true;
+        })));
 
     var->loadFromConfig(gvars, "graphics");
 
@@ -60,6 +66,7 @@ void Graphics::init(GameVariableManager* var, Window * w)
     flags->updateShaderPrefix();
 
     gl = new GLState();
+    spriteBatch = new SpriteBatch(this);
 
     gl->setDimensions(renderDimensions, scaledDimensions);
     gl->projection = Matrix4::calculateOrtho(scaledDimensions, 100, -100);
@@ -191,8 +198,20 @@ void Graphics::clearParticles()
         p.second->clear();
 }
 
+double Graphics::getLoadingProgress()
+{
+    return data->textureLoader.getProgress();
+}
+
+bool Graphics::getIsLoading()
+{
+    return data->textureLoader.isLoading();
+}
+
 void Graphics::update()
 {
+    //Milliseconds per frame spent uploading the loaded textures
+    data->update(assetUploadTime / 1000.0);
 
     if (flags->getIsRequestingReInitialization())
     {
@@ -280,7 +299,11 @@ void Graphics::update()
         ShaderBinder shader(this,s);
 
         getGLState()->bindDefaultAttribs();
+        spriteBatch->resetCounters();
         scene->traverse();
+        spriteBatch->flush();
+        spriteDrawCalls = spriteBatch->getDrawCalls();
+        spriteInstances = spriteBatch->getInstances();
         getGLState()->disableDefaultAttribs();
 
     }
@@ -342,6 +365,9 @@ void Graphics::deInit()
 
     scene->clear();
 
+    delete spriteBatch;
+    spriteBatch = nullptr;
+
     delete scene;
     delete data;
     delete gl;
@@ -25,6 +25,7 @@ class SceneFillLight;
 class ParticleSystem;
 class GLState;
 class GraphicsData;
+class SpriteBatch;
 class Shader;
 class GameVariableManager;
 
@@ -50,12 +51,17 @@ class Graphics
     SceneFillLight* playerLight= nullptr;
     SceneMasterBranch* scene = nullptr;
     GameVariableManager* variableManager = nullptr;
+    SpriteBatch* spriteBatch = nullptr;
 
     int frameCounter = 0;
+    unsigned int spriteDrawCalls = 0;
+    unsigned int spriteInstances = 0;
     double minFrameTime = 0.0;
+    double assetUploadTime = 4.0;
     double intervalTimer = 0.0;
     double framesPerSecond = 0.0;
     float graphicsDeltaTime = 1.0f;
+    float interpolationAlpha = 1.0f;
 
     //Screen size in different units:
 
@@ -91,6 +97,12 @@ public:
     //! Set graphics delta time
     void setDeltaTime(float f);
 
+    //! Get the fraction of the physics step elapsed since the last step
+    float getInterpolationAlpha() {return interpolationAlpha;}
+
+    //! Set the fraction of the physics step elapsed since the last step
+    void setInterpolationAlpha(float f) {interpolationAlpha = f;}
+
     //! Get random in range 0.0 - 1.0
     float getGRandom();
 
@@ -101,12 +113,27 @@ public:
     //! Get minimum frame time
     double getMinFrameTime(){return minFrameTime;}
 
+    //! Get the fraction of the textures loaded, 1.0 when not loading
+    double getLoadingProgress();
+
+    //! Returns true while textures are being loaded in the background
+    bool getIsLoading();
+
     //! Get reference to GraphicsData
     GraphicsData* getAssets(){return data;}
 
     //! Get reference to GLState
     GLState* getGLState(){return gl;}
 
+    //! Get reference to the SpriteBatch the sprites are drawn with
+    SpriteBatch* getSpriteBatch(){return spriteBatch;}
+
+    //! Get the amount of instanced draw calls of the sprite batch in the last frame
+    unsigned int getSpriteDrawCalls(){return spriteDrawCalls;}
+
+    //! Get the amount of quads drawn by the sprite batch in the last frame
+    unsigned int getSpriteInstances(){return spriteInstances;}
+
     //! Get reference to Window
     Window* getWindow(){return window;}
 
@@ -2,6 +2,7 @@
 #include "shader.hpp"
 #include "separatedFile.hpp"
 #include "fileOperations.hpp"
+#include "workerPool.hpp"
 
 #include <string>
 #include <sstream>
@@ -63,11 +64,17 @@ void GraphicsData::define()
 
     
 
+    atlas.define();
+
     SeparatedFile textureFile = SeparatedFile::BatchLoad(AssetsFolder+"/def","tex",':');
     for (auto sr : textureFile.rows)
     {
-        textures.addElement(Hash(sr.getString(0)))->setFilename(AssetsFolder+"/"+sr.getString(1))
-        ->setClampX(sr.getInt(2,0))->setClampY(sr.getInt(3,0));;
+        Texture* t = textures.addElement(Hash(sr.getString(0)))->setFilename(AssetsFolder+"/"+sr.getString(1))
+        ->setClampX(sr.getInt(2,0))->setClampY(sr.getInt(3,0));
+
+        //The fifth field leaves the texture out of the atlas
+        if (sr.getInt(4,1))
+            atlas.assign(t, sr.getString(0));
     }
 
     LoadFolderWithPrefix(textures, AssetsFolder+"/props","prop");
@@ -87,6 +94,10 @@ void GraphicsData::define()
 
 }
 
+GraphicsData::GraphicsData() : textureLoader(WorkerPool::getHardwareThreads() - 1)
+{
+}
+
 void GraphicsData::init(GFXFlags* settings)
 {
 
@@ -94,7 +105,9 @@ void GraphicsData::init(GFXFlags* settings)
     shaders.init();
 
     textures.initializeDefaultTextures();
+    atlas.init();
     textures.setAssets(this);
+    textures.setLoader(&textureLoader);
     textures.init();
 
     sheets.setAssets(this);
@@ -107,8 +120,16 @@ void GraphicsData::init(GFXFlags* settings)
     characterAnimations.init();
 
 }
+void GraphicsData::update(double budget)
+{
+    if (textureLoader.isLoading())
+        textureLoader.update(budget);
+}
+
 void GraphicsData::deInit()
 {
+    //The textures being loaded are left with the null textures
+    textureLoader.cancel();
 
     sheets.deInit();
 
@@ -116,6 +137,7 @@ void GraphicsData::deInit()
 
     textures.deInitializeDefaultTextures();
     textures.deInit();
+    atlas.deInit();
 
     fonts.deInit();
 
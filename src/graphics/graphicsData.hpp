@@ -1,6 +1,8 @@
 #pragma once
 #include "shader.hpp"
 #include "texture.hpp"
+#include "textureLoader.hpp"
+#include "textureAtlas.hpp"
 #include "characterAnimator.hpp"
 #include "font.hpp"
 #include "sheet.hpp"
@@ -21,9 +23,25 @@ public:
 
     CharacterAnimationMap characterAnimations;
 
+    //! Decodes the textures in the background, see update
+    TextureLoader textureLoader;
+
+    //! The textures packed by --make-atlas
+    TextureAtlas atlas;
+
     void define();
 
+    /*! \brief Initialize the assets
+
+        The textures are only queued, and are loaded by the following
+        calls to update, except for the ones the fonts use.
+    */
     void init(GFXFlags* settings);
 
+    //! Upload the decoded textures for about \p budget seconds, called once per frame
+    void update(double budget);
+
     void deInit();
+
+    GraphicsData();
 };
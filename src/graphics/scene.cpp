@@ -6,6 +6,8 @@
 
 #include "graphicsData.hpp"
 
+#include "spriteBatch.hpp"
+
 #include "oGL.hpp"
 
 
@@ -108,6 +110,10 @@ bool SceneMasterBranch::traverse()
         }
         else
             it++;
+
+        //The sprites of the node are timed with it
+        graphics->getSpriteBatch()->flush();
+
         #ifndef COPPERY_HEADLESS
         glEndQuery(GL_TIME_ELAPSED);
         #endif
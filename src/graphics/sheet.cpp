@@ -33,13 +33,11 @@ void TextureSheet::load(GraphicsData* assets)
         int nk;
         if (FileExists(s))
         {
-            size_t len;
-            char* fdata = GetFileContentsCopy(s, &len);
+            auto fdata = MapFileContents(s);
             if (fdata)
             {
-                sd = (char*) stbi_load_from_memory((unsigned char*)fdata, len, 
+                sd = (char*) stbi_load_from_memory((const unsigned char*)fdata->getData(), fdata->getSize(), 
                     &ddim.x, &ddim.y, &nk, 4);
-                delete[] fdata;
             }
 
             if (sd)
@@ -53,12 +51,10 @@ void TextureSheet::load(GraphicsData* assets)
         }
         if (FileExists(d))
         {
-            size_t len;
-            char* fdata = GetFileContentsCopy(d, &len);
+            auto fdata = MapFileContents(d);
             if (fdata)
             {
-                dd = (char*) stbi_load_from_memory((unsigned char*)fdata,len,&ddim.x,&ddim.y,&nk,4);
-                delete[] fdata;
+                dd = (char*) stbi_load_from_memory((const unsigned char*)fdata->getData(), fdata->getSize(),&ddim.x,&ddim.y,&nk,4);
             }
 
             if (dd)
@@ -73,12 +69,10 @@ void TextureSheet::load(GraphicsData* assets)
         }
         if (FileExists(n))
         {
-            size_t len;
-            char* fdata = GetFileContentsCopy(n, &len);
+            auto fdata = MapFileContents(n);
             if (fdata)
             {
-                nd = (char*) stbi_load_from_memory((unsigned char*)fdata,len,&ddim.x,&ddim.y,&nk,4);
-                delete[] fdata;
+                nd = (char*) stbi_load_from_memory((const unsigned char*)fdata->getData(), fdata->getSize(),&ddim.x,&ddim.y,&nk,4);
             }
 
             if (nd)
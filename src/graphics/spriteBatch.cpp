@@ -0,0 +1,128 @@
+#include "spriteBatch.hpp"
+#include "graphics.hpp"
+#include "glState.hpp"
+#include "glUtilities.hpp"
+#include "texture.hpp"
+#include "oGL.hpp"
+
+#include <cstddef>
+
+
+SpriteBatch::SpriteBatch(Graphics* g, bool d) : graphics(g), drawing(d)
+{
+}
+
+SpriteBatch::~SpriteBatch()
+{
+    deInit();
+}
+
+void SpriteBatch::deInit()
+{
+    instances.clear();
+
+    #ifndef COPPERY_HEADLESS
+    if (buffer)
+        glDeleteBuffers(1, &buffer);
+    #endif
+    buffer = 0;
+    bufferUsed = 0;
+}
+
+void SpriteBatch::resetCounters()
+{
+    drawCalls = 0;
+    drawnInstances = 0;
+}
+
+void SpriteBatch::add(Shader* s, Texture* t, const SpriteInstance& instance)
+{
+    //The textures of an atlas page are bound once
+    if (t && t->getAtlasPage())
+        t = t->getAtlasPage();
+
+    if (s != shader || t != texture)
+        flush();
+
+    shader = s;
+    texture = t;
+    instances.push_back(instance);
+
+    if (instances.size() >= MaxInstances)
+        flush();
+}
+
+void SpriteBatch::flush()
+{
+    //Binding the shader flushes too
+    if (flushing || instances.empty())
+        return;
+
+    flushing = true;
+    if (drawing)
+        draw();
+    flushing = false;
+
+    drawCalls++;
+    drawnInstances += instances.size();
+    instances.clear();
+}
+
+void SpriteBatch::draw()
+{
+    #ifndef COPPERY_HEADLESS
+
+    ShaderBinder shaderBinder(graphics, shader);
+    TextureBinder textureBinder(graphics, texture);
+
+    graphics->getGLState()->bindDefaultAttribs();
+
+    if (buffer == 0)
+        glGenBuffers(1, &buffer);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    //Orphan the storage when full, instead of waiting for the draws using it
+    if (bufferUsed == 0 || bufferUsed + instances.size() > MaxInstances)
+    {
+        glBufferData(GL_ARRAY_BUFFER, MaxInstances * sizeof(SpriteInstance), nullptr, GL_STREAM_DRAW);
+        bufferUsed = 0;
+    }
+
+    size_t base = bufferUsed * sizeof(SpriteInstance);
+    glBufferSubData(GL_ARRAY_BUFFER, base, instances.size() * sizeof(SpriteInstance), instances.data());
+    bufferUsed += instances.size();
+
+    struct Attrib
+    {
+        int size;
+        size_t offset;
+    };
+    const Attrib attribs[] =
+    {
+        {4, offsetof(SpriteInstance, position)},
+        {2, offsetof(SpriteInstance, rotation)},
+        {4, offsetof(SpriteInstance, uvMin)},
+        {4, offsetof(SpriteInstance, color)},
+        {4, offsetof(SpriteInstance, fade)}
+    };
+
+    for (int i = 0; i < 5; i++)
+    {
+        glEnableVertexAttribArray(2 + i);
+        glVertexAttribPointer(2 + i, attribs[i].size, GL_FLOAT, GL_FALSE,
+            sizeof(SpriteInstance), (void*)(base + attribs[i].offset));
+        glVertexAttribDivisor(2 + i, 1);
+    }
+
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instances.size());
+
+    //The other shaders expect the attributes per vertex
+    for (int i = 0; i < 5; i++)
+    {
+        glVertexAttribDivisor(2 + i, 0);
+        glDisableVertexAttribArray(2 + i);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    #endif /* COPPERY_HEADLESS */
+}
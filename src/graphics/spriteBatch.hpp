@@ -0,0 +1,101 @@
+#pragma once
+#include "vector2.hpp"
+#include "color.hpp"
+#include <cstddef>
+#include <vector>
+
+class Graphics;
+class Shader;
+class Texture;
+
+/*! \brief A quad drawn by SpriteBatch
+
+    Read by the shaders as vertex attributes 2 to 6, see
+    defaultQuad/instancedQuad.vs.
+*/
+struct SpriteInstance
+{
+    //! Center of the quad
+    Vector2f position;
+    //! Size of the quad, negative to mirror
+    Vector2f size;
+    //! Rotation in radians, like the Rotation uniform of defaultQuad.vs
+    float rotation = 0.0f;
+    float depth = 0.0f;
+    //! The area of the texture, see Texture::getUVMin
+    Vector2f uvMin = Vector2f(0, 0);
+    Vector2f uvMax = Vector2f(1, 1);
+    //! Multiplies the texture, like the FadeColor of texturedShaded.fs
+    Color color = Color(1, 1, 1);
+    float alpha = 1.0f;
+    //! Mixed over the texture by fadeAmount, like the FadeColor of texturedColor.fs
+    Color fade = Color(0, 0, 0);
+    float fadeAmount = 0.0f;
+};
+
+static_assert(sizeof(SpriteInstance) == sizeof(float) * 18, "SpriteInstance must match the vertex attributes");
+
+/*! \brief Draws the quads of consecutive sprites with one instanced draw call
+
+    The quads added with the same shader and textures are collected and
+    drawn together by flush, which is called when either changes, when
+    MaxInstances quads are waiting, and before anything else is drawn, see
+    ShaderBinder. The quads are thus drawn in the order they were added.
+
+    The instance data is streamed into a single vertex buffer, which is
+    orphaned when full. Without OpenGL, such as in headless builds or when
+    created for scripts, the batch only counts the draw calls.
+*/
+class SpriteBatch
+{
+    Graphics* graphics;
+    bool drawing;
+    bool flushing = false;
+
+    Shader* shader = nullptr;
+    Texture* texture = nullptr;
+    std::vector<SpriteInstance> instances;
+
+    unsigned int buffer = 0;
+    //Instances written to the buffer since it was orphaned
+    size_t bufferUsed = 0;
+
+    unsigned int drawCalls = 0;
+    unsigned int drawnInstances = 0;
+
+    void draw();
+
+public:
+
+    //! Maximum amount of quads in a draw call, and the size of the buffer
+    static const size_t MaxInstances = 4096;
+
+    /*! \brief Add a quad drawn with \p shader and the textures of \p texture
+
+        \p texture may be nullptr for untextured shaders. Textures in the
+        same atlas page are drawn together.
+    */
+    void add(Shader* shader, Texture* texture, const SpriteInstance& instance);
+
+    //! Draw the quads added so far
+    void flush();
+
+    //! Get the amount of quads waiting for flush
+    size_t getPendingInstances() const {return instances.size();}
+
+    //! Get the amount of draw calls since resetCounters
+    unsigned int getDrawCalls() const {return drawCalls;}
+
+    //! Get the amount of quads drawn since resetCounters
+    unsigned int getInstances() const {return drawnInstances;}
+
+    void resetCounters();
+
+    //! Delete the buffer
+    void deInit();
+
+    //! Constructor, issues no OpenGL calls unless \p drawing
+    SpriteBatch(Graphics* g, bool drawing = true);
+
+    ~SpriteBatch();
+};
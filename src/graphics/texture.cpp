@@ -1,6 +1,7 @@
 #include "texture.hpp"
 #include "log.hpp"
 #include "graphicsData.hpp"
+#include "textureLoader.hpp"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -33,7 +34,29 @@ std::string GetTextureSpecularFileName(const std::string& fn)
 
 void TextureMap::initializeElement(Texture* s)
 {
-    s->load(assets);
+    //Uses the textures of the atlas page
+    if (s->atlasPage)
+        return;
+
+    if (loader)
+        loader->queue(s, assets);
+    else
+        s->load(assets);
+}
+
+Texture* TextureMap::addArea(Hash name, Hash page, Vector2i position, Vector2i size)
+{
+    Texture* p = tryGetElement(page);
+    if (tryGetElement(name) || !p || p->atlasPage)
+        return nullptr;
+
+    Vector2i pageSize = p->getDimensions();
+    if (pageSize.x <= 0 || pageSize.y <= 0)
+        return nullptr;
+
+    Texture* t = addElement(name);
+    t->setAtlas(p, pageSize, position, size);
+    return t;
 }
 
 void TextureMap::deInitializeElement(Texture* s)
@@ -74,23 +97,43 @@ void TextureMap::initializeDefaultTextures()
 
 }
 
-TextureData Texture::loadFile(const std::string& file, TextureLoadParameters tld)
+void DecodedImageDeleter::operator()(unsigned char* p) const
 {
-    unsigned int texid;
+    stbi_image_free(p);
+}
+
+DecodedImage Texture::decodeFile(GBVFS::File& file)
+{
+    DecodedImage img;
     int n;
-    Vector2i dim;
-    dim.x = 0;
-    dim.y = 0;
 
-    size_t len;
+    auto fdata = MapFileContents(file);
+    if (fdata && !GetCacheDirectory().empty())
+    {
+        //Cooked by the --cook-textures mode
+        uint64_t hash = CookedTexture::HashContents(fdata->getData(), fdata->getSize());
+        img.cooked = MapRealFileContents(GetCacheDirectory() + CookedTexture::GetFileName(hash));
+        if (img.cooked && CookedTexture::Parse(img.cooked->getData(), img.cooked->getSize(), hash, img.levels))
+        {
+            img.dimensions = img.levels[0].dimensions;
+            return img;
+        }
+        img.cooked.reset();
+    }
 
-    char* fdata = GetFileContentsCopy(file, &len);
-    unsigned char *data = nullptr;
     if (fdata)
     {
-        data = stbi_load_from_memory((unsigned char*)fdata, len, &dim.width, &dim.height, &n, 4);
-        delete[] fdata;
+        img.pixels.reset(stbi_load_from_memory((const unsigned char*)fdata->getData(), fdata->getSize(), &img.dimensions.width, &img.dimensions.height, &n, 4));
     }
+    if (!img.pixels)
+        img.dimensions = Vector2i(0, 0);
+    return img;
+}
+
+TextureData Texture::upload(const std::string& file, const DecodedImage& img, TextureLoadParameters tld)
+{
+    unsigned int texid = 0;
+    Vector2i dim = img.dimensions;
 
     #ifndef COPPERY_HEADLESS
     glGenTextures(1,&texid);
@@ -106,15 +149,28 @@ TextureData Texture::loadFile(const std::string& file, TextureLoadParameters tld
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA,1, 1, 0, GL_RGBA ,GL_FLOAT, (void*) fdata);
         #endif
     }
+    else if (img.cooked)
+    {
+        #ifndef COPPERY_HEADLESS
+        //The mip levels are already there
+        size_t levels = tld.useMipMaps ? img.levels.size() : 1;
+        for (size_t i = 0; i < levels; i++)
+        {
+            auto& level = img.levels[i];
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, level.dimensions.width, level.dimensions.height, 0, GL_RGBA ,GL_UNSIGNED_BYTE, (const void*) level.pixels);
+        }
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+        #endif
+    }
     else
     {
         #ifndef COPPERY_HEADLESS
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dim.width, dim.height, 0, GL_RGBA ,GL_UNSIGNED_BYTE, (void*) data);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, dim.width, dim.height, 0, GL_RGBA ,GL_UNSIGNED_BYTE, (void*) img.pixels.get());
         #endif
     }
     #ifndef COPPERY_HEADLESS
     
-    if (tld.useMipMaps)
+    if (tld.useMipMaps && !img.cooked)
         glGenerateMipmap(GL_TEXTURE_2D);
     
     if (tld.useMipMaps)
@@ -135,15 +191,21 @@ TextureData Texture::loadFile(const std::string& file, TextureLoadParameters tld
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     #endif
 
-    if (data)
-        stbi_image_free(data);
-
     TextureData td;
     td.dimensions = dim;
     td.id = texid;
     return td;
 }
 
+TextureData Texture::loadFile(const std::string& file, TextureLoadParameters tld)
+{
+    DecodedImage img;
+    auto f = GetFileStream(file);
+    if (f)
+        img = decodeFile(*f);
+    return upload(file, img, tld);
+}
+
 TextureData Texture::loadMemory(Vector2i dim, char* data, TextureLoadParameters tld)
 {
     unsigned int texid;
@@ -181,61 +243,86 @@ TextureData Texture::loadMemory(Vector2i dim, char* data, TextureLoadParameters
 }
 
 
-void Texture::load(GraphicsData* assets)
+TextureLoadParameters Texture::getLoadParameters() const
 {
     TextureLoadParameters tld;
     tld.clampX = clampX;
     tld.clampY = clampY;
     tld.useMipMaps = useMipMaps;
+    return tld;
+}
 
-    bool specular,normal,diffuse;
-    specular = normal = diffuse = false;
-
-    std::string nFile = GetTextureNormalFileName(filenamePrefix);
-    std::string sFile = GetTextureSpecularFileName(filenamePrefix);
-    std::string dFile = GetTextureDiffuseFileName(filenamePrefix);
-
-    specular = FileExists(sFile);
-    diffuse = FileExists(dFile);
-    normal = FileExists(nFile);
-
+bool Texture::prepareLoad(GraphicsData* assets, bool& normal, bool& specular)
+{
+    specular = FileExists(GetTextureSpecularFileName(filenamePrefix));
+    normal = FileExists(GetTextureNormalFileName(filenamePrefix));
 
     normalID = assets->textures.getNullNormal();
     diffuseID = assets->textures.getNullDiffuse();
     specularID = assets->textures.getNullSpecular();
-    if (!diffuse)
+    if (!FileExists(GetTextureDiffuseFileName(filenamePrefix)))
     {
         Log << "Failed to find texture data " << filenamePrefix << Trace(CHash("Warning"));
-        return;
+        return false;
     }
+    return true;
+}
 
+void Texture::setChannel(Channel channel, const TextureData& td)
+{
+    switch (channel)
+    {
+    case Diffuse:
+        hasDiffuse = true;
+        diffuseID = td.id;
+        dimensions = td.dimensions;
+
+        //The diffuse texture doubles as the specular one
+        if (!hasSpecular)
+            specularID = diffuseID;
+        break;
+    case Normal:
+        hasNormal = true;
+        normalID = td.id;
+        break;
+    case Specular:
+        hasSpecular = true;
+        specularID = td.id;
+        break;
+    }
+}
 
-    TextureData texDataDif;
+void Texture::setAtlas(Texture* page, Vector2i pageSize, Vector2i position, Vector2i size)
+{
+    atlasPage = page;
+    if (!page)
+    {
+        uvMin = Vector2f(0, 0);
+        uvMax = Vector2f(1, 1);
+        return;
+    }
 
-    hasDiffuse = true;
-    texDataDif = loadFile(dFile,tld);
+    //The page may not be uploaded yet
+    dimensions = size;
+    uvMin = Vector2f(position) / Vector2f(pageSize);
+    uvMax = Vector2f(position + size) / Vector2f(pageSize);
+}
 
-    diffuseID = texDataDif.id;
-    dimensions = texDataDif.dimensions;
+void Texture::load(GraphicsData* assets)
+{
+    TextureLoadParameters tld = getLoadParameters();
 
-    specularID = diffuseID;
+    bool specular,normal;
+    if (!prepareLoad(assets, normal, specular))
+        return;
 
+    setChannel(Diffuse, loadFile(GetTextureDiffuseFileName(filenamePrefix),tld));
 
     if (normal)
-    {
-        hasNormal = true;
-        TextureData td;
-        td = loadFile(nFile,tld);
-        normalID = td.id;
-    }
+        setChannel(Normal, loadFile(GetTextureNormalFileName(filenamePrefix),tld));
 
     if (specular)
-    {
-        hasSpecular = true;
-        TextureData td;
-        td = loadFile(sFile,tld);
-        specularID = td.id;
-    }
+        setChannel(Specular, loadFile(GetTextureSpecularFileName(filenamePrefix),tld));
 }
 
 void Texture::loadFromMemory(GraphicsData* assets, Vector2i size, char* difp, char* norp, char* spep)
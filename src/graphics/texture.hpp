@@ -1,7 +1,10 @@
 #pragma once
 #include "elementMapper.hpp"
 #include <string>
+#include <memory>
 #include "vector2.hpp"
+#include "fileOperations.hpp"
+#include "cookedTexture.hpp"
 
 std::string GetTextureNormalFileName(const std::string&);
 std::string GetTextureDiffuseFileName(const std::string&);
@@ -18,6 +21,32 @@ public:
 
 class ShaderMap;
 class GraphicsData;
+class TextureLoader;
+class TextureAtlas;
+
+//! Frees the pixels of a DecodedImage
+struct DecodedImageDeleter
+{
+    void operator()(unsigned char*) const;
+};
+
+/*! \brief RGBA pixels decoded from an image file, not yet uploaded to OpenGL
+
+    The pixels come either from decoding the image file, or with all the
+    mip levels from its cooked texture, see cookedTexture.hpp.
+*/
+class DecodedImage
+{
+public:
+    //! Image dimensions, zero if decoding failed
+    Vector2i dimensions = Vector2i(0, 0);
+    std::unique_ptr<unsigned char, DecodedImageDeleter> pixels;
+
+    //! The mapped cooked texture, if found in the cache
+    std::unique_ptr<FileView> cooked;
+    //! The levels of the cooked texture
+    std::vector<CookedTexture::LevelInfo> levels;
+};
 
 //! Structure for single OpenGL texture
 class TextureData
@@ -36,6 +65,22 @@ public:
 */
 class Texture
 {
+public:
+    //! The OpenGL textures of a material
+    enum Channel
+    {
+        Diffuse,
+        Normal,
+        Specular
+    };
+
+private:
+    //! Decode an image file, may be called from any thread
+    static DecodedImage decodeFile(GBVFS::File&);
+
+    //! Upload the decoded image, or a white pixel if decoding failed
+    static TextureData upload(const std::string& file, const DecodedImage&, TextureLoadParameters tld);
+
     static TextureData loadFile(const std::string&, TextureLoadParameters tld = TextureLoadParameters());
     static TextureData loadMemory(Vector2i, char*, TextureLoadParameters tld = TextureLoadParameters());
 
@@ -47,11 +92,27 @@ class Texture
 
     void load(GraphicsData*);
 
+    //Reset the sources to the null textures and find the files to load
+    bool prepareLoad(GraphicsData*, bool& normal, bool& specular);
+
+    //Take the OpenGL texture \p td as the source of \p channel
+    void setChannel(Channel channel, const TextureData& td);
+
+    TextureLoadParameters getLoadParameters() const;
+
     void unLoad();
     Vector2i dimensions = Vector2i(0, 0);
     unsigned int diffuseID, specularID, normalID;
     std::string filenamePrefix;
 
+    //The atlas page the texture is packed into, see textureAtlas.hpp
+    Texture* atlasPage = nullptr;
+    Vector2f uvMin = Vector2f(0, 0);
+    Vector2f uvMax = Vector2f(1, 1);
+
+    //Use the area at \p position of \p page, nullptr to load the texture by itself
+    void setAtlas(Texture* page, Vector2i pageSize, Vector2i position, Vector2i size);
+
     void loadFromMemory(GraphicsData*, Vector2i size, char* diffuse, char* normal, char* specular);
 
 public:
@@ -104,30 +165,64 @@ public:
 
     unsigned int getSpecular()
     {
+        if (atlasPage)
+            return atlasPage->getSpecular();
         return specularID;
     }
 
 
     unsigned int getNormal()
     {
+        if (atlasPage)
+            return atlasPage->getNormal();
         return normalID;
     }
 
 
     unsigned int getDiffuse()
     {
+        if (atlasPage)
+            return atlasPage->getDiffuse();
         return diffuseID;
     }
 
+    //! Get the atlas page the texture is packed into, or nullptr
+    Texture* getAtlasPage()
+    {
+        return atlasPage;
+    }
+
+    //! Get the UV coordinates of the top left corner of the texture
+    Vector2f getUVMin()
+    {
+        return uvMin;
+    }
+
+    //! Get the UV coordinates of the bottom right corner of the texture
+    Vector2f getUVMax()
+    {
+        return uvMax;
+    }
+
+    //! Map UV coordinates within the texture to the UV coordinates of the OpenGL textures
+    Vector2f mapUV(Vector2f uv)
+    {
+        return uvMin + (uvMax - uvMin) * uv;
+    }
+
 
     friend class TextureMap;
     friend class TextureSheet;
+    friend class TextureLoader;
+    friend class TextureAtlas;
+    friend class TextureMap;
 };
 
 //! Collection of Texture instances
 class TextureMap : public ElementMapper<Texture>
 {
     GraphicsData* assets = nullptr;
+    TextureLoader* loader = nullptr;
     unsigned int nullDiffuse, nullNormal;
 public:
     
@@ -144,6 +239,17 @@ public:
     
     void setAssets(GraphicsData* g) {assets = g;};
 
+    //! Load the textures with \p l instead of right away, nullptr to load right away
+    void setLoader(TextureLoader* l) {loader = l;};
+
+    /*! \brief Add the texture \p name drawing an area of the texture \p page
+
+        The texture is drawn like one packed into an atlas page, see
+        textureAtlas.hpp, and is never loaded by itself. Returns nullptr if
+        \p name is taken, or \p page isn't loaded or is in an atlas itself.
+    */
+    Texture* addArea(Hash name, Hash page, Vector2i position, Vector2i size);
+
 
     void deInitializeDefaultTextures();
 
@@ -0,0 +1,260 @@
+#include "textureAtlas.hpp"
+#include "cookedTexture.hpp"
+#include "fileOperations.hpp"
+#include "log.hpp"
+
+#include <fstream>
+#include <sstream>
+
+
+const char* const TextureAtlas::IndexFileName = "atlas.index";
+
+std::string TextureAtlas::GetPageFileName(unsigned int page, Texture::Channel channel)
+{
+    const char* suffix[] = {"", ".n", ".s"};
+    return "atlas" + std::to_string(page) + suffix[channel] + ".ctex";
+}
+
+static void GetSourceFileNames(const std::string& filenamePrefix, std::string out[3])
+{
+    out[Texture::Diffuse] = GetTextureDiffuseFileName(filenamePrefix);
+    out[Texture::Normal] = GetTextureNormalFileName(filenamePrefix);
+    out[Texture::Specular] = GetTextureSpecularFileName(filenamePrefix);
+}
+
+static uint64_t HashSource(const std::string& file)
+{
+    if (!FileExists(file))
+        return 0;
+    auto view = MapFileContents(file);
+    if (!view)
+        return 0;
+    return CookedTexture::HashContents(view->getData(), view->getSize());
+}
+
+//Compare the stamp first, so that the unchanged files aren't read
+static bool IsSourceUnchanged(const std::string& file, const FileStamp& stamp, uint64_t hash)
+{
+    FileStamp current;
+    if (GetFileStamp(file, current))
+    {
+        if (current.size != stamp.size)
+            return false;
+        if (current.modified == stamp.modified)
+            return true;
+    }
+    return HashSource(file) == hash;
+}
+
+void TextureAtlas::HashSources(const std::string& filenamePrefix, uint64_t out[3])
+{
+    std::string files[3];
+    GetSourceFileNames(filenamePrefix, files);
+    for (int i = 0; i < 3; i++)
+        out[i] = HashSource(files[i]);
+}
+
+void TextureAtlas::StampSources(const std::string& filenamePrefix, FileStamp out[3])
+{
+    std::string files[3];
+    GetSourceFileNames(filenamePrefix, files);
+    for (int i = 0; i < 3; i++)
+    {
+        out[i] = FileStamp();
+        GetFileStamp(files[i], out[i]);
+    }
+}
+
+bool TextureAtlas::WriteIndex(const std::string& realPath, const std::vector<Page>& pages,
+    const std::vector<std::pair<std::string, Entry>>& entries)
+{
+    std::ofstream out(realPath, std::ios::trunc);
+    if (!out)
+    {
+        LogError << "Can't open " << realPath << " for writing" << Message();
+        return false;
+    }
+
+    out << "atlas " << Version << " " << pages.size() << "\n";
+    for (auto& p : pages)
+    {
+        out << "page " << p.dimensions.x << " " << p.dimensions.y << std::hex;
+        for (auto h : p.hashes)
+            out << " " << h;
+        out << std::dec << "\n";
+    }
+
+    for (auto& e : entries)
+    {
+        const Entry& entry = e.second;
+        out << "texture " << entry.page << " " << entry.position.x << " " << entry.position.y << " "
+            << entry.dimensions.x << " " << entry.dimensions.y << std::hex;
+        for (auto h : entry.sources)
+            out << " " << h;
+        out << std::dec;
+        for (auto& stamp : entry.stamps)
+            out << " " << stamp.size;
+        for (auto& stamp : entry.stamps)
+            out << " " << stamp.modified;
+        out << " " << e.first << "\n";
+    }
+
+    out.close();
+    if (!out)
+    {
+        LogError << "Failed to write " << realPath << Message();
+        return false;
+    }
+    return true;
+}
+
+bool TextureAtlas::readIndex(const std::string& realPath)
+{
+    std::ifstream in(realPath);
+    if (!in)
+        return false;
+
+    std::string line, word;
+    uint32_t version = 0;
+    size_t count = 0;
+    if (!std::getline(in, line))
+        return false;
+
+    std::stringstream header(line);
+    header >> word >> version >> count;
+    if (!header || word != "atlas" || version != Version)
+        return false;
+
+    while (std::getline(in, line))
+    {
+        std::stringstream sst(line);
+        sst >> word;
+        if (word == "page")
+        {
+            Page p;
+            sst >> p.dimensions.x >> p.dimensions.y >> std::hex >> p.hashes[0] >> p.hashes[1] >> p.hashes[2];
+            if (!sst || p.dimensions.x <= 0 || p.dimensions.y <= 0)
+                return false;
+            pages.push_back(p);
+        }
+        else if (word == "texture")
+        {
+            Entry e;
+            std::string name;
+            sst >> e.page >> e.position.x >> e.position.y >> e.dimensions.x >> e.dimensions.y
+                >> std::hex >> e.sources[0] >> e.sources[1] >> e.sources[2] >> std::dec;
+            for (auto& stamp : e.stamps)
+                sst >> stamp.size;
+            for (auto& stamp : e.stamps)
+                sst >> stamp.modified;
+            sst.get();
+            std::getline(sst, name);
+            if (!sst || name.empty())
+                return false;
+            entries[Hash(name)] = e;
+        }
+    }
+    if (pages.size() != count)
+        return false;
+
+    for (auto& it : entries)
+    {
+        const Entry& e = it.second;
+        if (e.page >= count || e.position.x < 0 || e.position.y < 0 || e.dimensions.x <= 0 || e.dimensions.y <= 0 ||
+            e.position.x + e.dimensions.x > pages[e.page].dimensions.x ||
+            e.position.y + e.dimensions.y > pages[e.page].dimensions.y)
+            return false;
+    }
+    return true;
+}
+
+bool TextureAtlas::define()
+{
+    pages.clear();
+    pageTextures.clear();
+    entries.clear();
+
+    const std::string& cache = GetCacheDirectory();
+    if (cache.empty() || !readIndex(cache + IndexFileName))
+    {
+        pages.clear();
+        entries.clear();
+        return false;
+    }
+
+    for (size_t i = 0; i < pages.size(); i++)
+    {
+        for (int c = 0; c < 3; c++)
+        {
+            std::vector<CookedTexture::LevelInfo> levels;
+            auto view = MapRealFileContents(cache + GetPageFileName(i, Texture::Channel(c)));
+            if (!view || !CookedTexture::Parse(view->getData(), view->getSize(), pages[i].hashes[c], levels) ||
+                levels[0].dimensions != pages[i].dimensions)
+            {
+                Log << "The texture atlas is missing page " << i << ", make it again with --make-atlas" << Trace(CHash("Warning"));
+                pages.clear();
+                entries.clear();
+                return false;
+            }
+        }
+
+        auto page = std::unique_ptr<Texture>(new Texture());
+        page->setClampX(true)->setClampY(true);
+        pageTextures.push_back(std::move(page));
+    }
+    return true;
+}
+
+bool TextureAtlas::assign(Texture* texture, const std::string& name)
+{
+    auto it = entries.find(Hash(name));
+    if (it == entries.end())
+        return false;
+
+    const Entry& entry = it->second;
+    std::string files[3];
+    GetSourceFileNames(texture->filenamePrefix, files);
+    for (int i = 0; i < 3; i++)
+    {
+        if (!IsSourceUnchanged(files[i], entry.stamps[i], entry.sources[i]))
+        {
+            Log << "Texture " << name << " has changed since the atlas was made" << Trace(CHash("Warning"));
+            return false;
+        }
+    }
+
+    texture->setAtlas(pageTextures[entry.page].get(), pages[entry.page].dimensions, entry.position, entry.dimensions);
+    return true;
+}
+
+void TextureAtlas::init()
+{
+    const std::string& cache = GetCacheDirectory();
+    for (size_t i = 0; i < pageTextures.size(); i++)
+    {
+        Texture* page = pageTextures[i].get();
+        for (int c = 0; c < 3; c++)
+        {
+            Texture::Channel channel = Texture::Channel(c);
+            std::string file = cache + GetPageFileName(i, channel);
+
+            //Checked by define, uploads a white pixel if removed since
+            DecodedImage img;
+            img.cooked = MapRealFileContents(file);
+            if (img.cooked && CookedTexture::Parse(img.cooked->getData(), img.cooked->getSize(), pages[i].hashes[c], img.levels))
+                img.dimensions = img.levels[0].dimensions;
+            else
+                img.cooked.reset();
+            page->setChannel(channel, Texture::upload(file, img, page->getLoadParameters()));
+        }
+    }
+
+    if (!pageTextures.empty())
+        Log << "Loaded " << pageTextures.size() << " texture atlas pages" << Trace(CHash("General"));
+}
+
+void TextureAtlas::deInit()
+{
+    for (auto& page : pageTextures)
+        page->unLoad();
+}
@@ -0,0 +1,106 @@
+#pragma once
+#include "texture.hpp"
+#include "hash.hpp"
+#include "fileOperations.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*! \file textureAtlas.hpp
+    \brief Textures packed together into atlas pages
+
+    The --make-atlas mode packs the textures listed in the .tex files into
+    atlas pages, so that the sprites using them share the bound textures.
+    Every page is stored in the cache directory as three cooked textures,
+    see cookedTexture.hpp, one per Texture::Channel. The normal and
+    specular maps of a texture are at the same coordinates as its diffuse
+    map. A texture without a normal map gets the null normal, and one
+    without a specular map its diffuse map, like when loaded by itself.
+
+    The index, TextureAtlas::IndexFileName, is a text file:
+
+        atlas <version> <page count>
+        page <width> <height> <diffuse hash> <normal hash> <specular hash>
+        texture <page> <x> <y> <width> <height> <3 hashes> <3 sizes> <3 modification times> <name>
+
+    The page hashes are the source hashes of the cooked pages, and the
+    texture hashes those of the diffuse, normal and specular image files of
+    the texture, see CookedTexture::HashContents, 0 for a missing file. A
+    texture whose files have changed since the atlas was made is loaded by
+    itself. The files are only stat'ed if their size and modification time
+    are unchanged, and hashed if only the modification time has changed or
+    they are in a pack.
+*/
+class TextureAtlas
+{
+public:
+    //! The area of a texture in the atlas
+    struct Entry
+    {
+        unsigned int page;
+        Vector2i position;
+        Vector2i dimensions;
+        //! Hashes of the diffuse, normal and specular image files
+        uint64_t sources[3];
+        //! Sizes and modification times of the image files
+        FileStamp stamps[3];
+    };
+
+    //! A page, with the hashes of its diffuse, normal and specular pixels
+    struct Page
+    {
+        Vector2i dimensions;
+        uint64_t hashes[3];
+    };
+
+    static const uint32_t Version = 2;
+
+    //! Name of the index in the cache directory
+    static const char* const IndexFileName;
+
+    //! Get the name of a channel of a page in the cache directory
+    static std::string GetPageFileName(unsigned int page, Texture::Channel channel);
+
+    //! Hash the image files of the texture \p filenamePrefix, 0 for missing ones
+    static void HashSources(const std::string& filenamePrefix, uint64_t out[3]);
+
+    //! Get the stamps of the image files of the texture \p filenamePrefix, zero for missing ones
+    static void StampSources(const std::string& filenamePrefix, FileStamp out[3]);
+
+    //! Write an index to \p realPath, a path on the real file system
+    static bool WriteIndex(const std::string& realPath, const std::vector<Page>& pages,
+        const std::vector<std::pair<std::string, Entry>>& entries);
+
+private:
+    std::vector<Page> pages;
+    std::vector<std::unique_ptr<Texture>> pageTextures;
+    std::unordered_map<Hash, Entry> entries;
+
+    bool readIndex(const std::string& realPath);
+
+public:
+
+    /*! \brief Read the atlas from the cache directory
+
+        Returns false if there is no atlas, or a page is missing.
+    */
+    bool define();
+
+    /*! \brief Put \p texture named \p name in the atlas
+
+        Returns false if it isn't in the atlas, or has changed since
+        the atlas was made, in which case it's loaded by itself.
+    */
+    bool assign(Texture* texture, const std::string& name);
+
+    //! Upload the pages
+    void init();
+
+    //! Delete the pages
+    void deInit();
+
+    //! Get the amount of pages
+    size_t getPageCount() const {return pages.size();}
+};
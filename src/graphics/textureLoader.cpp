@@ -0,0 +1,225 @@
+#include "textureLoader.hpp"
+#include "graphicsData.hpp"
+#include "fileOperations.hpp"
+#include "workerPool.hpp"
+#include "log.hpp"
+
+#include <limits>
+
+
+TextureLoader::TextureLoader(unsigned int threads)
+{
+    workers = std::unique_ptr<WorkerPool>(new WorkerPool(threads));
+}
+
+TextureLoader::~TextureLoader()
+{
+    cancel();
+    workers.reset();
+}
+
+double TextureLoader::getProgress() const
+{
+    if (total == 0)
+        return 1.0;
+    return double(uploaded) / total;
+}
+
+void TextureLoader::queue(Texture* texture, GraphicsData* assets)
+{
+    bool normal, specular;
+    if (!texture->prepareLoad(assets, normal, specular))
+        return;
+
+    if (!isLoading())
+    {
+        total = 0;
+        uploaded = 0;
+        cooked = 0;
+        loadStart = std::chrono::high_resolution_clock::now();
+    }
+
+    auto add = [&](Texture::Channel channel, const std::string& filename)
+    {
+        auto job = std::unique_ptr<Job>(new Job());
+        job->texture = texture;
+        job->channel = channel;
+        job->filename = filename;
+        jobs.push_back(std::move(job));
+        total++;
+    };
+
+    add(Texture::Diffuse, GetTextureDiffuseFileName(texture->filenamePrefix));
+    if (normal)
+        add(Texture::Normal, GetTextureNormalFileName(texture->filenamePrefix));
+    if (specular)
+        add(Texture::Specular, GetTextureSpecularFileName(texture->filenamePrefix));
+}
+
+void TextureLoader::submit(Job* job)
+{
+    //The VFS is used only from the main thread
+    job->file = GetFileStream(job->filename);
+    job->state = Decoding;
+    active++;
+
+    auto task = [this, job]()
+    {
+        DecodedImage image;
+        if (job->file)
+            image = Texture::decodeFile(*job->file);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        job->image = std::move(image);
+        job->state = Decoded;
+        decodedCv.notify_all();
+    };
+    workers->submit(task);
+}
+
+void TextureLoader::fill()
+{
+    while (active < queueLimit && nextWaiting < jobs.size())
+    {
+        Job* job = jobs[nextWaiting++].get();
+        if (job)
+            submit(job);
+    }
+}
+
+bool TextureLoader::hasDecoded(size_t& index)
+{
+    for (size_t i = 0; i < nextWaiting; i++)
+    {
+        if (jobs[i] && jobs[i]->state == Decoded)
+        {
+            index = i;
+            return true;
+        }
+    }
+    return false;
+}
+
+void TextureLoader::uploadJob(size_t index)
+{
+    Job* job = jobs[index].get();
+    job->file.reset();
+    if (job->image.cooked)
+        cooked++;
+    job->texture->setChannel(job->channel, Texture::upload(job->filename, job->image, job->texture->getLoadParameters()));
+
+    if (index < nextWaiting)
+        active--;
+    uploaded++;
+    jobs[index].reset();
+
+    if (!isLoading())
+    {
+        auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - loadStart);
+        Log << "Loaded " << total << " texture images in " << (long long) ms.count() << " ms, "
+            << cooked << " from the cache" << Trace(CHash("General"));
+    }
+}
+
+void TextureLoader::removeUploaded()
+{
+    size_t kept = 0;
+    size_t waiting = nextWaiting;
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        if (!jobs[i])
+        {
+            if (i < nextWaiting)
+                waiting--;
+            continue;
+        }
+        if (kept != i)
+            jobs[kept] = std::move(jobs[i]);
+        kept++;
+    }
+    jobs.resize(kept);
+    nextWaiting = waiting;
+}
+
+unsigned int TextureLoader::update(double budget)
+{
+    auto start = std::chrono::high_resolution_clock::now();
+    unsigned int count = 0;
+
+    fill();
+    for (;;)
+    {
+        size_t index;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!hasDecoded(index))
+                break;
+        }
+
+        uploadJob(index);
+        count++;
+        fill();
+
+        std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+        if (elapsed.count() >= budget)
+            break;
+    }
+
+    removeUploaded();
+    return count;
+}
+
+void TextureLoader::loadNow(Texture* texture)
+{
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        Job* job = jobs[i].get();
+        if (!job || job->texture != texture)
+            continue;
+
+        if (i >= nextWaiting)
+        {
+            //Not submitted, nothing else refers to it
+            auto file = GetFileStream(job->filename);
+            if (file)
+                job->image = Texture::decodeFile(*file);
+        }
+        else
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            decodedCv.wait(lock, [job]()
+            {
+                return job->state == Decoded;
+            });
+        }
+        uploadJob(i);
+    }
+    removeUploaded();
+}
+
+void TextureLoader::finish()
+{
+    while (isLoading())
+    {
+        if (update(std::numeric_limits<double>::infinity()) > 0)
+            continue;
+
+        size_t index;
+        std::unique_lock<std::mutex> lock(mutex);
+        decodedCv.wait(lock, [this, &index]()
+        {
+            return hasDecoded(index);
+        });
+    }
+}
+
+void TextureLoader::cancel()
+{
+    workers->waitTasks();
+    jobs.clear();
+    nextWaiting = 0;
+    active = 0;
+    total = 0;
+    uploaded = 0;
+    cooked = 0;
+}
@@ -0,0 +1,112 @@
+#pragma once
+#include "texture.hpp"
+#include "fileOperations.hpp"
+
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+
+/*! \brief Loads textures over multiple frames
+
+    Loading is split into two stages. The image files are read and decoded
+    on worker threads, and the decoded images are uploaded to OpenGL on the
+    main thread by update, until its time budget runs out. At most
+    queueLimit images are being decoded or waiting for the upload at a
+    time, which bounds the memory held by the decoded images.
+
+    Until its images have been uploaded, a texture uses the null textures
+    and has zero dimensions. In headless mode nothing is uploaded, but the
+    images are still decoded and the dimensions set.
+*/
+class TextureLoader
+{
+    enum JobState
+    {
+        Waiting,
+        Decoding,
+        Decoded
+    };
+
+    struct Job
+    {
+        Texture* texture;
+        Texture::Channel channel;
+        std::string filename;
+        std::unique_ptr<FileHandle> file;
+        DecodedImage image;
+        //Guarded by mutex once submitted
+        JobState state = Waiting;
+    };
+
+    std::unique_ptr<WorkerPool> workers;
+
+    //Owned by the main thread, in the order they were queued
+    std::vector<std::unique_ptr<Job>> jobs;
+    size_t nextWaiting = 0;
+    unsigned int active = 0;
+    unsigned int total = 0;
+    unsigned int uploaded = 0;
+    unsigned int cooked = 0;
+    std::chrono::high_resolution_clock::time_point loadStart;
+
+    std::mutex mutex;
+    std::condition_variable decodedCv;
+
+    void submit(Job* job);
+    //Submit the waiting jobs until queueLimit are active
+    void fill();
+    //Find a decoded job, the mutex must be locked
+    bool hasDecoded(size_t& index);
+    void uploadJob(size_t index);
+    void removeUploaded();
+
+public:
+
+    //! Maximum amount of images decoded or waiting for the upload
+    unsigned int queueLimit = 16;
+
+    //! Queue the images of \p texture, resetting it to the null textures
+    void queue(Texture* texture, GraphicsData* assets);
+
+    /*! \brief Upload the decoded images for about \p budget seconds
+
+        Uploads at least one image if one has been decoded, and keeps the
+        workers busy. Returns the amount of images uploaded.
+    */
+    unsigned int update(double budget);
+
+    //! Finish loading \p texture right away, blocking if needed
+    void loadNow(Texture* texture);
+
+    //! Finish loading all the queued textures, blocking
+    void finish();
+
+    //! Wait for the images being decoded and drop all the queued ones
+    void cancel();
+
+    //! Returns true while there are images left to upload
+    bool isLoading() const {return uploaded < total;}
+
+    //! Get the fraction of the images uploaded since loading last started
+    double getProgress() const;
+
+    //! Get the amount of images uploaded since loading last started
+    unsigned int getUploadedImages() const {return uploaded;}
+
+    //! Get the amount of images queued since loading last started
+    unsigned int getTotalImages() const {return total;}
+
+    //! Get the amount of uploaded images that were read from the cache
+    unsigned int getCookedImages() const {return cooked;}
+
+    //! Constructor, decodes on \p threads worker threads or immediately if 0
+    TextureLoader(unsigned int threads);
+
+    //! Destructor, cancels the loading
+    ~TextureLoader();
+};
@@ -4,6 +4,10 @@
 
 
 #include "compiler.hpp"
+#include "mapConverter.hpp"
+#include "packer.hpp"
+#include "textureCooker.hpp"
+#include "textureAtlasBuilder.hpp"
 #include "argumentParser.hpp"
 
 #include "log.hpp"
@@ -26,6 +30,7 @@
 
 
 #include "fileOperations.hpp"
+#include "asyncFile.hpp"
 #include "variable.hpp"
 
 
@@ -151,6 +156,9 @@ void gameMain(ArgumentParser& args)
                 //The following order of execution can be important
                 //and should be carefully considered
                 
+                //Make the files read in the background visible
+                PollAsyncFiles();
+
                 //Control controls, update it first
                 control->update();
                 
@@ -299,6 +307,14 @@ int main(int argc, const char** argv)
     bool compilerOnlyMode = false;  
     compilerOnlyMode = argumentParser.getArgument("-c", "--compiler");
 
+    bool mapConverterMode = argumentParser.getArgument("", "--convert-map");
+
+    bool packerMode = argumentParser.getArgument("", "--make-pack");
+
+    bool cookerMode = argumentParser.getArgument("", "--cook-textures");
+
+    bool atlasMode = argumentParser.getArgument("", "--make-atlas");
+
     //All traces
 
     /*
@@ -328,7 +344,7 @@ int main(int argc, const char** argv)
     if (veryVerbose)
         verbose = true;
 
-    if (!compilerOnlyMode)
+    if (!compilerOnlyMode && !mapConverterMode && !packerMode && !cookerMode && !atlasMode)
     {
 
         Log.enableTrace(CHash("Warning"), "Warning: ");
@@ -405,6 +421,22 @@ int main(int argc, const char** argv)
     {   
         compilerMain(argumentParser);
     }
+    else if (mapConverterMode)
+    {
+        mapConverterMain(argumentParser);
+    }
+    else if (packerMode)
+    {
+        packerMain(argumentParser);
+    }
+    else if (cookerMode)
+    {
+        textureCookerMain(argumentParser);
+    }
+    else if (atlasMode)
+    {
+        textureAtlasBuilderMain(argumentParser);
+    }
     else
     {
         gameMain(argumentParser);
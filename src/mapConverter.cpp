@@ -0,0 +1,38 @@
+#include "mapConverter.hpp"
+#include "game/tilemapLoading.hpp"
+
+#include "fileOperations.hpp"
+#include "log.hpp"
+
+#include <sstream>
+
+
+void mapConverterMain(ArgumentParser& args)
+{
+    VFS_Init(args);
+
+    //The arguments are pairs of input and output files within the VFS
+    std::string files;
+    args.getArgumentFullString("", "--convert-map", files);
+
+    //Chunked version 3 files for TilemapStreamer
+    bool chunked = args.getArgument("", "--chunked");
+
+    std::stringstream sst(files);
+    std::string from, to;
+    while (sst >> from)
+    {
+        if (!(sst >> to))
+        {
+            LogError << "No output file given for " << from << Message();
+            break;
+        }
+
+        if (TilemapLoading::ConvertTSMap(from, to, chunked))
+            Log << "Converted " << from << " -> " << to << Trace(CHash("General"));
+        else
+            LogError << "Failed to convert " << from << Message();
+    }
+
+    VFS_Deinit();
+}
@@ -0,0 +1,5 @@
+#pragma once
+#include "argumentParser.hpp"
+
+//! Run engine as a .tsmap version 1 to version 2 converter
+extern void mapConverterMain(ArgumentParser&);
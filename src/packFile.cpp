@@ -0,0 +1,332 @@
+#include "packFile.hpp"
+#include "fileOperations.hpp"
+#include "log.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+
+//! GBVFS::File reading from memory kept alive by owner
+class MemoryFile : public GBVFS::File
+{
+    const char* data;
+    size_t size;
+    size_t position = 0;
+    std::shared_ptr<const void> owner;
+public:
+
+    unsigned long tell() override
+    {
+        return position;
+    }
+
+    void seek(unsigned long o) override
+    {
+        position = std::min(size_t(o), size);
+    }
+
+    size_t read(void* p, size_t bytes) override
+    {
+        bytes = std::min(bytes, size - position);
+        memcpy(p, data + position, bytes);
+        position += bytes;
+        return bytes;
+    }
+
+    long getSize() override
+    {
+        return size;
+    }
+
+    bool isEOF() override
+    {
+        return position >= size;
+    }
+
+    void close() override
+    {
+        position = size;
+    }
+
+    GBVFS::FileSpan map() override
+    {
+        GBVFS::FileSpan span;
+        span.data = data;
+        span.size = size;
+        span.owner = owner;
+        return span;
+    }
+
+    MemoryFile(const char* d, size_t s, std::shared_ptr<const void> o) : data(d), size(s), owner(std::move(o))
+    {
+    }
+};
+
+static uint32_t ReadU32(const uint8_t* p)
+{
+    return uint32_t(p[0]) | uint32_t(p[1]) << 8 | uint32_t(p[2]) << 16 | uint32_t(p[3]) << 24;
+}
+
+static uint64_t ReadU64(const uint8_t* p)
+{
+    return uint64_t(ReadU32(p)) | uint64_t(ReadU32(p + 4)) << 32;
+}
+
+static void WriteU32(std::vector<char>& out, uint32_t v)
+{
+    for (int i = 0; i < 4; i++)
+        out.push_back(char(v >> (i * 8)));
+}
+
+static void WriteU64(std::vector<char>& out, uint64_t v)
+{
+    WriteU32(out, uint32_t(v));
+    WriteU32(out, uint32_t(v >> 32));
+}
+
+
+PackLoader::PackLoader()
+{
+}
+
+PackLoader::~PackLoader()
+{
+}
+
+bool PackLoader::open(const std::string& realPath)
+{
+    entries.clear();
+    view = MapRealFileContents(realPath);
+    if (!view)
+        return false;
+
+    const uint8_t* file = reinterpret_cast<const uint8_t*>(view->getData());
+    size_t size = view->getSize();
+    if (size < sizeof(PackFile::Header) ||
+        ReadU32(file) != PackFile::Magic || ReadU32(file + 4) != PackFile::Version)
+    {
+        view.reset();
+        return false;
+    }
+
+    uint32_t count = ReadU32(file + 8);
+    uint64_t indexOffset = ReadU64(file + 16);
+    uint64_t pathOffset = ReadU64(file + 24);
+    uint64_t pathSize = ReadU64(file + 32);
+
+    bool valid = ReadU64(file + 40) == size &&
+        indexOffset <= size && count <= (size - indexOffset) / sizeof(PackFile::Entry) &&
+        pathOffset <= size && pathSize <= size - pathOffset;
+
+    for (uint32_t i = 0; i < count && valid; i++)
+    {
+        const uint8_t* e = file + indexOffset + size_t(i) * sizeof(PackFile::Entry);
+        uint32_t nameOffset = ReadU32(e);
+        uint32_t nameLength = ReadU32(e + 4);
+        uint64_t offset = ReadU64(e + 8);
+        uint64_t bytes = ReadU64(e + 16);
+
+        if (uint64_t(nameOffset) + nameLength > pathSize || offset > size || bytes > size - offset)
+        {
+            valid = false;
+            break;
+        }
+
+        IndexEntry entry;
+        entry.path.assign(view->getData() + pathOffset + nameOffset, nameLength);
+        entry.data = view->getData() + offset;
+        entry.size = bytes;
+
+        //The lookups rely on the order
+        if (!entries.empty() && !(entries.back().path < entry.path))
+            valid = false;
+        entries.push_back(std::move(entry));
+    }
+
+    if (!valid)
+    {
+        entries.clear();
+        view.reset();
+        return false;
+    }
+    return true;
+}
+
+std::vector<PackLoader::IndexEntry>::const_iterator PackLoader::lowerBound(const std::string& path) const
+{
+    return std::lower_bound(entries.begin(), entries.end(), path,
+        [](const IndexEntry& e, const std::string& p)
+        {
+            return e.path < p;
+        });
+}
+
+std::vector<std::string> PackLoader::getRootDirectories() const
+{
+    std::vector<std::string> dirs;
+    for (auto& e : entries)
+    {
+        auto slash = e.path.find('/');
+        if (slash == std::string::npos)
+            continue;
+        std::string dir = e.path.substr(0, slash);
+        if (dirs.empty() || dirs.back() != dir)
+            dirs.push_back(dir);
+    }
+    return dirs;
+}
+
+void PackLoader::iterateEntries(const GBVFS::PathView& pv, FileIteratorCallback fic)
+{
+    std::string prefix = pv.getCString();
+    if (prefix.size() > 0)
+        prefix += '/';
+
+    //The entries within a directory are next to each other
+    std::string last;
+    for (auto it = lowerBound(prefix); it != entries.end(); ++it)
+    {
+        if (it->path.compare(0, prefix.size(), prefix) != 0)
+            break;
+
+        GBVFS::FileEntry f;
+        f.exists = true;
+        std::string name = it->path.substr(prefix.size());
+        auto slash = name.find('/');
+        if (slash != std::string::npos)
+        {
+            name.resize(slash);
+            f.directory = true;
+        }
+        else
+            f.fileSize = it->size;
+
+        if (name == last)
+            continue;
+        last = name;
+        fic(name.c_str(), f);
+    }
+}
+
+GBVFS::FileEntry PackLoader::getFileEntry(const GBVFS::PathView& pv)
+{
+    GBVFS::FileEntry f;
+    std::string path = pv.getCString();
+    if (path.empty())
+    {
+        f.exists = !entries.empty();
+        f.directory = true;
+        return f;
+    }
+
+    auto it = lowerBound(path);
+    if (it != entries.end() && it->path == path)
+    {
+        f.exists = true;
+        f.fileSize = it->size;
+        return f;
+    }
+
+    path += '/';
+    it = lowerBound(path);
+    if (it != entries.end() && it->path.compare(0, path.size(), path) == 0)
+    {
+        f.exists = true;
+        f.directory = true;
+    }
+    return f;
+}
+
+std::unique_ptr<GBVFS::File> PackLoader::openFile(const GBVFS::PathView& pv)
+{
+    std::string path = pv.getCString();
+    auto it = lowerBound(path);
+    if (it == entries.end() || it->path != path)
+        return nullptr;
+    return std::make_unique<MemoryFile>(it->data, it->size, view);
+}
+
+std::unique_ptr<GBVFS::FileWriter> PackLoader::openFileWrite(const GBVFS::PathView&)
+{
+    return nullptr;
+}
+
+
+bool PackFile::Write(const std::string& realPath, std::vector<std::string> files)
+{
+    for (auto& f : files)
+        f = CanonicalizePath(f);
+    std::sort(files.begin(), files.end());
+    files.erase(std::unique(files.begin(), files.end()), files.end());
+
+    std::ofstream out(realPath, std::ios::binary | std::ios::trunc);
+    if (!out)
+    {
+        LogError << "Can't open " << realPath << " for writing" << Message();
+        return false;
+    }
+
+    //The header is written last, once the offsets are known
+    std::vector<char> header(sizeof(Header), 0);
+    out.write(header.data(), header.size());
+    uint64_t position = header.size();
+
+    std::vector<char> index;
+    std::vector<char> paths;
+    std::vector<char> buffer;
+    for (auto& name : files)
+    {
+        auto f = GetFileStream(name);
+        if (!f)
+        {
+            LogError << "Can't read " << name << Message();
+            return false;
+        }
+        buffer.resize(f->getSize());
+        size_t read = buffer.empty() ? 0 : f->read(buffer.data(), buffer.size());
+        f->close();
+        if (read != buffer.size())
+        {
+            LogError << "Can't read " << name << Message();
+            return false;
+        }
+
+        uint64_t aligned = (position + Alignment - 1) & ~uint64_t(Alignment - 1);
+        std::vector<char> padding(aligned - position, 0);
+        out.write(padding.data(), padding.size());
+        out.write(buffer.data(), buffer.size());
+
+        WriteU32(index, paths.size());
+        WriteU32(index, name.size());
+        WriteU64(index, aligned);
+        WriteU64(index, buffer.size());
+        paths.insert(paths.end(), name.begin(), name.end());
+        position = aligned + buffer.size();
+    }
+
+    uint64_t indexOffset = position;
+    uint64_t pathOffset = indexOffset + index.size();
+    out.write(index.data(), index.size());
+    out.write(paths.data(), paths.size());
+
+    header.clear();
+    WriteU32(header, Magic);
+    WriteU32(header, Version);
+    WriteU32(header, files.size());
+    WriteU32(header, 0);
+    WriteU64(header, indexOffset);
+    WriteU64(header, pathOffset);
+    WriteU64(header, paths.size());
+    WriteU64(header, pathOffset + paths.size());
+    out.seekp(0);
+    out.write(header.data(), header.size());
+
+    out.close();
+    if (!out)
+    {
+        LogError << "Failed to write " << realPath << Message();
+        return false;
+    }
+    return true;
+}
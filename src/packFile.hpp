@@ -0,0 +1,103 @@
+#pragma once
+#include <gbvfs.hpp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+class FileView;
+
+/*! \file packFile.hpp
+    \brief Single file archives of the read only data folders
+
+    All values are little-endian. The file starts with PackFile::Header,
+    followed by the data of every file, each starting at a multiple of
+    PackFile::Alignment bytes. After the data comes the index of
+    entryCount PackFile::Entry entries sorted by path, and the paths
+    themselves. The paths are virtual paths, such as
+    "assets/textures/tiles.png".
+*/
+namespace PackFile
+{
+    const uint32_t Magic = 0x4B415043;
+    const uint32_t Version = 1;
+    const uint32_t Alignment = 64;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t reserved;
+        uint64_t indexOffset;
+        uint64_t pathOffset;
+        uint64_t pathSize;
+        uint64_t fileSize;
+    };
+
+    struct Entry
+    {
+        //! Offset and length of the path within the paths
+        uint32_t pathOffset;
+        uint32_t pathLength;
+        uint64_t offset;
+        uint64_t size;
+    };
+
+    static_assert(sizeof(Header) == 48, "PackFile::Header must match the file layout");
+    static_assert(sizeof(Entry) == 24, "PackFile::Entry must match the file layout");
+
+    /*! \brief Write the files \p files of the VFS into \p realPath
+     *
+     * \p realPath is a path on the real file system. The files are
+     * stored with the paths they have in the VFS. Returns false if a
+     * file can't be read or the output can't be written.
+     */
+    bool Write(const std::string& realPath, std::vector<std::string> files);
+}
+
+/*! \brief GBVFS::Loader reading a memory mapped pack file
+ *
+ * The whole pack is mapped once, and the files opened from it read
+ * directly from the mapping without any further system calls. Mapping a
+ * file returns its place in the pack. Paths are looked up with a binary
+ * search in the sorted index, and the directories are the prefixes of the
+ * paths. The files are read only.
+ */
+class PackLoader : public GBVFS::Loader
+{
+    struct IndexEntry
+    {
+        std::string path;
+        const char* data;
+        size_t size;
+    };
+
+    std::shared_ptr<FileView> view;
+    std::vector<IndexEntry> entries;
+
+    //First entry with a path not less than \p path
+    std::vector<IndexEntry>::const_iterator lowerBound(const std::string& path) const;
+
+public:
+
+    /*! \brief Map and index the pack at \p realPath
+     *
+     * Returns false if the file can't be mapped or isn't a valid pack.
+     */
+    bool open(const std::string& realPath);
+
+    //! Get the directories at the root of the pack
+    std::vector<std::string> getRootDirectories() const;
+
+    //! Get the amount of files in the pack
+    size_t getFileCount() const {return entries.size();}
+
+    void iterateEntries(const GBVFS::PathView&, FileIteratorCallback fic) override;
+    GBVFS::FileEntry getFileEntry(const GBVFS::PathView&) override;
+    std::unique_ptr<GBVFS::File> openFile(const GBVFS::PathView&) override;
+    std::unique_ptr<GBVFS::FileWriter> openFileWrite(const GBVFS::PathView&) override;
+
+    PackLoader();
+    ~PackLoader();
+};
@@ -0,0 +1,47 @@
+#include "packer.hpp"
+#include "packFile.hpp"
+
+#include "fileOperations.hpp"
+#include "log.hpp"
+
+#include <sstream>
+
+
+void packerMain(ArgumentParser& args)
+{
+    VFS_Init(args);
+
+    //The output file on the real file system, followed by the VFS folders
+    std::string params;
+    args.getArgumentFullString("", "--make-pack", params);
+
+    std::stringstream sst(params);
+    std::string output;
+    sst >> output;
+
+    std::vector<std::string> folders;
+    std::string folder;
+    while (sst >> folder)
+        folders.push_back(folder);
+
+    if (folders.empty())
+        folders = {AssetsFolder, ControlScriptsFolder, ScriptsFolder, "static"};
+
+    if (output.empty())
+    {
+        LogError << "No output file given for the pack" << Message();
+    }
+    else
+    {
+        std::vector<std::string> files;
+        for (auto& f : folders)
+            GetFilesInDirectoryRecursive(f, "", files);
+
+        if (PackFile::Write(output, files))
+            Log << "Packed " << files.size() << " files to " << output << Trace(CHash("General"));
+        else
+            LogError << "Failed to write the pack " << output << Message();
+    }
+
+    VFS_Deinit();
+}
@@ -0,0 +1,5 @@
+#pragma once
+#include "argumentParser.hpp"
+
+//! Run engine as a packer of the read only data folders into a pack file
+extern void packerMain(ArgumentParser&);
@@ -0,0 +1,374 @@
+#include "textureAtlasBuilder.hpp"
+#include "graphics/textureAtlas.hpp"
+#include "graphics/cookedTexture.hpp"
+
+#include "fileOperations.hpp"
+#include "separatedFile.hpp"
+#include "log.hpp"
+
+#include <stb_image.h>
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <set>
+#include <sstream>
+
+
+//Pixels around every texture, repeating its edges, so that the neighbours don't bleed in
+static const int Padding = 2;
+
+//The null normal, see TextureMap::initializeDefaultTextures
+static const unsigned char NullNormal[4] = {128, 128, 255, 0};
+
+//! Packs rectangles into a page, placing each as high up as possible
+class Skyline
+{
+    struct Segment
+    {
+        int x;
+        int y;
+        int width;
+    };
+
+    Vector2i size;
+    std::vector<Segment> segments;
+
+public:
+
+    //! Find the place of a rectangle of \p dim, returns false if it doesn't fit
+    bool insert(Vector2i dim, Vector2i& position)
+    {
+        int bestBottom = INT_MAX;
+        size_t best = 0;
+        for (size_t i = 0; i < segments.size(); i++)
+        {
+            if (segments[i].x + dim.x > size.x)
+                break;
+
+            //The rectangle rests on the highest segment below it
+            int y = 0;
+            int left = dim.x;
+            for (size_t j = i; left > 0; j++)
+            {
+                y = std::max(y, segments[j].y);
+                left -= segments[j].width;
+            }
+
+            if (y + dim.y <= size.y && y + dim.y < bestBottom)
+            {
+                bestBottom = y + dim.y;
+                best = i;
+            }
+        }
+        if (bestBottom == INT_MAX)
+            return false;
+
+        position = Vector2i(segments[best].x, bestBottom - dim.y);
+
+        Segment s = {position.x, bestBottom, dim.x};
+        segments.insert(segments.begin() + best, s);
+
+        //Cut the segments the rectangle covers
+        size_t i = best + 1;
+        while (i < segments.size() && segments[i].x < s.x + s.width)
+        {
+            int cut = s.x + s.width - segments[i].x;
+            if (cut < segments[i].width)
+            {
+                segments[i].x += cut;
+                segments[i].width -= cut;
+                break;
+            }
+            segments.erase(segments.begin() + i);
+        }
+
+        for (i = 0; i + 1 < segments.size();)
+        {
+            if (segments[i].y == segments[i + 1].y)
+            {
+                segments[i].width += segments[i + 1].width;
+                segments.erase(segments.begin() + i + 1);
+            }
+            else
+                i++;
+        }
+        return true;
+    }
+
+    Skyline(Vector2i s) : size(s)
+    {
+        segments.push_back({0, 0, s.x});
+    }
+};
+
+struct AtlasTexture
+{
+    std::string name;
+    std::string filenamePrefix;
+    Vector2i dimensions;
+    bool normal = false;
+    bool specular = false;
+    TextureAtlas::Entry entry;
+};
+
+typedef std::unique_ptr<unsigned char, void(*)(void*)> Pixels;
+
+static Pixels Decode(const std::string& file, Vector2i& dim)
+{
+    int n;
+    auto view = MapFileContents(file);
+    if (!view)
+        return Pixels(nullptr, stbi_image_free);
+    return Pixels(stbi_load_from_memory((const unsigned char*)view->getData(), view->getSize(),
+        &dim.width, &dim.height, &n, 4), stbi_image_free);
+}
+
+//Get the dimensions of an image without decoding it, zero if it can't be read
+static Vector2i GetImageDimensions(const std::string& file)
+{
+    Vector2i dim(0, 0);
+    int n;
+    auto view = MapFileContents(file);
+    if (!view || !stbi_info_from_memory((const unsigned char*)view->getData(), view->getSize(), &dim.width, &dim.height, &n))
+        return Vector2i(0, 0);
+    return dim;
+}
+
+//Copy \p src to \p position of \p page, with Padding pixels repeating its edges
+static void Blit(std::vector<unsigned char>& page, Vector2i pageDim, const unsigned char* src, Vector2i dim, Vector2i position)
+{
+    for (int y = -Padding; y < dim.y + Padding; y++)
+    for (int x = -Padding; x < dim.x + Padding; x++)
+    {
+        int sx = std::min(std::max(x, 0), dim.x - 1);
+        int sy = std::min(std::max(y, 0), dim.y - 1);
+        size_t d = (size_t(position.y + y) * pageDim.x + position.x + x) * 4;
+        memcpy(&page[d], src + (size_t(sy) * dim.x + sx) * 4, 4);
+    }
+}
+
+//Check the files of a texture, returns false if it can't be put in the atlas
+static bool Prepare(AtlasTexture& t, Vector2i pageSize)
+{
+    t.dimensions = GetImageDimensions(GetTextureDiffuseFileName(t.filenamePrefix));
+    if (t.dimensions.x == 0 || t.dimensions.y == 0)
+    {
+        Log << "Can't read texture " << t.name << Trace(CHash("Warning"));
+        return false;
+    }
+
+    if (t.dimensions.x + Padding * 2 > pageSize.x || t.dimensions.y + Padding * 2 > pageSize.y)
+    {
+        Log << "Texture " << t.name << " doesn't fit in a page" << Trace(CHash("Warning"));
+        return false;
+    }
+
+    //The maps share the coordinates of the diffuse map
+    t.normal = FileExists(GetTextureNormalFileName(t.filenamePrefix));
+    t.specular = FileExists(GetTextureSpecularFileName(t.filenamePrefix));
+    if ((t.normal && GetImageDimensions(GetTextureNormalFileName(t.filenamePrefix)) != t.dimensions) ||
+        (t.specular && GetImageDimensions(GetTextureSpecularFileName(t.filenamePrefix)) != t.dimensions))
+    {
+        Log << "The maps of texture " << t.name << " differ in size" << Trace(CHash("Warning"));
+        return false;
+    }
+
+    TextureAtlas::HashSources(t.filenamePrefix, t.entry.sources);
+    TextureAtlas::StampSources(t.filenamePrefix, t.entry.stamps);
+    t.entry.dimensions = t.dimensions;
+    return true;
+}
+
+//Draw the textures of a page into its three channels
+static bool Compose(const std::vector<AtlasTexture*>& textures, Vector2i dim, std::vector<unsigned char> channels[3])
+{
+    size_t size = size_t(dim.x) * dim.y * 4;
+    channels[Texture::Diffuse].assign(size, 0);
+    channels[Texture::Specular].assign(size, 0);
+    channels[Texture::Normal].resize(size);
+    for (size_t i = 0; i < size; i += 4)
+        memcpy(&channels[Texture::Normal][i], NullNormal, 4);
+
+    for (auto t : textures)
+    {
+        Vector2i imageDim;
+        Pixels diffuse = Decode(GetTextureDiffuseFileName(t->filenamePrefix), imageDim);
+        if (!diffuse || imageDim != t->dimensions)
+        {
+            LogError << "Can't decode texture " << t->name << Message();
+            return false;
+        }
+        Blit(channels[Texture::Diffuse], dim, diffuse.get(), t->dimensions, t->entry.position);
+
+        //Like a texture loaded by itself, the diffuse map doubles as the specular one
+        Pixels specular(nullptr, stbi_image_free);
+        if (t->specular)
+            specular = Decode(GetTextureSpecularFileName(t->filenamePrefix), imageDim);
+        if (t->specular && (!specular || imageDim != t->dimensions))
+        {
+            LogError << "Can't decode the specular map of " << t->name << Message();
+            return false;
+        }
+        Blit(channels[Texture::Specular], dim, specular ? specular.get() : diffuse.get(), t->dimensions, t->entry.position);
+
+        if (t->normal)
+        {
+            Pixels normal = Decode(GetTextureNormalFileName(t->filenamePrefix), imageDim);
+            if (!normal || imageDim != t->dimensions)
+            {
+                LogError << "Can't decode the normal map of " << t->name << Message();
+                return false;
+            }
+            Blit(channels[Texture::Normal], dim, normal.get(), t->dimensions, t->entry.position);
+        }
+    }
+    return true;
+}
+
+void textureAtlasBuilderMain(ArgumentParser& args)
+{
+    VFS_Init(args);
+
+    //The size of the pages
+    std::string params;
+    args.getArgumentFullString("", "--make-atlas", params);
+
+    int size = 2048;
+    std::stringstream sst(params);
+    sst >> size;
+    size = std::min(std::max(size, 64), 16384);
+    Vector2i pageSize(size, size);
+
+    const std::string& cache = GetCacheDirectory();
+    if (cache.empty())
+    {
+        LogError << "No cache directory to make the atlas into, see --dir-cache" << Message();
+        VFS_Deinit();
+        return;
+    }
+
+    //The fonts compute the UVs of the glyphs themselves
+    std::set<std::string> fontTextures;
+    SeparatedFile fontFile = SeparatedFile::BatchLoad(AssetsFolder+"/def","font",':');
+    for (auto sr : fontFile.rows)
+        fontTextures.insert(sr.getString(1));
+
+    std::vector<AtlasTexture> textures;
+    std::set<std::string> names;
+    unsigned int leftOut = 0;
+    SeparatedFile textureFile = SeparatedFile::BatchLoad(AssetsFolder+"/def","tex",':');
+    for (auto sr : textureFile.rows)
+    {
+        //Like GraphicsData::define, the first definition is used
+        std::string name = sr.getString(0);
+        if (!names.insert(name).second)
+            continue;
+
+        if (fontTextures.count(name) || !sr.getInt(4,1))
+        {
+            leftOut++;
+            continue;
+        }
+
+        AtlasTexture t;
+        t.name = name;
+        t.filenamePrefix = AssetsFolder+"/"+sr.getString(1);
+        if (!Prepare(t, pageSize))
+        {
+            leftOut++;
+            continue;
+        }
+        textures.push_back(std::move(t));
+    }
+
+    //The tallest first leaves the fewest gaps
+    std::vector<AtlasTexture*> order;
+    for (auto& t : textures)
+        order.push_back(&t);
+    std::stable_sort(order.begin(), order.end(), [](const AtlasTexture* a, const AtlasTexture* b)
+    {
+        if (a->dimensions.y != b->dimensions.y)
+            return a->dimensions.y > b->dimensions.y;
+        return a->dimensions.x > b->dimensions.x;
+    });
+
+    std::vector<Skyline> skylines;
+    std::vector<std::vector<AtlasTexture*>> pageTextures;
+    std::vector<TextureAtlas::Page> pages;
+    for (auto t : order)
+    {
+        Vector2i padded = t->dimensions + Vector2i(Padding * 2, Padding * 2);
+        Vector2i position;
+        size_t page = 0;
+        while (page < skylines.size() && !skylines[page].insert(padded, position))
+            page++;
+
+        if (page == skylines.size())
+        {
+            skylines.push_back(Skyline(pageSize));
+            pageTextures.emplace_back();
+            pages.push_back(TextureAtlas::Page());
+            pages.back().dimensions = Vector2i(0, 0);
+            skylines.back().insert(padded, position);
+        }
+
+        t->entry.page = page;
+        t->entry.position = position + Vector2i(Padding, Padding);
+        pageTextures[page].push_back(t);
+
+        //The pages are cut to the area used
+        Vector2i& used = pages[page].dimensions;
+        used.x = std::max(used.x, position.x + padded.x);
+        used.y = std::max(used.y, position.y + padded.y);
+    }
+
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < pages.size(); i++)
+    {
+        std::vector<unsigned char> channels[3];
+        if (!Compose(pageTextures[i], pages[i].dimensions, channels))
+        {
+            VFS_Deinit();
+            return;
+        }
+
+        for (int c = 0; c < 3; c++)
+        {
+            std::string path = cache + TextureAtlas::GetPageFileName(i, Texture::Channel(c));
+            pages[i].hashes[c] = CookedTexture::HashContents((const char*)channels[c].data(), channels[c].size());
+            if (!CookedTexture::Write(path, channels[c].data(), pages[i].dimensions, pages[i].hashes[c]))
+            {
+                VFS_Deinit();
+                return;
+            }
+            bytes += channels[c].size();
+        }
+    }
+
+    //Remove the pages of an earlier, larger atlas
+    for (size_t i = pages.size(); ; i++)
+    {
+        if (std::remove((cache + TextureAtlas::GetPageFileName(i, Texture::Diffuse)).c_str()) != 0)
+            break;
+        std::remove((cache + TextureAtlas::GetPageFileName(i, Texture::Normal)).c_str());
+        std::remove((cache + TextureAtlas::GetPageFileName(i, Texture::Specular)).c_str());
+    }
+
+    std::vector<std::pair<std::string, TextureAtlas::Entry>> entries;
+    for (auto& t : textures)
+        entries.push_back(std::make_pair(t.name, t.entry));
+
+    if (!TextureAtlas::WriteIndex(cache + TextureAtlas::IndexFileName, pages, entries))
+    {
+        VFS_Deinit();
+        return;
+    }
+
+    Log << "Packed " << textures.size() << " textures into " << pages.size() << " atlas pages, "
+        << leftOut << " left out, " << (long long) (bytes / 1024) << " KB of pixels in " << cache << Message();
+
+    VFS_Deinit();
+}
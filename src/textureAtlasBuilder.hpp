@@ -0,0 +1,5 @@
+#pragma once
+#include "argumentParser.hpp"
+
+//! Run engine as a packer of the textures into the texture atlas, see textureAtlas.hpp
+extern void textureAtlasBuilderMain(ArgumentParser&);
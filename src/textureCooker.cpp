@@ -0,0 +1,129 @@
+#include "textureCooker.hpp"
+#include "graphics/cookedTexture.hpp"
+
+#include "fileOperations.hpp"
+#include "log.hpp"
+
+#include <stb_image.h>
+
+#include <chrono>
+#include <memory>
+#include <sstream>
+
+
+//Read every cache line, like the upload would
+static unsigned int TouchPixels(const std::vector<CookedTexture::LevelInfo>& levels)
+{
+    unsigned int sum = 0;
+    for (auto& level : levels)
+    {
+        size_t size = size_t(level.dimensions.x) * level.dimensions.y * 4;
+        for (size_t i = 0; i < size; i += 64)
+            sum += level.pixels[i];
+    }
+    return sum;
+}
+
+void textureCookerMain(ArgumentParser& args)
+{
+    VFS_Init(args);
+
+    //The VFS folders to cook, the assets by default
+    std::string params;
+    args.getArgumentFullString("", "--cook-textures", params);
+
+    std::stringstream sst(params);
+    std::vector<std::string> folders;
+    std::string folder;
+    while (sst >> folder)
+        folders.push_back(folder);
+
+    if (folders.empty())
+        folders = {AssetsFolder};
+
+    const std::string& cache = GetCacheDirectory();
+    if (cache.empty())
+    {
+        LogError << "No cache directory to cook the textures into, see --dir-cache" << Message();
+        VFS_Deinit();
+        return;
+    }
+
+    std::vector<std::string> files;
+    for (auto& f : folders)
+        GetFilesInDirectoryRecursive(f, "png", files);
+
+    typedef std::chrono::high_resolution_clock Clock;
+    std::chrono::duration<double, std::milli> decodeTime(0), cookedTime(0);
+    unsigned int cooked = 0, upToDate = 0, failed = 0;
+    uint64_t bytes = 0;
+    volatile unsigned int checksum = 0;
+
+    for (auto& name : files)
+    {
+        auto view = MapFileContents(name);
+        if (!view)
+        {
+            failed++;
+            continue;
+        }
+
+        uint64_t hash = CookedTexture::HashContents(view->getData(), view->getSize());
+        std::string path = cache + CookedTexture::GetFileName(hash);
+
+        //Time both ways of loading for the comparison
+        auto start = Clock::now();
+        Vector2i dim;
+        int n;
+        std::unique_ptr<unsigned char, void(*)(void*)> pixels(stbi_load_from_memory(
+            (const unsigned char*)view->getData(), view->getSize(), &dim.width, &dim.height, &n, 4), stbi_image_free);
+        decodeTime += Clock::now() - start;
+
+        if (!pixels)
+        {
+            Log << "Can't decode " << name << Trace(CHash("Warning"));
+            failed++;
+            continue;
+        }
+
+        std::vector<CookedTexture::LevelInfo> levels;
+        start = Clock::now();
+        auto existing = MapRealFileContents(path);
+        bool valid = existing && CookedTexture::Parse(existing->getData(), existing->getSize(), hash, levels);
+        if (valid)
+        {
+            checksum += TouchPixels(levels);
+            cookedTime += Clock::now() - start;
+            bytes += existing->getSize();
+            upToDate++;
+            continue;
+        }
+        existing.reset();
+
+        if (!CookedTexture::Write(path, pixels.get(), dim, hash))
+        {
+            failed++;
+            continue;
+        }
+
+        start = Clock::now();
+        existing = MapRealFileContents(path);
+        if (!existing || !CookedTexture::Parse(existing->getData(), existing->getSize(), hash, levels))
+        {
+            LogError << "Failed to read back " << path << Message();
+            failed++;
+            continue;
+        }
+        checksum += TouchPixels(levels);
+        cookedTime += Clock::now() - start;
+        bytes += existing->getSize();
+        cooked++;
+    }
+
+    Log << "Cooked " << cooked << " textures, " << upToDate << " up to date, " << failed << " failed, "
+        << (long long) (bytes / 1024) << " KB in " << cache << Trace(CHash("General"));
+    Log << "Decoding the images took " << decodeTime.count() << " ms, reading the cooked textures "
+        << cookedTime.count() << " ms" << Message();
+
+    VFS_Deinit();
+}
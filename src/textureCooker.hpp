@@ -0,0 +1,5 @@
+#pragma once
+#include "argumentParser.hpp"
+
+//! Run engine as a cooker of the images in the assets into the cache
+extern void textureCookerMain(ArgumentParser&);
@@ -424,16 +424,14 @@ void Window::setWindowIcon(const std::vector<std::string>& fnames)
 
     for (auto& fname : fnames)
     {
-        size_t len;
-        char* fdata = GetFileContentsCopy(fname, &len);
+        auto fdata = MapFileContents(fname);
         if (fdata)
         {
             int n;
             int w;
             int h;
             unsigned char *data = nullptr;
-            data = stbi_load_from_memory((unsigned char*)fdata, len, &w, &h, &n, 4);
-            delete[] fdata;
+            data = stbi_load_from_memory((const unsigned char*)fdata->getData(), fdata->getSize(), &w, &h, &n, 4);
 
             if (data)
             {
@@ -0,0 +1,155 @@
+#include "workerPool.hpp"
+
+WorkerPool::WorkerPool(unsigned int count)
+{
+    setThreadCount(count);
+}
+
+WorkerPool::~WorkerPool()
+{
+    stopThreads();
+}
+
+unsigned int WorkerPool::getHardwareThreads()
+{
+    unsigned int c = std::thread::hardware_concurrency();
+    if (c == 0)
+        return 1;
+    return c;
+}
+
+void WorkerPool::stopThreads()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workCv.notify_all();
+    for (auto& t : threads)
+        t.join();
+    threads.clear();
+    stopping = false;
+}
+
+void WorkerPool::setThreadCount(unsigned int count)
+{
+    if (count == threads.size())
+        return;
+
+    stopThreads();
+    for (unsigned int i = 0; i < count; i++)
+        threads.push_back(std::thread(&WorkerPool::workerMain, this));
+}
+
+void WorkerPool::runChunks(std::unique_lock<std::mutex>& lock)
+{
+    while (nextChunk < jobChunks)
+    {
+        size_t chunk = nextChunk++;
+        size_t begin = jobCount * chunk / jobChunks;
+        size_t end = jobCount * (chunk + 1) / jobChunks;
+
+        lock.unlock();
+        job(begin, end, chunk);
+        lock.lock();
+
+        chunksDone++;
+        if (chunksDone == jobChunks)
+            doneCv.notify_all();
+    }
+}
+
+void WorkerPool::workerMain()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true)
+    {
+        workCv.wait(lock, [this]()
+        {
+            return stopping || nextChunk < jobChunks || !tasks.empty();
+        });
+
+        if (stopping)
+            return;
+
+        if (nextChunk < jobChunks)
+        {
+            runChunks(lock);
+            continue;
+        }
+
+        Task task = std::move(tasks.front());
+        tasks.pop_front();
+        tasksRunning++;
+
+        lock.unlock();
+        task();
+        lock.lock();
+
+        tasksRunning--;
+        if (tasks.empty() && tasksRunning == 0)
+            doneCv.notify_all();
+    }
+}
+
+void WorkerPool::submit(Task task)
+{
+    if (threads.empty())
+    {
+        task();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push_back(std::move(task));
+    }
+    workCv.notify_one();
+}
+
+void WorkerPool::waitTasks()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    doneCv.wait(lock, [this]()
+    {
+        return tasks.empty() && tasksRunning == 0;
+    });
+}
+
+void WorkerPool::parallelFor(size_t count, size_t chunks, const RangeJob& j)
+{
+    if (count == 0)
+        return;
+
+    if (chunks > count)
+        chunks = count;
+    if (chunks == 0)
+        chunks = 1;
+
+    if (threads.empty() || chunks <= 1)
+    {
+        for (size_t i = 0; i < chunks; i++)
+            j(count * i / chunks, count * (i + 1) / chunks, i);
+        return;
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    job = j;
+    jobCount = count;
+    jobChunks = chunks;
+    nextChunk = 0;
+    chunksDone = 0;
+    workCv.notify_all();
+
+    runChunks(lock);
+    doneCv.wait(lock, [this]()
+    {
+        return chunksDone == jobChunks;
+    });
+
+    job = RangeJob();
+    jobCount = 0;
+    jobChunks = 0;
+    nextChunk = 0;
+    chunksDone = 0;
+}
@@ -0,0 +1,90 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <vector>
+#include <deque>
+
+/*! \brief A small pool of persistent worker threads
+ *
+ * Used for splitting data parallel work over multiple cores. The work is
+ * divided into chunks, and every chunk is processed exactly once by
+ * either a worker thread or the calling thread. The chunk index is passed
+ * to the job, so that the results can be gathered in a deterministic order
+ * regardless of which thread processed the chunk.
+ *
+ * Independent background tasks can be queued as well. The workers run
+ * them when there are no parallelFor chunks to process.
+ *
+ * The jobs must not touch AngelScript or Lua state.
+ */
+class WorkerPool
+{
+public:
+    //! Job type: begin index, end index (exclusive) and chunk index
+    typedef std::function<void(size_t, size_t, size_t)> RangeJob;
+
+    //! Background task type
+    typedef std::function<void()> Task;
+
+private:
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable workCv;
+    std::condition_variable doneCv;
+
+    RangeJob job;
+    size_t jobCount = 0;
+    size_t jobChunks = 0;
+    size_t nextChunk = 0;
+    size_t chunksDone = 0;
+    bool stopping = false;
+
+    std::deque<Task> tasks;
+    size_t tasksRunning = 0;
+
+    void workerMain();
+    void runChunks(std::unique_lock<std::mutex>& lock);
+    void stopThreads();
+
+public:
+
+    //! Get the amount of worker threads, not counting the calling thread
+    unsigned int getThreadCount() {return threads.size();}
+
+    //! Set the amount of worker threads. Must not be called during parallelFor
+    void setThreadCount(unsigned int count);
+
+    /*! \brief Process the range [0, count) in chunks
+
+        Blocks until all the chunks have been processed. The calling
+        thread processes chunks as well. If the pool has no threads or
+        chunks is 1, the job is run directly on the calling thread.
+
+        \param count size of the range
+        \param chunks amount of chunks the range is divided into
+        \param job function called for every chunk
+    */
+    void parallelFor(size_t count, size_t chunks, const RangeJob& job);
+
+    /*! \brief Queue a task to be run by a worker thread
+
+        Returns immediately. If the pool has no threads, the task is run
+        directly on the calling thread. The tasks still queued when the
+        pool is destroyed are discarded.
+    */
+    void submit(Task task);
+
+    //! Blocks until all the queued tasks have been run
+    void waitTasks();
+
+    //! Returns the amount of hardware threads, at least 1
+    static unsigned int getHardwareThreads();
+
+    //! Constructor
+    WorkerPool(unsigned int count = 0);
+
+    //! Destructor, joins the threads
+    ~WorkerPool();
+};